@@ -3,23 +3,27 @@
 #include "../../../Engine/Serializer/SceneSerializer.h"
 #include "../../../Engine/ImGui/Editor/EditorManager.h" 
 #include "../../../Engine/ECS/Entity/EntityManager.h"
+#include "../../../Engine/Scene/WorldPartition/WorldStreamer.h"
 
 void BaseScene::Init()
 {
 	if (m_name.empty()) return;
 
 	std::string path = "Asset/Data/Scene/" + m_name + ".json";
-	std::vector<std::shared_ptr<Entity>> loadedEntities;
 
 	std::shared_ptr<CameraBase> cam = nullptr;
 
-	if (SceneSerializer::Load(path, loadedEntities, cam))
+	// ワールドパーティションがあれば常駐するエンティティだけを読む (セルは WorldStreamer が読む)
+	if (WorldStreamer::Instance().Begin(path))
 	{
-		for (auto& entity : loadedEntities)
-		{
-			EntityManager::Instance().AddEntity(entity);
-		}
+		path = WorldPartition::GetPersistentPath(path);
 	}
+
+	// 読めたエンティティから追加待ちに入れる (シーン全体を読み終わるのを待たない)
+	SceneSerializer::LoadStreaming(path, [](std::vector<std::shared_ptr<Entity>>& batch)
+		{
+			EntityManager::Instance().AddEntities(batch);
+		}, cam);
 }
 
 void BaseScene::Release()
@@ -4,7 +4,7 @@
 #include "Scene/GameScene/GameScene.h"
 #include "Scene/ResultScene/ResultScene.h"
 
-int WINAPI WinMain(_In_ HINSTANCE, _In_opt_  HINSTANCE, _In_ LPSTR, _In_ int)
+int WINAPI WinMain(_In_ HINSTANCE, _In_opt_  HINSTANCE, _In_ LPSTR lpCmdLine, _In_ int)
 {
 	// メモリリークを知らせる
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -21,6 +21,16 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_  HINSTANCE, _In_ LPSTR, _In_ int)
 	// ImGuiとファイルシステムの整合性を保つためUTF-8に変更
 	setlocale(LC_ALL, ".UTF8");
 
+	// "-cook" … アセットの事前変換だけを行って終了する ("-force" でテクスチャを全て変換し直す)
+	if (lpCmdLine && strstr(lpCmdLine, "-cook"))
+	{
+		int result = Engine::Instance().RunCooker(strstr(lpCmdLine, "-force") != nullptr);
+
+		CoUninitialize();
+
+		return result;
+	}
+
 	//===================================================================
 	// 実行
 	//===================================================================
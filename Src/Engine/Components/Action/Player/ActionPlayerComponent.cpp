@@ -1,6 +1,7 @@
 ﻿#include "ActionPlayerComponent.h"
 #include "../../../../Application/GameObject/Camera/FPSCamera/FPSCamera.h"
 #include "../../../../Application/GameObject/Camera/TPSCamera/TPSCamera.h"
+#include "../../../ECS/Component/Reflection/ComponentReflection.h"
 
 void ActionPlayerComponent::Init()
 {
@@ -162,9 +163,7 @@ void ActionPlayerComponent::DrawInspector()
 {
     if (ImGui::CollapsingHeader("Action Player", ImGuiTreeNodeFlags_DefaultOpen))
     {
-        ImGui::DragFloat("Speed", &m_speed, 0.1f);
-        ImGui::DragFloat("Jump Power", &m_jumpPower, 0.1f);
-        ImGui::DragFloat("Gravity", &m_gravity, 0.01f);
+        if (ComponentReflection::DrawInspector(*this)) { MarkDirty(); }
         
         ImGui::Text("Is Ground: %s", m_isGround ? "True" : "False");
     }
@@ -172,19 +171,22 @@ void ActionPlayerComponent::DrawInspector()
 
 void ActionPlayerComponent::Serialize(nlohmann::json& outJson) const
 {
-	outJson = nlohmann::json
-	{
-		{ "Speed",     m_speed },
-		{ "JumpPower", m_jumpPower },
-		{ "Gravity",   m_gravity }
-	};
+	ComponentReflection::Serialize(*this, outJson);
 }
 
 void ActionPlayerComponent::Deserialize(const nlohmann::json& inJson)
 {
-	m_speed     = inJson.value("Speed", m_speed);
-	m_jumpPower = inJson.value("JumpPower", m_jumpPower);
-	m_gravity   = inJson.value("Gravity", m_gravity);
+	ComponentReflection::Deserialize(*this, inJson);
+}
+
+const SceneComponentSchema* ActionPlayerComponent::GetBinarySchema() const
+{
+	return ComponentReflection::GetBinarySchema<ActionPlayerComponent>();
+}
+
+void ActionPlayerComponent::DeserializeBinary(SceneBinaryReader& reader)
+{
+	ComponentReflection::DeserializeBinary(*this, reader);
 }
 
 std::shared_ptr<CameraBase> ActionPlayerComponent::GetCamera() const
@@ -22,9 +22,21 @@ public:
 	// Serialization
 	void Serialize(nlohmann::json& j) const override;
 	void Deserialize(const nlohmann::json& j) override;
+	const SceneComponentSchema* GetBinarySchema() const override;
+	void DeserializeBinary(SceneBinaryReader& reader) override;
 
 	const char* GetType() const override { return "ActionPlayer"; }
 
+	// 保存するフィールド (ComponentField.h)
+	static constexpr uint32_t kFieldVersion = 1;
+	static constexpr auto GetFields()
+	{
+		return std::make_tuple(
+			ComponentField("Speed",     &ActionPlayerComponent::m_speed,     0.1f),
+			ComponentField("JumpPower", &ActionPlayerComponent::m_jumpPower, 0.1f),
+			ComponentField("Gravity",   &ActionPlayerComponent::m_gravity,   0.01f));
+	}
+
 	// Camera Control
 	void SetCameraActive(bool active) { m_isCameraActive = active; }
 	std::shared_ptr<CameraBase> GetCamera() const;
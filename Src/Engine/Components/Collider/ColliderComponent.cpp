@@ -1,5 +1,6 @@
 ﻿#include "ColliderComponent.h"
-#include "../../Serializer/JsonUtils.h"
+#include "../../ECS/Component/Reflection/ComponentReflection.h"
+#include "../../Core/Thread/Profiler/Profiler.h"
 
 using json = nlohmann::json;
 
@@ -73,10 +74,27 @@ void ColliderComponent::RegisterShape()
     }
 }
 
+bool ColliderComponent::Intersects(const KdCollider::RayInfo& target, std::list<KdCollider::CollisionResult>* pResults) const
+{
+    if (!m_collider || !m_enable) return false;
+
+    // 判定結果のリストなど、当たり判定で発生する確保を集計する
+    PROFILE_ALLOC_TAG("Collision");
+
+    std::shared_ptr<Entity> spOwner = GetOwner();
+    if (spOwner)
+    {
+         return m_collider->Intersects(target, spOwner->GetMatrix(), pResults);
+    }
+    return false;
+}
+
 void ColliderComponent::DrawDebug()
 {
     if (!m_enable || !m_debugDraw) return;
 
+    PROFILE_ALLOC_TAG("DebugDraw");
+
     // Get Owner's World Matrix
     Math::Matrix worldMat = GetOwner()->GetMatrix();
 
@@ -105,39 +123,23 @@ void ColliderComponent::DrawDebug()
 
 void ColliderComponent::Serialize(json& j) const
 {
-	j = json{
-		{ "Enable",         m_enable },
-		{ "DebugDraw",      m_debugDraw },
-		{ "CollisionType",  m_collisionType },
-		
-		{ "EnableSphere",   m_enableSphere },
-		{ "SphereRadius",   m_sphereRadius },
-		
-		{ "EnableBox",      m_enableBox },
-		{ "BoxExtents",     m_boxExtents },
-		
-		{ "EnableModel",    m_enableModel },
-		
-		{ "Offset",         m_offset }
-	};
+	ComponentReflection::Serialize(*this, j);
 }
 
 void ColliderComponent::Deserialize(const json& j)
 {
-	// 値取り出し。無ければ初期値(または現状維持)
-	m_enable			= j.value("Enable", m_enable);
-	m_debugDraw			= j.value("DebugDraw", m_debugDraw);
-	m_collisionType		= j.value("CollisionType", m_collisionType);
-
-	m_enableSphere		= j.value("EnableSphere", m_enableSphere);
-	m_sphereRadius		= j.value("SphereRadius", m_sphereRadius);
-
-	m_enableBox			= j.value("EnableBox", m_enableBox);
-	m_boxExtents		= j.value("BoxExtents", m_boxExtents); // Uses JsonUtils
-
-	m_enableModel		= j.value("EnableModel", m_enableModel);
+	// 無いキーは現状維持
+	ComponentReflection::Deserialize(*this, j);
+	m_isDirty = true;
+}
 
-	m_offset			= j.value("Offset", m_offset); // Uses JsonUtils
+const SceneComponentSchema* ColliderComponent::GetBinarySchema() const
+{
+	return ComponentReflection::GetBinarySchema<ColliderComponent>();
+}
 
+void ColliderComponent::DeserializeBinary(SceneBinaryReader& reader)
+{
+	ComponentReflection::DeserializeBinary(*this, reader);
 	m_isDirty = true;
 }
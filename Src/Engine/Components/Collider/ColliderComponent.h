@@ -10,52 +10,60 @@ public:
 	void Update() override; 
     void DrawDebug() override;       
 
-    void SetEnableSphere(bool enable)					 { m_enableSphere = enable; m_isDirty = true; }
+    void SetEnableSphere(bool enable)					 { m_enableSphere = enable; m_isDirty = true; MarkDirty(); }
     bool GetEnableSphere() const						 { return m_enableSphere; }
 
-    void SetEnableBox(bool enable)						 { m_enableBox = enable; m_isDirty = true; }
+    void SetEnableBox(bool enable)						 { m_enableBox = enable; m_isDirty = true; MarkDirty(); }
     bool GetEnableBox() const							 { return m_enableBox; }
 
-    void SetEnableModel(bool enable)					 { m_enableModel = enable; m_isDirty = true; }
+    void SetEnableModel(bool enable)					 { m_enableModel = enable; m_isDirty = true; MarkDirty(); }
     bool GetEnableModel() const							 { return m_enableModel; }
 
     // スフィア
-    void SetSphereRadius(float radius)					 { m_sphereRadius = radius; m_isDirty = true; }
+    void SetSphereRadius(float radius)					 { m_sphereRadius = radius; m_isDirty = true; MarkDirty(); }
     float GetSphereRadius() const						 { return m_sphereRadius; }
 
     // AABB
-    void SetBoxExtents(const Math::Vector3& extents)	 { m_boxExtents = extents; m_isDirty = true; }
+    void SetBoxExtents(const Math::Vector3& extents)	 { m_boxExtents = extents; m_isDirty = true; MarkDirty(); }
     const Math::Vector3& GetBoxExtents() const			 { return m_boxExtents; }
 
-    void SetOffset(const Math::Vector3& offset)			 { m_offset = offset; m_isDirty = true; }
+    void SetOffset(const Math::Vector3& offset)			 { m_offset = offset; m_isDirty = true; MarkDirty(); }
     const Math::Vector3& GetOffset() const				 { return m_offset; }
 
-    void SetEnable(bool enable)							 { m_enable = enable; }
+    void SetEnable(bool enable)							 { m_enable = enable; MarkDirty(); }
     bool IsEnable() const								 { return m_enable; }
 
-    void SetDebugDrawEnabled(bool enable)				 { m_debugDraw = enable; }
+    void SetDebugDrawEnabled(bool enable)				 { m_debugDraw = enable; MarkDirty(); }
     bool IsDebugDrawEnabled() const						 { return m_debugDraw; }
 		
-    void SetCollisionType(UINT type)					 { m_collisionType = type; m_isDirty = true; }
+    void SetCollisionType(UINT type)					 { m_collisionType = type; m_isDirty = true; MarkDirty(); }
     UINT GetCollisionType() const						 { return m_collisionType; }
 
-    bool Intersects(const KdCollider::RayInfo& target, std::list<KdCollider::CollisionResult>* pResults) const
-    {
-        if (!m_collider || !m_enable) return false;
-        
-        std::shared_ptr<Entity> spOwner = GetOwner();
-        if (spOwner)
-        {
-             return m_collider->Intersects(target, spOwner->GetMatrix(), pResults);
-        }
-        return false;
-    }
+    bool Intersects(const KdCollider::RayInfo& target, std::list<KdCollider::CollisionResult>* pResults) const;
 
 	void Serialize(nlohmann::json& j) const override;
 	void Deserialize(const nlohmann::json& j) override;
+	const SceneComponentSchema* GetBinarySchema() const override;
+	void DeserializeBinary(SceneBinaryReader& reader) override;
 
 	const char* GetType() const override { return "Collider"; }
 
+	// 保存するフィールド (ComponentField.h)
+	static constexpr uint32_t kFieldVersion = 1;
+	static constexpr auto GetFields()
+	{
+		return std::make_tuple(
+			ComponentField("Enable",        &ColliderComponent::m_enable),
+			ComponentField("DebugDraw",     &ColliderComponent::m_debugDraw),
+			ComponentField("CollisionType", &ColliderComponent::m_collisionType),
+			ComponentField("EnableSphere",  &ColliderComponent::m_enableSphere),
+			ComponentField("SphereRadius",  &ColliderComponent::m_sphereRadius, 0.1f, 0.0f, FLT_MAX),
+			ComponentField("EnableBox",     &ColliderComponent::m_enableBox),
+			ComponentField("BoxExtents",    &ColliderComponent::m_boxExtents, 0.1f, 0.0f, FLT_MAX),
+			ComponentField("EnableModel",   &ColliderComponent::m_enableModel),
+			ComponentField("Offset",        &ColliderComponent::m_offset, 0.1f));
+	}
+
 private:
 	void RegisterShape(); 
 
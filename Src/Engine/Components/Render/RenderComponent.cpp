@@ -1,4 +1,6 @@
 ﻿#include "RenderComponent.h"
+#include "../../Core/Thread/Asset/ModelLodStreamer.h"
+#include "../../ECS/Component/Reflection/ComponentReflection.h"
 
 using json = nlohmann::json;
 
@@ -15,14 +17,19 @@ void RenderComponent::DrawLit()
 	{
 		if (auto transform = owner->GetComponent<TransformComponent>())
 		{
+			// 画面上の大きさに応じて細かいLODを読み込んでもらう (1フレームに1回)
+			ModelLodStreamer& lodStreamer = ModelLodStreamer::Instance();
+			if (m_lodRequestFrame != lodStreamer.GetFrame())
+			{
+				m_lodRequestFrame = lodStreamer.GetFrame();
+				lodStreamer.Request(m_modelData, transform->GetWorldMatrix());
+			}
+
 			if(m_modelWork)
 			{
-				// 非同期ロードでモデルデータの中身が入れ替わった場合、
-				// Work側のノードリストとサイズが合わなくなるので再セットアップする
-				if (m_modelWork->GetNodes().size() != m_modelWork->GetDataNodes().size())
-				{
-					m_modelWork->SetModelData(m_modelWork->GetData());
-				}
+				// 非同期ロード・ホットリロードでモデルデータの中身が入れ替わった場合、
+				// Work側のノードリストが合わなくなるので再セットアップする
+				m_modelWork->SyncModelData();
 
 				KdShaderManager::Instance().m_StandardShader.DrawModel(*m_modelWork, transform->GetWorldMatrix());
 			}
@@ -38,6 +45,7 @@ void RenderComponent::DrawLit()
 void RenderComponent::SetModel(const std::string& filePath)
 {
 	m_filePath = filePath;
+	MarkDirty();
     
     if (filePath.empty())
     {
@@ -59,23 +67,22 @@ void RenderComponent::SetModel(const std::string& filePath)
 
 void RenderComponent::Serialize(json& j) const
 {
-	j = json{
-		{ "ModelPath", m_filePath },
-		{ "IsDynamic", m_isDynamic }
-	};
+	ComponentReflection::Serialize(*this, j);
 }
 
 void RenderComponent::Deserialize(const json& j)
 {
-	std::string path = j.value("ModelPath", "");
-	bool isDynamic   = j.value("IsDynamic", false);
+	ComponentReflection::Deserialize(*this, j);
+	SetModel(m_filePath);
+}
 
-	if (isDynamic)
-	{
-		SetModelWork(path);
-	}
-	else
-	{
-		SetModelData(path);
-	}
+const SceneComponentSchema* RenderComponent::GetBinarySchema() const
+{
+	return ComponentReflection::GetBinarySchema<RenderComponent>();
+}
+
+void RenderComponent::DeserializeBinary(SceneBinaryReader& reader)
+{
+	ComponentReflection::DeserializeBinary(*this, reader);
+	SetModel(m_filePath);
 }
@@ -32,12 +32,27 @@ public:
 
 	void Serialize(nlohmann::json& j) const override;
 	void Deserialize(const nlohmann::json& j) override;
+	const SceneComponentSchema* GetBinarySchema() const override;
+	void DeserializeBinary(SceneBinaryReader& reader) override;
 
 	const char* GetType() const override { return "Render"; }
 
+	// 保存するフィールド (ComponentField.h)
+	// 読み込んだ後に SetModel し直す
+	static constexpr uint32_t kFieldVersion = 1;
+	static constexpr auto GetFields()
+	{
+		return std::make_tuple(
+			ComponentField("ModelPath", &RenderComponent::m_filePath),
+			ComponentField("IsDynamic", &RenderComponent::m_isDynamic));
+	}
+
 private:
 	std::shared_ptr<KdModelWork> m_modelWork;
 	std::shared_ptr<KdModelData> m_modelData;
 	std::string m_filePath;
 	bool m_isDynamic = false;
+
+	// 最後に ModelLodStreamer に画面上の大きさを報告したフレーム
+	uint64_t m_lodRequestFrame = 0;
 };
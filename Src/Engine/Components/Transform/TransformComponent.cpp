@@ -1,5 +1,5 @@
 ﻿#include "TransformComponent.h"
-#include "../../Serializer/JsonUtils.h"
+#include "../../ECS/Component/Reflection/ComponentReflection.h"
 
 using json = nlohmann::json;
 
@@ -17,18 +17,27 @@ const Math::Matrix& TransformComponent::GetWorldMatrix()
 	return m_worldMatrix;
 }
 
+void TransformComponent::DrawInspector()
+{
+	if (ComponentReflection::DrawInspector(*this)) { MarkDirty(); }
+}
+
 void TransformComponent::Serialize(json& j) const
 {
-	j = json{
-		{ "Position", m_position },
-		{ "Rotation", m_rotation },
-		{ "Scale",    m_scale }
-	};
+	ComponentReflection::Serialize(*this, j);
 }
 
 void TransformComponent::Deserialize(const json& j)
 {
-	m_position = j.value("Position", Math::Vector3::Zero);
-	m_rotation = j.value("Rotation", Math::Vector3::Zero);
-	m_scale    = j.value("Scale",    Math::Vector3::One);
+	ComponentReflection::Deserialize(*this, j);
+}
+
+const SceneComponentSchema* TransformComponent::GetBinarySchema() const
+{
+	return ComponentReflection::GetBinarySchema<TransformComponent>();
+}
+
+void TransformComponent::DeserializeBinary(SceneBinaryReader& reader)
+{
+	ComponentReflection::DeserializeBinary(*this, reader);
 }
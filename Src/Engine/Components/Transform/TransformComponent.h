@@ -7,9 +7,9 @@ public:
 	~TransformComponent() override {}
 
 	// --- Accessors ---
-	void SetPosition(const Math::Vector3& pos) { m_position = pos; }
-	void SetRotation(const Math::Vector3& rot) { m_rotation = rot; }
-	void SetScale(const Math::Vector3& scale)  { m_scale = scale; }
+	void SetPosition(const Math::Vector3& pos) { m_position = pos; MarkDirty(); }
+	void SetRotation(const Math::Vector3& rot) { m_rotation = rot; MarkDirty(); }
+	void SetScale(const Math::Vector3& scale)  { m_scale = scale; MarkDirty(); }
 
 	const Math::Vector3& GetPosition() const { return m_position; }
 	const Math::Vector3& GetRotation() const { return m_rotation; }
@@ -20,9 +20,23 @@ public:
 
 	void Serialize(nlohmann::json& j) const override;
 	void Deserialize(const nlohmann::json& j) override;
+	const SceneComponentSchema* GetBinarySchema() const override;
+	void DeserializeBinary(SceneBinaryReader& reader) override;
+
+	void DrawInspector() override;
 
 	const char* GetType() const override { return "Transform"; }
 
+	// 保存するフィールド (ComponentField.h)
+	static constexpr uint32_t kFieldVersion = 1;
+	static constexpr auto GetFields()
+	{
+		return std::make_tuple(
+			ComponentField("Position", &TransformComponent::m_position, 0.1f),
+			ComponentField("Rotation", &TransformComponent::m_rotation, 0.1f),
+			ComponentField("Scale",    &TransformComponent::m_scale,    0.1f));
+	}
+
 private:
 	Math::Vector3 m_position = Math::Vector3::Zero;
 	Math::Vector3 m_rotation = Math::Vector3::Zero; // Degrees
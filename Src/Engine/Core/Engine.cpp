@@ -3,11 +3,17 @@
 #include "../ImGui/ImGuiManager.h"
 #include "Thread/ThreadManager.h"
 #include "Thread/Asset/AsyncAssetLoader.h"
+#include "Thread/Asset/AssetHotReloader.h"
+#include "Thread/Asset/ModelLodStreamer.h"
 #include "Thread/Profiler/Profiler.h"
 #include "../../Application/main.h"
 #include "../ECS/Entity/EntityManager.h"
 #include "../Render/Renderer.h"
 #include "../ECS/Component/Factory/ComponentFactory.h"
+#include "../Serializer/SceneBinary.h"
+#include "../Serializer/SceneSaver.h"
+#include "../Scene/WorldPartition/WorldStreamer.h"
+#include "../../Framework/Direct3D/KdGLTFLoader.h"
 
 bool Engine::Init(int width, int height)
 {
@@ -63,12 +69,30 @@ bool Engine::Init(int width, int height)
 	// オーディオ初期化
 	KdAudioManager::Instance().Init();
 
+	// 派生データキャッシュ初期化 (変換済みモデル・ミップ付きテクスチャの保存先)
+	KdDerivedDataCache::Instance().Init();
+
 	// スレッドプール初期化
 	ThreadManager::Instance().Init();
+
+	// Framework側の並列処理 (glTFの読み込みなど) もスレッドプールで実行する
+	KdParallel::Instance().SetDispatcher([](std::function<void()> func)
+	{
+		ThreadManager::Instance().AddJob(std::move(func));
+	}, (int)ThreadManager::Instance().GetWorkerCount());
+
+	// モデル読み込みのログ (メッシュ最適化の結果など) をログウィンドウに出す
+	KdSetImportLog([](const std::string& msg) { Logger::Log("Import", msg); });
+
+	// パックファイルがあればマウント (無ければ Asset フォルダのファイルをそのまま読む)
+	KdFileSystem::Instance().Mount("Asset.kdpak");
 	
 	// 非同期ローダー初期化
 	AsyncAssetLoader::Instance().Init();
 
+	// アセットのホットリロード (Assetフォルダの監視開始)
+	AssetHotReloader::Instance().Init("Asset");
+
 	// コンポーネントファクトリ初期化 (これがないとロード時にコンポーネントが生成されない)
 	InitComponentFactory();
 
@@ -84,6 +108,11 @@ bool Engine::Init(int width, int height)
 		return AsyncAssetLoader::Instance().LoadModelAsync(filename);
 	});
 
+	// アセットのメモリ予算 (超えたら参照されていないものから解放される)
+	KdAssets::Instance().SetBudget(KdAssetCategory::Texture, 1024ull * 1024 * 1024);
+	KdAssets::Instance().SetBudget(KdAssetCategory::Mesh, 512ull * 1024 * 1024);
+	KdAssets::Instance().SetBudget(KdAssetCategory::Animation, 128ull * 1024 * 1024);
+
 	return true;
 }
 
@@ -124,6 +153,10 @@ void Engine::Execute()
 	KdFPSController fpsCtrl;
 	fpsCtrl.Init();
 
+	Profiler::Instance().SetThreadName("Main Thread");
+	// 目標フレーム時間の2倍を超えたらヒッチとして直近のフレームをダンプする
+	Profiler::Instance().SetHitchThreshold(2.0f * 1000.0f / (float)fpsCtrl.m_maxFps);
+
 	while (true)
 	{
 		Profiler::Instance().ResetFrame();
@@ -173,17 +206,66 @@ void Engine::Execute()
 		}
 		KdPostDraw();
 
+		// アセットのメモリ集計と予算超過分の解放
+		KdAssets::Instance().Update();
+
+		// 描画・アセットの統計をプロファイラへ
+		PROFILE_GAUGE("Draw Calls", KdDirect3D::Instance().GetDrawStats().m_drawCalls);
+		PROFILE_GAUGE("Triangles", KdDirect3D::Instance().GetDrawStats().m_triangles);
+		PROFILE_GAUGE("Live Textures", KdAssets::Instance().m_textures.GetDataCount());
+		PROFILE_GAUGE("Live Models", KdAssets::Instance().m_modeldatas.GetDataCount());
+		PROFILE_GAUGE("Texture MB", KdAssets::Instance().GetResidentMemory()[KdAssetCategory::Texture] / (1024.0 * 1024.0));
+		PROFILE_GAUGE("Mesh MB", KdAssets::Instance().GetResidentMemory()[KdAssetCategory::Mesh] / (1024.0 * 1024.0));
+		PROFILE_GAUGE("Animation MB", KdAssets::Instance().GetResidentMemory()[KdAssetCategory::Animation] / (1024.0 * 1024.0));
+		KdDirect3D::Instance().ResetDrawStats();
+
 		fpsCtrl.Update();
 	}
 	Release();
 }
 
+int Engine::RunCooker(bool force)
+{
+	ThreadManager::Instance().Init();
+
+	KdParallel::Instance().SetDispatcher([](std::function<void()> func)
+	{
+		ThreadManager::Instance().AddJob(std::move(func));
+	}, (int)ThreadManager::Instance().GetWorkerCount());
+
+	// 元ファイルはディスク上の Asset フォルダから読む (パックファイルはマウントしない)
+	KdTextureCooker::Result result = KdTextureCooker::CookDirectory("Asset", force);
+
+	// シーンのバイナリ (コンポーネントのスキーマ・デフォルト値にファクトリを使う)
+	InitComponentFactory();
+	size_t failedScenes = SceneBinary::ConvertDirectory("Asset/Data/Scene");
+
+	// ワールドパーティション (目次のあるシーンだけ、元のシーンから作り直す)
+	failedScenes += WorldPartition::BuildDirectory("Asset/Data/Scene");
+
+	KdParallel::Instance().SetDispatcher(nullptr, 0);
+	ThreadManager::Instance().Release();
+
+	// 初期化していないものを Release しない
+	m_isReleased = true;
+
+	return (result.m_failed > 0 || failedScenes > 0) ? 1 : 0;
+}
+
 void Engine::Release()
 {
 	if (m_isReleased) return;
 
+	AssetHotReloader::Instance().Release();
+	ModelLodStreamer::Instance().Release();
+	WorldStreamer::Instance().Release();	// セルの読み込みジョブを待ってから
 	AsyncAssetLoader::Instance().Release();
+	SceneSaver::Instance().Release();	// 保存中のシーンを書き終えてから
+	KdFileSystem::Instance().UnmountAll();
+	KdSetImportLog(nullptr);
+	KdParallel::Instance().SetDispatcher(nullptr, 0);
 	ThreadManager::Instance().Release();
+	KdDerivedDataCache::Instance().Release();
 	SceneManager::Instance().Release();
 	ImGuiManager::Instance().GuiRelease();
 	KdShaderManager::Instance().Release();
@@ -199,9 +281,15 @@ void Engine::KdBeginUpdate()
 	// 入力状況の更新
 	KdInputManager::Instance().Update();
 
+	// 変更されたアセットの読み込み直し (読み込み自体は非同期)
+	AssetHotReloader::Instance().Update();
+
 	// 非同期ローダー更新
 	AsyncAssetLoader::Instance().Update();
 
+	// モデルのLODの読み込み・解放
+	ModelLodStreamer::Instance().Update();
+
 	// 空間環境の更新
 	KdShaderManager::Instance().WorkAmbientController().Update();
 }
@@ -8,6 +8,12 @@ public:
 	void Execute();
 	void Release();
 
+	// アセットの事前変換だけを行う (ウィンドウ・デバイスは作らない)
+	// ・テクスチャ → BC 圧縮の DDS
+	// ・シーン (JSON) → バイナリシーン
+	// 戻り値 … 失敗したものがあれば 1
+	int RunCooker(bool force);
+
 	void Quit() { m_endFlag = true; }
 	void SetMouseGrabbed(bool enable); 
 
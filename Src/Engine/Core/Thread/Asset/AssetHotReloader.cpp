@@ -0,0 +1,80 @@
+﻿#include "AssetHotReloader.h"
+#include "AsyncAssetLoader.h"
+#include "../Profiler/Profiler.h"
+#include "../../../ImGui/Log/Logger.h"
+
+void AssetHotReloader::Init(const std::string& watchDir)
+{
+	if (!m_watcher.Start(watchDir))
+	{
+		Logger::Error("HotReload: Failed to watch " + watchDir);
+		return;
+	}
+
+	if (m_watcher.IsPolling())
+	{
+		// 変更通知が使えない環境
+		Logger::Log("HotReload", "Watching " + watchDir + " by polling");
+	}
+}
+
+void AssetHotReloader::Release()
+{
+	m_watcher.Stop();
+	m_changes.clear();
+}
+
+void AssetHotReloader::Update()
+{
+	if (!m_enabled || !m_watcher.IsWatching()) { return; }
+
+	m_changes.clear();
+	m_watcher.PopChanges(m_changes);
+	if (m_changes.empty()) { return; }
+
+	PROFILE_SCOPE("AssetHotReload");
+
+	// 読み込み済みのアセット
+	std::vector<std::pair<std::string, std::shared_ptr<KdTexture>>> textures;
+	std::vector<std::pair<std::string, std::shared_ptr<KdModelData>>> models;
+	KdAssets::Instance().m_textures.GetLoadedDatas(textures);
+	KdAssets::Instance().m_modeldatas.GetLoadedDatas(models);
+
+	for (const std::string& changed : m_changes)
+	{
+		std::string changedPath = NormalizePath(changed);
+		std::string changedExt = std::filesystem::path(changedPath).extension().string();
+		std::string changedDir = std::filesystem::path(changedPath).parent_path().string();
+
+		for (const auto& [name, spTexture] : textures)
+		{
+			if (NormalizePath(name) != changedPath) { continue; }
+
+			Logger::Log("HotReload", "Reload Texture: " + name);
+			AsyncAssetLoader::Instance().ReloadTexture(spTexture, name);
+		}
+
+		for (const auto& [name, spModel] : models)
+		{
+			std::string modelPath = NormalizePath(name);
+
+			// .gltf の頂点などは同じフォルダの .bin に入っている
+			bool isTarget = (modelPath == changedPath) ||
+				(changedExt == ".bin" && std::filesystem::path(modelPath).parent_path().string() == changedDir);
+			if (!isTarget) { continue; }
+
+			Logger::Log("HotReload", "Reload Model: " + name);
+			AsyncAssetLoader::Instance().ReloadModel(spModel, name);
+		}
+	}
+}
+
+std::string AssetHotReloader::NormalizePath(std::string_view path)
+{
+	std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+
+	// Windowsのパスは大文字小文字を区別しない
+	std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	return normalized;
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+// アセットのホットリロード
+// ・Assetフォルダを監視し、変更されたファイルを KdAssets に読み込み済みのアセットへ読み込み直す
+// ・読み込みは AsyncAssetLoader 経由でワーカースレッドで行い、完了したらメインスレッドで中身を差し替える
+//   (モデルは KdModelData::Swap、テクスチャは KdTexture::SetSRView)
+// ・ハンドルはそのままなので、参照している側は何もしなくてよい
+//   (KdModelWork はモデルデータのリビジョンを見て自動でノードを作り直す)
+class AssetHotReloader
+{
+public:
+
+	// 初期化 (監視開始)
+	void Init(const std::string& watchDir = "Asset");
+
+	// 更新 (変更されたファイルの読み込み直しを依頼するだけなのでフレームは止めない)
+	void Update();
+
+	// 解放 (監視終了)
+	void Release();
+
+	void SetEnabled(bool enable) { m_enabled = enable; }
+	bool IsEnabled() const { return m_enabled; }
+
+private:
+	AssetHotReloader() {}
+	~AssetHotReloader() { Release(); }
+
+	// 比較用に正規化したパス ('/' 区切り・小文字)
+	static std::string NormalizePath(std::string_view path);
+
+	KdFileWatcher m_watcher;
+	bool m_enabled = true;
+
+	std::vector<std::string> m_changes;
+
+public:
+	static AssetHotReloader& Instance()
+	{
+		static AssetHotReloader instance;
+		return instance;
+	}
+};
@@ -2,6 +2,19 @@
 #include "../ThreadManager.h" // スレッドマネージャ
 #include "../Profiler/Profiler.h"
 #include "../../../ImGui/Log/Logger.h"
+#include "../../../../Framework/Direct3D/KdModelBinary.h"
+
+// 読み込んだファイルのサイズ (プロファイラの Bytes Loaded 用)
+static uintmax_t GetLoadedFileSize(const std::string& path)
+{
+	// パックファイル内なら展開後のサイズ
+	uint64_t size = 0;
+	return KdFileSystem::Instance().GetFileSize(path, size) ? size : 0;
+}
+
+// テクスチャの変換処理 (ミップ生成) を変えたら上げる
+static constexpr uint32_t kTextureCookVersion = 1;
+static constexpr const char* kTextureCookSettings = "Mips=Full;Filter=Default";
 
 void AsyncAssetLoader::Init()
 {
@@ -9,9 +22,11 @@ void AsyncAssetLoader::Init()
 
 void AsyncAssetLoader::Release()
 {
+	// 実行中のジョブは次の段階に進む前に止まる
+	CancelAll();
+
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
 	m_completionCallbacks.clear();
-	m_textureCache.clear();
-	m_modelCache.clear();
 }
 
 void AsyncAssetLoader::Update()
@@ -34,12 +49,104 @@ void AsyncAssetLoader::Update()
 	}
 }
 
+std::shared_ptr<AsyncLoadHandle> AsyncAssetLoader::FindLoadHandle(const void* pAsset) const
+{
+	std::lock_guard<std::mutex> lock(m_handleMutex);
+
+	auto it = m_activeLoads.find(pAsset);
+	return it != m_activeLoads.end() ? it->second : nullptr;
+}
+
+void AsyncAssetLoader::GetActiveLoads(std::vector<std::shared_ptr<AsyncLoadHandle>>& out) const
+{
+	std::lock_guard<std::mutex> lock(m_handleMutex);
+
+	out.reserve(out.size() + m_activeLoads.size());
+	for (const auto& [pAsset, spHandle] : m_activeLoads) { out.push_back(spHandle); }
+}
+
+size_t AsyncAssetLoader::CancelUnreferenced()
+{
+	std::vector<std::shared_ptr<AsyncLoadHandle>> handles;
+	GetActiveLoads(handles);
+
+	// KdAssets の1つだけなら、使う側はもういない
+	// ・参照数はワーカースレッドの GetData と競合するので、KdAssets のロックの中で数えて取り除く
+	//   取り除けたものだけ取り消す (読み込まれないままのアセットが次のシーンで共有されないように)
+	size_t cancelledCount = 0;
+	for (const auto& spHandle : handles)
+	{
+		bool removed = false;
+		if (spHandle->GetType() == AsyncLoadHandle::Type::Texture)
+		{
+			removed = KdAssets::Instance().m_textures.RemoveUnreferenced(spHandle->GetPath(), static_cast<const KdTexture*>(spHandle->m_pAsset));
+		}
+		else
+		{
+			removed = KdAssets::Instance().m_modeldatas.RemoveUnreferenced(spHandle->GetPath(), static_cast<const KdModelData*>(spHandle->m_pAsset));
+		}
+
+		if (removed)
+		{
+			spHandle->Cancel();
+			++cancelledCount;
+		}
+	}
+
+	if (cancelledCount > 0)
+	{
+		Logger::Log("AsyncLoader", "Cancelled " + std::to_string(cancelledCount) + " unreferenced loads");
+	}
+
+	return cancelledCount;
+}
+
+void AsyncAssetLoader::CancelAll()
+{
+	std::lock_guard<std::mutex> lock(m_handleMutex);
+
+	for (const auto& [pAsset, spHandle] : m_activeLoads) { spHandle->Cancel(); }
+}
+
+std::shared_ptr<AsyncLoadHandle> AsyncAssetLoader::BeginLoad(AsyncLoadHandle::Type type, const std::string& filename, const std::shared_ptr<void>& spAsset)
+{
+	auto spHandle = std::make_shared<AsyncLoadHandle>(type, filename, spAsset);
+
+	std::lock_guard<std::mutex> lock(m_handleMutex);
+
+	// 同じアセットへの前の読み込みは結果が古いので取り消す (ホットリロードが続いた時など)
+	auto& spActive = m_activeLoads[spAsset.get()];
+	if (spActive) { spActive->Cancel(); }
+	spActive = spHandle;
+
+	PROFILE_GAUGE("Pending Loads", m_activeLoads.size());
+
+	return spHandle;
+}
+
+void AsyncAssetLoader::FinishLoad(const std::shared_ptr<AsyncLoadHandle>& spHandle, AsyncLoadHandle::State state)
+{
+	spHandle->m_state = state;
+
+	if (state == AsyncLoadHandle::State::Cancelled)
+	{
+		PROFILE_COUNT("Loads Cancelled", 1);
+	}
+
+	std::lock_guard<std::mutex> lock(m_handleMutex);
+
+	// 後から同じアセットの読み込みが始まっていれば、そちらの登録は残す
+	auto it = m_activeLoads.find(spHandle->m_pAsset);
+	if (it != m_activeLoads.end() && it->second == spHandle) { m_activeLoads.erase(it); }
+
+	PROFILE_GAUGE("Pending Loads", m_activeLoads.size());
+}
+
 // 1x1 白テクスチャの管理
+// ・シーンの並列読み込みで複数のワーカースレッドから同時に呼ばれるので、static の初期化 (1回だけ・スレッドセーフ) で作る
 ID3D11ShaderResourceView* AsyncAssetLoader::GetWhiteTex()
 {
-    static ID3D11ShaderResourceView* s_whiteSRV = nullptr;
-    
-    if (!s_whiteSRV)
+    static ID3D11ShaderResourceView* s_whiteSRV = []() -> ID3D11ShaderResourceView*
     {
         // 1x1の白テクスチャを作成
         D3D11_TEXTURE2D_DESC desc = {};
@@ -57,6 +164,8 @@ ID3D11ShaderResourceView* AsyncAssetLoader::GetWhiteTex()
         data.pSysMem = &whitePixels;
         data.SysMemPitch = 4;
 
+        ID3D11ShaderResourceView* srv = nullptr;
+
         ID3D11Texture2D* tex = nullptr;
         if (SUCCEEDED(KdDirect3D::Instance().WorkDev()->CreateTexture2D(&desc, &data, &tex)))
         {
@@ -68,11 +177,13 @@ ID3D11ShaderResourceView* AsyncAssetLoader::GetWhiteTex()
             srvDesc.Texture2D.MostDetailedMip = 0;
             srvDesc.Texture2D.MipLevels = 1;
             
-            KdDirect3D::Instance().WorkDev()->CreateShaderResourceView(tex, &srvDesc, &s_whiteSRV);
+            KdDirect3D::Instance().WorkDev()->CreateShaderResourceView(tex, &srvDesc, &srv);
             
             tex->Release();
         }
-    }
+        return srv;
+    }();
+
     return s_whiteSRV;
 }
 
@@ -80,20 +191,9 @@ std::shared_ptr<KdTexture> AsyncAssetLoader::LoadTextureAsync(const std::string&
 {
 	if (filename.empty()) return nullptr;
 
-	// キャッシュ確認
-	auto it = m_textureCache.find(filename);
-	if (it != m_textureCache.end())
-	{
-		auto ptr = it->second.lock();
-		if (ptr) return ptr;
-	}
-
 	// 新規作成
 	std::shared_ptr<KdTexture> newTex = std::make_shared<KdTexture>();
 
-	// キャッシュ登録
-	m_textureCache[filename] = newTex;
-
 	// プレースホルダーセット
 	ID3D11ShaderResourceView* white = GetWhiteTex();
 	if (white)
@@ -101,53 +201,140 @@ std::shared_ptr<KdTexture> AsyncAssetLoader::LoadTextureAsync(const std::string&
 		newTex->SetSRView(white);
 	}
 
+	RequestTextureLoad(newTex, filename, priority);
+
+	return newTex;
+}
+
+void AsyncAssetLoader::ReloadTexture(const std::shared_ptr<KdTexture>& spTexture, const std::string& filename)
+{
+	if (!spTexture || filename.empty()) return;
+
+	// 読み込みが終わるまでは今の画像のまま (新しく表示するものの読み込みを先にする)
+	RequestTextureLoad(spTexture, filename, Job::Priority::Low);
+}
+
+void AsyncAssetLoader::RequestTextureLoad(const std::shared_ptr<KdTexture>& spTexture, const std::string& filename, Job::Priority priority)
+{
 	// パスをコピーしてスレッドに渡す
 	std::string pathStr = filename;
 
-	// newTexを weak_ptr で渡す
-	std::weak_ptr<KdTexture> weakTex = newTex;
+	// テクスチャは weak_ptr で渡す
+	std::weak_ptr<KdTexture> weakTex = spTexture;
 
-	ThreadManager::Instance().AddJobWithPriority(priority, [this, weakTex, pathStr]()
+	std::shared_ptr<AsyncLoadHandle> spHandle = BeginLoad(AsyncLoadHandle::Type::Texture, pathStr, spTexture);
+
+	ThreadManager::Instance().AddJobWithPriority(priority, [this, weakTex, pathStr, spHandle]()
 		{
-			PROFILE_SCOPE("LoadTexture: " + pathStr);
+			// 順番待ちの間に要らなくなったものは、ファイルを開く前にやめる
+			if (spHandle->ShouldStop())
+			{
+				FinishLoad(spHandle, AsyncLoadHandle::State::Cancelled);
+				return;
+			}
+
+			PROFILE_SCOPE_DYNAMIC("LoadTexture: " + pathStr);
+			PROFILE_ALLOC_TAG("AssetLoad");
 
 			// --- ワーカースレッド内 ---
+			spHandle->m_state = AsyncLoadHandle::State::Reading;
 
 			// 開発用ログ
 			Logger::Log("AsyncLoader", "Loading Texture: " + pathStr);
 
-			// A. ファイル読み込み
-			std::wstring wFilename = sjis_to_wide(pathStr);
+			// ファイルを読み進めた分だけ進める (読むファイルを変える時は m_loadedBytes を 0 に戻す)
+			KdFileSystem::ScopedReadProgress readProgress([&spHandle](uint64_t bytes) { spHandle->m_loadedBytes += bytes; });
+
 			DirectX::TexMetadata meta;
 			DirectX::ScratchImage image;
 			bool bLoaded = false;
+			bool bFromCache = false;
 
-			if (SUCCEEDED(DirectX::LoadFromWICFile(wFilename.c_str(), DirectX::WIC_FLAGS_ALL_FRAMES, &meta, image))) bLoaded = true;
-			if (!bLoaded && SUCCEEDED(DirectX::LoadFromDDSFile(wFilename.c_str(), DirectX::DDS_FLAGS_NONE, &meta, image))) bLoaded = true;
-			if (!bLoaded && SUCCEEDED(DirectX::LoadFromTGAFile(wFilename.c_str(), &meta, image))) bLoaded = true;
-			if (!bLoaded && SUCCEEDED(DirectX::LoadFromHDRFile(wFilename.c_str(), &meta, image))) bLoaded = true;
+			// A0. 事前変換済み (BC 圧縮・ミップ生成済み) の DDS があれば、そのまま GPU に送る
+			std::string cookedPath = KdTextureCooker::FindCooked(pathStr);
+			if (!cookedPath.empty())
+			{
+				spHandle->m_totalBytes = GetLoadedFileSize(cookedPath);
+				spHandle->m_loadedBytes = 0;
 
-			if (!bLoaded)
+				std::vector<uint8_t> data;
+				if (KdFileSystem::Instance().ReadFile(cookedPath, data) &&
+					SUCCEEDED(DirectX::LoadFromDDSMemory(data.data(), data.size(), DirectX::DDS_FLAGS_NONE, &meta, image)))
+				{
+					bLoaded = true;
+					bFromCache = true;
+					PROFILE_COUNT("Bytes Loaded", data.size());
+				}
+			}
+
+			// A. 派生データキャッシュ (ミップ生成済みのDDS) から読み込み
+			KdDerivedDataCache& ddc = KdDerivedDataCache::Instance();
+			std::string cacheKey = ddc.MakeKey({ pathStr }, kTextureCookSettings, kTextureCookVersion);
+			std::string cachedPath = bLoaded ? std::string() : ddc.Find(cacheKey, "dds");
+
+			if (!cachedPath.empty())
 			{
-				// ログ出力
-				Logger::Error("Failed to load texture: " + pathStr);
-				return; // 失敗
+				spHandle->m_totalBytes = GetLoadedFileSize(cachedPath);
+				spHandle->m_loadedBytes = 0;
+
+				// DirectXTex が直接読むので、読み終えた時にまとめて進める
+				if (SUCCEEDED(DirectX::LoadFromDDSFile(sjis_to_wide(cachedPath).c_str(), DirectX::DDS_FLAGS_NONE, &meta, image)))
+				{
+					bLoaded = true;
+					bFromCache = true;
+					spHandle->m_loadedBytes = spHandle->m_totalBytes.load();
+					PROFILE_COUNT("Bytes Loaded", spHandle->m_totalBytes.load());
+				}
 			}
 
-			// Mipmap
-			if (meta.mipLevels == 1)
+			// B. 元ファイル読み込み (パックファイル内ならそこから)
+			if (!bLoaded)
 			{
-				DirectX::ScratchImage mipChain;
-				if (SUCCEEDED(DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::TEX_FILTER_DEFAULT, 0, mipChain)))
+				spHandle->m_totalBytes = GetLoadedFileSize(pathStr);
+				spHandle->m_loadedBytes = 0;
+
+				size_t readBytes = 0;
+				bLoaded = KdTexture::LoadImageFile(pathStr, meta, image, &readBytes);
+
+				if (!bLoaded)
+				{
+					// ログ出力
+					Logger::Error("Failed to load texture: " + pathStr);
+					FinishLoad(spHandle, AsyncLoadHandle::State::Failed);
+					return; // 失敗
+				}
+				PROFILE_COUNT("Bytes Loaded", readBytes);
+
+				if (spHandle->ShouldStop())
+				{
+					FinishLoad(spHandle, AsyncLoadHandle::State::Cancelled);
+					return;
+				}
+				spHandle->m_state = AsyncLoadHandle::State::Decoding;
+
+				// Mipmap
+				if (meta.mipLevels == 1)
 				{
-					image = std::move(mipChain);
+					DirectX::ScratchImage mipChain;
+					if (SUCCEEDED(DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::TEX_FILTER_DEFAULT, 0, mipChain)))
+					{
+						image = std::move(mipChain);
+					}
 				}
 			}
 
-			// B. リソース作成
+			// C. リソース作成
+			if (spHandle->ShouldStop())
+			{
+				FinishLoad(spHandle, AsyncLoadHandle::State::Cancelled);
+				return;
+			}
+			spHandle->m_state = AsyncLoadHandle::State::Uploading;
+
 			ID3D11Texture2D* newTexRes = nullptr;
 			if (FAILED(DirectX::CreateTextureEx(KdDirect3D::Instance().WorkDev(), image.GetImages(), image.GetImageCount(), image.GetMetadata(), D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0, DirectX::CREATETEX_FLAGS::CREATETEX_DEFAULT, (ID3D11Resource**)&newTexRes)))
 			{
+				FinishLoad(spHandle, AsyncLoadHandle::State::Failed);
 				return;
 			}
 
@@ -166,20 +353,50 @@ std::shared_ptr<KdTexture> AsyncAssetLoader::LoadTextureAsync(const std::string&
 			if (FAILED(KdDirect3D::Instance().WorkDev()->CreateShaderResourceView(newTexRes, &srvDesc, &newSRV)))
 			{
 				newTexRes->Release();
+				FinishLoad(spHandle, AsyncLoadHandle::State::Failed);
 				return;
 			}
 
-			// C. メインスレッドに適用依頼
+			// D. 次回のためにキャッシュへ書き出す (表示には不要なので優先度を下げて後回し)
+			if (!bFromCache && !cacheKey.empty())
+			{
+				auto spImage = std::make_shared<DirectX::ScratchImage>(std::move(image));
+
+				ThreadManager::Instance().AddJobWithPriority(Job::Priority::Low, [cacheKey, spImage]()
+					{
+						PROFILE_SCOPE("CacheTexture");
+
+						KdDerivedDataCache& ddc = KdDerivedDataCache::Instance();
+						std::string writePath = ddc.GetWritePath(cacheKey, "dds");
+
+						if (FAILED(DirectX::SaveToDDSFile(spImage->GetImages(), spImage->GetImageCount(), spImage->GetMetadata(),
+							DirectX::DDS_FLAGS_NONE, sjis_to_wide(writePath).c_str())))
+						{
+							std::error_code ec;
+							std::filesystem::remove(writePath, ec);
+							return;
+						}
+
+						ddc.Commit(cacheKey, "dds", writePath);
+					});
+			}
+
+			// E. メインスレッドに適用依頼
 			{
 				std::lock_guard<std::mutex> lock(m_callbackMutex);
-				m_completionCallbacks.emplace_back([weakTex, newSRV, newTexRes]()
+				m_completionCallbacks.emplace_back([this, weakTex, newSRV, newTexRes, spHandle]()
 					{
 						// メインスレッドで実行
 						auto ptr = weakTex.lock();
-						if (ptr)
+						if (ptr && !spHandle->ShouldStop())
 						{
 							// 差し替え (KdTexture::SetSRView は Release() も呼んでくれる)
 							ptr->SetSRView(newSRV);
+							FinishLoad(spHandle, AsyncLoadHandle::State::Done);
+						}
+						else
+						{
+							FinishLoad(spHandle, AsyncLoadHandle::State::Cancelled);
 						}
 
 						// SetSRViewでAddRefされるので、ここのカウントは下げる
@@ -188,51 +405,90 @@ std::shared_ptr<KdTexture> AsyncAssetLoader::LoadTextureAsync(const std::string&
 					});
 			}
 		});
-
-	return newTex;
 }
 
 std::shared_ptr<KdModelData> AsyncAssetLoader::LoadModelAsync(const std::string& filename, Job::Priority priority)
 {
     if (filename.empty()) return nullptr;
 
-    // キャッシュ確認
-    auto it = m_modelCache.find(filename);
-    if (it != m_modelCache.end())
-    {
-        auto ptr = it->second.lock();
-        if (ptr) return ptr;
-    }
-
     // 新規作成 (中身は空)
     std::shared_ptr<KdModelData> newModel = std::make_shared<KdModelData>();
 
-    // キャッシュ登録
-    m_modelCache[filename] = newModel;
+    // まず一番粗いLODで表示する
+    RequestModelLoad(newModel, filename, KdModelData::kCoarsestLod, priority);
+
+    return newModel;
+}
+
+void AsyncAssetLoader::ReloadModel(const std::shared_ptr<KdModelData>& spModel, const std::string& filename)
+{
+    if (!spModel || filename.empty()) return;
+
+    // 読み込みが終わるまでは今のモデルのまま (LODも今と同じものを読み込む、新しく表示するものの読み込みを先にする)
+    RequestModelLoad(spModel, filename, spModel->GetResidentLod(), Job::Priority::Low);
+}
 
+void AsyncAssetLoader::RequestModelLoad(const std::shared_ptr<KdModelData>& spModel, const std::string& filename, int firstLod, Job::Priority priority)
+{
     // パスをコピー
     std::string pathStr = filename;
-    std::weak_ptr<KdModelData> weakModel = newModel;
+    std::weak_ptr<KdModelData> weakModel = spModel;
+
+    std::shared_ptr<AsyncLoadHandle> spHandle = BeginLoad(AsyncLoadHandle::Type::Model, pathStr, spModel);
 
-    ThreadManager::Instance().AddJobWithPriority(priority, [this, weakModel, pathStr]()
+    ThreadManager::Instance().AddJobWithPriority(priority, [this, weakModel, pathStr, firstLod, spHandle]()
     {
-        PROFILE_SCOPE("LoadModel: " + pathStr);
+        // 順番待ちの間に要らなくなったものは、ファイルを開く前にやめる
+        if (spHandle->ShouldStop())
+        {
+            FinishLoad(spHandle, AsyncLoadHandle::State::Cancelled);
+            return;
+        }
+
+        PROFILE_SCOPE_DYNAMIC("LoadModel: " + pathStr);
+        PROFILE_ALLOC_TAG("AssetLoad");
         // 開発用ログ
         Logger::Log("AsyncLoader", "Loading Model: " + pathStr);
 
         // ワーカースレッド内でモデルロード
+        // (KdModelData::Load は読み込み・展開・バッファ作成をまとめて行うので、Decoding は通らない)
+        spHandle->m_state = AsyncLoadHandle::State::Reading;
+        // .gltf は同じフォルダの .bin も読むので合わせる
+        uint64_t totalBytes = 0;
+        for (const std::string& sourcePath : KdModelBinary::GetSourceFiles(pathStr)) { totalBytes += GetLoadedFileSize(sourcePath); }
+        spHandle->m_totalBytes = totalBytes;
+
+        // glTF とその .bin は読み進めた分だけ進める
+        // (変換済みのバイナリはメモリマップで読むので、読み終えた時にまとめて進める)
+        KdFileSystem::ScopedReadProgress readProgress([&spHandle](uint64_t bytes) { spHandle->m_loadedBytes += bytes; });
+
         auto loadedModel = std::make_shared<KdModelData>();
         
-        if (loadedModel->Load(pathStr))
+        if (loadedModel->Load(pathStr, firstLod))
         {
+            spHandle->m_loadedBytes = spHandle->m_totalBytes.load();
+            PROFILE_COUNT("Bytes Loaded", spHandle->m_totalBytes.load());
+
+            if (spHandle->ShouldStop())
+            {
+                FinishLoad(spHandle, AsyncLoadHandle::State::Cancelled);
+                return;
+            }
+            spHandle->m_state = AsyncLoadHandle::State::Uploading;
+
             // 成功したらメインスレッドでスワップ
             std::lock_guard<std::mutex> lock(m_callbackMutex);
-            m_completionCallbacks.emplace_back([weakModel, loadedModel]()
+            m_completionCallbacks.emplace_back([this, weakModel, loadedModel, spHandle]()
             {
                 auto ptr = weakModel.lock();
-                if (ptr)
+                if (ptr && !spHandle->ShouldStop())
                 {
                     ptr->Swap(*loadedModel);
+                    FinishLoad(spHandle, AsyncLoadHandle::State::Done);
+                }
+                else
+                {
+                    FinishLoad(spHandle, AsyncLoadHandle::State::Cancelled);
                 }
             });
         }
@@ -241,9 +497,8 @@ std::shared_ptr<KdModelData> AsyncAssetLoader::LoadModelAsync(const std::string&
             #ifdef _DEBUG
             Logger::Error("Failed to load model: " + pathStr);
             #endif
+            FinishLoad(spHandle, AsyncLoadHandle::State::Failed);
         }
 
     });
-
-    return newModel;
 }
@@ -1,8 +1,90 @@
 ﻿#pragma once
 #include "../ThreadManager.h"
 
+// 非同期読み込み1件の状態
+// ・ワーカースレッドが書き込み、どのスレッドからでも読める
+class AsyncLoadHandle
+{
+public:
+	enum class State : uint8_t
+	{
+		Queued,		// 順番待ち
+		Reading,	// ファイル読み込み中
+		Decoding,	// 展開・ミップ生成中
+		Uploading,	// GPU リソース作成・メインスレッドでの差し替え待ち
+		Done,		// 完了
+		Failed,		// 読み込み失敗
+		Cancelled,	// 取り消された (または使う側がいなくなった)
+	};
+
+	enum class Type : uint8_t
+	{
+		Texture,
+		Model,
+	};
+
+	AsyncLoadHandle(Type type, const std::string& path, const std::shared_ptr<void>& spAsset)
+		: m_type(type), m_path(path), m_pAsset(spAsset.get()), m_wpAsset(spAsset) {}
+
+	Type				GetType() const { return m_type; }
+	const std::string&	GetPath() const { return m_path; }
+	State				GetState() const { return m_state; }
+
+	// 完了・失敗・取り消しのどれか
+	bool IsFinished() const
+	{
+		State state = m_state;
+		return state == State::Done || state == State::Failed || state == State::Cancelled;
+	}
+
+	// 読み込んだバイト数 / ファイルのサイズ (読み始めるまでは 0)
+	// ・読み込んだバイト数はファイルを読んでいる間に増えていく (KdFileSystem::ScopedReadProgress)
+	// ・モデルのファイルのサイズは .bin を含めたもの
+	uint64_t GetLoadedBytes() const { return m_loadedBytes; }
+	uint64_t GetTotalBytes() const { return m_totalBytes; }
+
+	// 0～1 (読み込み中はバイト数、それ以降は段階で大まかに進める)
+	float GetProgress() const
+	{
+		switch (GetState())
+		{
+		case State::Queued:		return 0.0f;
+		case State::Reading:
+		{
+			uint64_t total = m_totalBytes;
+			return total > 0 ? 0.7f * (float)std::min<uint64_t>(m_loadedBytes, total) / (float)total : 0.0f;
+		}
+		case State::Decoding:	return 0.7f;
+		case State::Uploading:	return 0.9f;
+		default:				return 1.0f;
+		}
+	}
+
+	// 取り消し (ワーカースレッドは次の段階に進む前に止まる)
+	void Cancel() { m_cancelRequested = true; }
+
+	// 取り消されたか、読み込み先のアセットを使う側がいなくなったか
+	bool ShouldStop() const { return m_cancelRequested || m_wpAsset.expired(); }
+
+private:
+	friend class AsyncAssetLoader;
+
+	const Type				m_type;
+	const std::string		m_path;
+
+	// 読み込み先 (KdTexture / KdModelData)
+	const void*				m_pAsset = nullptr;
+	std::weak_ptr<void>		m_wpAsset;
+
+	std::atomic<State>		m_state = State::Queued;
+	std::atomic<uint64_t>	m_loadedBytes = 0;
+	std::atomic<uint64_t>	m_totalBytes = 0;
+	std::atomic<bool>		m_cancelRequested = false;
+};
+
 // 非同期アセットローダー
 // ・別スレッドでのアセット読み込みを管理する
+// ・キャッシュは持たない (KdAssets のカスタムローダーとして登録し、重複読み込みの防止は KdDataStorage に任せる)
 class AsyncAssetLoader
 {
 public:
@@ -17,11 +99,35 @@ public:
 	void Release();
 
 	// テクスチャの非同期ロード
+	// ・呼ぶたびに新しいハンドルを作るので、通常は KdAssets 経由で取得すること
 	std::shared_ptr<KdTexture> LoadTextureAsync(const std::string& filename, Job::Priority priority = Job::Priority::Normal);
 
 	// モデルの非同期ロード
+	// ・変換済みのモデルは最も粗いLODだけを読み込む (細かいLODは ModelLodStreamer が読み込む)
 	std::shared_ptr<KdModelData> LoadModelAsync(const std::string& filename, Job::Priority priority = Job::Priority::Normal);
 
+	// 既存のハンドルに読み込み直す (ホットリロード用)
+	// ・別スレッドで読み込み、完了したらメインスレッドで中身を差し替える
+	// ・Low 優先度で投入するので、表示に必要な Normal 以上の読み込みが先に処理される
+	void ReloadTexture(const std::shared_ptr<KdTexture>& spTexture, const std::string& filename);
+	void ReloadModel(const std::shared_ptr<KdModelData>& spModel, const std::string& filename);
+
+	// 読み込み中のハンドル (pAsset は KdTexture / KdModelData、読み込み中でなければ nullptr)
+	std::shared_ptr<AsyncLoadHandle> FindLoadHandle(const void* pAsset) const;
+
+	// 読み込み中のハンドル一覧
+	void GetActiveLoads(std::vector<std::shared_ptr<AsyncLoadHandle>>& out) const;
+
+	// KdAssets 以外から参照されていないアセットの読み込みを取り消す
+	// ・取り消したアセットは KdAssets からも取り除く (読み込まれていないまま共有されないように)
+	// ・KdAssets に無いアセットは対象外 (使う側がいなくなれば ShouldStop で止まる)
+	// ・シーン切り替えの直後などにメインスレッドから呼ぶこと
+	// 戻り値 … 取り消した数
+	size_t CancelUnreferenced();
+
+	// 全ての読み込みを取り消す
+	void CancelAll();
+
 private:
 	AsyncAssetLoader() {}
 	~AsyncAssetLoader() { Release(); }
@@ -29,11 +135,20 @@ private:
 	// 白テクスチャ取得 (プレースホルダー用)
 	ID3D11ShaderResourceView* GetWhiteTex();
 
-	// テクスチャキャッシュ (ファイルパス -> テクスチャ)
-	// weak_ptrにしておき、使われなくなったら自動解放されるようにする
-	std::map<std::string, std::weak_ptr<KdTexture>> m_textureCache;
-	std::map<std::string, std::weak_ptr<KdModelData>> m_modelCache;
-	
+	// ワーカースレッドで読み込み、完了したらメインスレッドで spTexture / spModel に差し替える
+	void RequestTextureLoad(const std::shared_ptr<KdTexture>& spTexture, const std::string& filename, Job::Priority priority);
+	void RequestModelLoad(const std::shared_ptr<KdModelData>& spModel, const std::string& filename, int firstLod, Job::Priority priority);
+
+	// ハンドルを作って登録する (同じアセットの前の読み込みは取り消す)
+	std::shared_ptr<AsyncLoadHandle> BeginLoad(AsyncLoadHandle::Type type, const std::string& filename, const std::shared_ptr<void>& spAsset);
+
+	// 読み込みを終えて登録を外す
+	void FinishLoad(const std::shared_ptr<AsyncLoadHandle>& spHandle, AsyncLoadHandle::State state);
+
+	// 読み込み中のハンドル (読み込み先のアセット → ハンドル)
+	mutable std::mutex m_handleMutex;
+	std::unordered_map<const void*, std::shared_ptr<AsyncLoadHandle>> m_activeLoads;
+
 	// コールバックリクエスト
 	// スレッドからメインスレッドに処理を依頼するためのキュー
 	// (テクスチャ差し替えなど)
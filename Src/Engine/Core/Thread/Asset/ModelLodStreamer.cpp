@@ -0,0 +1,242 @@
+﻿#include "ModelLodStreamer.h"
+#include "../ThreadManager.h"
+#include "../Profiler/Profiler.h"
+#include "../../../ImGui/Log/Logger.h"
+
+namespace
+{
+	// LOD[i] を使う最小の画面上の大きさ (これより小さければ次のLOD)
+	constexpr float kLodScreenSizes[] = { 0.25f, 0.1f, 0.04f };
+}
+
+int ModelLodStreamer::SelectLod(float screenSize, int lodCount)
+{
+	int lod = 0;
+	while (lod < lodCount - 1 && lod < (int)std::size(kLodScreenSizes) && screenSize < kLodScreenSizes[lod])
+	{
+		++lod;
+	}
+	return lod;
+}
+
+int ModelLodStreamer::SelectLod(float screenSize, int lodCount, int currentLod)
+{
+	int lod = SelectLod(screenSize, lodCount);
+	if (lod <= currentLod) { return lod; }
+
+	// 粗くする方向は、境界を少し下回っただけでは切り替えない
+	return std::max(currentLod, SelectLod(screenSize * kLodHysteresis, lodCount));
+}
+
+void ModelLodStreamer::Release()
+{
+	// 実行中のジョブが終わるのを待つ (待っている間に始まったものは読み込まずに終わる)
+	// ・完了通知を捨てた後に m_loadingCount が減らされないように
+	m_isReleasing = true;
+
+	std::unique_lock<std::mutex> lock(m_completedMutex);
+	m_jobsCondition.wait(lock, [this] { return m_jobsInFlight == 0; });
+
+	m_completed.clear();
+	m_models.clear();
+	m_loadingCount = 0;
+
+	m_isReleasing = false;
+}
+
+void ModelLodStreamer::Request(const std::shared_ptr<KdModelData>& spModel, const Math::Matrix& world)
+{
+	if (!m_enabled || !spModel || !spModel->CanStreamLod()) { return; }
+
+	// 画面上の大きさ
+	DirectX::BoundingSphere sphere;
+	spModel->GetBoundingSphere().Transform(sphere, world);
+
+	const KdShaderManager::cbCamera& camera = KdShaderManager::Instance().GetCameraCB();
+	float distance = (Math::Vector3(sphere.Center) - camera.CamPos).Length();
+	float screenSize = sphere.Radius * camera.mProj._22 / std::max(distance, sphere.Radius);
+
+	ModelState& state = m_models[spModel.get()];
+
+	// 同じアドレスに別のモデルが作られていた
+	if (state.m_wpModel.expired() && !state.m_isLoading)
+	{
+		state = ModelState();
+	}
+
+	state.m_wpModel = spModel;
+	state.m_screenSize = std::max(state.m_screenSize, screenSize);
+	state.m_lastRequestFrame = m_frame;
+}
+
+void ModelLodStreamer::Update()
+{
+	PROFILE_SCOPE("ModelLodStreamer");
+
+	// 読み込みが終わったものを差し替える
+	std::vector<std::function<void()>> completed;
+	{
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		completed = std::move(m_completed);
+		m_completed.clear();
+	}
+	for (auto& func : completed)
+	{
+		func();
+	}
+
+	if (!m_enabled) { return; }
+
+	// 候補
+	struct Candidate
+	{
+		const KdModelData* m_pKey;
+		std::shared_ptr<KdModelData> m_spModel;
+		int m_desiredLod;
+		float m_screenSize;
+		uint64_t m_lastRequestFrame;
+	};
+	std::vector<Candidate> refines;
+	std::vector<Candidate> trims;
+
+	for (auto it = m_models.begin(); it != m_models.end();)
+	{
+		ModelState& state = it->second;
+
+		std::shared_ptr<KdModelData> spModel = state.m_wpModel.lock();
+		if (!spModel)
+		{
+			// 読み込み中のものは完了通知で消す
+			if (state.m_isLoading) { ++it; }
+			else { it = m_models.erase(it); }
+			continue;
+		}
+
+		// 報告が無かったものは映っていない
+		bool isVisible = state.m_lastRequestFrame == m_frame;
+		state.m_lastScreenSize = isVisible ? state.m_screenSize : 0.0f;
+		state.m_screenSize = 0.0f;
+
+		// 切り替えたばかりのものはしばらくそのまま
+		bool canChange = state.m_lastChangeFrame == 0 || state.m_lastChangeFrame + kLodChangeIntervalFrames <= m_frame;
+
+		if (!state.m_isLoading && !state.m_isFailed && canChange && spModel->CanStreamLod())
+		{
+			int residentLod = spModel->GetResidentLod();
+			int desiredLod = SelectLod(state.m_lastScreenSize, spModel->GetLodCount(), residentLod);
+
+			Candidate candidate{ it->first, spModel, desiredLod, state.m_lastScreenSize, state.m_lastRequestFrame };
+			if (desiredLod < residentLod) { refines.push_back(candidate); }
+			else if (desiredLod > residentLod) { trims.push_back(candidate); }
+		}
+
+		++it;
+	}
+
+	++m_frame;
+
+	PROFILE_GAUGE("LOD Loads In Flight", m_loadingCount);
+
+	// メッシュの予算
+	uint64_t meshBudget = KdAssets::Instance().GetBudget(KdAssetCategory::Mesh);
+	uint64_t meshResident = KdAssets::Instance().GetResidentMemory()[KdAssetCategory::Mesh];
+	bool isOverBudget = meshBudget > 0 && meshResident > meshBudget;
+
+	if (isOverBudget)
+	{
+		// 長く映っていないもの → 小さく映っているものの順に粗くする
+		std::sort(trims.begin(), trims.end(), [](const Candidate& a, const Candidate& b)
+			{
+				if (a.m_lastRequestFrame != b.m_lastRequestFrame) { return a.m_lastRequestFrame < b.m_lastRequestFrame; }
+				return a.m_screenSize < b.m_screenSize;
+			});
+
+		uint64_t over = meshResident - meshBudget;
+		uint64_t freeing = 0;
+		for (const Candidate& candidate : trims)
+		{
+			if (freeing >= over || m_loadingCount >= kMaxLoadsInFlight) { break; }
+
+			// 粗いメッシュは小さいので、今のメッシュのほとんどが空くとみなす
+			freeing += candidate.m_spModel->GetMeshMemorySize();
+
+			StartLoad(candidate.m_pKey, m_models[candidate.m_pKey], candidate.m_spModel, candidate.m_desiredLod);
+		}
+
+		// 予算を超えている間は細かくしない
+		return;
+	}
+
+	// 大きく映っているものから細かくする (一度に1段ずつ)
+	std::sort(refines.begin(), refines.end(), [](const Candidate& a, const Candidate& b)
+		{
+			return a.m_screenSize > b.m_screenSize;
+		});
+
+	for (const Candidate& candidate : refines)
+	{
+		if (m_loadingCount >= kMaxLoadsInFlight) { break; }
+
+		StartLoad(candidate.m_pKey, m_models[candidate.m_pKey], candidate.m_spModel, candidate.m_spModel->GetResidentLod() - 1);
+	}
+}
+
+void ModelLodStreamer::StartLoad(const KdModelData* pKey, ModelState& state, const std::shared_ptr<KdModelData>& spModel, int lod)
+{
+	state.m_isLoading = true;
+	state.m_lastChangeFrame = m_frame;
+	++m_loadingCount;
+
+	std::weak_ptr<KdModelData> weakModel = spModel;
+	std::string cookedPath = spModel->GetCookedPath();
+	int currentLod = spModel->GetResidentLod();
+	uint32_t revision = spModel->GetRevision();
+
+	{
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		++m_jobsInFlight;
+	}
+
+	// 細かくする方を、粗くする方より先にワーカースレッドに取り出させる (同じ優先度の中の順番は Update で決めている)
+	Job::Priority priority = lod < currentLod ? Job::Priority::Normal : Job::Priority::Low;
+
+	ThreadManager::Instance().AddJobWithPriority(priority, [this, pKey, weakModel, cookedPath, lod, currentLod, revision]()
+		{
+			PROFILE_SCOPE_DYNAMIC("LoadModelLod: " + cookedPath);
+			PROFILE_ALLOC_TAG("AssetLoad");
+
+			// 待っている間に破棄された・終了処理中なら読まない
+			auto spMeshes = std::make_shared<std::vector<std::shared_ptr<KdMesh>>>();
+			bool isLoaded = !m_isReleasing && !weakModel.expired() && KdModelData::LoadLodMeshes(cookedPath, lod, currentLod, *spMeshes);
+
+			std::lock_guard<std::mutex> lock(m_completedMutex);
+			--m_jobsInFlight;
+			m_jobsCondition.notify_all();
+
+			m_completed.emplace_back([this, pKey, weakModel, spMeshes, isLoaded, lod, revision, cookedPath]()
+				{
+					--m_loadingCount;
+
+					auto it = m_models.find(pKey);
+					if (it == m_models.end()) { return; }
+
+					ModelState& state = it->second;
+					state.m_isLoading = false;
+
+					auto spModel = weakModel.lock();
+					if (!spModel) { return; }
+
+					// 読み込み中にホットリロードなどで中身が入れ替わった
+					if (spModel->GetRevision() != revision) { return; }
+
+					if (!isLoaded)
+					{
+						Logger::Error("Failed to load model LOD: " + cookedPath);
+						state.m_isFailed = true;
+						return;
+					}
+
+					spModel->ApplyLodMeshes(lod, *spMeshes);
+				});
+		});
+}
@@ -0,0 +1,88 @@
+﻿#pragma once
+
+// モデルのLODストリーミング
+// ・非同期ロードでは最も粗いLODだけを読み込んで先に表示し、細かいLODは後から読み込む
+// ・描画のたびに Request で画面上の大きさを報告してもらい、大きく映っているモデルから順に細かくする
+// ・メッシュのメモリが予算を超えたら、小さく映っている (または映っていない) モデルから粗いLODに戻す
+// ・読み込みはワーカースレッド、差し替えは Update (メインスレッド) で行う
+// ・読み込む順番は、同時に読み込む数を kMaxLoadsInFlight に絞った上で、毎フレーム画面上の大きさ順に投げることで決める
+//   (ThreadManager のキューは投げた順に実行するので、Job::Priority では順番は変わらない)
+class ModelLodStreamer
+{
+public:
+
+	// 更新 (読み込み完了の反映・読み込み開始・予算超過時の解放)
+	void Update();
+
+	// 解放
+	void Release();
+
+	// 描画時に呼ぶ (world … モデルのワールド行列)
+	// ・同じフレームに何度も描画するものは、GetFrame を見て1回だけ呼べばよい
+	void Request(const std::shared_ptr<KdModelData>& spModel, const Math::Matrix& world);
+
+	// Request を受け付けている今のフレーム
+	uint64_t GetFrame() const { return m_frame; }
+
+	// 画面上の大きさ (境界球の直径 / 画面の高さ) から使うLODを選ぶ
+	static int SelectLod(float screenSize, int lodCount);
+
+	// 今の currentLod から切り替える先を選ぶ
+	// ・粗くするのは境界より kLodHysteresis 倍小さくなってから (境界付近で行き来しないように)
+	static int SelectLod(float screenSize, int lodCount, int currentLod);
+
+	void SetEnabled(bool enable) { m_enabled = enable; }
+	bool IsEnabled() const { return m_enabled; }
+
+private:
+	ModelLodStreamer() {}
+	~ModelLodStreamer() { Release(); }
+
+	// 同時に読み込むモデルの最大数
+	static constexpr int kMaxLoadsInFlight = 4;
+
+	// 粗くする時の画面上の大きさの余裕
+	static constexpr float kLodHysteresis = 1.25f;
+
+	// LODを切り替えてから、次に切り替えられるようになるまでのフレーム数
+	static constexpr uint64_t kLodChangeIntervalFrames = 30;
+
+	struct ModelState
+	{
+		std::weak_ptr<KdModelData>	m_wpModel;
+
+		float		m_screenSize = 0.0f;		// 今回の報告の最大値
+		float		m_lastScreenSize = 0.0f;	// 前回の Update までの最大値
+		uint64_t	m_lastRequestFrame = 0;
+		uint64_t	m_lastChangeFrame = 0;		// 最後にLODを切り替えたフレーム (0 … まだ切り替えていない)
+
+		bool		m_isLoading = false;
+		bool		m_isFailed = false;			// 変換済みバイナリが消えたなど (以後は切り替えない)
+	};
+
+	// ワーカースレッドで lod を読み込み、完了したら差し替える
+	void StartLoad(const KdModelData* pKey, ModelState& state, const std::shared_ptr<KdModelData>& spModel, int lod);
+
+	bool m_enabled = true;
+
+	uint64_t m_frame = 1;
+	int m_loadingCount = 0;
+
+	std::unordered_map<const KdModelData*, ModelState> m_models;
+
+	// ワーカースレッドからの完了通知
+	std::mutex m_completedMutex;
+	std::vector<std::function<void()>> m_completed;
+
+	// 実行中のジョブの数 (Release で全て終わるのを待つ、m_completedMutex で守る)
+	int m_jobsInFlight = 0;
+	std::condition_variable m_jobsCondition;
+	std::atomic<bool> m_isReleasing = false;
+
+public:
+	static ModelLodStreamer& Instance()
+	{
+		static ModelLodStreamer instance;
+		return instance;
+	}
+};
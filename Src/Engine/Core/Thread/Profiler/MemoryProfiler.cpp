@@ -0,0 +1,488 @@
+﻿#include "Profiler.h"
+
+#include <DbgHelp.h>
+#pragma comment(lib, "dbghelp.lib")
+
+//====================================================
+// 確保フック側の状態
+// ・operator new から触るので、動的な初期化や確保を伴う型は使わない
+//   (すべてゼロ初期化 / 定数初期化で済むもの)
+// ・KD_PROFILE_ALLOC=0 の時は置き換えないので、タグの登録だけが残る
+//====================================================
+namespace
+{
+	const char* g_tagNames[MemoryProfiler::kMaxTags] = { "Untagged" };
+	std::atomic<int> g_tagCount = 1;
+	std::mutex g_tagMutex;
+
+	std::atomic<bool> g_captureCallSites = false;
+}
+
+#if KD_PROFILE_ALLOC
+namespace
+{
+	// 確保したブロックの先頭に付けるヘッダ
+	// ・16byteにしてmallocのアライメントを崩さない
+	struct AllocHeader
+	{
+		uint64_t m_size;
+		uint32_t m_tag;
+		uint32_t m_magic;
+	};
+	static_assert(sizeof(AllocHeader) == 16, "AllocHeader must keep 16 byte alignment");
+
+	constexpr uint32_t kAllocMagic = 0x4B44414Cu; // "KDAL"
+
+	// 確保と解放は別のスレッドで同時に起きやすいので、それぞれ別のキャッシュラインに置く
+	// (隣のタグとも共有しない)
+	constexpr size_t kCacheLineSize = 64;
+
+	struct alignas(kCacheLineSize) CounterPair
+	{
+		std::atomic<uint64_t> m_count;
+		std::atomic<uint64_t> m_bytes;
+	};
+
+	struct TagCounters
+	{
+		CounterPair m_alloc;
+		CounterPair m_free;
+	};
+	static_assert(sizeof(TagCounters) == kCacheLineSize * 2, "TagCounters must not share cache lines");
+
+	struct CallSite
+	{
+		std::atomic<uint32_t> m_hash;
+		std::atomic<uint64_t> m_allocCount;
+		std::atomic<uint64_t> m_allocBytes;
+		std::atomic<bool> m_isReady; // スタックの書き込み完了
+		void* m_frames[MemoryProfiler::kMaxStackFrames];
+		uint16_t m_frameCount;
+	};
+
+	TagCounters g_tagCounters[MemoryProfiler::kMaxTags];
+
+	thread_local uint16_t t_tagStack[MemoryProfiler::kMaxTagDepth];
+	thread_local int t_tagDepth = 0;
+
+	CallSite g_callSites[MemoryProfiler::kMaxCallSites];
+
+	// RecordCallSite を実行中のスレッド数 (ClearCallSites は抜けるのを待ってから消す)
+	std::atomic<int> g_callSiteWriters = 0;
+
+	struct CallSiteWriterScope
+	{
+		CallSiteWriterScope() { g_callSiteWriters.fetch_add(1); }
+		~CallSiteWriterScope() { g_callSiteWriters.fetch_sub(1, std::memory_order_release); }
+	};
+
+	void RecordCallSite(size_t size)
+	{
+		// 先に数えてから記録中かを見る
+		// (ClearCallSites は記録を止めてから数を見るので、どちらかが必ず相手に気付く)
+		CallSiteWriterScope writer;
+		if (!g_captureCallSites.load()) return;
+
+		void* frames[MemoryProfiler::kMaxStackFrames];
+		ULONG hash = 0;
+		// 0: RecordCallSite, 1: TrackedAlloc, 2: operator new を飛ばす
+		USHORT frameCount = RtlCaptureStackBackTrace(3, MemoryProfiler::kMaxStackFrames, frames, &hash);
+		if (frameCount == 0) return;
+		if (hash == 0) hash = 1; // 0は空きスロットの印
+
+		// オープンアドレス法 (探索回数に上限を設け、溢れたら記録しない)
+		constexpr uint32_t kMask = MemoryProfiler::kMaxCallSites - 1;
+		static_assert((MemoryProfiler::kMaxCallSites & kMask) == 0, "kMaxCallSites must be a power of two");
+
+		for (uint32_t i = 0; i < 32; i++)
+		{
+			CallSite& site = g_callSites[(hash + i) & kMask];
+
+			uint32_t current = site.m_hash.load(std::memory_order_acquire);
+			if (current == 0)
+			{
+				uint32_t expected = 0;
+				if (site.m_hash.compare_exchange_strong(expected, (uint32_t)hash, std::memory_order_acq_rel))
+				{
+					memcpy(site.m_frames, frames, sizeof(void*) * frameCount);
+					site.m_frameCount = frameCount;
+					site.m_isReady.store(true, std::memory_order_release);
+					current = (uint32_t)hash;
+				}
+				else
+				{
+					current = expected;
+				}
+			}
+
+			if (current == (uint32_t)hash)
+			{
+				site.m_allocCount.fetch_add(1, std::memory_order_relaxed);
+				site.m_allocBytes.fetch_add(size, std::memory_order_relaxed);
+				return;
+			}
+		}
+	}
+
+	void* TrackedAlloc(size_t size)
+	{
+		AllocHeader* header = (AllocHeader*)malloc(size + sizeof(AllocHeader));
+		if (!header) return nullptr;
+
+		uint32_t tag = (t_tagDepth > 0) ? t_tagStack[t_tagDepth - 1] : 0;
+
+		header->m_size = size;
+		header->m_tag = tag;
+		header->m_magic = kAllocMagic;
+
+		// 生存量が合わなくなるので、確保・解放の数はプロファイラが無効でも数える
+		g_tagCounters[tag].m_alloc.m_count.fetch_add(1, std::memory_order_relaxed);
+		g_tagCounters[tag].m_alloc.m_bytes.fetch_add(size, std::memory_order_relaxed);
+
+		if (g_captureCallSites.load(std::memory_order_relaxed) && Profiler::IsEnabled())
+		{
+			RecordCallSite(size);
+		}
+
+		return header + 1;
+	}
+
+	void TrackedFree(void* ptr)
+	{
+		if (!ptr) return;
+
+		// 置き換えはプログラム全体に効くので、ここに来るのは TrackedAlloc で確保したものだけ
+		// (マジックは壊れたポインタ・二重解放の検出用。違っても推測で free しない)
+		AllocHeader* header = (AllocHeader*)ptr - 1;
+		assert(header->m_magic == kAllocMagic && "MemoryProfiler: operator delete に TrackedAlloc 以外のポインタが渡されました");
+		header->m_magic = 0;
+
+		g_tagCounters[header->m_tag].m_free.m_count.fetch_add(1, std::memory_order_relaxed);
+		g_tagCounters[header->m_tag].m_free.m_bytes.fetch_add(header->m_size, std::memory_order_relaxed);
+
+		free(header);
+	}
+
+	void* TrackedNew(size_t size)
+	{
+		if (size == 0) size = 1;
+
+		while (true)
+		{
+			void* ptr = TrackedAlloc(size);
+			if (ptr) return ptr;
+
+			std::new_handler handler = std::get_new_handler();
+			if (!handler) throw std::bad_alloc();
+			handler();
+		}
+	}
+}
+
+//====================================================
+// グローバル operator new/delete の置き換え
+// ・アライメント指定版は置き換えない (標準の実装同士で対になる)
+//====================================================
+void* operator new(size_t size) { return TrackedNew(size); }
+void* operator new[](size_t size) { return TrackedNew(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	try { return TrackedNew(size); }
+	catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	try { return TrackedNew(size); }
+	catch (...) { return nullptr; }
+}
+
+void operator delete(void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+#endif
+
+bool MemoryProfiler::IsHooked()
+{
+#if KD_PROFILE_ALLOC
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint16_t MemoryProfiler::RegisterTag(const char* name)
+{
+	std::lock_guard<std::mutex> lock(g_tagMutex);
+
+	int count = g_tagCount.load(std::memory_order_acquire);
+	for (int i = 0; i < count; i++)
+	{
+		if (strcmp(g_tagNames[i], name) == 0) return (uint16_t)i;
+	}
+
+	if (count >= kMaxTags) return 0;
+
+	g_tagNames[count] = name;
+	g_tagCount.store(count + 1, std::memory_order_release);
+	return (uint16_t)count;
+}
+
+void MemoryProfiler::PushTag(uint16_t tag)
+{
+#if KD_PROFILE_ALLOC
+	// 上限を超えた分は数えるだけ (Popと対応させる)
+	if (t_tagDepth < kMaxTagDepth)
+	{
+		t_tagStack[t_tagDepth] = tag;
+	}
+	t_tagDepth++;
+#else
+	(void)tag;
+#endif
+}
+
+void MemoryProfiler::PopTag()
+{
+#if KD_PROFILE_ALLOC
+	if (t_tagDepth > 0) t_tagDepth--;
+#endif
+}
+
+void MemoryProfiler::SetCaptureCallSites(bool enable)
+{
+	g_captureCallSites.store(enable, std::memory_order_relaxed);
+}
+
+bool MemoryProfiler::IsCaptureCallSites()
+{
+	return g_captureCallSites.load(std::memory_order_relaxed);
+}
+
+void MemoryProfiler::ClearCallSites()
+{
+#if KD_PROFILE_ALLOC
+	// 記録を止め、記録中のスレッドが抜けるのを待ってから消す
+	// (途中のスレッドが消した後のスロットにスタックや回数を書き込まないように)
+	bool capture = g_captureCallSites.exchange(false);
+	while (g_callSiteWriters.load(std::memory_order_acquire) > 0)
+	{
+		std::this_thread::yield();
+	}
+
+	for (CallSite& site : g_callSites)
+	{
+		site.m_isReady.store(false, std::memory_order_relaxed);
+		site.m_allocCount.store(0, std::memory_order_relaxed);
+		site.m_allocBytes.store(0, std::memory_order_relaxed);
+		site.m_hash.store(0, std::memory_order_release);
+	}
+
+	g_captureCallSites.store(capture);
+#endif
+}
+
+void MemoryProfiler::EndFrame()
+{
+#if KD_PROFILE_ALLOC
+	int tagCount = g_tagCount.load(std::memory_order_acquire);
+
+	m_tagStats.resize(tagCount);
+	m_total = TagStats();
+	m_total.m_name = "Total";
+
+	for (int i = 0; i < tagCount; i++)
+	{
+		const TagCounters& counters = g_tagCounters[i];
+		uint64_t allocCount = counters.m_alloc.m_count.load(std::memory_order_relaxed);
+		uint64_t allocBytes = counters.m_alloc.m_bytes.load(std::memory_order_relaxed);
+		uint64_t freeCount = counters.m_free.m_count.load(std::memory_order_relaxed);
+		uint64_t freeBytes = counters.m_free.m_bytes.load(std::memory_order_relaxed);
+
+		TagStats& stats = m_tagStats[i];
+		stats.m_name = g_tagNames[i];
+		stats.m_totalAllocCount = allocCount;
+		stats.m_totalAllocBytes = allocBytes;
+		stats.m_frameAllocCount = allocCount - m_lastAllocCount[i];
+		stats.m_frameAllocBytes = allocBytes - m_lastAllocBytes[i];
+		// 別のタグで確保されたものを解放することもあるので、タグ単位では符号付きで持つ
+		stats.m_liveCount = (int64_t)(allocCount - freeCount);
+		stats.m_liveBytes = (int64_t)(allocBytes - freeBytes);
+
+		m_lastAllocCount[i] = allocCount;
+		m_lastAllocBytes[i] = allocBytes;
+
+		m_total.m_totalAllocCount += stats.m_totalAllocCount;
+		m_total.m_totalAllocBytes += stats.m_totalAllocBytes;
+		m_total.m_frameAllocCount += stats.m_frameAllocCount;
+		m_total.m_frameAllocBytes += stats.m_frameAllocBytes;
+		m_total.m_liveCount += stats.m_liveCount;
+		m_total.m_liveBytes += stats.m_liveBytes;
+	}
+#endif
+}
+
+std::vector<MemoryProfiler::CallSiteStats> MemoryProfiler::GetTopCallSites(int count, bool byBytes) const
+{
+	std::vector<CallSiteStats> result;
+
+#if KD_PROFILE_ALLOC
+	for (const CallSite& site : g_callSites)
+	{
+		if (!site.m_isReady.load(std::memory_order_acquire)) continue;
+
+		CallSiteStats stats;
+		stats.m_hash = site.m_hash.load(std::memory_order_relaxed);
+		stats.m_allocCount = site.m_allocCount.load(std::memory_order_relaxed);
+		stats.m_allocBytes = site.m_allocBytes.load(std::memory_order_relaxed);
+		stats.m_frames.assign(site.m_frames, site.m_frames + site.m_frameCount);
+		result.push_back(std::move(stats));
+	}
+#endif
+
+	std::sort(result.begin(), result.end(), [byBytes](const CallSiteStats& a, const CallSiteStats& b)
+	{
+		return byBytes ? (a.m_allocBytes > b.m_allocBytes) : (a.m_allocCount > b.m_allocCount);
+	});
+
+	if ((int)result.size() > count)
+	{
+		result.resize(count);
+	}
+	return result;
+}
+
+std::string MemoryProfiler::ResolveSymbol(void* address)
+{
+	auto it = m_symbolCache.find(address);
+	if (it != m_symbolCache.end()) return it->second;
+
+	HANDLE process = GetCurrentProcess();
+	if (!m_isSymbolInitialized)
+	{
+		SymSetOptions(SymGetOptions() | SYMOPT_LOAD_LINES | SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+		SymInitialize(process, nullptr, TRUE);
+		m_isSymbolInitialized = true;
+	}
+
+	char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME];
+	SYMBOL_INFO* symbol = (SYMBOL_INFO*)buffer;
+	symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+	symbol->MaxNameLen = MAX_SYM_NAME;
+
+	std::ostringstream oss;
+	DWORD64 displacement = 0;
+	if (SymFromAddr(process, (DWORD64)address, &displacement, symbol))
+	{
+		oss << symbol->Name;
+
+		IMAGEHLP_LINE64 line = {};
+		line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+		DWORD lineDisplacement = 0;
+		if (SymGetLineFromAddr64(process, (DWORD64)address, &lineDisplacement, &line))
+		{
+			oss << " (" << std::filesystem::path(line.FileName).filename().string() << ":" << line.LineNumber << ")";
+		}
+	}
+	else
+	{
+		oss << "0x" << std::hex << (uintptr_t)address;
+	}
+
+	return m_symbolCache.emplace(address, oss.str()).first->second;
+}
+
+void MemoryProfiler::DrawImGui()
+{
+	if (!IsHooked())
+	{
+		ImGui::TextDisabled("Allocation hook is disabled (build with KD_PROFILE_ALLOC=1)");
+		return;
+	}
+
+	auto toKB = [](int64_t bytes) { return (double)bytes / 1024.0; };
+
+	ImGui::Text("Live: %.2f MB (%lld allocs)", (double)m_total.m_liveBytes / (1024.0 * 1024.0), m_total.m_liveCount);
+	ImGui::Text("This Frame: %llu allocs / %.1f KB", m_total.m_frameAllocCount, toKB((int64_t)m_total.m_frameAllocBytes));
+
+	// --- タグごと ---
+	ImGuiTableFlags tableFlags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit;
+	if (ImGui::BeginTable("MemoryTags", 6, tableFlags))
+	{
+		ImGui::TableSetupColumn("Tag", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Allocs/Frame");
+		ImGui::TableSetupColumn("KB/Frame");
+		ImGui::TableSetupColumn("Live Allocs");
+		ImGui::TableSetupColumn("Live KB");
+		ImGui::TableSetupColumn("Total Allocs");
+		ImGui::TableHeadersRow();
+
+		for (const TagStats& stats : m_tagStats)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(stats.m_name);
+			ImGui::TableNextColumn(); ImGui::Text("%llu", stats.m_frameAllocCount);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", toKB((int64_t)stats.m_frameAllocBytes));
+			ImGui::TableNextColumn(); ImGui::Text("%lld", stats.m_liveCount);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", toKB(stats.m_liveBytes));
+			ImGui::TableNextColumn(); ImGui::Text("%llu", stats.m_totalAllocCount);
+		}
+		ImGui::EndTable();
+	}
+
+	// --- 呼び出し元 ---
+	bool capture = IsCaptureCallSites();
+	if (ImGui::Checkbox("Capture Call Sites", &capture))
+	{
+		SetCaptureCallSites(capture);
+	}
+	ImGui::SameLine();
+	ImGui::Checkbox("Sort by Bytes", &m_sortCallSitesByBytes);
+	ImGui::SameLine();
+	if (ImGui::Button("Refresh"))
+	{
+		m_topCallSites = GetTopCallSites(20, m_sortCallSitesByBytes);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Clear"))
+	{
+		ClearCallSites();
+		m_topCallSites.clear();
+	}
+
+	if (m_topCallSites.empty()) return;
+
+	if (ImGui::BeginTable("MemoryCallSites", 3, tableFlags | ImGuiTableFlags_ScrollY, ImVec2(0.0f, 200.0f)))
+	{
+		ImGui::TableSetupColumn("Call Site", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Allocs");
+		ImGui::TableSetupColumn("KB");
+		ImGui::TableHeadersRow();
+
+		for (const CallSiteStats& site : m_topCallSites)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+
+			// 先頭は確保を行ったコンテナ内部になりがちなので、スタック全体はツールチップで出す
+			std::string caller = site.m_frames.empty() ? "?" : ResolveSymbol(site.m_frames.front());
+			ImGui::Text("%08X %s", site.m_hash, caller.c_str());
+			if (ImGui::IsItemHovered())
+			{
+				ImGui::BeginTooltip();
+				for (void* frame : site.m_frames)
+				{
+					ImGui::TextUnformatted(ResolveSymbol(frame).c_str());
+				}
+				ImGui::EndTooltip();
+			}
+
+			ImGui::TableNextColumn(); ImGui::Text("%llu", site.m_allocCount);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", toKB((int64_t)site.m_allocBytes));
+		}
+		ImGui::EndTable();
+	}
+}
@@ -0,0 +1,120 @@
+﻿#pragma once
+
+//====================================================
+// メモリ確保のプロファイラ
+// ・グローバルな operator new/delete を置き換えて、確保回数・確保量・生存量を数える
+// ・スコープ単位のタグ (PROFILE_ALLOC_TAG) ごとに集計する
+// ・呼び出し元の記録を有効にすると、スタックのハッシュごとに確保量を集計する
+//
+// ビルドスイッチ
+// ・KD_PROFILE_ALLOC=1 … 置き換える (全ての確保にヘッダ16byteとアトミック加算が付くので Debug のみ)
+// ・未定義 / KD_PROFILE=0 … 置き換え自体を行わない (Release の既定。PROFILE_ALLOC_TAG も消える)
+//====================================================
+#ifndef KD_PROFILE_ALLOC
+#define KD_PROFILE_ALLOC 0
+#endif
+#if !KD_PROFILE
+#undef KD_PROFILE_ALLOC
+#define KD_PROFILE_ALLOC 0
+#endif
+
+class MemoryProfiler
+{
+public:
+	static constexpr int kMaxTags = 64;			// 登録できるタグの数 (0番は "Untagged")
+	static constexpr int kMaxTagDepth = 32;		// タグのネストの上限
+	static constexpr int kMaxCallSites = 2048;	// 記録できる呼び出し元の数
+	static constexpr int kMaxStackFrames = 12;	// 呼び出し元として記録するスタックの深さ
+
+	// タグ1つ分の集計
+	struct TagStats
+	{
+		const char* m_name = nullptr;
+		uint64_t m_totalAllocCount = 0;	// 起動からの累計
+		uint64_t m_totalAllocBytes = 0;
+		uint64_t m_frameAllocCount = 0;	// 直前のフレームでの確保
+		uint64_t m_frameAllocBytes = 0;
+		int64_t m_liveCount = 0;			// 現在生存している確保
+		int64_t m_liveBytes = 0;
+	};
+
+	// 呼び出し元1つ分の集計
+	struct CallSiteStats
+	{
+		uint32_t m_hash = 0;
+		uint64_t m_allocCount = 0;
+		uint64_t m_allocBytes = 0;
+		std::vector<void*> m_frames;
+	};
+
+	static MemoryProfiler& Instance()
+	{
+		static MemoryProfiler instance;
+		return instance;
+	}
+
+	// operator new/delete が置き換えられているか
+	static bool IsHooked();
+
+	// タグを登録し、番号を返す (同じ名前なら同じ番号。上限を超えたら0)
+	// ・name は文字列リテラルなどプログラム終了まで有効なもの
+	static uint16_t RegisterTag(const char* name);
+
+	// 現在のスレッドのタグスタック操作
+	static void PushTag(uint16_t tag);
+	static void PopTag();
+
+	// 呼び出し元の記録 (スタックの取得が重いので必要な時だけONにする)
+	// ・Profiler が無効の間は記録しない
+	// ・ClearCallSites は記録中のスレッドが抜けるのを待ってから消す
+	static void SetCaptureCallSites(bool enable);
+	static bool IsCaptureCallSites();
+	static void ClearCallSites();
+
+	// フレームの区切り (Profiler::ResetFrame から呼ばれる)
+	void EndFrame();
+
+	// 直前のフレームまでの集計
+	const TagStats& GetTotal() const { return m_total; }
+	const std::vector<TagStats>& GetTagStats() const { return m_tagStats; }
+
+	// 確保量の多い呼び出し元 (byBytes = false なら確保回数順)
+	std::vector<CallSiteStats> GetTopCallSites(int count, bool byBytes) const;
+
+	// アドレスを "関数名 (ファイル:行)" に変換
+	std::string ResolveSymbol(void* address);
+
+	// ImGui描画
+	void DrawImGui();
+
+private:
+	MemoryProfiler() {}
+
+	TagStats m_total;
+	std::vector<TagStats> m_tagStats;
+	uint64_t m_lastAllocCount[kMaxTags] = {};
+	uint64_t m_lastAllocBytes[kMaxTags] = {};
+
+	// 表示設定
+	bool m_sortCallSitesByBytes = true;
+	std::vector<CallSiteStats> m_topCallSites;
+	std::unordered_map<void*, std::string> m_symbolCache;
+	bool m_isSymbolInitialized = false;
+};
+
+// タグのスコープ (RAII)
+class ScopedAllocTag
+{
+public:
+	ScopedAllocTag(uint16_t tag) { MemoryProfiler::PushTag(tag); }
+	~ScopedAllocTag() { MemoryProfiler::PopTag(); }
+};
+
+#if KD_PROFILE_ALLOC
+// スコープ内の確保を name のタグで集計する
+#define PROFILE_ALLOC_TAG(name) \
+	static const uint16_t KD_PROFILE_CONCAT(kdAllocTagID, __LINE__) = MemoryProfiler::RegisterTag(name); \
+	ScopedAllocTag KD_PROFILE_CONCAT(kdAllocTag, __LINE__)(KD_PROFILE_CONCAT(kdAllocTagID, __LINE__))
+#else
+#define PROFILE_ALLOC_TAG(name)
+#endif
@@ -0,0 +1,408 @@
+﻿#include "ProfileStatistics.h"
+#include "Profiler.h"
+
+namespace
+{
+	// 計測結果1件 (ツリー復元用)
+	struct ScopeEntry
+	{
+		const ProfileResult* m_result = nullptr;
+		int m_node = -1;
+		int m_flat = -1;
+		float m_childMs = 0.0f; // 直下の子区間の合計
+	};
+
+	// 最近傍順位法によるパーセンタイル (samples はソート済み)
+	float Percentile(const std::vector<float>& samples, float p)
+	{
+		if (samples.empty()) return 0.0f;
+		size_t rank = (size_t)std::ceil(p * (float)samples.size());
+		rank = std::clamp<size_t>(rank, 1, samples.size());
+		return samples[rank - 1];
+	}
+
+	// サンプル列から統計値を埋める
+	void Finalize(ProfileScopeStats& stats, std::vector<float>& samples)
+	{
+		if (samples.empty()) return;
+
+		std::sort(samples.begin(), samples.end());
+		stats.m_minMs = samples.front();
+		stats.m_maxMs = samples.back();
+		stats.m_avgMs = (float)(stats.m_inclusiveMs / (double)stats.m_callCount);
+		stats.m_p95Ms = Percentile(samples, 0.95f);
+		stats.m_p99Ms = Percentile(samples, 0.99f);
+	}
+}
+
+void ProfileStatistics::AddFrames(std::vector<ProfileFrame>&& frames, int windowFrames)
+{
+	for (ProfileFrame& frame : frames)
+	{
+		m_window.push_back(std::move(frame));
+	}
+
+	size_t count = (size_t)std::max(1, windowFrames);
+	if (m_window.size() > count)
+	{
+		m_window.erase(m_window.begin(), m_window.end() - count);
+	}
+
+	Build();
+}
+
+void ProfileStatistics::Clear()
+{
+	m_window.clear();
+	m_treeNodes.clear();
+	m_treeRoots.clear();
+	m_flat.clear();
+	m_frameCount = 0;
+}
+
+void ProfileStatistics::Build()
+{
+	m_treeNodes.clear();
+	m_treeRoots.clear();
+	m_flat.clear();
+
+	m_frameCount = (int)m_window.size();
+	if (m_window.empty()) return;
+
+	// 親ノード と スコープ名 からツリーノードを引く
+	std::unordered_map<uint64_t, int> nodeMap;
+	std::unordered_map<uint32_t, int> flatMap;
+	std::vector<std::vector<float>> nodeSamples;
+	std::vector<std::vector<float>> flatSamples;
+
+	auto getNode = [&](int parent, const ProfileResult& res) -> int
+	{
+		uint64_t key = ((uint64_t)(uint32_t)(parent + 1) << 32) | res.m_nameHash;
+		auto it = nodeMap.find(key);
+		if (it != nodeMap.end()) return it->second;
+
+		int index = (int)m_treeNodes.size();
+		ProfileScopeStats& node = m_treeNodes.emplace_back();
+		node.m_name = res.m_name;
+		node.m_nameHash = res.m_nameHash;
+		node.m_parent = parent;
+		node.m_depth = (parent >= 0) ? m_treeNodes[parent].m_depth + 1 : 0;
+		nodeSamples.emplace_back();
+
+		if (parent >= 0)
+		{
+			m_treeNodes[parent].m_children.push_back(index);
+		}
+		else
+		{
+			m_treeRoots.push_back(index);
+		}
+
+		nodeMap.emplace(key, index);
+		return index;
+	};
+
+	auto getFlat = [&](const ProfileResult& res) -> int
+	{
+		auto it = flatMap.find(res.m_nameHash);
+		if (it != flatMap.end()) return it->second;
+
+		int index = (int)m_flat.size();
+		ProfileScopeStats& stats = m_flat.emplace_back();
+		stats.m_name = res.m_name;
+		stats.m_nameHash = res.m_nameHash;
+		flatSamples.emplace_back();
+
+		flatMap.emplace(res.m_nameHash, index);
+		return index;
+	};
+
+	// スタックから取り除く時に自身の時間を確定する
+	auto closeEntry = [&](const ScopeEntry& entry)
+	{
+		float exclusive = std::max(0.0f, entry.m_result->m_duration - entry.m_childMs);
+		m_treeNodes[entry.m_node].m_exclusiveMs += exclusive;
+		m_flat[entry.m_flat].m_exclusiveMs += exclusive;
+	};
+
+	std::map<std::thread::id, std::vector<const ProfileResult*>> threadResults;
+	std::vector<ScopeEntry> stack;
+
+	for (const ProfileFrame& frame : m_window)
+	{
+		// 結果は区間の終了順に積まれているので、スレッドごとに開始順へ並べ直す
+		for (auto& [id, results] : threadResults) results.clear();
+		for (const ProfileResult& res : frame.m_results)
+		{
+			threadResults[res.m_threadID].push_back(&res);
+		}
+
+		for (auto& [id, results] : threadResults)
+		{
+			std::sort(results.begin(), results.end(), [](const ProfileResult* a, const ProfileResult* b)
+			{
+				if (a->m_startOffset != b->m_startOffset) return a->m_startOffset < b->m_startOffset;
+				return a->m_depth < b->m_depth;
+			});
+
+			stack.clear();
+			for (const ProfileResult* res : results)
+			{
+				// 自分より深い(または同じ深さの)区間と、既に終わっている区間は閉じる
+				while (!stack.empty() &&
+					(stack.back().m_result->m_depth >= res->m_depth ||
+					 stack.back().m_result->m_startOffset + stack.back().m_result->m_duration < res->m_startOffset))
+				{
+					closeEntry(stack.back());
+					stack.pop_back();
+				}
+
+				// 親がフレームをまたいでいる場合は最上位として扱う
+				int parent = -1;
+				if (!stack.empty())
+				{
+					parent = stack.back().m_node;
+					stack.back().m_childMs += res->m_duration;
+				}
+
+				ScopeEntry entry;
+				entry.m_result = res;
+				entry.m_node = getNode(parent, *res);
+				entry.m_flat = getFlat(*res);
+
+				ProfileScopeStats& node = m_treeNodes[entry.m_node];
+				node.m_callCount++;
+				node.m_inclusiveMs += res->m_duration;
+				nodeSamples[entry.m_node].push_back(res->m_duration);
+
+				// 再帰呼び出しの二重計上を避けるため、同名の区間の内側では名前ごとの回数・時間に加えない
+				// ・回数と時間の両方を外側の呼び出しだけで数えるので、平均・パーセンタイルが食い違わない
+				// ・内側の自身の時間は closeEntry で加える
+				bool isNested = std::any_of(stack.begin(), stack.end(),
+					[&entry](const ScopeEntry& e) { return e.m_flat == entry.m_flat; });
+
+				if (!isNested)
+				{
+					ProfileScopeStats& flat = m_flat[entry.m_flat];
+					flat.m_callCount++;
+					flat.m_inclusiveMs += res->m_duration;
+					flatSamples[entry.m_flat].push_back(res->m_duration);
+				}
+
+				stack.push_back(entry);
+			}
+
+			while (!stack.empty())
+			{
+				closeEntry(stack.back());
+				stack.pop_back();
+			}
+		}
+	}
+
+	for (size_t i = 0; i < m_treeNodes.size(); i++)
+	{
+		Finalize(m_treeNodes[i], nodeSamples[i]);
+	}
+	for (size_t i = 0; i < m_flat.size(); i++)
+	{
+		Finalize(m_flat[i], flatSamples[i]);
+	}
+
+	Sort();
+}
+
+bool ProfileStatistics::Less(const ProfileScopeStats& a, const ProfileScopeStats& b) const
+{
+	auto compare = [this](auto lhs, auto rhs)
+	{
+		return m_sortAscending ? (lhs < rhs) : (rhs < lhs);
+	};
+
+	switch (m_sortColumn)
+	{
+	case Column_Name:		return m_sortAscending ? (strcmp(a.m_name, b.m_name) < 0) : (strcmp(a.m_name, b.m_name) > 0);
+	case Column_Calls:		return compare(a.m_callCount, b.m_callCount);
+	case Column_Inclusive:	return compare(a.m_inclusiveMs, b.m_inclusiveMs);
+	case Column_Exclusive:	return compare(a.m_exclusiveMs, b.m_exclusiveMs);
+	case Column_Min:		return compare(a.m_minMs, b.m_minMs);
+	case Column_Avg:		return compare(a.m_avgMs, b.m_avgMs);
+	case Column_Max:		return compare(a.m_maxMs, b.m_maxMs);
+	case Column_P95:		return compare(a.m_p95Ms, b.m_p95Ms);
+	case Column_P99:		return compare(a.m_p99Ms, b.m_p99Ms);
+	default:				return false;
+	}
+}
+
+void ProfileStatistics::Sort()
+{
+	auto indexLess = [this](int a, int b) { return Less(m_treeNodes[a], m_treeNodes[b]); };
+
+	std::stable_sort(m_treeRoots.begin(), m_treeRoots.end(), indexLess);
+	for (ProfileScopeStats& node : m_treeNodes)
+	{
+		std::stable_sort(node.m_children.begin(), node.m_children.end(), indexLess);
+	}
+
+	std::stable_sort(m_flat.begin(), m_flat.end(),
+		[this](const ProfileScopeStats& a, const ProfileScopeStats& b) { return Less(a, b); });
+}
+
+bool ProfileStatistics::ExportCSV(const std::string& filepath) const
+{
+	std::filesystem::path path(filepath);
+	if (path.has_parent_path())
+	{
+		std::filesystem::create_directories(path.parent_path());
+	}
+
+	std::ofstream os(filepath);
+	if (!os) return false;
+
+	// 名前にカンマや引用符が含まれても崩れないようにする
+	auto quote = [](const char* str)
+	{
+		std::string result = "\"";
+		for (const char* c = str; *c; ++c)
+		{
+			if (*c == '"') result += '"';
+			result += *c;
+		}
+		return result + "\"";
+	};
+
+	auto writeStats = [&os](const ProfileScopeStats& stats)
+	{
+		os << stats.m_callCount << ','
+			<< stats.m_inclusiveMs << ',' << stats.m_exclusiveMs << ','
+			<< stats.m_minMs << ',' << stats.m_avgMs << ',' << stats.m_maxMs << ','
+			<< stats.m_p95Ms << ',' << stats.m_p99Ms << '\n';
+	};
+
+	os << "# Frames," << m_frameCount << '\n';
+
+	// 呼び出しツリー (深さ優先、親から順に)
+	os << "Section,Path,Depth,Calls,Inclusive(ms),Exclusive(ms),Min(ms),Avg(ms),Max(ms),P95(ms),P99(ms)\n";
+
+	std::function<void(int, const std::string&)> writeNode = [&](int index, const std::string& parentPath)
+	{
+		const ProfileScopeStats& node = m_treeNodes[index];
+		std::string nodePath = parentPath.empty() ? node.m_name : parentPath + "/" + node.m_name;
+
+		os << "Tree," << quote(nodePath.c_str()) << ',' << node.m_depth << ',';
+		writeStats(node);
+
+		for (int child : node.m_children)
+		{
+			writeNode(child, nodePath);
+		}
+	};
+	for (int root : m_treeRoots)
+	{
+		writeNode(root, "");
+	}
+
+	// スコープ名ごと
+	for (const ProfileScopeStats& stats : m_flat)
+	{
+		os << "Flat," << quote(stats.m_name) << ",0,";
+		writeStats(stats);
+	}
+
+	return (bool)os;
+}
+
+void ProfileStatistics::DrawRow(const ProfileScopeStats& stats) const
+{
+	ImGui::TableNextColumn(); ImGui::Text("%u", stats.m_callCount);
+	ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.m_inclusiveMs);
+	ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.m_exclusiveMs);
+	ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.m_minMs);
+	ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.m_avgMs);
+	ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.m_maxMs);
+	ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.m_p95Ms);
+	ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.m_p99Ms);
+}
+
+void ProfileStatistics::DrawTreeNode(int index) const
+{
+	const ProfileScopeStats& node = m_treeNodes[index];
+
+	ImGui::TableNextRow();
+	ImGui::TableNextColumn();
+
+	ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen;
+	if (node.m_children.empty())
+	{
+		flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+	}
+
+	// 同名ノードが別の親の下にあってもIDが衝突しないようにインデックスを使う
+	bool isOpen = ImGui::TreeNodeEx((void*)(intptr_t)index, flags, "%s", node.m_name);
+	DrawRow(node);
+
+	if (isOpen && !node.m_children.empty())
+	{
+		for (int child : node.m_children)
+		{
+			DrawTreeNode(child);
+		}
+		ImGui::TreePop();
+	}
+}
+
+void ProfileStatistics::DrawImGui()
+{
+	ImGui::Checkbox("Call Tree", &m_showTree);
+	ImGui::SameLine();
+	ImGui::Text("(%d frames)", m_frameCount);
+
+	ImGuiTableFlags tableFlags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg |
+		ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit;
+
+	if (!ImGui::BeginTable("ProfileStatistics", Column_Count, tableFlags, ImVec2(0.0f, 300.0f))) return;
+
+	ImGui::TableSetupScrollFreeze(0, 1);
+	ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch, 0.0f, Column_Name);
+	ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_None, 0.0f, Column_Calls);
+	ImGui::TableSetupColumn("Incl (ms)", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending, 0.0f, Column_Inclusive);
+	ImGui::TableSetupColumn("Excl (ms)", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, Column_Exclusive);
+	ImGui::TableSetupColumn("Min", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, Column_Min);
+	ImGui::TableSetupColumn("Avg", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, Column_Avg);
+	ImGui::TableSetupColumn("Max", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, Column_Max);
+	ImGui::TableSetupColumn("P95", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, Column_P95);
+	ImGui::TableSetupColumn("P99", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, Column_P99);
+	ImGui::TableHeadersRow();
+
+	// ソート指定が変わったら並べ替える
+	if (ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs())
+	{
+		if (sortSpecs->SpecsDirty && sortSpecs->SpecsCount > 0)
+		{
+			m_sortColumn = (int)sortSpecs->Specs[0].ColumnUserID;
+			m_sortAscending = (sortSpecs->Specs[0].SortDirection == ImGuiSortDirection_Ascending);
+			Sort();
+			sortSpecs->SpecsDirty = false;
+		}
+	}
+
+	if (m_showTree)
+	{
+		for (int root : m_treeRoots)
+		{
+			DrawTreeNode(root);
+		}
+	}
+	else
+	{
+		for (const ProfileScopeStats& stats : m_flat)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(stats.m_name);
+			DrawRow(stats);
+		}
+	}
+
+	ImGui::EndTable();
+}
@@ -0,0 +1,89 @@
+﻿#pragma once
+
+struct ProfileFrame;
+
+// 計測区間の集計結果 (呼び出しツリーの1ノード、またはスコープ名ごとの集計)
+struct ProfileScopeStats
+{
+	const char* m_name = nullptr;
+	uint32_t m_nameHash = 0;
+	int m_depth = 0;
+	int m_parent = -1; // 親ノード (-1 = 最上位)
+	std::vector<int> m_children;
+
+	uint32_t m_callCount = 0;
+	double m_inclusiveMs = 0.0; // 子区間を含む合計
+	double m_exclusiveMs = 0.0; // 子区間を除いた合計
+	float m_minMs = 0.0f;
+	float m_avgMs = 0.0f;
+	float m_maxMs = 0.0f;
+	float m_p95Ms = 0.0f;
+	float m_p99Ms = 0.0f;
+};
+
+// 複数フレームにわたる計測区間の統計
+// ・呼び出しツリー (親子関係ごとに集計) と、スコープ名ごとの集計の2種類を持つ
+// ・min/avg/max/p95/p99 は1回の呼び出し(子を含む時間)単位
+// ・スコープ名ごとの集計の呼び出し回数・時間は、再帰の一番外側の呼び出しのみ数える
+//   (自身の時間は全ての深さの分を加える。深さごとの内訳は呼び出しツリーのノードで見る)
+// ・集計するフレームは自分で持つ (プロファイラのロックの外で集計できるように)
+class ProfileStatistics
+{
+public:
+	// 確定したフレーム (古い順) を追加し、直近 windowFrames フレーム分を集計し直す
+	void AddFrames(std::vector<ProfileFrame>&& frames, int windowFrames);
+
+	// 持っているフレームを捨てる (集計するフレーム数を変えた時など)
+	void Clear();
+
+	// 集計したフレーム数
+	int GetFrameCount() const { return m_frameCount; }
+
+	const std::vector<ProfileScopeStats>& GetTreeNodes() const { return m_treeNodes; }
+	const std::vector<int>& GetTreeRoots() const { return m_treeRoots; }
+	const std::vector<ProfileScopeStats>& GetFlat() const { return m_flat; }
+
+	// CSV出力 (ツリー → スコープ名ごと の順)
+	bool ExportCSV(const std::string& filepath) const;
+
+	// ImGui描画 (ソート可能なテーブル)
+	void DrawImGui();
+
+private:
+	// 列 (ImGuiのColumnUserIDとしても使う)
+	enum Column
+	{
+		Column_Name,
+		Column_Calls,
+		Column_Inclusive,
+		Column_Exclusive,
+		Column_Min,
+		Column_Avg,
+		Column_Max,
+		Column_P95,
+		Column_P99,
+		Column_Count
+	};
+
+	// m_window を集計し直す
+	void Build();
+
+	// 現在のソート設定で並べ替える
+	void Sort();
+	bool Less(const ProfileScopeStats& a, const ProfileScopeStats& b) const;
+
+	void DrawRow(const ProfileScopeStats& stats) const;
+	void DrawTreeNode(int index) const;
+
+	std::vector<ProfileFrame> m_window; // 古い順 (ProfileFrame はここでは不完全型なので vector)
+
+	std::vector<ProfileScopeStats> m_treeNodes;
+	std::vector<int> m_treeRoots;
+	std::vector<ProfileScopeStats> m_flat;
+	int m_frameCount = 0;
+
+	// 表示設定
+	bool m_showTree = true;
+	int m_sortColumn = Column_Inclusive;
+	bool m_sortAscending = false;
+};
@@ -0,0 +1,131 @@
+﻿#include "ProfileTraceExporter.h"
+#include "Profiler.h"
+
+using json = nlohmann::json;
+
+bool ProfileTraceExporter::ExportChromeTrace(const std::string& filepath,
+	const std::deque<ProfileFrame>& frames,
+	const std::map<std::thread::id, std::string>& threadNames)
+{
+	if (frames.empty()) return false;
+
+	std::filesystem::path path(filepath);
+	if (path.has_parent_path())
+	{
+		std::filesystem::create_directories(path.parent_path());
+	}
+
+	std::ofstream os(filepath);
+	if (!os) return false;
+
+	// 最初のフレームの開始時刻を時間軸の原点にする (単位 : μs)
+	const auto origin = frames.front().m_startTime;
+	auto toMicro = [&origin](const ProfileFrame& frame, float offsetMs) -> double
+	{
+		double frameStart = std::chrono::duration<double, std::micro>(frame.m_startTime - origin).count();
+		return frameStart + (double)offsetMs * 1000.0;
+	};
+
+	// std::thread::id をトレース用の連番に変換
+	// 0番はフレーム区切り・カウンタ用のレーン
+	std::map<std::thread::id, int> tids;
+	auto getTid = [&tids](const std::thread::id& id) -> int
+	{
+		auto it = tids.find(id);
+		if (it != tids.end()) return it->second;
+
+		int tid = (int)tids.size() + 1;
+		tids.emplace(id, tid);
+		return tid;
+	};
+
+	bool isFirst = true;
+	auto writeEvent = [&os, &isFirst](const json& ev)
+	{
+		os << (isFirst ? "\n" : ",\n");
+		// パス名などにUTF-8以外が混ざっても出力できるように置換モードでダンプ
+		os << ev.dump(-1, ' ', false, json::error_handler_t::replace);
+		isFirst = false;
+	};
+
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	writeEvent({ {"name", "process_name"}, {"ph", "M"}, {"pid", 1}, {"tid", 0}, {"args", {{"name", "Editor"}}} });
+	writeEvent({ {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", 0}, {"args", {{"name", "Frames"}}} });
+
+	for (const ProfileFrame& frame : frames)
+	{
+		// フレーム区切り
+		writeEvent({
+			{"name", "Frame " + std::to_string(frame.m_frameIndex)},
+			{"cat", "frame"}, {"ph", "X"}, {"pid", 1}, {"tid", 0},
+			{"ts", toMicro(frame, 0.0f)}, {"dur", (double)frame.m_duration * 1000.0}
+		});
+
+		// 計測スコープ (ネストはts/durの包含関係でビューア側が復元する)
+		for (const ProfileResult& res : frame.m_results)
+		{
+			writeEvent({
+				{"name", res.m_name}, {"cat", "scope"}, {"ph", "X"}, {"pid", 1}, {"tid", getTid(res.m_threadID)},
+				{"ts", toMicro(frame, res.m_startOffset)}, {"dur", (double)res.m_duration * 1000.0},
+				{"args", {{"depth", res.m_depth}}}
+			});
+		}
+
+		// ジョブのフロー矢印 (投入 → 実行)
+		for (const ProfileFlow& flow : frame.m_flows)
+		{
+			json ev = {
+				{"name", "Job"}, {"cat", "job"}, {"ph", flow.m_isBegin ? "s" : "f"}, {"id", flow.m_id},
+				{"pid", 1}, {"tid", getTid(flow.m_threadID)}, {"ts", toMicro(frame, flow.m_offset)}
+			};
+			// 実行側は包含するスライス(Job Execution)に結びつける
+			if (!flow.m_isBegin) ev["bp"] = "e";
+
+			writeEvent(ev);
+		}
+
+		// ログ (スレッド上のインスタントイベント)
+		for (const ProfileLog& log : frame.m_logs)
+		{
+			writeEvent({
+				{"name", log.m_text}, {"cat", "log"}, {"ph", "i"}, {"s", "t"},
+				{"pid", 1}, {"tid", getTid(log.m_threadID)}, {"ts", toMicro(frame, log.m_offset)}
+			});
+		}
+
+		// カウンタ
+		for (const ProfileCounter& counter : frame.m_counters)
+		{
+			writeEvent({
+				{"name", counter.m_name}, {"ph", "C"}, {"pid", 1}, {"tid", 0},
+				{"ts", toMicro(frame, counter.m_offset)}, {"args", {{"value", counter.m_value}}}
+			});
+		}
+	}
+
+	// スレッド名 (登録されていないスレッドは連番で表示)
+	for (const auto& [id, tid] : tids)
+	{
+		auto it = threadNames.find(id);
+		std::string name = (it != threadNames.end()) ? it->second : "Thread " + std::to_string(tid);
+
+		writeEvent({ {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", tid}, {"args", {{"name", name}}} });
+		writeEvent({ {"name", "thread_sort_index"}, {"ph", "M"}, {"pid", 1}, {"tid", tid}, {"args", {{"sort_index", tid}}} });
+	}
+
+	os << "\n]}\n";
+
+	return (bool)os;
+}
+
+std::string ProfileTraceExporter::MakeFileTimestamp()
+{
+	auto now = std::chrono::system_clock::now();
+	auto time = std::chrono::system_clock::to_time_t(now);
+	std::tm tm;
+	localtime_s(&tm, &time);
+	std::ostringstream oss;
+	oss << std::put_time(&tm, "%Y%m%d_%H%M%S");
+	return oss.str();
+}
@@ -0,0 +1,21 @@
+﻿#pragma once
+
+struct ProfileFrame;
+
+// プロファイル結果のトレース出力
+// ・Chrome Trace Event Format (JSON)
+//   chrome://tracing や Perfetto UI (ui.perfetto.dev) でそのまま読み込める
+class ProfileTraceExporter
+{
+public:
+	// フレーム列をトレースファイルに書き出す
+	// ・filepath		… 出力先 (ディレクトリが無ければ作成する)
+	// ・frames			… 出力するフレーム (古い順)
+	// ・threadNames	… スレッド名 (レーン名として出力)
+	static bool ExportChromeTrace(const std::string& filepath,
+		const std::deque<ProfileFrame>& frames,
+		const std::map<std::thread::id, std::string>& threadNames);
+
+	// ファイル名用のタイムスタンプ (例: 20261019_153000)
+	static std::string MakeFileTimestamp();
+};
@@ -1,27 +1,334 @@
 ﻿#include "Profiler.h"
+#include "ProfileTraceExporter.h"
+#include "../ThreadManager.h"
+
+// スコープのネスト深さ (スレッドごと)
+static thread_local int t_profileDepth = 0;
 
 void Profiler::ResetFrame()
 {
-	// ポーズ中は履歴を更新しない（表示を固定）
-	if (!m_isPaused)
+	auto now = std::chrono::high_resolution_clock::now();
+
+	// メモリ確保の集計もフレームで区切る
+	MemoryProfiler& memory = MemoryProfiler::Instance();
+	memory.EndFrame();
+
+	std::shared_ptr<std::deque<ProfileFrame>> hitchFrames;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// 記録中のフレームを確定
+	if (m_frameCount > 0)
 	{
-		m_historyResults = std::move(m_results);
+		m_current.m_duration = std::chrono::duration<float, std::milli>(now - m_current.m_startTime).count();
+
+		ProfileCounter frameTime;
+		frameTime.m_name = "Frame Time (ms)";
+		frameTime.m_value = m_current.m_duration;
+		frameTime.m_offset = 0.0f;
+		m_current.m_counters.push_back(frameTime);
+
+		FlushCounters();
+
+		if (MemoryProfiler::IsHooked())
+		{
+			m_current.m_counters.push_back({ "Alloc Count", (double)memory.GetTotal().m_frameAllocCount, 0.0f });
+			m_current.m_counters.push_back({ "Alloc Bytes (KB)", (double)memory.GetTotal().m_frameAllocBytes / 1024.0, 0.0f });
+			m_current.m_counters.push_back({ "Live Memory (MB)", (double)memory.GetTotal().m_liveBytes / (1024.0 * 1024.0), 0.0f });
+		}
+
+		// ポーズ中は履歴を更新しない（表示を固定）
+		if (!m_isPaused)
+		{
+			m_historyResults = m_current.m_results;
+
+			hitchFrames = CheckHitch(m_current);
+
+			m_frames.push_back(std::move(m_current));
+			while ((int)m_frames.size() > m_historyFrameCount)
+			{
+				m_frames.pop_front();
+			}
+		}
+	}
+
+	// 新しいフレームを開始
+	m_current = ProfileFrame();
+	m_current.m_frameIndex = m_frameCount++;
+	m_current.m_startTime = now;
+
+	lock.unlock();
+
+	// ジョブ投入もプロファイラを使うので、ロックを外してから
+	if (hitchFrames)
+	{
+		DumpHitch(hitchFrames);
 	}
-	m_results.clear(); 
-    m_frameStartTime = std::chrono::high_resolution_clock::now();
 }
 
-void Profiler::WriteProfile(const std::string& name, float duration, float startOffset)
+void Profiler::WriteProfile(const ProfileName& name, std::chrono::high_resolution_clock::time_point startTime, float duration, int depth)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// フレーム開始時刻は ResetFrame がロック中に書き換えるので、ここで読む
+	float startOffset = std::chrono::duration<float, std::milli>(startTime - m_current.m_startTime).count();
 	
 	ProfileResult res;
-	res.m_name = name;
+	res.m_name = name.m_str;
+	res.m_nameHash = name.m_hash;
 	res.m_duration = duration;
 	res.m_threadID = std::this_thread::get_id();
 	res.m_startOffset = startOffset;
+	res.m_depth = depth;
 	
-	m_results.push_back(res);
+	m_current.m_results.push_back(res);
+}
+
+ProfileName Profiler::InternName(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_internMutex);
+
+	auto it = m_internedNames.insert(name).first;
+	return ProfileName(it->c_str(), KdProfileHash(it->c_str()));
+}
+
+uint64_t Profiler::BeginFlow()
+{
+	uint64_t flowID = ++m_flowCounter;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ProfileFlow flow;
+	flow.m_id = flowID;
+	flow.m_isBegin = true;
+	flow.m_threadID = std::this_thread::get_id();
+	flow.m_offset = GetOffsetFromFrameStart();
+	m_current.m_flows.push_back(flow);
+
+	return flowID;
+}
+
+void Profiler::EndFlow(uint64_t flowID)
+{
+	if (flowID == 0 || !IsEnabled()) return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ProfileFlow flow;
+	flow.m_id = flowID;
+	flow.m_isBegin = false;
+	flow.m_threadID = std::this_thread::get_id();
+	flow.m_offset = GetOffsetFromFrameStart();
+	m_current.m_flows.push_back(flow);
+}
+
+void Profiler::WriteCounter(const std::string& name, double value)
+{
+	ProfileName interned = InternName(name);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ProfileCounter counter;
+	counter.m_name = interned.m_str;
+	counter.m_value = value;
+	counter.m_offset = GetOffsetFromFrameStart();
+	m_current.m_counters.push_back(counter);
+}
+
+int Profiler::RegisterCounter(const char* name, CounterType type)
+{
+	Profiler& profiler = Instance();
+	std::lock_guard<std::mutex> lock(profiler.m_counterMutex);
+
+	for (int i = 0; i < profiler.m_counterSlotCount; i++)
+	{
+		if (strcmp(profiler.m_counterSlots[i].m_name, name) == 0) return i;
+	}
+
+	if (profiler.m_counterSlotCount >= kMaxCounters)
+	{
+		assert(0 && "Profiler::RegisterCounter カウンタの登録数が上限を超えました");
+		return -1;
+	}
+
+	int id = profiler.m_counterSlotCount++;
+	profiler.m_counterSlots[id].m_name = name;
+	profiler.m_counterSlots[id].m_type = type;
+	s_counterValues[id].store(0.0, std::memory_order_relaxed);
+	return id;
+}
+
+void Profiler::FlushCounters()
+{
+	std::lock_guard<std::mutex> lock(m_counterMutex);
+
+	for (int i = 0; i < m_counterSlotCount; i++)
+	{
+		const CounterSlot& slot = m_counterSlots[i];
+
+		double value = (slot.m_type == CounterType::Counter) ?
+			s_counterValues[i].exchange(0.0, std::memory_order_relaxed) :
+			s_counterValues[i].load(std::memory_order_relaxed);
+
+		m_current.m_counters.push_back({ slot.m_name, value, 0.0f });
+	}
+}
+
+void Profiler::WriteLog(const std::string& text)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ProfileLog log;
+	log.m_text = text;
+	log.m_threadID = std::this_thread::get_id();
+	log.m_offset = GetOffsetFromFrameStart();
+	m_current.m_logs.push_back(std::move(log));
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_threadNames[std::this_thread::get_id()] = name;
+}
+
+void Profiler::SetHistoryFrameCount(int count)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_historyFrameCount = std::max(1, count);
+	while ((int)m_frames.size() > m_historyFrameCount)
+	{
+		m_frames.pop_front();
+	}
+}
+
+bool Profiler::ExportChromeTrace(const std::string& filepath)
+{
+	// 書き出し中も計測を止めないようにコピーしてから出力する
+	std::deque<ProfileFrame> frames;
+	std::map<std::thread::id, std::string> threadNames;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		frames = m_frames;
+		threadNames = m_threadNames;
+	}
+
+	bool result = ProfileTraceExporter::ExportChromeTrace(filepath, frames, threadNames);
+	if (result)
+	{
+		Logger::Log("Profiler", "Exported trace (" + std::to_string(frames.size()) + " frames): " + filepath);
+	}
+	else
+	{
+		Logger::Error("Failed to export trace: " + filepath);
+	}
+	return result;
+}
+
+std::shared_ptr<std::deque<ProfileFrame>> Profiler::CheckHitch(const ProfileFrame& frame)
+{
+	if (m_hitchThresholdMs <= 0.0f) return nullptr;
+	if (frame.m_duration < m_hitchThresholdMs) return nullptr;
+	if ((int)frame.m_frameIndex < m_hitchWarmupFrames) return nullptr;
+
+	auto now = std::chrono::high_resolution_clock::now();
+	if (m_hitchCount > 0 && std::chrono::duration<float>(now - m_lastHitchTime).count() < m_hitchCooldownSec)
+	{
+		return nullptr;
+	}
+	m_lastHitchTime = now;
+	m_hitchCount++;
+
+	// 確定済みのフレーム + ヒッチのフレーム
+	auto frames = std::make_shared<std::deque<ProfileFrame>>();
+	int count = std::min((int)m_frames.size(), m_hitchDumpFrameCount - 1);
+	frames->assign(m_frames.end() - count, m_frames.end());
+	frames->push_back(frame);
+	return frames;
+}
+
+void Profiler::DumpHitch(std::shared_ptr<std::deque<ProfileFrame>> frames)
+{
+	const ProfileFrame& hitch = frames->back();
+	std::string filepath = "Log/Profile/Hitch_" + ProfileTraceExporter::MakeFileTimestamp() +
+		"_F" + std::to_string(hitch.m_frameIndex) + ".json";
+	float duration = hitch.m_duration;
+
+	std::map<std::thread::id, std::string> threadNames;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		threadNames = m_threadNames;
+		m_lastHitchFile = filepath;
+	}
+
+	// 書き出しでさらにフレームを止めないようにワーカーで行う
+	ThreadManager::Instance().AddJobWithPriority(Job::Priority::Low, [frames, threadNames, filepath, duration]()
+	{
+		if (ProfileTraceExporter::ExportChromeTrace(filepath, *frames, threadNames))
+		{
+			std::ostringstream oss;
+			oss << std::fixed << std::setprecision(2) << "Hitch detected (" << duration << " ms). Dumped " << frames->size() << " frames: " << filepath;
+			Logger::Log("Profiler", oss.str());
+		}
+		else
+		{
+			Logger::Error("Failed to dump hitch: " + filepath);
+		}
+	});
+}
+
+bool Profiler::ExportStatisticsCSV(const std::string& filepath)
+{
+	UpdateStatistics();
+
+	bool result = m_statistics.ExportCSV(filepath);
+	if (result)
+	{
+		Logger::Log("Profiler", "Exported statistics (" + std::to_string(m_statistics.GetFrameCount()) + " frames): " + filepath);
+	}
+	else
+	{
+		Logger::Error("Failed to export statistics: " + filepath);
+	}
+	return result;
+}
+
+void Profiler::UpdateStatistics()
+{
+	// ロック中は集計済みでないフレームのコピーだけを取り出し、集計はロックの外で行う
+	// (毎フレーム集計しても WriteProfile を止めない)
+	std::vector<ProfileFrame> newFrames;
+	bool isContinuous = true;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_frames.empty()) return;
+
+		uint64_t latest = m_frames.back().m_frameIndex + 1;
+		if (latest == m_statisticsBuiltFrame) return;
+
+		size_t maxCount = (size_t)std::max(1, m_statisticsFrameCount);
+		auto first = m_frames.end();
+		while (first != m_frames.begin() && (size_t)(m_frames.end() - first) < maxCount &&
+			(first - 1)->m_frameIndex >= m_statisticsBuiltFrame)
+		{
+			--first;
+		}
+		newFrames.assign(first, m_frames.end());
+
+		// 間のフレームが無い (ポーズ中・表示していない間に履歴から消えた) なら続けて集計しない
+		isContinuous = (newFrames.front().m_frameIndex == m_statisticsBuiltFrame);
+		m_statisticsBuiltFrame = latest;
+	}
+
+	if (!isContinuous) m_statistics.Clear();
+	m_statistics.AddFrames(std::move(newFrames), m_statisticsFrameCount);
+}
+
+float Profiler::GetOffsetFromFrameStart() const
+{
+	auto now = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<float, std::milli>(now - m_current.m_startTime).count();
 }
 
 void Profiler::DrawProfilerWindow()
@@ -29,11 +336,80 @@ void Profiler::DrawProfilerWindow()
     if (ImGui::Begin("Profiler"))
     {
         // --- Control Panel ---
+        bool enabled = IsEnabled();
+        if (ImGui::Checkbox("Enable", &enabled))
+        {
+            SetEnabled(enabled);
+        }
+        ImGui::SameLine();
         ImGui::Checkbox("Pause", &m_isPaused);
         ImGui::SameLine();
         ImGui::SliderFloat("Scale", &m_timeScale, 0.1f, 10.0f, "x%.1f");
-        
-        ImGui::Text("Total Profiles: %d", m_historyResults.size());
+
+        int historyCount = m_historyFrameCount;
+        if (ImGui::SliderInt("History Frames", &historyCount, 1, 3000))
+        {
+            SetHistoryFrameCount(historyCount);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Export Trace"))
+        {
+            ExportChromeTrace("Log/Profile/Trace_" + ProfileTraceExporter::MakeFileTimestamp() + ".json");
+        }
+
+        // ヒッチ検出
+        bool hitchEnabled = (m_hitchThresholdMs > 0.0f);
+        if (ImGui::Checkbox("Hitch Dump", &hitchEnabled))
+        {
+            m_hitchThresholdMs = hitchEnabled ? 33.3f : 0.0f;
+        }
+        if (hitchEnabled)
+        {
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(120.0f);
+            ImGui::DragFloat("Threshold (ms)", &m_hitchThresholdMs, 0.5f, 1.0f, 1000.0f, "%.1f");
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(120.0f);
+            ImGui::SliderInt("Dump Frames", &m_hitchDumpFrameCount, 1, m_historyFrameCount);
+            ImGui::Text("Hitches: %d  %s", m_hitchCount, m_lastHitchFile.c_str());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ImGui::Text("Total Profiles: %d", (int)m_historyResults.size());
+            ImGui::Text("Recorded Frames: %d", (int)m_frames.size());
+        }
+
+        // --- Statistics ---
+        if (ImGui::CollapsingHeader("Scope Statistics"))
+        {
+            if (ImGui::SliderInt("Window Frames", &m_statisticsFrameCount, 1, m_historyFrameCount))
+            {
+                // 保持しているフレームから集計し直す
+                m_statistics.Clear();
+                m_statisticsBuiltFrame = 0;
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Export CSV"))
+            {
+                ExportStatisticsCSV("Log/Profile/Stats_" + ProfileTraceExporter::MakeFileTimestamp() + ".csv");
+            }
+
+            UpdateStatistics();
+            m_statistics.DrawImGui();
+        }
+
+        // --- Counters ---
+        if (ImGui::CollapsingHeader("Counters"))
+        {
+            DrawCounterGraphs();
+        }
+
+        // --- Memory ---
+        if (ImGui::CollapsingHeader("Memory"))
+        {
+            MemoryProfiler::Instance().DrawImGui();
+        }
 
         // --- Visualization ---
         // 各スレッドごとにレーンを分ける
@@ -79,25 +455,34 @@ void Profiler::DrawProfilerWindow()
             if (x1 > p.x + width) x1 = p.x + width;
 
             // 色分け (ハッシュ)
-            std::hash<std::string> hasher;
-            size_t hash = hasher(res.m_name);
+            uint32_t hash = res.m_nameHash;
             ImU32 col = IM_COL32((hash & 0xFF), ((hash >> 8) & 0xFF) | 100, ((hash >> 16) & 0xFF) | 100, 200);
 
+            // ネストの深さに応じて少し縮める
+            float inset = std::min(res.m_depth * 3.0f, rowHeight * 0.4f);
+            y0 += inset;
+
             ImGui::GetWindowDrawList()->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), col);
             
             // 文字は枠内に収まるときだけ
             if (x1 - x0 > 20.0f)
             {
-                ImGui::GetWindowDrawList()->AddText(ImVec2(x0 + 2, y0 + 2), IM_COL32(255, 255, 255, 255), res.m_name.c_str());
+                ImGui::GetWindowDrawList()->AddText(ImVec2(x0 + 2, y0 + 2), IM_COL32(255, 255, 255, 255), res.m_name);
             }
 
             // マウスホバーで詳細表示
             if (ImGui::IsMouseHoveringRect(ImVec2(x0, y0), ImVec2(x1, y1)))
             {
                 ImGui::BeginTooltip();
-                ImGui::Text("%s", res.m_name.c_str());
+                ImGui::Text("%s", res.m_name);
                 ImGui::Text("Time: %.4f ms", res.m_duration);
                 ImGui::Text("Offset: %.4f ms", res.m_startOffset);
+                ImGui::Text("Depth: %d", res.m_depth);
+                auto nameIt = m_threadNames.find(res.m_threadID);
+                if (nameIt != m_threadNames.end())
+                {
+                    ImGui::Text("Thread: %s", nameIt->second.c_str());
+                }
                 ImGui::EndTooltip();
                 
                 // ホバー時に枠を明るくする
@@ -116,24 +501,56 @@ void Profiler::DrawProfilerWindow()
     ImGui::End();
 }
 
+void Profiler::DrawCounterGraphs()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_frames.empty()) return;
+
+    // 最新フレームにあるカウンタを、保持しているフレーム分の時系列で表示する
+    std::vector<float> values;
+    for (const ProfileCounter& latest : m_frames.back().m_counters)
+    {
+        values.clear();
+        for (const ProfileFrame& frame : m_frames)
+        {
+            float value = 0.0f;
+            for (const ProfileCounter& counter : frame.m_counters)
+            {
+                // 名前はリテラルかインターン済みなのでアドレスで比較できる
+                if (counter.m_name == latest.m_name)
+                {
+                    value = (float)counter.m_value;
+                    break;
+                }
+            }
+            values.push_back(value);
+        }
+
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%.2f", latest.m_value);
+
+        ImGui::PlotLines(latest.m_name, values.data(), (int)values.size(), 0, overlay, FLT_MAX, FLT_MAX, ImVec2(0.0f, 40.0f));
+    }
+}
+
 // --- ScopedProfile ---
 
-ScopedProfile::ScopedProfile(const std::string& name)
-    : m_name(name)
+void ScopedProfile::Begin(const ProfileName& name)
 {
+    m_name = name.m_str;
+    m_nameHash = name.m_hash;
+    m_depth = t_profileDepth++;
     m_startTime = std::chrono::high_resolution_clock::now();
 }
 
-ScopedProfile::~ScopedProfile()
+void ScopedProfile::End()
 {
     auto endTime = std::chrono::high_resolution_clock::now();
+    --t_profileDepth;
     
     // 経過時間 (ms)
     float duration = std::chrono::duration<float, std::milli>(endTime - m_startTime).count();
-    
-    // フレーム開始からのオフセット
-    auto frameStart = Profiler::Instance().GetFrameStartTime();
-    float startOffset = std::chrono::duration<float, std::milli>(m_startTime - frameStart).count();
 
-    Profiler::Instance().WriteProfile(m_name, duration, startOffset);
+    Profiler::Instance().WriteProfile(ProfileName(m_name, m_nameHash), m_startTime, duration, m_depth);
 }
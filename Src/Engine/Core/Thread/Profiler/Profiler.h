@@ -1,12 +1,87 @@
 ﻿#pragma once
 
+#include "ProfileStatistics.h"
+
+//====================================================
+// ビルドスイッチ
+// ・KD_PROFILE=1 … 計測コードを埋め込む (実行時に Profiler::SetEnabled で ON/OFF)
+// ・KD_PROFILE=0 … 計測コードを完全に取り除く (出荷ビルド用)
+// _DEBUG とは独立しているので、最適化ビルドでも計測できる
+//====================================================
+#ifndef KD_PROFILE
+#define KD_PROFILE 1
+#endif
+
+// コンパイル時文字列ハッシュ (FNV-1a 32bit)
+constexpr uint32_t KdProfileHash(const char* str)
+{
+	uint32_t hash = 2166136261u;
+	while (*str)
+	{
+		hash ^= (uint32_t)(unsigned char)(*str++);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// 計測区間の名前
+// ・文字列リテラルから constexpr で生成すると、ハッシュ計算は実行時に発生しない
+struct ProfileName
+{
+	const char* m_str = nullptr;
+	uint32_t m_hash = 0;
+
+	constexpr ProfileName(const char* str) : m_str(str), m_hash(KdProfileHash(str)) {}
+	constexpr ProfileName(const char* str, uint32_t hash) : m_str(str), m_hash(hash) {}
+};
+
 // プロファイルデータ（1区間の計測結果）
 struct ProfileResult
 {
-	std::string m_name;
+	const char* m_name = nullptr; // リテラル or Profiler::InternName で確保した文字列
+	uint32_t m_nameHash = 0;
 	float m_duration; // ms
 	std::thread::id m_threadID;
 	float m_startOffset; // フレーム開始からの経過時間 (ms)
+	int m_depth = 0; // スコープのネスト深さ (0 = 最上位)
+};
+
+// ジョブのフロー（投入 → 実行）の端点
+struct ProfileFlow
+{
+	uint64_t m_id = 0;
+	bool m_isBegin = true; // true : 投入側 / false : 実行側
+	std::thread::id m_threadID;
+	float m_offset = 0.0f; // フレーム開始からの経過時間 (ms)
+};
+
+// カウンタのサンプル値
+struct ProfileCounter
+{
+	const char* m_name = nullptr; // リテラル or Profiler::InternName で確保した文字列
+	double m_value = 0.0;
+	float m_offset = 0.0f; // フレーム開始からの経過時間 (ms)
+};
+
+// ログ1行 (ヒッチ発生時のダンプ用)
+struct ProfileLog
+{
+	std::string m_text;
+	std::thread::id m_threadID;
+	float m_offset = 0.0f; // フレーム開始からの経過時間 (ms)
+};
+
+// 1フレーム分の計測結果
+struct ProfileFrame
+{
+	uint64_t m_frameIndex = 0;
+	std::chrono::high_resolution_clock::time_point m_startTime;
+	float m_duration = 0.0f; // ms
+
+	std::vector<ProfileResult> m_results;
+	std::vector<ProfileFlow> m_flows;
+	std::vector<ProfileCounter> m_counters;
+	std::vector<ProfileLog> m_logs;
 };
 
 // プロファイラ
@@ -19,26 +94,149 @@ public:
 		return instance;
 	}
 
+	// 実行時の有効/無効
+	// 無効時の計測コストは ScopedProfile 内の分岐1つのみ
+	static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+	static void SetEnabled(bool enable) { s_enabled.store(enable, std::memory_order_relaxed); }
+
 	void ResetFrame();
-	void WriteProfile(const std::string& name, float duration, float startOffset);
+	// startTime … 区間の開始時刻 (フレーム開始からのオフセットはロックを取った中で求める)
+	void WriteProfile(const ProfileName& name, std::chrono::high_resolution_clock::time_point startTime, float duration, int depth = 0);
+
+	// 動的な名前(アセットパスなど)を登録し、プロファイラが寿命を持つ文字列を返す
+	ProfileName InternName(const std::string& name);
+
+	// ジョブフローの記録 (BeginFlowで発行したIDをEndFlowに渡す)
+	uint64_t BeginFlow();
+	void EndFlow(uint64_t flowID);
+
+	// カウンタ値の記録 (その時点の値を1つ記録する)
+	void WriteCounter(const std::string& name, double value);
+
+	// フレーム単位のカウンタ/ゲージ
+	// ・Counter … フレーム中に加算し、フレームの終わりに記録して0に戻す (ドローコール数など)
+	// ・Gauge   … 最後に設定した値をフレームの終わりに記録する (エンティティ数など)
+	// 加算/設定はロックを取らずアトミック操作のみ
+	enum class CounterType
+	{
+		Counter,
+		Gauge
+	};
+	static constexpr int kMaxCounters = 128;
+
+	// 名前を登録し番号を返す (同じ名前なら同じ番号。上限を超えたら-1)
+	// ・name は文字列リテラルなどプログラム終了まで有効なもの
+	static int RegisterCounter(const char* name, CounterType type);
+	static void AddCounter(int id, double value)
+	{
+		if (id >= 0) s_counterValues[id].fetch_add(value, std::memory_order_relaxed);
+	}
+	static void SetGauge(int id, double value)
+	{
+		if (id >= 0) s_counterValues[id].store(value, std::memory_order_relaxed);
+	}
+
+	// ログの記録 (Logger から呼ばれる)
+	void WriteLog(const std::string& text);
+
+	// 現在のスレッドに名前を付ける (トレース出力用)
+	void SetThreadName(const std::string& name);
 
 	// ImGui描画
 	void DrawProfilerWindow();
 
-	// フレームごとの計測結果を取得
-	const std::vector<ProfileResult>& GetResults() const { return m_results; }
+	// 保持している直近Nフレームを Chrome Trace Event 形式(JSON)で書き出す
+	// chrome://tracing や Perfetto UI でそのまま開ける
+	bool ExportChromeTrace(const std::string& filepath);
 
-    // フレーム開始時間を取得
-    std::chrono::high_resolution_clock::time_point GetFrameStartTime() const { return m_frameStartTime; }
+	// 計測区間の統計 (直近Nフレームを集計) をCSVで書き出す
+	bool ExportStatisticsCSV(const std::string& filepath);
+
+	// 保持するフレーム数
+	void SetHistoryFrameCount(int count);
+	int GetHistoryFrameCount() const { return m_historyFrameCount; }
+
+	// ヒッチ検出
+	// ・1フレームが thresholdMs を超えたら、直近のフレームをトレースファイルに書き出す
+	// ・記録済みのリングバッファをそのまま使うので、ヒッチが起きるまで追加のコストは無い
+	// ・thresholdMs <= 0 で無効
+	void SetHitchThreshold(float thresholdMs) { m_hitchThresholdMs = thresholdMs; }
+	float GetHitchThreshold() const { return m_hitchThresholdMs; }
+	void SetHitchDumpFrameCount(int count) { m_hitchDumpFrameCount = std::max(1, count); }
 
 private:
 	Profiler() {}
-	
-    std::chrono::high_resolution_clock::time_point m_frameStartTime;
-	std::vector<ProfileResult> m_results;
+
+	// 経過時間 (フレーム開始から, ms。m_mutexをロックした状態で呼ぶ)
+	float GetOffsetFromFrameStart() const;
+
+	// 統計を最新のフレームで集計し直す
+	void UpdateStatistics();
+
+	// 登録されたカウンタ/ゲージを記録中のフレームに書き込む (m_mutexをロックした状態で呼ぶ)
+	void FlushCounters();
+
+	// カウンタのグラフ描画
+	void DrawCounterGraphs();
+
+	// ヒッチなら直近のフレームを書き出し用に取り出す (m_mutexをロックした状態で呼ぶ)
+	std::shared_ptr<std::deque<ProfileFrame>> CheckHitch(const ProfileFrame& frame);
+
+	// ヒッチのダンプをワーカースレッドで書き出す
+	void DumpHitch(std::shared_ptr<std::deque<ProfileFrame>> frames);
+
+	// 記録中のフレーム
+	ProfileFrame m_current;
+	// 直近Nフレームのリングバッファ
+	std::deque<ProfileFrame> m_frames;
+	int m_historyFrameCount = 300;
+	uint64_t m_frameCount = 0;
+
+	// 表示用 (ポーズ中は固定)
 	std::vector<ProfileResult> m_historyResults;
+
+	// スレッド名 (m_mutex で保護する)
+	std::map<std::thread::id, std::string> m_threadNames;
+
+	// ヒッチ検出
+	float m_hitchThresholdMs = 0.0f;
+	int m_hitchDumpFrameCount = 120;
+	float m_hitchCooldownSec = 5.0f; // 連続したヒッチでファイルが溢れないように
+	int m_hitchWarmupFrames = 30;	 // 起動直後の重いフレームは対象外
+	std::chrono::high_resolution_clock::time_point m_lastHitchTime;
+	int m_hitchCount = 0;
+	std::string m_lastHitchFile;
+
+	// 計測区間の統計
+	ProfileStatistics m_statistics;
+	int m_statisticsFrameCount = 120;
+	uint64_t m_statisticsBuiltFrame = 0; // 集計済みのフレーム (同じなら再集計しない)
+
+	// 動的な名前の保管庫 (要素のアドレスは再ハッシュでも変わらない)
+	std::unordered_set<std::string> m_internedNames;
+	std::mutex m_internMutex;
+
+	std::atomic<uint64_t> m_flowCounter = 0;
 	std::mutex m_mutex;
 
+	// フレーム単位のカウンタ/ゲージ
+	struct CounterSlot
+	{
+		const char* m_name = nullptr;
+		CounterType m_type = CounterType::Counter;
+	};
+	CounterSlot m_counterSlots[kMaxCounters];
+	int m_counterSlotCount = 0;
+	std::mutex m_counterMutex;
+	static inline std::atomic<double> s_counterValues[kMaxCounters];
+
+#ifdef _DEBUG
+	static inline std::atomic<bool> s_enabled = true;
+#else
+	// 最適化ビルドでは必要な時だけONにする
+	static inline std::atomic<bool> s_enabled = false;
+#endif
+
 	// グラフ描画用の一時バッファなどはcpp側で
 	bool m_isPaused = false;
 	float m_timeScale = 1.0f;
@@ -48,19 +246,67 @@ private:
 class ScopedProfile
 {
 public:
-	ScopedProfile(const std::string& name);
-	~ScopedProfile();
+	// PROFILE_SCOPE / PROFILE_FUNCTION / PROFILE_SCOPE_DYNAMIC
+	// ・PROFILE_SCOPE_DYNAMIC は無効時に名前を作らず m_str が nullptr のものを渡す
+	ScopedProfile(const ProfileName& name)
+	{
+		if (!Profiler::IsEnabled() || !name.m_str) return;
+		Begin(name);
+	}
+
+	~ScopedProfile()
+	{
+		if (m_name) End();
+	}
 
 private:
-	std::string m_name;
+	void Begin(const ProfileName& name);
+	void End();
+
+	const char* m_name = nullptr;
+	uint32_t m_nameHash = 0;
 	std::chrono::high_resolution_clock::time_point m_startTime;
+	int m_depth = 0;
 };
 
-// マクロ定義 (リリースビルドで無効化できるように)
-#ifdef _DEBUG
-#define PROFILE_FUNCTION() ScopedProfile timer(__FUNCTION__)
-#define PROFILE_SCOPE(name) ScopedProfile timer(name)
+// マクロ定義 (KD_PROFILE=0 で完全に無効化できるように)
+#define KD_PROFILE_CONCAT_INNER(a, b) a##b
+#define KD_PROFILE_CONCAT(a, b) KD_PROFILE_CONCAT_INNER(a, b)
+
+#if KD_PROFILE
+#define PROFILE_SCOPE(name) \
+	static constexpr ProfileName KD_PROFILE_CONCAT(kdProfileName, __LINE__)(name); \
+	ScopedProfile KD_PROFILE_CONCAT(kdProfileScope, __LINE__)(KD_PROFILE_CONCAT(kdProfileName, __LINE__))
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+// 名前の文字列は有効な時だけ組み立てる
+#define PROFILE_SCOPE_DYNAMIC(name) \
+	ScopedProfile KD_PROFILE_CONCAT(kdProfileScope, __LINE__)( \
+		Profiler::IsEnabled() ? Profiler::Instance().InternName(name) : ProfileName(nullptr, 0u))
+#define PROFILE_FLOW_BEGIN() (Profiler::IsEnabled() ? Profiler::Instance().BeginFlow() : 0)
+#define PROFILE_FLOW_END(id) Profiler::Instance().EndFlow(id)
+#define PROFILE_COUNTER(name, value) \
+	do { \
+		if (Profiler::IsEnabled()) Profiler::Instance().WriteCounter(name, (double)(value)); \
+	} while (0)
+#define PROFILE_COUNT(name, value) \
+	do { \
+		static const int kdCounterID = Profiler::RegisterCounter(name, Profiler::CounterType::Counter); \
+		if (Profiler::IsEnabled()) Profiler::AddCounter(kdCounterID, (double)(value)); \
+	} while (0)
+#define PROFILE_GAUGE(name, value) \
+	do { \
+		static const int kdCounterID = Profiler::RegisterCounter(name, Profiler::CounterType::Gauge); \
+		if (Profiler::IsEnabled()) Profiler::SetGauge(kdCounterID, (double)(value)); \
+	} while (0)
 #else
 #define PROFILE_FUNCTION()
 #define PROFILE_SCOPE(name)
+#define PROFILE_SCOPE_DYNAMIC(name)
+#define PROFILE_FLOW_BEGIN() 0
+#define PROFILE_FLOW_END(id) ((void)(id))
+#define PROFILE_COUNTER(name, value) do {} while (0)
+#define PROFILE_COUNT(name, value) do {} while (0)
+#define PROFILE_GAUGE(name, value) do {} while (0)
 #endif
+
+#include "MemoryProfiler.h"
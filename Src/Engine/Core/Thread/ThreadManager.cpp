@@ -1,5 +1,4 @@
 ﻿#include "ThreadManager.h"
-#include "Profiler/Profiler.h"
 
 void ThreadManager::Init()
 {
@@ -16,7 +15,7 @@ void ThreadManager::Init()
 	m_workers.reserve(numThreads);
 	for (unsigned int threadIdx = 0; threadIdx < numThreads; ++threadIdx)
 	{
-		m_workers.emplace_back(std::bind(&ThreadManager::WorkerThreadLoop, this));
+		m_workers.emplace_back(std::bind(&ThreadManager::WorkerThreadLoop, this, threadIdx));
 	}
 }
 
@@ -43,8 +42,11 @@ void ThreadManager::Release()
 	m_workers.clear();
 }
 
-void ThreadManager::WorkerThreadLoop()
+void ThreadManager::WorkerThreadLoop(unsigned int threadIdx)
 {
+	// トレース出力用のスレッド名
+	Profiler::Instance().SetThreadName("Worker " + std::to_string(threadIdx));
+
 	while (true)
 	{
 		Job job(nullptr);
@@ -54,20 +56,23 @@ void ThreadManager::WorkerThreadLoop()
 
 			// ジョブが来るか、停止フラグが立つまで待機
 			m_condition.wait(lock, [this] {
-				return m_stop || !m_jobs.empty();
+				return m_stop || HasJobLocked();
 			});
 
 			// 停止フラグかつジョブもなければ終了
-			if (m_stop && m_jobs.empty())
+			if (m_stop && !HasJobLocked())
 			{
 				return;
 			}
 
-			// ジョブを取り出す
-			if (!m_jobs.empty())
+			// 優先度の高いキューからジョブを取り出す
+			for (std::queue<Job>& jobs : m_jobs)
 			{
-				job = std::move(m_jobs.front());
-				m_jobs.pop();
+				if (jobs.empty()) { continue; }
+
+				job = std::move(jobs.front());
+				jobs.pop();
+				break;
 			}
 		}
 
@@ -77,6 +82,7 @@ void ThreadManager::WorkerThreadLoop()
 			try
 			{
 				PROFILE_SCOPE("Job Execution");
+				PROFILE_FLOW_END(job.m_flowID);
 				job.m_func();
 			}
 			catch (...)
@@ -85,3 +91,12 @@ void ThreadManager::WorkerThreadLoop()
 		}
 	}
 }
+
+bool ThreadManager::HasJobLocked() const
+{
+	for (const std::queue<Job>& jobs : m_jobs)
+	{
+		if (!jobs.empty()) { return true; }
+	}
+	return false;
+}
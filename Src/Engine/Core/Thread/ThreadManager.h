@@ -1,12 +1,18 @@
 ﻿#pragma once
+#include "Profiler/Profiler.h"
+
 // ジョブ
 struct Job
 {
+	// ワーカースレッドは優先度の高いジョブから取り出す (同じ優先度の中では投入順)
+	// ・高い優先度のジョブが投入され続けると、低い優先度のジョブは待たされたままになる
 	enum class Priority
 	{
 		High,
 		Normal,
-		Low
+		Low,
+
+		Count
 	};
 
 	// 実行する関数
@@ -15,9 +21,12 @@ struct Job
 	// 優先度
 	Priority m_priority = Priority::Normal;
 
+	// プロファイラ用フローID (投入 → 実行の矢印)
+	uint64_t m_flowID = 0;
+
 	// コンストラクタ
-	Job(std::function<void()> func, Priority prio = Priority::Normal)
-		: m_func(func), m_priority(prio) {}
+	Job(std::function<void()> func, Priority prio = Priority::Normal, uint64_t flowID = 0)
+		: m_func(func), m_priority(prio), m_flowID(flowID) {}
 };
 
 // スレッド
@@ -30,6 +39,9 @@ public:
 	// 終了処理
 	void Release();
 
+	// ワーカースレッド数
+	size_t GetWorkerCount() const { return m_workers.size(); }
+
 	// ジョブ投入 
 	template<typename Func, typename... Args>
 	auto AddJob(Func&& func, Args&&... args) -> std::future<typename std::invoke_result<Func, Args...>::type>
@@ -43,12 +55,15 @@ public:
 
 		std::future<ReturnType> res = task->get_future();
 
+		uint64_t flowID = PROFILE_FLOW_BEGIN();
+		PROFILE_COUNT("Jobs Submitted", 1);
+
 		{
 			std::unique_lock<std::mutex> lock(m_queueMutex);
 
 			// ラムダ式でラップしてキューに入れる
 			// (packaged_taskを実行するだけのジョブ)
-			m_jobs.emplace([task]() { (*task)(); });
+			m_jobs[(size_t)Job::Priority::Normal].emplace([task]() { (*task)(); }, Job::Priority::Normal, flowID);
 		}
 
 		// 待機中のスレッドを1つ起こす
@@ -70,11 +85,14 @@ public:
 
 		std::future<ReturnType> res = task->get_future();
 
+		uint64_t flowID = PROFILE_FLOW_BEGIN();
+		PROFILE_COUNT("Jobs Submitted", 1);
+
 		{
 			std::unique_lock<std::mutex> lock(m_queueMutex);
 
-			// 優先度付きでキューに入れる
-			m_jobs.emplace([task]() { (*task)(); }, priority);
+			// 優先度ごとのキューに入れる
+			m_jobs[(size_t)priority].emplace([task]() { (*task)(); }, priority, flowID);
 		}
 
 		// 待機中のスレッドを1つ起こす
@@ -88,13 +106,16 @@ private:
 	~ThreadManager() { Release(); }
 
 	// ワーカースレッドのループ関数
-	void WorkerThreadLoop();
+	void WorkerThreadLoop(unsigned int threadIdx);
 
 	// ワーカースレッドリスト
 	std::vector<std::thread> m_workers;
 
-	// ジョブキュー
-	std::queue<Job> m_jobs;
+	// 取り出すジョブがあるか (m_queueMutex をロックして呼ぶ)
+	bool HasJobLocked() const;
+
+	// ジョブキュー (優先度ごと)
+	std::array<std::queue<Job>, (size_t)Job::Priority::Count> m_jobs;
 
 	// 排他制御用
 	std::mutex m_queueMutex;
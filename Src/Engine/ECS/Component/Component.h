@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 class Entity;
+struct SceneComponentSchema;
+class SceneBinaryReader;
 
 class Component
 {
@@ -22,6 +24,12 @@ public:
 
 	virtual void Serialize(nlohmann::json& j) const {}
 	virtual void Deserialize(const nlohmann::json& j) {}
+
+	// バイナリシーン (SceneBinary) 用
+	// ・GetBinarySchema … Serialize が書き出すキーと型の並び (nullptr なら JSON を MessagePack にして保存する)
+	// ・DeserializeBinary … スキーマの順に読む (ファイルのスキーマが同じ版の時だけ呼ばれ、違えば Deserialize が呼ばれる)
+	virtual const SceneComponentSchema* GetBinarySchema() const { return nullptr; }
+	virtual void DeserializeBinary(SceneBinaryReader& reader) {}
 	
 	// Identifier for Factory and Serialization key
 	virtual const char* GetType() const = 0;
@@ -29,10 +37,24 @@ public:
 	void SetOwner(const std::shared_ptr<Entity>& owner) { m_owner = owner; }
 	std::shared_ptr<Entity> GetOwner() const { return m_owner.lock(); }
 
-	void SetEnable(bool enable) { m_enable = enable; }
+	void SetEnable(bool enable) { m_enable = enable; MarkDirty(); }
 	bool IsEnable() const { return m_enable; }
 
+	// 保存用の変更番号 (Serialize の結果が変わる値を変えたら MarkDirty を呼ぶ)
+	// ・SceneSaver は前回の保存から番号が変わったエンティティだけを書き直す
+	void MarkDirty() { m_revision = NextRevision(); }
+	uint64_t GetRevision() const { return m_revision; }
+
+	// エンティティ・コンポーネントで共通の通し番号 (変更のたびに増えるので、最大値を見れば変更が分かる)
+	static uint64_t NextRevision()
+	{
+		static std::atomic<uint64_t> s_revision = 0;
+		return ++s_revision;
+	}
+
 protected:
 	std::weak_ptr<Entity> m_owner;
 	bool m_enable = true;
+
+	uint64_t m_revision = 0;
 };
@@ -14,17 +14,23 @@ public:
 	using Creator = std::function<std::shared_ptr<Component>()>;
 
 	// Register a component type
+	// ・起動時 (シーンを読み込む前) に登録すること (FindCreator で返した作り方を置き換えないように)
 	template <typename T>
 	void Register(const std::string& typeName)
 	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
 		m_creators[typeName] = []() -> std::shared_ptr<Component> {
 			return std::make_shared<T>();
 		};
 	}
 
 	// Create a component by name
+	// ・シーンの並列読み込みで、複数のワーカースレッドから同時に呼ばれる
 	std::shared_ptr<Component> Create(const std::string& typeName)
 	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
 		auto it = m_creators.find(typeName);
 		if (it != m_creators.end())
 		{
@@ -33,8 +39,18 @@ public:
 		return nullptr;
 	}
 
+	// 作り方を探す (同じ型をまとめて作る時に、名前で探すのを1回で済ませる)
+	const Creator* FindCreator(const std::string& typeName) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+		auto it = m_creators.find(typeName);
+		return it != m_creators.end() ? &it->second : nullptr;
+	}
+
 private:
-	std::map<std::string, Creator> m_creators;
+	mutable std::shared_mutex			m_mutex;
+	std::map<std::string, Creator>	m_creators;
 
 	ComponentFactory() {}
 	~ComponentFactory() {}
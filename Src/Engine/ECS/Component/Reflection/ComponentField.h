@@ -0,0 +1,50 @@
+﻿#pragma once
+
+//=====================================================
+//
+// コンポーネントのフィールド記述
+//
+// ・コンポーネントは保存するフィールドを GetFields() に1回だけ書く
+//   JSON・バイナリ・インスペクタのコードは ComponentReflection.h のテンプレートがそこから作る
+// ・メンバーはメンバーポインタで持つので、どのメンバーかはコンパイル時に決まる
+// ・キーのハッシュもコンパイル時に計算しておき、読み込み時は JSON のキーのハッシュと比べるだけにする
+//
+//   static constexpr uint32_t kFieldVersion = 1;	// フィールドを足す・消す・型や順番を変えたら上げる
+//   static constexpr auto GetFields()
+//   {
+//       return std::make_tuple(
+//           ComponentField("Position", &TransformComponent::m_position, 0.1f),
+//           ...);
+//   }
+//
+// 使える型 … bool / int32_t / uint32_t / float / Math::Vector3 / std::string
+//
+//=====================================================
+
+// フィールド名のハッシュ (FNV-1a 32bit)
+constexpr uint32_t ComponentFieldHash(std::string_view name)
+{
+	uint32_t hash = 2166136261u;
+	for (char c : name)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+template <typename C, typename T>
+struct ComponentField
+{
+	const char*	m_name = nullptr;		// JSON のキー・インスペクタの表示名
+	uint32_t	m_hash = 0;
+	T C::*		m_member = nullptr;
+
+	// インスペクタ用 (数値だけ。min == max なら制限なし)
+	float		m_dragSpeed = 0.1f;
+	float		m_min = 0.0f;
+	float		m_max = 0.0f;
+
+	constexpr ComponentField(const char* name, T C::* member, float dragSpeed = 0.1f, float min = 0.0f, float max = 0.0f)
+		: m_name(name), m_hash(ComponentFieldHash(name)), m_member(member), m_dragSpeed(dragSpeed), m_min(min), m_max(max) {}
+};
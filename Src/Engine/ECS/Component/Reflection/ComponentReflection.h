@@ -0,0 +1,215 @@
+﻿#pragma once
+#include "ComponentField.h"
+#include "../../../Serializer/SceneBinary.h"
+
+//=====================================================
+//
+// GetFields() からのコード生成
+//
+// ・フィールドはタプルで持ち、std::apply で展開するので、ループも型による分岐もコンパイル時に消える
+// ・コンポーネントの .cpp から呼ぶ (読み込み後の処理があるコンポーネントは、呼んだ後に自分で行う)
+//
+//   void TransformComponent::Serialize(json& j) const { ComponentReflection::Serialize(*this, j); }
+//
+//=====================================================
+namespace ComponentReflection
+{
+	// 型 → バイナリシーンのフィールドの型
+	template <typename T>
+	constexpr SceneFieldType GetSceneFieldType()
+	{
+		if constexpr (std::is_same_v<T, bool>)					{ return SceneFieldType::Bool; }
+		else if constexpr (std::is_same_v<T, int32_t>)			{ return SceneFieldType::Int; }
+		else if constexpr (std::is_same_v<T, uint32_t>)			{ return SceneFieldType::UInt; }
+		else if constexpr (std::is_same_v<T, float>)			{ return SceneFieldType::Float; }
+		else if constexpr (std::is_same_v<T, Math::Vector3>)	{ return SceneFieldType::Vector3; }
+		else
+		{
+			static_assert(std::is_same_v<T, std::string>, "ComponentField: unsupported field type");
+			return SceneFieldType::String;
+		}
+	}
+
+	// 同じハッシュのフィールドが無いか (キーの照合はハッシュだけで決めるので)
+	template <typename Fields>
+	constexpr bool HasUniqueHashes(const Fields& fields)
+	{
+		return std::apply([](const auto&... field)
+			{
+				const uint32_t hashes[] = { 0u, field.m_hash... };
+				for (size_t i = 1; i < std::size(hashes); ++i)
+				{
+					for (size_t k = i + 1; k < std::size(hashes); ++k)
+					{
+						if (hashes[i] == hashes[k]) { return false; }
+					}
+				}
+				return true;
+			}, fields);
+	}
+
+	// 1つの値を JSON から読む (型が合わなければ読まずに false)
+	template <typename T>
+	bool ReadJsonValue(const nlohmann::json& j, T& out)
+	{
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			if (!j.is_boolean()) { return false; }
+			out = j.get<bool>();
+		}
+		else if constexpr (std::is_same_v<T, Math::Vector3>)
+		{
+			if (!j.is_array() || j.size() < 3 || !j[0].is_number() || !j[1].is_number() || !j[2].is_number()) { return false; }
+			out = Math::Vector3(j[0].get<float>(), j[1].get<float>(), j[2].get<float>());
+		}
+		else if constexpr (std::is_same_v<T, std::string>)
+		{
+			if (!j.is_string()) { return false; }
+			out = j.get_ref<const std::string&>();
+		}
+		else
+		{
+			if (!j.is_number()) { return false; }
+			out = j.get<T>();
+		}
+		return true;
+	}
+
+	template <typename T>
+	nlohmann::json WriteJsonValue(const T& value)
+	{
+		if constexpr (std::is_same_v<T, Math::Vector3>)
+		{
+			return nlohmann::json{ value.x, value.y, value.z };
+		}
+		else
+		{
+			return nlohmann::json(value);
+		}
+	}
+
+	template <typename T>
+	void ReadBinaryValue(SceneBinaryReader& reader, T& out)
+	{
+		constexpr SceneFieldType type = GetSceneFieldType<T>();
+		if constexpr (type == SceneFieldType::Bool)			{ out = reader.ReadBool(); }
+		else if constexpr (type == SceneFieldType::Int)		{ out = reader.ReadInt(); }
+		else if constexpr (type == SceneFieldType::UInt)	{ out = reader.ReadUInt(); }
+		else if constexpr (type == SceneFieldType::Float)	{ out = reader.ReadFloat(); }
+		else if constexpr (type == SceneFieldType::Vector3)	{ out = reader.ReadVector3(); }
+		else												{ out = reader.ReadString(); }
+	}
+
+	// 1つの値のインスペクタ (変えたら true)
+	template <typename C, typename T>
+	bool DrawValue(const ComponentField<C, T>& field, T& value)
+	{
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			return ImGui::Checkbox(field.m_name, &value);
+		}
+		else if constexpr (std::is_same_v<T, int32_t>)
+		{
+			return ImGui::DragInt(field.m_name, &value, field.m_dragSpeed, (int)field.m_min, (int)field.m_max);
+		}
+		else if constexpr (std::is_same_v<T, uint32_t>)
+		{
+			return ImGui::DragScalar(field.m_name, ImGuiDataType_U32, &value, field.m_dragSpeed);
+		}
+		else if constexpr (std::is_same_v<T, float>)
+		{
+			return ImGui::DragFloat(field.m_name, &value, field.m_dragSpeed, field.m_min, field.m_max);
+		}
+		else if constexpr (std::is_same_v<T, Math::Vector3>)
+		{
+			return ImGui::DragFloat3(field.m_name, &value.x, field.m_dragSpeed, field.m_min, field.m_max);
+		}
+		else
+		{
+			char buffer[MAX_PATH] = "";
+			strncpy_s(buffer, value.c_str(), _TRUNCATE);
+			if (!ImGui::InputText(field.m_name, buffer, sizeof(buffer), ImGuiInputTextFlags_EnterReturnsTrue)) { return false; }
+
+			value = buffer;
+			return true;
+		}
+	}
+
+	//-------------------------------------------------
+	// コンポーネント単位
+	//-------------------------------------------------
+
+	template <typename C>
+	void Serialize(const C& component, nlohmann::json& j)
+	{
+		j = nlohmann::json::object();
+		std::apply([&](const auto&... field)
+			{
+				(j.emplace(field.m_name, WriteJsonValue(component.*field.m_member)), ...);
+			}, C::GetFields());
+	}
+
+	// JSON のキーを1回ずつ見て、ハッシュが一致するフィールドに入れる
+	// ・無いキー・型が合わない値は今の値のまま (作ったばかりならデフォルト値)
+	template <typename C>
+	void Deserialize(C& component, const nlohmann::json& j)
+	{
+		static_assert(HasUniqueHashes(C::GetFields()), "ComponentField: duplicate field name hash");
+
+		if (!j.is_object()) { return; }
+
+		for (auto it = j.begin(); it != j.end(); ++it)
+		{
+			const std::string& key = it.key();
+			const uint32_t hash = ComponentFieldHash(key);
+
+			std::apply([&](const auto&... field)
+				{
+					((field.m_hash == hash && key == field.m_name && ReadJsonValue(it.value(), component.*field.m_member)) || ...);
+				}, C::GetFields());
+		}
+	}
+
+	// バイナリシーン用のスキーマ (フィールドの順)
+	template <typename C>
+	const SceneComponentSchema* GetBinarySchema()
+	{
+		static const SceneComponentSchema schema = []()
+			{
+				SceneComponentSchema result;
+				result.m_version = C::kFieldVersion;
+				std::apply([&](const auto&... field)
+					{
+						(result.m_fields.push_back({ field.m_name,
+							GetSceneFieldType<std::remove_cvref_t<decltype(std::declval<C&>().*field.m_member)>>() }), ...);
+					}, C::GetFields());
+				return result;
+			}();
+		return &schema;
+	}
+
+	template <typename C>
+	void DeserializeBinary(C& component, SceneBinaryReader& reader)
+	{
+		std::apply([&](const auto&... field)
+			{
+				(ReadBinaryValue(reader, component.*field.m_member), ...);
+			}, C::GetFields());
+	}
+
+	// フィールドを並べたインスペクタ (どれかを変えたら true。MarkDirty は呼ぶ側で)
+	template <typename C>
+	bool DrawInspector(C& component)
+	{
+		bool changed = false;
+
+		ImGui::PushID(component.GetType());
+		std::apply([&](const auto&... field)
+			{
+				((changed |= DrawValue(field, component.*field.m_member)), ...);
+			}, C::GetFields());
+		ImGui::PopID();
+
+		return changed;
+	}
+}
@@ -136,6 +136,16 @@ Math::Matrix Entity::GetMatrix() const
 	return Math::Matrix::Identity;
 }
 
+uint64_t Entity::GetRevision() const
+{
+	uint64_t revision = m_revision;
+	for (const auto& [type, comp] : m_components)
+	{
+		revision = std::max(revision, comp->GetRevision());
+	}
+	return revision;
+}
+
 void Entity::DrawDebug()
 {
 	if (!m_visible) return;
@@ -154,6 +164,7 @@ void Entity::AddComponent(const std::shared_ptr<Component>& component)
 	component->SetOwner(shared_from_this());
 	// Using typeid(*component) gets the runtime type of the object
 	m_components[std::type_index(typeid(*component))] = component;
+	MarkDirty();
 	
 	if (IsInitialized())
 	{
@@ -36,7 +36,7 @@ public:
 	virtual void DrawInspector();
 	virtual void DrawDebug();
 
-	void SetName(const std::string& name)	 { m_name = name; }
+	void SetName(const std::string& name)	 { m_name = name; MarkDirty(); }
 	const std::string& GetName() const		 { return m_name; }
 
 	void SetVisible(bool visible)			 { m_visible = visible; }
@@ -64,6 +64,10 @@ public:
 
 	Math::Matrix GetMatrix() const;
 
+	// 保存用の変更番号 (名前・コンポーネントの構成と、各コンポーネントの番号の最大値)
+	void MarkDirty() { m_revision = Component::NextRevision(); }
+	uint64_t GetRevision() const;
+
 private:
 	std::string m_name	= "Entity";
 	bool m_initialized	= false;
@@ -73,6 +77,8 @@ private:
 	State m_state = State::Constructed;
 
 	std::unordered_map<std::type_index, std::shared_ptr<Component>> m_components;
+
+	uint64_t m_revision = 0;
 };
 
 template <typename T>
@@ -83,6 +89,7 @@ void Entity::AddComponent(const std::shared_ptr<T>& component)
 
 	component->SetOwner(shared_from_this());
 	m_components[std::type_index(typeid(T))] = component;
+	MarkDirty();
 	if (IsInitialized())
 	{
 		component->Init();
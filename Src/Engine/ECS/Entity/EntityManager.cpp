@@ -1,4 +1,5 @@
 ﻿#include "EntityManager.h"
+#include "../../Core/Thread/Profiler/Profiler.h"
 
 void EntityManager::Update()
 {
@@ -6,6 +7,8 @@ void EntityManager::Update()
 	{
 		entity->Update();
 	}
+
+	WriteProfileCounters();
 }
 
 void EntityManager::PostUpdate()
@@ -60,6 +63,20 @@ void EntityManager::AddEntity(const std::shared_ptr<Entity>& entity)
 	}
 }
 
+void EntityManager::AddEntities(std::vector<std::shared_ptr<Entity>>& entities)
+{
+	// Queue for addition
+	m_pendingAddList.reserve(m_pendingAddList.size() + entities.size());
+	for (auto& entity : entities)
+	{
+		if (entity)
+		{
+			m_pendingAddList.push_back(std::move(entity));
+		}
+	}
+	entities.clear();
+}
+
 void EntityManager::RemoveEntity(const std::shared_ptr<Entity>& entity)
 {
 	if (entity)
@@ -69,6 +86,19 @@ void EntityManager::RemoveEntity(const std::shared_ptr<Entity>& entity)
 	}
 }
 
+void EntityManager::RemoveEntities(const std::vector<std::shared_ptr<Entity>>& entities)
+{
+	// Queue for removal
+	m_pendingRemoveList.reserve(m_pendingRemoveList.size() + entities.size());
+	for (const auto& entity : entities)
+	{
+		if (entity)
+		{
+			m_pendingRemoveList.push_back(entity);
+		}
+	}
+}
+
 void EntityManager::ProcessPendingUpdates()
 {
 	// Add pending entities
@@ -80,13 +110,19 @@ void EntityManager::ProcessPendingUpdates()
 	m_pendingAddList.clear();
 
 	// Remove pending entities
-	for (const auto& entity : m_pendingRemoveList)
+	// セル単位でまとめて消されるので、1回の走査で消す
+	if (!m_pendingRemoveList.empty())
 	{
-		auto it = std::remove(m_entityList.begin(), m_entityList.end(), entity);
-		if (it != m_entityList.end())
+		std::unordered_set<Entity*> removeSet;
+		removeSet.reserve(m_pendingRemoveList.size());
+		for (const auto& entity : m_pendingRemoveList)
 		{
-			m_entityList.erase(it, m_entityList.end());
+			removeSet.insert(entity.get());
 		}
+
+		auto it = std::remove_if(m_entityList.begin(), m_entityList.end(),
+			[&removeSet](const std::shared_ptr<Entity>& entity) { return removeSet.count(entity.get()) > 0; });
+		m_entityList.erase(it, m_entityList.end());
 	}
 	m_pendingRemoveList.clear();
 }
@@ -96,4 +132,42 @@ void EntityManager::ClearEntities()
 	m_entityList.clear();
 	m_pendingAddList.clear();
 	m_pendingRemoveList.clear();
-}
\ No newline at end of file
+}
+
+void EntityManager::WriteProfileCounters() const
+{
+#if KD_PROFILE
+	if (!Profiler::IsEnabled()) return;
+
+	PROFILE_GAUGE("Entities", m_entityList.size());
+
+	// コンポーネントの種類ごとの数
+	// GetType() はリテラルを返すので、アドレスをキーにしてカウンタ番号を覚えておく
+	static std::unordered_map<const char*, int> s_componentCounterIDs;
+	std::unordered_map<const char*, int> counts;
+
+	for (const auto& entity : m_entityList)
+	{
+		for (const auto& [type, component] : entity->GetAllComponents())
+		{
+			counts[component->GetType()]++;
+		}
+	}
+
+	for (const auto& [typeName, count] : counts)
+	{
+		if (s_componentCounterIDs.find(typeName) == s_componentCounterIDs.end())
+		{
+			ProfileName name = Profiler::Instance().InternName(std::string("Components: ") + typeName);
+			s_componentCounterIDs[typeName] = Profiler::RegisterCounter(name.m_str, Profiler::CounterType::Gauge);
+		}
+	}
+
+	// 居なくなった種類も0として記録する
+	for (const auto& [typeName, id] : s_componentCounterIDs)
+	{
+		auto it = counts.find(typeName);
+		Profiler::SetGauge(id, (it != counts.end()) ? (double)it->second : 0.0);
+	}
+#endif
+}
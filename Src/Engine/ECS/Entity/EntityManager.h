@@ -12,7 +12,9 @@ public:
 	void InitEntities();
 	void ActivateEntities();
 	void AddEntity(const std::shared_ptr<Entity>& entity);
+	void AddEntities(std::vector<std::shared_ptr<Entity>>& entities);	// まとめて追加 (entities は空になる)
 	void RemoveEntity(const std::shared_ptr<Entity>& entity);
+	void RemoveEntities(const std::vector<std::shared_ptr<Entity>>& entities);	// まとめて削除
 	void ClearEntities();
 	void ProcessPendingUpdates();
 
@@ -26,6 +28,9 @@ private:
 	std::vector<std::shared_ptr<Entity>> m_pendingAddList;
 	std::vector<std::shared_ptr<Entity>> m_pendingRemoveList;
 
+	// エンティティ数・コンポーネント数をプロファイラへ
+	void WriteProfileCounters() const;
+
 public:
 	static EntityManager& Instance()
 	{
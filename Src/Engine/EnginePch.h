@@ -11,6 +11,7 @@
 // Engine
 // ============================================
 #include "ECS/Component/Component.h"
+#include "ECS/Component/Reflection/ComponentField.h"
 #include "ECS/Entity/Entity/Entity.h"
 
 #include "Components/Render/RenderComponent.h"
@@ -0,0 +1,133 @@
+﻿#include "AssetResidencyPanel.h"
+
+namespace
+{
+	const char* kCategoryNames[(int)KdAssetCategory::Count] = { "Texture", "Mesh", "Animation" };
+
+	double ToMB(uint64_t bytes) { return bytes / (1024.0 * 1024.0); }
+}
+
+void AssetResidencyPanel::Draw()
+{
+	if (ImGui::Begin("Asset Residency"))
+	{
+		DrawContents();
+	}
+	ImGui::End();
+}
+
+void AssetResidencyPanel::DrawContents()
+{
+	KdAssets& assets = KdAssets::Instance();
+
+	// 区分ごとの使用量と予算
+	for (int i = 0; i < (int)KdAssetCategory::Count; ++i)
+	{
+		KdAssetCategory category = (KdAssetCategory)i;
+
+		uint64_t resident = assets.GetResidentMemory()[category];
+		uint64_t budget = assets.GetBudget(category);
+
+		char overlay[64];
+		if (budget > 0)
+		{
+			snprintf(overlay, sizeof(overlay), "%.1f / %.1f MB", ToMB(resident), ToMB(budget));
+		}
+		else
+		{
+			snprintf(overlay, sizeof(overlay), "%.1f MB (no budget)", ToMB(resident));
+		}
+
+		ImGui::ProgressBar(budget > 0 ? (float)((double)resident / budget) : 0.0f, ImVec2(240.0f, 0.0f), overlay);
+		ImGui::SameLine();
+
+		int budgetMB = (int)(budget / (1024 * 1024));
+		ImGui::SetNextItemWidth(100.0f);
+		if (ImGui::DragInt((std::string(kCategoryNames[i]) + " Budget (MB)").c_str(), &budgetMB, 1.0f, 0, 16 * 1024))
+		{
+			assets.SetBudget(category, (uint64_t)budgetMB * 1024 * 1024);
+		}
+	}
+
+	if (ImGui::Button("Evict Unreferenced"))
+	{
+		assets.ClearData(false);
+	}
+
+	// アセットごとのメモリ量 (大きい順)
+	std::vector<KdDataStorage<KdTexture>::ResidencyInfo> textures;
+	std::vector<KdDataStorage<KdModelData>::ResidencyInfo> models;
+	assets.m_textures.GetResidency(textures);
+	assets.m_modeldatas.GetResidency(models);
+
+	struct Row
+	{
+		const char* m_type;
+		const std::string* m_name;
+		KdAssetMemory m_memory;
+		uint64_t m_lastUsedFrame;
+		long m_useCount;
+		bool m_isLoading;
+	};
+	std::vector<Row> rows;
+	rows.reserve(textures.size() + models.size());
+	for (const auto& info : textures) { rows.push_back({ "Texture", &info.m_name, info.m_memory, info.m_lastUsedFrame, info.m_useCount, info.m_isLoading }); }
+	for (const auto& info : models) { rows.push_back({ "Model", &info.m_name, info.m_memory, info.m_lastUsedFrame, info.m_useCount, info.m_isLoading }); }
+
+	std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.m_memory.GetTotal() > b.m_memory.GetTotal(); });
+
+	m_filter.Draw("Filter", 200.0f);
+
+	ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+	if (ImGui::BeginTable("AssetResidency", 6, flags, ImVec2(0.0f, 300.0f)))
+	{
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Asset", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Type");
+		ImGui::TableSetupColumn("Size (KB)");
+		ImGui::TableSetupColumn("Detail");
+		ImGui::TableSetupColumn("Refs");
+		ImGui::TableSetupColumn("Unused (frames)");
+		ImGui::TableHeadersRow();
+
+		for (const Row& row : rows)
+		{
+			if (!m_filter.PassFilter(row.m_name->c_str())) { continue; }
+
+			ImGui::TableNextRow();
+
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(row.m_name->c_str());
+
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(row.m_type);
+
+			ImGui::TableNextColumn();
+			if (row.m_isLoading)
+			{
+				ImGui::TextDisabled("Loading");
+			}
+			else
+			{
+				ImGui::Text("%.1f", row.m_memory.GetTotal() / 1024.0);
+			}
+
+			ImGui::TableNextColumn();
+			if (row.m_memory[KdAssetCategory::Animation] > 0)
+			{
+				ImGui::Text("Mesh %.1f / Anim %.1f", row.m_memory[KdAssetCategory::Mesh] / 1024.0, row.m_memory[KdAssetCategory::Animation] / 1024.0);
+			}
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%ld", row.m_useCount);
+
+			ImGui::TableNextColumn();
+			if (row.m_useCount == 0 && !row.m_isLoading)
+			{
+				ImGui::Text("%llu", (unsigned long long)(assets.GetFrame() - row.m_lastUsedFrame));
+			}
+		}
+
+		ImGui::EndTable();
+	}
+}
@@ -0,0 +1,15 @@
+﻿#pragma once
+
+// アセットの常駐状況の表示 ("Asset Residency" ウィンドウ)
+// ・区分ごとの使用量と予算、アセットごとのメモリ量と参照状況
+// ・エディタのデバッグウィンドウと一緒に EditorManager が描画する
+class AssetResidencyPanel
+{
+public:
+	void Draw();
+
+private:
+	void DrawContents();
+
+	ImGuiTextFilter	m_filter;
+};
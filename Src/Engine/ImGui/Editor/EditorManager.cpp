@@ -1,8 +1,12 @@
 ﻿#include "EditorManager.h"
 #include "../../Scene/SceneManager.h"
 #include "../../Core/Thread/Profiler/Profiler.h"
+#include "../../Core/Thread/ThreadManager.h"
 #include "File/ImGuiFileBrowser.h"
 #include "../../Serializer/SceneSerializer.h"
+#include "../../Serializer/SceneBinary.h"
+#include "../../Serializer/SceneSaver.h"
+#include "../../Scene/WorldPartition/WorldStreamer.h"
 #include "EditorCamera/EditorCamera.h"
 #include "Command/CommandManager.h"
 #include "Command/CmdTransform.h"
@@ -12,6 +16,7 @@
 #include "../../Render/RenderSystem.h"
 #include "EditorUI/Panels/HierarchyPanel.h"
 #include "EditorUI/Panels/InspectorPanel.h"
+#include "../Debug/Asset/AssetResidencyPanel.h"
 
 void EditorManager::Init()
 {
@@ -26,6 +31,7 @@ void EditorManager::Init()
     // パネル初期化
     m_hierarchyPanel = std::make_shared<EditorPanels::HierarchyPanel>();
     m_inspectorPanel = std::make_shared<EditorPanels::InspectorPanel>();
+    m_assetResidencyPanel = std::make_shared<AssetResidencyPanel>();
 
     m_isPlayerView = false;
     m_prevAltV = false;
@@ -65,6 +71,20 @@ void EditorManager::Update()
         }
 	}
     m_prevAltV = currTrigger;
+
+    // 失敗した手動保存の書き直し (保存を頼んだ時の内容なので、プレイ中でも書いてよい)
+    SceneSaver::Instance().UpdateRetry();
+
+    // 自動保存 (プレイ中はゲームが動かした値なので保存しない)
+    // ・セルを読んでいる間は読んだ分しか居ないので保存しない
+    if (!m_isPlayerView && !WorldStreamer::Instance().IsActive())
+    {
+        std::shared_ptr<CameraBase> cam = m_camera.lock();
+        if (!cam) cam = m_editorCamera;
+
+        SceneSaver::Instance().UpdateAutosave(SceneManager::Instance().GetCurrentSceneName(),
+            EntityManager::Instance().GetEntityList(), cam);
+    }
 }
 
 void EditorManager::Draw()
@@ -200,7 +220,12 @@ void EditorManager::DrawUI()
 					if (!cam) cam = m_editorCamera; // フォールバック
 
 					std::string currentScene = SceneManager::Instance().GetCurrentSceneName();
-					if (!currentScene.empty())
+					if (WorldStreamer::Instance().IsActive())
+					{
+						// 読んだセルの分だけで元のシーンを上書きしてしまう
+						Logger::Error("Cannot save while world partition streaming is active (disable streaming and reload the scene)");
+					}
+					else if (!currentScene.empty())
 					{
 						std::string path = "Asset/Data/Scene/" + currentScene + ".json";
 						const auto& entities = EntityManager::Instance().GetEntityList();
@@ -223,11 +248,102 @@ void EditorManager::DrawUI()
 							bool res = SceneSerializer::Load(path, loadedEntities, cam);
 							if (res)
 							{
+								WorldStreamer::Instance().End();
 								EntityManager::Instance().ClearEntities();
 								for (auto& entity : loadedEntities) EntityManager::Instance().AddEntity(entity);
 							}
 						});
 				}
+				ImGui::Separator();
+				if (ImGui::MenuItem("Build Asset Pack"))
+				{
+					// 重いのでワーカーで作る
+					// ・マウント中のパックファイルは置き換えられないので外す
+					// ・編集中のファイルが読まれるように、作ったものは次回の起動からマウントする
+					ThreadManager::Instance().AddJobWithPriority(Job::Priority::Low, []()
+						{
+							KdFileSystem::Instance().Unmount("Asset.kdpak");
+
+							if (KdPackFile::Build("Asset", "Asset.kdpak"))
+							{
+								Logger::Log("Editor", "Asset pack built: Asset.kdpak");
+							}
+							else
+							{
+								Logger::Error("Failed to build asset pack");
+							}
+						});
+				}
+				if (ImGui::MenuItem("Convert Scenes to Binary"))
+				{
+					SceneBinary::ConvertDirectory("Asset/Data/Scene");
+				}
+				{
+					// 実行時と同じようにバイナリから読んで確かめる時だけ入れる (普段は編集の元の JSON を読む)
+					bool preferBinary = SceneSerializer::IsPreferBinary();
+					if (ImGui::MenuItem("Load Binary Scenes", NULL, &preferBinary))
+					{
+						SceneSerializer::SetPreferBinary(preferBinary);
+					}
+				}
+				if (ImGui::MenuItem("Build World Partition"))
+				{
+					// 保存済みのシーン JSON から作る (セルの大きさは前回のまま)
+					std::string currentScene = SceneManager::Instance().GetCurrentSceneName();
+					if (!currentScene.empty())
+					{
+						std::string path = "Asset/Data/Scene/" + currentScene + ".json";
+
+						// 保存したばかりのシーンは書き終えてから読む
+						// (ジョブの中で待つと、書き込みのジョブがその後ろに積まれていた時に回らなくなる)
+						SceneSaver::Instance().Wait(path);
+
+						ThreadManager::Instance().AddJobWithPriority(Job::Priority::Low, [path]()
+							{
+								WorldPartition partition;
+								float cellSize = partition.Load(WorldPartition::GetIndexPath(path)) ? partition.m_cellSize : WorldPartition::kDefaultCellSize;
+
+								if (!WorldPartition::Build(path, cellSize))
+								{
+									Logger::Error("Failed to build world partition: " + path);
+								}
+							});
+					}
+				}
+				{
+					// 切り替えたらシーンを読み直す
+					bool isStreaming = WorldStreamer::Instance().IsEnabled();
+					if (ImGui::MenuItem("World Partition Streaming", NULL, &isStreaming))
+					{
+						WorldStreamer::Instance().SetEnabled(isStreaming);
+						SceneManager::Instance().ChangeScene(SceneManager::Instance().GetCurrentSceneName());
+					}
+					if (WorldStreamer::Instance().IsActive())
+					{
+						ImGui::TextDisabled("Cells: %zu / %zu (%llu MB)", WorldStreamer::Instance().GetLoadedCellCount(),
+							WorldStreamer::Instance().GetCellCount(), WorldStreamer::Instance().GetResidentBytes() / (1024 * 1024));
+					}
+				}
+				if (ImGui::MenuItem("Convert Binary Scene to JSON"))
+				{
+					// バイナリしか無いシーンを編集用の JSON に戻す
+					ImGuiFileBrowser::Instance().Open(
+						"ConvertSceneBinary",
+						"Convert Scene Binary",
+						{ ".scnb" },
+						[](const std::string& path)
+						{
+							std::string jsonPath = std::filesystem::path(path).replace_extension(".json").string();
+							if (SceneBinary::ConvertToJson(path, jsonPath))
+							{
+								Logger::Log("Editor", "Converted scene binary to: " + jsonPath);
+							}
+							else
+							{
+								Logger::Error("Failed to convert scene binary: " + path);
+							}
+						});
+				}
 				ImGui::EndMenu();
 			}
 
@@ -256,6 +372,17 @@ void EditorManager::DrawUI()
 				ImGui::EndMenu();
 			}
 
+			// 手動保存の失敗 (書き直すまで出しておく)
+			std::string failedSavePath;
+			if (SceneSaver::Instance().GetFailedSavePath(failedSavePath))
+			{
+				ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Save failed: %s", failedSavePath.c_str());
+				if (ImGui::SmallButton("Retry"))
+				{
+					SceneSaver::Instance().RetryFailedSave();
+				}
+			}
+
 			ImGui::EndMainMenuBar();
 		}
 	}
@@ -300,6 +427,9 @@ void EditorManager::DrawUI()
 			// プロファイラ描画
 			Profiler::Instance().DrawProfilerWindow();
 
+			// アセットの常駐状況
+			if (m_assetResidencyPanel) m_assetResidencyPanel->Draw();
+
 			// ImGuiFileDialog描画
 			ImGuiFileBrowser::Instance().Draw();
 		}
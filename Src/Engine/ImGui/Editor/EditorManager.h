@@ -6,6 +6,7 @@
 class CameraBase;
 class EditorScene;
 class EditorCamera;
+class AssetResidencyPanel;
 namespace EditorPanels {
 	class HierarchyPanel;
 	class InspectorPanel;
@@ -63,4 +64,7 @@ private:
     // Panels
     std::shared_ptr<EditorPanels::HierarchyPanel> m_hierarchyPanel;
     std::shared_ptr<EditorPanels::InspectorPanel> m_inspectorPanel;
+
+    // デバッグウィンドウ
+    std::shared_ptr<AssetResidencyPanel> m_assetResidencyPanel;
 };
\ No newline at end of file
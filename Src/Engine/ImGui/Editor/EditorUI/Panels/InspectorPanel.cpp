@@ -23,13 +23,8 @@ namespace
 				bool enable = trans->IsEnable();
 				if (ImGui::Checkbox("Enable##Transform", &enable)) trans->SetEnable(enable);
 
-				Math::Vector3 pos = trans->GetPosition();
-				Math::Vector3 rot = trans->GetRotation();
-				Math::Vector3 scale = trans->GetScale();
-
-				if (ImGui::DragFloat3("Position", &pos.x, 0.1f))	trans->SetPosition(pos);
-				if (ImGui::DragFloat3("Rotation", &rot.x, 0.1f))	trans->SetRotation(rot);
-				if (ImGui::DragFloat3("Scale", &scale.x, 0.1f))	trans->SetScale(scale);
+				// Position / Rotation / Scale (GetFields から)
+				trans->DrawInspector();
 			}
 		}
 	}
@@ -1,4 +1,5 @@
 ﻿#include "Logger.h"
+#include "../../Core/Thread/Profiler/Profiler.h"
 
 static ImGuiTextBuffer     Buf;
 static ImGuiTextFilter     Filter;
@@ -70,18 +71,33 @@ void Logger::DrawAddLog()
 
 void Logger::Add(const char* fmt, ...)
 {
-	std::lock_guard<std::mutex> lock(s_mutex);
-
-	int old_size = Buf.size();
-	va_list args;
-	va_start(args, fmt);
-	Buf.appendfv(fmt, args);
-	va_end(args);
-	for (int new_size = Buf.size(); old_size < new_size; old_size++)
+	std::string line;
 	{
-		if (Buf[old_size] == '\n')
+		std::lock_guard<std::mutex> lock(s_mutex);
+
+		int old_size = Buf.size();
+		va_list args;
+		va_start(args, fmt);
+		Buf.appendfv(fmt, args);
+		va_end(args);
+
+		line.assign(Buf.begin() + old_size, Buf.end());
+
+		for (int new_size = Buf.size(); old_size < new_size; old_size++)
 		{
-			LineOffsets.push_back(old_size + 1);
+			if (Buf[old_size] == '\n')
+			{
+				LineOffsets.push_back(old_size + 1);
+			}
 		}
 	}
+
+#if KD_PROFILE
+	// ヒッチ発生時のダンプに含めるため、プロファイラにも残す
+	if (Profiler::IsEnabled())
+	{
+		while (!line.empty() && line.back() == '\n') line.pop_back();
+		Profiler::Instance().WriteLog(line);
+	}
+#endif
 }
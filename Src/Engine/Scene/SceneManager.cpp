@@ -3,46 +3,150 @@
 #include "../../Application/Scene/BaseScene/BaseScene.h"
 #include "../ECS/Entity/EntityManager.h"
 #include "../Render/RenderSystem.h"
+#include "../Core/Thread/Asset/AsyncAssetLoader.h"
+#include "../Serializer/SceneManifest.h"
+#include "../Serializer/SceneSaver.h"
+#include "WorldPartition/WorldStreamer.h"
 
 void SceneManager::Update()
 {
 	// Scene Transition
 	if (!m_nextSceneName.empty())
 	{
-		if (m_currentScene) m_currentScene->Release();
-		EntityManager::Instance().ClearEntities();
-
-
-		auto it = m_sceneRegistry.find(m_nextSceneName);
-		if (it != m_sceneRegistry.end())
+		// 前のシーンを片付けて、次のシーンのアセットを読み始める
+		if (!m_isPreloading || m_preloadSceneName != m_nextSceneName)
 		{
-			m_currentScene = it->second();
-		}
-		else
-		{
-			auto scene = std::make_shared<BaseScene>();
-			scene->SetName(m_nextSceneName);
-			m_currentScene = scene;
-		}
+			if (m_currentScene) m_currentScene->Release();
+			m_currentScene = nullptr;
+			WorldStreamer::Instance().End();
+			EntityManager::Instance().ClearEntities();
 
-		m_currentSceneName = m_nextSceneName;
+			StartPreload(m_nextSceneName);
+		}
 
-		if (m_currentScene)
+		// 全て読み終わったらシーンを作る (それまでは GetLoadProgress でロード画面を出す)
+		LoadProgress progress = GetLoadProgress();
+		if (progress.m_finishedCount >= progress.m_totalCount)
 		{
-			m_currentScene->Init();
+			EnterNextScene();
 		}
-		EntityManager::Instance().InitEntities();
-		EntityManager::Instance().ActivateEntities();
-		m_nextSceneName.clear();
 	}
 
 	// Logic Update
 	if (m_currentScene) m_currentScene->Update();
+
+	// ワールドパーティションのセルの読み込み・解放 (カメラの周り)
+	WorldStreamer::Instance().Update(KdShaderManager::Instance().GetCameraCB().CamPos);
 	
 	// Safety: Process Entity additions/removals at the end of frame logic
 	EntityManager::Instance().ProcessPendingUpdates();
 }
 
+void SceneManager::StartPreload(const std::string& sceneName)
+{
+	m_preloadAssets.clear();
+	m_preloadSceneName = sceneName;
+	m_isPreloading = true;
+
+	// セルを読むシーンは、常駐するエンティティの分だけ待つ (セルのアセットはセルと一緒に読む)
+	std::string scenePath = "Asset/Data/Scene/" + sceneName + ".json";
+
+	// 保存したばかりなら、マニフェストを書き終えてから読む
+	SceneSaver::Instance().Wait(scenePath);
+
+	if (WorldStreamer::Instance().IsEnabled() && WorldPartition::IsUpToDate(scenePath))
+	{
+		scenePath = WorldPartition::GetPersistentPath(scenePath);
+	}
+
+	SceneManifest manifest;
+	if (!manifest.Load(SceneManifest::GetManifestPath(scenePath))) { return; }
+
+	// マニフェストの順 (優先度 → サイズの大きい順) に投入する
+	// ・ワーカースレッドは同じ優先度の中では投入順に取り出すので、大きいものから並列に読まれる
+	m_preloadAssets.reserve(manifest.m_assets.size());
+	for (const SceneManifest::Asset& asset : manifest.m_assets)
+	{
+		PreloadAsset& preload = m_preloadAssets.emplace_back();
+		preload.m_size = asset.m_size;
+
+		switch (asset.m_type)
+		{
+		case SceneManifest::AssetType::Model:
+			preload.m_spAsset = KdAssets::Instance().m_modeldatas.GetData(asset.m_path);
+			break;
+		case SceneManifest::AssetType::Texture:
+			preload.m_spAsset = KdAssets::Instance().m_textures.GetData(asset.m_path);
+			break;
+		case SceneManifest::AssetType::Sound:
+			// 音はワーカースレッドで読めないので、ここで読んでしまう
+			KdAudioManager::Instance().PreloadSound(asset.m_path);
+			break;
+		}
+	}
+
+	Logger::Log("SceneManager", "Preload " + sceneName + ": " + std::to_string(m_preloadAssets.size()) + " assets, "
+		+ std::to_string(manifest.GetTotalSize() / 1024) + " KB");
+}
+
+SceneManager::LoadProgress SceneManager::GetLoadProgress() const
+{
+	LoadProgress progress;
+	progress.m_totalCount = m_preloadAssets.size();
+
+	for (const PreloadAsset& preload : m_preloadAssets)
+	{
+		progress.m_totalBytes += preload.m_size;
+
+		// ハンドルが無いものは読み終わっている (失敗したものも待たない)
+		std::shared_ptr<AsyncLoadHandle> spHandle = preload.m_spAsset ? AsyncAssetLoader::Instance().FindLoadHandle(preload.m_spAsset.get()) : nullptr;
+		if (!spHandle || spHandle->IsFinished())
+		{
+			++progress.m_finishedCount;
+			progress.m_loadedBytes += preload.m_size;
+		}
+		else
+		{
+			progress.m_loadedBytes += (uint64_t)(preload.m_size * (double)spHandle->GetProgress());
+		}
+	}
+
+	return progress;
+}
+
+void SceneManager::EnterNextScene()
+{
+	auto it = m_sceneRegistry.find(m_nextSceneName);
+	if (it != m_sceneRegistry.end())
+	{
+		m_currentScene = it->second();
+	}
+	else
+	{
+		auto scene = std::make_shared<BaseScene>();
+		scene->SetName(m_nextSceneName);
+		m_currentScene = scene;
+	}
+
+	m_currentSceneName = m_nextSceneName;
+
+	if (m_currentScene)
+	{
+		m_currentScene->Init();
+	}
+	EntityManager::Instance().InitEntities();
+	EntityManager::Instance().ActivateEntities();
+	m_nextSceneName.clear();
+
+	// 前のシーンだけが使っていたアセットの読み込みは、最後まで待たずに取り消す
+	AsyncAssetLoader::Instance().CancelUnreferenced();
+
+	// 使われているものはエンティティが参照しているので、プリロードの参照は手放してよい
+	m_preloadAssets.clear();
+	m_preloadSceneName.clear();
+	m_isPreloading = false;
+}
+
 void SceneManager::PreDraw()
 {
 	EntityManager::Instance().PreDraw();
@@ -73,7 +177,11 @@ void SceneManager::DrawSprite()
 void SceneManager::Release()
 {
 	if (m_currentScene) m_currentScene->Release();
+	WorldStreamer::Instance().End();
 	EntityManager::Instance().ClearEntities();
+
+	m_preloadAssets.clear();
+	m_isPreloading = false;
 }
 
 void SceneManager::RegisterScene(const std::string& name, SceneFactory factory)
@@ -25,6 +25,27 @@ public:
     const std::string& GetCurrentSceneName() const { return m_currentSceneName; }
 	void CreateScene(const std::string& name);
 
+	// シーン切り替え時のプリロード (ロード画面用)
+	// ・シーンのマニフェスト (SceneManifest) にあるアセットを、エンティティを作る前に全て読み始める
+	// ・読み込みが終わるまで次のシーンは作られない
+	struct LoadProgress
+	{
+		size_t		m_finishedCount = 0;
+		size_t		m_totalCount = 0;
+		uint64_t	m_loadedBytes = 0;
+		uint64_t	m_totalBytes = 0;
+
+		// 0～1 (サイズが分からなければ個数で)
+		float GetRatio() const
+		{
+			if (m_totalBytes > 0) { return (float)((double)m_loadedBytes / (double)m_totalBytes); }
+			return m_totalCount > 0 ? (float)m_finishedCount / (float)m_totalCount : 1.0f;
+		}
+	};
+
+	bool			IsLoading() const { return m_isPreloading; }
+	LoadProgress	GetLoadProgress() const;
+
 private:
 	SceneManager() {}
 	~SceneManager() { Release(); }
@@ -34,6 +55,22 @@ private:
     std::string m_currentSceneName = "";
 	std::string m_nextSceneName = "";
 
+	// マニフェストのアセットを全て読み始める
+	void StartPreload(const std::string& sceneName);
+
+	// 新しいシーンを作ってエンティティを読み込む
+	void EnterNextScene();
+
+	// 読み込み中のアセット (シーンを作り終えるまで参照を持っておく)
+	struct PreloadAsset
+	{
+		std::shared_ptr<void>	m_spAsset;		// KdTexture / KdModelData (サウンドは読み込み済みなので nullptr)
+		uint64_t				m_size = 0;
+	};
+	std::vector<PreloadAsset>	m_preloadAssets;
+	std::string					m_preloadSceneName;
+	bool						m_isPreloading = false;
+
 public:
 	static SceneManager& Instance()
 	{
@@ -0,0 +1,313 @@
+﻿#include "WorldPartition.h"
+#include "../../Serializer/JsonUtils.h"
+#include "../../Serializer/SceneManifest.h"
+#include "../../Serializer/SceneBinary.h"
+
+using json = nlohmann::json;
+
+namespace
+{
+	// シーンファイル1つ分 (JSON・マニフェスト・バイナリ) を書き出す
+	// outAssets … マニフェストのアセット (重複無し)
+	bool WriteSceneFile(const std::string& path, const json& sceneJson, std::vector<SceneManifest::Asset>& outAssets)
+	{
+		{
+			std::ofstream os(path);
+			if (!os) { return false; }
+
+			os << sceneJson.dump(4);
+			os.close();	// バイナリより後に更新されると、バイナリが古いと判定される
+			if (!os) { return false; }
+		}
+
+		SceneManifest manifest;
+		manifest.CollectFromJson(sceneJson["Entities"]);
+		manifest.Finalize();
+		outAssets = manifest.m_assets;
+		if (!manifest.Save(SceneManifest::GetManifestPath(path))) { return false; }
+
+		std::vector<uint8_t> binary;
+		return SceneBinary::FromJson(sceneJson, binary) && SceneBinary::Save(SceneBinary::GetBinaryPath(path), binary);
+	}
+}
+
+std::string WorldPartition::GetIndexPath(const std::string& scenePath)
+{
+	return std::filesystem::path(scenePath).replace_extension(".partition").generic_string();
+}
+
+std::string WorldPartition::GetCellDir(const std::string& scenePath)
+{
+	return std::filesystem::path(scenePath).replace_extension(".cells").generic_string() + "/";
+}
+
+std::string WorldPartition::GetPersistentPath(const std::string& scenePath)
+{
+	return GetCellDir(scenePath) + "Persistent.json";
+}
+
+std::string WorldPartition::GetCellPath(const std::string& scenePath, int32_t x, int32_t z)
+{
+	return GetCellDir(scenePath) + "Cell_" + std::to_string(x) + "_" + std::to_string(z) + ".json";
+}
+
+bool WorldPartition::Load(const std::string& indexPath)
+{
+	m_assets.clear();
+	m_cells.clear();
+
+	std::string text;
+	if (!KdFileSystem::Instance().ReadFile(indexPath, text)) { return false; }
+
+	json indexJson = json::parse(text, nullptr, false);
+	if (indexJson.is_discarded() || indexJson.value("Version", 0u) != kVersion) { return false; }
+
+	m_cellSize = indexJson.value("CellSize", 0.0f);
+	if (m_cellSize <= 0.0f) { return false; }
+
+	if (!indexJson.contains("Cells") || !indexJson["Cells"].is_array()) { return false; }
+	if (!indexJson.contains("Assets") || !indexJson["Assets"].is_array()) { return false; }
+
+	for (const json& assetJson : indexJson["Assets"])
+	{
+		AssetInfo& asset = m_assets.emplace_back();
+		asset.m_path = assetJson.value("Path", std::string());
+		asset.m_bytes = assetJson.value("Bytes", (uint64_t)0);
+	}
+
+	for (const json& cellJson : indexJson["Cells"])
+	{
+		CellInfo& cell = m_cells.emplace_back();
+		cell.m_x = cellJson.value("X", 0);
+		cell.m_z = cellJson.value("Z", 0);
+		cell.m_entityCount = cellJson.value("Entities", 0u);
+
+		auto itAssets = cellJson.find("Assets");
+		if (itAssets == cellJson.end() || !itAssets->is_array()) { return false; }
+
+		for (const json& indexValue : *itAssets)
+		{
+			if (!indexValue.is_number_unsigned() || indexValue.get<uint64_t>() >= m_assets.size()) { return false; }
+			uint32_t assetIndex = indexValue.get<uint32_t>();
+
+			cell.m_assets.push_back(assetIndex);
+			cell.m_assetBytes += m_assets[assetIndex].m_bytes;
+		}
+	}
+
+	return true;
+}
+
+bool WorldPartition::IsUpToDate(const std::string& scenePath)
+{
+	std::string indexPath = GetIndexPath(scenePath);
+
+	KdFileSystem& fileSystem = KdFileSystem::Instance();
+	if (!fileSystem.Exists(indexPath)) { return false; }
+
+	// パックファイル内のものはパックファイルの日時で比べる
+	// ・パックファイルを作った後にシーンだけ保存し直した場合は古い
+	std::filesystem::file_time_type sceneTime;
+	if (!fileSystem.GetWriteTime(scenePath, sceneTime)) { return true; }
+
+	// シーンを保存した後は、作り直すまでシーン全体を読む
+	std::filesystem::file_time_type indexTime;
+	return fileSystem.GetWriteTime(indexPath, indexTime) && indexTime >= sceneTime;
+}
+
+bool WorldPartition::IsPersistent(const json& entityJson)
+{
+	// キーは各コンポーネントの GetType()
+	return !entityJson.contains("Transform") || entityJson.contains("ActionPlayer");
+}
+
+bool WorldPartition::Build(const std::string& scenePath, float cellSize)
+{
+	if (cellSize <= 0.0f) { return false; }
+
+	std::string text;
+	if (!KdFileSystem::Instance().ReadFile(scenePath, text))
+	{
+		Logger::Error("WorldPartition: Failed to read scene: " + scenePath);
+		return false;
+	}
+
+	json sceneJson = json::parse(text, nullptr, false);
+	if (sceneJson.is_discarded() || !sceneJson.contains("Entities") || !sceneJson["Entities"].is_array())
+	{
+		Logger::Error("WorldPartition: Invalid scene: " + scenePath);
+		return false;
+	}
+
+	// 位置でセルに振り分ける (セルは座標順に並べる)
+	json persistent = json::array();
+	std::map<std::pair<int32_t, int32_t>, json> cellEntities;
+
+	for (json& entityJson : sceneJson["Entities"])
+	{
+		if (IsPersistent(entityJson))
+		{
+			persistent.push_back(std::move(entityJson));
+			continue;
+		}
+
+		const json& transformJson = entityJson["Transform"];
+		Math::Vector3 pos = transformJson.is_object() ? transformJson.value("Position", Math::Vector3::Zero) : Math::Vector3::Zero;
+
+		json& entities = cellEntities[{ ToCell(pos.x, cellSize), ToCell(pos.z, cellSize) }];
+		if (entities.is_null()) { entities = json::array(); }
+		entities.push_back(std::move(entityJson));
+	}
+
+	// 前回のものを消す (目次から消すので、途中で失敗しても古いセルは使われない)
+	std::error_code ec;
+	std::string indexPath = GetIndexPath(scenePath);
+	std::filesystem::remove(indexPath, ec);
+	std::filesystem::remove_all(GetCellDir(scenePath), ec);
+	std::filesystem::create_directories(GetCellDir(scenePath), ec);
+
+	const std::string sceneName = sceneJson.value("Scene", "Untitled");
+	auto makeScene = [&sceneName](json& entities)
+	{
+		json cellScene;
+		cellScene["Scene"] = sceneName;
+		cellScene["Entities"] = std::move(entities);
+		return cellScene;
+	};
+
+	std::vector<SceneManifest::Asset> persistentAssets;
+	size_t persistentCount = persistent.size();
+	if (!WriteSceneFile(GetPersistentPath(scenePath), makeScene(persistent), persistentAssets))
+	{
+		Logger::Error("WorldPartition: Failed to write: " + GetPersistentPath(scenePath));
+		return false;
+	}
+
+	// セルはそれぞれ別のファイルなので並列に書く
+	WorldPartition partition;
+	partition.m_cellSize = cellSize;
+
+	std::vector<json*> cellJsons;
+	for (auto& [coord, entities] : cellEntities)
+	{
+		CellInfo& cell = partition.m_cells.emplace_back();
+		cell.m_x = coord.first;
+		cell.m_z = coord.second;
+		cell.m_entityCount = (uint32_t)entities.size();
+		cellJsons.push_back(&entities);
+	}
+
+	std::vector<uint8_t> succeeded(partition.m_cells.size(), 0);
+	std::vector<std::vector<SceneManifest::Asset>> cellAssets(partition.m_cells.size());
+	KdParallel::Instance().For(partition.m_cells.size(), [&](size_t i)
+	{
+		CellInfo& cell = partition.m_cells[i];
+		succeeded[i] = WriteSceneFile(GetCellPath(scenePath, cell.m_x, cell.m_z), makeScene(*cellJsons[i]), cellAssets[i]) ? 1 : 0;
+	});
+
+	for (size_t i = 0; i < succeeded.size(); ++i)
+	{
+		if (succeeded[i]) { continue; }
+
+		const CellInfo& cell = partition.m_cells[i];
+		Logger::Error("WorldPartition: Failed to write: " + GetCellPath(scenePath, cell.m_x, cell.m_z));
+		return false;
+	}
+
+	// アセットの一覧 (セル同士で共有するものは1つにまとめ、常駐するエンティティが使うものは除く)
+	std::unordered_set<std::string> persistentPaths;
+	for (const SceneManifest::Asset& asset : persistentAssets) { persistentPaths.insert(asset.m_path); }
+
+	std::unordered_map<std::string, uint32_t> assetIndices;
+	for (size_t i = 0; i < partition.m_cells.size(); ++i)
+	{
+		CellInfo& cell = partition.m_cells[i];
+		for (const SceneManifest::Asset& asset : cellAssets[i])
+		{
+			if (persistentPaths.count(asset.m_path)) { continue; }
+
+			auto [it, inserted] = assetIndices.emplace(asset.m_path, (uint32_t)partition.m_assets.size());
+			if (inserted) { partition.m_assets.push_back({ asset.m_path, asset.m_size }); }
+
+			cell.m_assets.push_back(it->second);
+			cell.m_assetBytes += asset.m_size;
+		}
+	}
+
+	// 目次は最後に書く
+	json assetsJson = json::array();
+	for (const AssetInfo& asset : partition.m_assets)
+	{
+		assetsJson.push_back({
+			{ "Path", asset.m_path },
+			{ "Bytes", asset.m_bytes },
+		});
+	}
+
+	json cellsJson = json::array();
+	for (const CellInfo& cell : partition.m_cells)
+	{
+		cellsJson.push_back({
+			{ "X", cell.m_x },
+			{ "Z", cell.m_z },
+			{ "Entities", cell.m_entityCount },
+			{ "Assets", cell.m_assets },
+		});
+	}
+
+	json indexJson;
+	indexJson["Version"] = kVersion;
+	indexJson["CellSize"] = cellSize;
+	indexJson["Assets"] = assetsJson;
+	indexJson["Cells"] = cellsJson;
+
+	std::string tmpPath = indexPath + ".tmp";
+	{
+		std::ofstream os(tmpPath);
+		if (!os) { return false; }
+
+		os << indexJson.dump(4);
+		os.close();
+		if (!os)
+		{
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+	}
+	std::filesystem::rename(tmpPath, indexPath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+
+	Logger::Log("WorldPartition", "Built " + scenePath + ": " + std::to_string(partition.m_cells.size()) + " cells, "
+		+ std::to_string(persistentCount) + " persistent entities");
+	return true;
+}
+
+size_t WorldPartition::BuildDirectory(const std::string& dir)
+{
+	// Build が目次を消して書き直すので、先に集めておく
+	std::vector<std::string> indexPaths;
+	{
+		std::error_code ec;
+		for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+		{
+			if (it->is_regular_file(ec) && it->path().extension() == ".partition") { indexPaths.push_back(it->path().generic_string()); }
+		}
+	}
+
+	size_t failed = 0;
+	for (const std::string& indexPath : indexPaths)
+	{
+		std::string scenePath = std::filesystem::path(indexPath).replace_extension(".json").generic_string();
+
+		WorldPartition partition;
+		float cellSize = partition.Load(indexPath) ? partition.m_cellSize : kDefaultCellSize;
+
+		if (!Build(scenePath, cellSize)) { ++failed; }
+	}
+
+	return failed;
+}
@@ -0,0 +1,73 @@
+﻿#pragma once
+
+//=====================================================
+//
+// ワールドパーティション (シーンを XZ 平面の格子に分けたもの)
+//
+// ・編集するのは今まで通り1つのシーン JSON。Build でそこから作る (実行時用)
+// ・エンティティは Transform の位置でセルに振り分け、セルごとに普通のシーンファイルとして書き出す
+//   (JSON・マニフェスト・バイナリ。読み込みは SceneSerializer::LoadStreaming がそのまま使える)
+// ・Transform を持たないもの・プレイヤーは常駐用のファイルに入れ、最初に全て読む
+//
+// ファイル ("Asset/Data/Scene/Field.json" の場合)
+//   Asset/Data/Scene/Field.partition				… 目次 (セルの大きさ・アセットの一覧・セルごとのエンティティ数と使うアセット)
+//   Asset/Data/Scene/Field.cells/Persistent.json	… 常駐するエンティティ
+//   Asset/Data/Scene/Field.cells/Cell_<x>_<z>.json	… セル
+//
+//=====================================================
+class WorldPartition
+{
+public:
+
+	// 目次の形式を変えたら上げる
+	static constexpr uint32_t kVersion = 2;
+
+	static constexpr float kDefaultCellSize = 64.0f;
+
+	// セルが使うアセット (読み込み予算の計算用)
+	// ・セルのマニフェストに載るもの (エンティティの JSON に書かれたモデル・テクスチャ・音) のファイルサイズ
+	//   モデルのマテリアルが読むテクスチャはモデルを読むまで分からないので入らない (予算はその分少なめの目安になる)
+	// ・常駐するエンティティも使うアセットは常に読み込まれているので、セルの分には入れない
+	struct AssetInfo
+	{
+		std::string	m_path;
+		uint64_t	m_bytes = 0;
+	};
+
+	struct CellInfo
+	{
+		int32_t					m_x = 0;
+		int32_t					m_z = 0;
+		uint32_t				m_entityCount = 0;
+		uint64_t				m_assetBytes = 0;	// m_assets の合計 (他のセルと共有するものも含む。表示用)
+		std::vector<uint32_t>	m_assets;			// WorldPartition::m_assets の番号
+	};
+
+	float					m_cellSize = kDefaultCellSize;
+	std::vector<AssetInfo>	m_assets;				// 全セルで1つずつ
+	std::vector<CellInfo>	m_cells;
+
+	// パス
+	static std::string GetIndexPath(const std::string& scenePath);
+	static std::string GetCellDir(const std::string& scenePath);
+	static std::string GetPersistentPath(const std::string& scenePath);
+	static std::string GetCellPath(const std::string& scenePath, int32_t x, int32_t z);
+
+	// 位置 → セル
+	static int32_t ToCell(float pos, float cellSize) { return (int32_t)std::floor(pos / cellSize); }
+
+	// 目次を読む (無い・形式が違う場合は false)
+	bool Load(const std::string& indexPath);
+
+	// 使える目次があるか (無い・シーン JSON の方が新しい場合は false)
+	static bool IsUpToDate(const std::string& scenePath);
+
+	// シーン JSON からセルのファイルを作り直す (前回のセルのファイルは消す)
+	static bool Build(const std::string& scenePath, float cellSize);
+
+	// dir 以下の、目次のあるシーンを全て作り直す (セルの大きさは前回のまま。戻り値 … 失敗した数)
+	static size_t BuildDirectory(const std::string& dir);
+
+	// 常駐させるエンティティか (Transform が無い・プレイヤー)
+	static bool IsPersistent(const nlohmann::json& entityJson);
+};
@@ -0,0 +1,311 @@
+﻿#include "WorldStreamer.h"
+#include "../../ECS/Entity/EntityManager.h"
+#include "../../Core/Thread/ThreadManager.h"
+#include "../../Serializer/SceneSerializer.h"
+#include "../../Serializer/SceneManifest.h"
+#include "../../Core/Thread/Profiler/Profiler.h"
+
+bool WorldStreamer::Begin(const std::string& scenePath)
+{
+	End();
+
+	if (!m_enabled) { return false; }
+
+	std::string indexPath = WorldPartition::GetIndexPath(scenePath);
+	if (!WorldPartition::IsUpToDate(scenePath))
+	{
+		if (KdFileSystem::Instance().Exists(indexPath))
+		{
+			Logger::Log("WorldStreamer", "Partition is older than the scene, loading the whole scene: " + scenePath);
+		}
+		return false;
+	}
+
+	WorldPartition partition;
+	if (!partition.Load(indexPath))
+	{
+		Logger::Error("WorldStreamer: Failed to load partition: " + indexPath);
+		return false;
+	}
+
+	m_scenePath = scenePath;
+	m_cellSize = partition.m_cellSize;
+
+	m_cells.resize(partition.m_cells.size());
+	for (size_t i = 0; i < m_cells.size(); ++i)
+	{
+		m_cells[i].m_info = partition.m_cells[i];
+	}
+
+	m_assetBytes.resize(partition.m_assets.size());
+	for (size_t i = 0; i < m_assetBytes.size(); ++i)
+	{
+		m_assetBytes[i] = partition.m_assets[i].m_bytes;
+	}
+	m_assetRefCounts.assign(m_assetBytes.size(), 0);
+
+	m_isActive = true;
+
+	Logger::Log("WorldStreamer", "Streaming " + scenePath + ": " + std::to_string(m_cells.size()) + " cells");
+	return true;
+}
+
+void WorldStreamer::End()
+{
+	// 読み込み中のジョブの結果は世代が変わるので捨てられる
+	++m_generation;
+
+	m_cells.clear();
+	m_assetBytes.clear();
+	m_assetRefCounts.clear();
+	m_scenePath.clear();
+	m_loadedCount = 0;
+	m_loadingCount = 0;
+	m_residentBytes = 0;
+	m_isActive = false;
+
+	// エンティティはメインスレッドで破棄する
+	std::vector<Completed> completed;
+	{
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		completed.swap(m_completed);
+	}
+}
+
+void WorldStreamer::Release()
+{
+	m_isReleasing = true;
+
+	{
+		std::unique_lock<std::mutex> lock(m_completedMutex);
+		m_jobsCondition.wait(lock, [this] { return m_jobsInFlight == 0; });
+	}
+
+	End();
+}
+
+float WorldStreamer::GetDistance(const Cell& cell, const Math::Vector3& focus) const
+{
+	float minX = cell.m_info.m_x * m_cellSize;
+	float minZ = cell.m_info.m_z * m_cellSize;
+
+	float dx = std::max({ minX - focus.x, 0.0f, focus.x - (minX + m_cellSize) });
+	float dz = std::max({ minZ - focus.z, 0.0f, focus.z - (minZ + m_cellSize) });
+	return std::sqrt(dx * dx + dz * dz);
+}
+
+void WorldStreamer::Update(const Math::Vector3& focus)
+{
+	if (!m_isActive) { return; }
+
+	PROFILE_FUNCTION();
+
+	ProcessCompleted();
+
+	for (Cell& cell : m_cells)
+	{
+		cell.m_distance = GetDistance(cell, focus);
+	}
+
+	// 離れたセルを解放する
+	for (Cell& cell : m_cells)
+	{
+		if (cell.m_state == CellState::Loaded && cell.m_distance > m_settings.m_unloadRadius) { Unload(cell); }
+	}
+
+	// 読み込み範囲の外に残っているセル (遠い順)
+	// ・予算を超えている時は、これを手放して空ける
+	std::vector<Cell*> releasable;
+	for (Cell& cell : m_cells)
+	{
+		if (cell.m_state == CellState::Loaded && cell.m_distance > m_settings.m_loadRadius) { releasable.push_back(&cell); }
+	}
+	std::sort(releasable.begin(), releasable.end(), [](const Cell* a, const Cell* b) { return a->m_distance > b->m_distance; });
+
+	// pCell … 読もうとしているセル (手放したセルとアセットを共有していると増える分が変わるので、毎回数え直す)
+	auto releaseUntil = [&](const Cell* pCell, float distance)
+	{
+		auto getRequired = [&]() { return pCell ? GetAdditionalBytes(*pCell) : 0; };
+
+		while (m_residentBytes > 0 && m_residentBytes + getRequired() > m_settings.m_memoryBudget && !releasable.empty())
+		{
+			// 読もうとしているセルより近いものは手放さない
+			if (releasable.front()->m_distance <= distance) { break; }
+
+			Unload(*releasable.front());
+			releasable.erase(releasable.begin());
+		}
+		return m_residentBytes == 0 || m_residentBytes + getRequired() <= m_settings.m_memoryBudget;
+	};
+
+	// 予算を下げた時など、既に超えている分
+	releaseUntil(nullptr, m_settings.m_loadRadius);
+
+	// 読み込み範囲のセルを近い順に読む
+	std::vector<size_t> candidates;
+	for (size_t i = 0; i < m_cells.size(); ++i)
+	{
+		const Cell& cell = m_cells[i];
+		if (cell.m_state == CellState::Unloaded && !cell.m_isFailed && cell.m_distance <= m_settings.m_loadRadius) { candidates.push_back(i); }
+	}
+	std::sort(candidates.begin(), candidates.end(), [this](size_t a, size_t b) { return m_cells[a].m_distance < m_cells[b].m_distance; });
+
+	for (size_t cellIndex : candidates)
+	{
+		if (m_loadingCount >= m_settings.m_maxLoadsInFlight) { break; }
+
+		// 近いものが入らなければ、それより遠いものも読まない
+		const Cell& cell = m_cells[cellIndex];
+		if (!releaseUntil(&cell, cell.m_distance)) { break; }
+
+		StartLoad(cellIndex);
+	}
+}
+
+void WorldStreamer::StartLoad(size_t cellIndex)
+{
+	Cell& cell = m_cells[cellIndex];
+	cell.m_state = CellState::Loading;
+
+	++m_loadingCount;
+	AddAssetRefs(cell);
+
+	std::string cellPath = WorldPartition::GetCellPath(m_scenePath, cell.m_info.m_x, cell.m_info.m_z);
+	uint64_t generation = m_generation;
+
+	{
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		++m_jobsInFlight;
+	}
+
+	ThreadManager::Instance().AddJobWithPriority(Job::Priority::Normal, [this, cellIndex, generation, cellPath]()
+	{
+		PROFILE_SCOPE("WorldStreamer::LoadCell");
+
+		auto spResult = std::make_shared<LoadResult>();
+		if (!m_isReleasing)
+		{
+			// アセットを先に読み始めておく (エンティティを作っている間に並列に読まれる)
+			// ・音はワーカースレッドで読めないので、エンティティが使う時に読む
+			SceneManifest manifest;
+			if (manifest.Load(SceneManifest::GetManifestPath(cellPath)))
+			{
+				for (const SceneManifest::Asset& asset : manifest.m_assets)
+				{
+					switch (asset.m_type)
+					{
+					case SceneManifest::AssetType::Model:
+						spResult->m_assets.push_back(KdAssets::Instance().m_modeldatas.GetData(asset.m_path));
+						break;
+					case SceneManifest::AssetType::Texture:
+						spResult->m_assets.push_back(KdAssets::Instance().m_textures.GetData(asset.m_path));
+						break;
+					default:
+						break;
+					}
+				}
+			}
+
+			std::shared_ptr<CameraBase> noCamera;
+			spResult->m_success = SceneSerializer::LoadStreaming(cellPath, [&spResult](std::vector<std::shared_ptr<Entity>>& batch)
+				{
+					spResult->m_entities.insert(spResult->m_entities.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+					batch.clear();
+				}, noCamera);
+		}
+
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		m_completed.push_back({ cellIndex, generation, std::move(spResult) });
+		--m_jobsInFlight;
+		m_jobsCondition.notify_all();
+	});
+}
+
+void WorldStreamer::ProcessCompleted()
+{
+	std::vector<Completed> completed;
+	{
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		completed.swap(m_completed);
+	}
+
+	for (Completed& done : completed)
+	{
+		// 前のシーンのもの
+		if (done.m_generation != m_generation || done.m_cellIndex >= m_cells.size()) { continue; }
+
+		Cell& cell = m_cells[done.m_cellIndex];
+		--m_loadingCount;
+
+		LoadResult& result = *done.m_spResult;
+		if (!result.m_success)
+		{
+			Logger::Error("WorldStreamer: Failed to load cell: " + WorldPartition::GetCellPath(m_scenePath, cell.m_info.m_x, cell.m_info.m_z));
+
+			cell.m_state = CellState::Unloaded;
+			cell.m_isFailed = true;
+			ReleaseAssetRefs(cell);
+			continue;
+		}
+
+		// 読み込み中に離れた
+		if (cell.m_distance > m_settings.m_unloadRadius)
+		{
+			cell.m_state = CellState::Unloaded;
+			ReleaseAssetRefs(cell);
+			continue;
+		}
+
+		cell.m_entities.assign(result.m_entities.begin(), result.m_entities.end());
+		cell.m_assets = std::move(result.m_assets);
+		cell.m_state = CellState::Loaded;
+		++m_loadedCount;
+
+		EntityManager::Instance().AddEntities(result.m_entities);
+	}
+}
+
+void WorldStreamer::Unload(Cell& cell)
+{
+	std::vector<std::shared_ptr<Entity>> entities;
+	entities.reserve(cell.m_entities.size());
+	for (const std::weak_ptr<Entity>& wpEntity : cell.m_entities)
+	{
+		if (auto spEntity = wpEntity.lock()) { entities.push_back(std::move(spEntity)); }
+	}
+	EntityManager::Instance().RemoveEntities(entities);
+
+	cell.m_entities.clear();
+	cell.m_assets.clear();
+	cell.m_state = CellState::Unloaded;
+
+	--m_loadedCount;
+	ReleaseAssetRefs(cell);
+}
+
+uint64_t WorldStreamer::GetAdditionalBytes(const Cell& cell) const
+{
+	uint64_t bytes = 0;
+	for (uint32_t assetIndex : cell.m_info.m_assets)
+	{
+		if (m_assetRefCounts[assetIndex] == 0) { bytes += m_assetBytes[assetIndex]; }
+	}
+	return bytes;
+}
+
+void WorldStreamer::AddAssetRefs(const Cell& cell)
+{
+	for (uint32_t assetIndex : cell.m_info.m_assets)
+	{
+		if (m_assetRefCounts[assetIndex]++ == 0) { m_residentBytes += m_assetBytes[assetIndex]; }
+	}
+}
+
+void WorldStreamer::ReleaseAssetRefs(const Cell& cell)
+{
+	for (uint32_t assetIndex : cell.m_info.m_assets)
+	{
+		if (m_assetRefCounts[assetIndex] == 0) { continue; }
+		if (--m_assetRefCounts[assetIndex] == 0) { m_residentBytes -= std::min(m_residentBytes, m_assetBytes[assetIndex]); }
+	}
+}
@@ -0,0 +1,151 @@
+﻿#pragma once
+#include "WorldPartition.h"
+
+class Entity;
+
+//=====================================================
+//
+// ワールドパーティションのセルの読み込み・解放
+//
+// ・カメラから m_loadRadius 以内のセルを近い順に読み、m_unloadRadius より離れたら解放する
+//   (m_unloadRadius を大きくしておくことで、境目を行き来してもすぐには読み直さない)
+// ・読み込み済み・読み込み中のセルが使うアセットの合計が m_memoryBudget を超える分は読まない
+//   アセットは参照数で数えるので、複数のセルで使うものも1回分だけ数える (最初のセルで足し、最後のセルを解放したら引く)
+//   モデルのマテリアルが読むテクスチャは入らないので目安 (WorldPartition::AssetInfo)
+//   予算を下げた時などで超えている間は、遠いセルから解放する
+// ・セルの読み込み (エンティティ作成・Init まで) はワーカー、EntityManager への追加・解放は Update (メインスレッド)
+//
+// ・エディタで保存するとシーン全体が上書きされるので、セルを読んでいる間は保存できない
+//   そのためエディタ (_DEBUG ビルド) では最初は切ってある (確かめる時はメニューから入れてシーンを読み直す)
+//
+//=====================================================
+class WorldStreamer
+{
+public:
+
+	struct Settings
+	{
+		float		m_loadRadius = 128.0f;
+		float		m_unloadRadius = 192.0f;				// m_loadRadius より大きくする
+		uint64_t	m_memoryBudget = 512ull * 1024 * 1024;	// 読み込み済みセルのアセットの合計 (目安)
+		int			m_maxLoadsInFlight = 2;
+	};
+
+	// シーンを読み始める時に呼ぶ
+	// ・使える目次があれば true (呼ぶ側は GetPersistentPath のエンティティだけを読む)
+	bool Begin(const std::string& scenePath);
+
+	// シーンを片付ける時に呼ぶ (読み込み中のものは捨てる)
+	void End();
+
+	// 毎フレーム (focus … 読み込みの中心。普通はカメラの位置)
+	void Update(const Math::Vector3& focus);
+
+	// 終了時 (読み込み中のジョブを待つ)
+	void Release();
+
+	// セルを読んでいるシーンか
+	bool IsActive() const { return m_isActive; }
+
+	// 無効にすると、次に読むシーンからシーン全体を読む
+	void SetEnabled(bool enable) { m_enabled = enable; }
+	bool IsEnabled() const { return m_enabled; }
+
+	Settings& WorkSettings() { return m_settings; }
+
+	// 表示用
+	size_t		GetCellCount() const		{ return m_cells.size(); }
+	size_t		GetLoadedCellCount() const	{ return m_loadedCount; }
+	uint64_t	GetResidentBytes() const	{ return m_residentBytes; }
+
+private:
+	WorldStreamer() {}
+	~WorldStreamer() { Release(); }
+
+	enum class CellState : uint8_t
+	{
+		Unloaded,
+		Loading,
+		Loaded,
+	};
+
+	// ワーカーで読んだ結果
+	struct LoadResult
+	{
+		std::vector<std::shared_ptr<Entity>>	m_entities;
+		std::vector<std::shared_ptr<void>>		m_assets;		// マニフェストのアセット (KdModelData / KdTexture)
+		bool									m_success = false;
+	};
+
+	struct Cell
+	{
+		WorldPartition::CellInfo			m_info;
+		CellState							m_state = CellState::Unloaded;
+		bool								m_isFailed = false;	// 読めなかった (このシーンの間は読み直さない)
+		float								m_distance = 0.0f;
+
+		std::vector<std::weak_ptr<Entity>>	m_entities;
+		std::vector<std::shared_ptr<void>>	m_assets;		// 読み込み済みの間は参照を持っておく
+	};
+
+	// カメラからセルまでの XZ 平面上の距離 (中に居れば 0)
+	float GetDistance(const Cell& cell, const Math::Vector3& focus) const;
+
+	void StartLoad(size_t cellIndex);
+	void Unload(Cell& cell);
+
+	// cell を読むと新しく増えるアセットのサイズ (他のセルが読んでいるものは入らない)
+	uint64_t GetAdditionalBytes(const Cell& cell) const;
+
+	// cell のアセットの参照数を増やす・減らす (0 との行き来で m_residentBytes に足す・引く)
+	void AddAssetRefs(const Cell& cell);
+	void ReleaseAssetRefs(const Cell& cell);
+
+	// ワーカーからの完了通知を反映する
+	void ProcessCompleted();
+
+	Settings				m_settings;
+#ifdef _DEBUG
+	bool					m_enabled = false;
+#else
+	bool					m_enabled = true;
+#endif
+	bool					m_isActive = false;
+
+	std::string				m_scenePath;
+	float					m_cellSize = WorldPartition::kDefaultCellSize;
+	std::vector<Cell>		m_cells;
+
+	// WorldPartition::m_assets ごと
+	std::vector<uint64_t>	m_assetBytes;
+	std::vector<uint32_t>	m_assetRefCounts;		// 読み込み済み・読み込み中のセルのうち、使っているセルの数
+
+	size_t					m_loadedCount = 0;
+	int						m_loadingCount = 0;
+	uint64_t				m_residentBytes = 0;	// 参照数が 1 以上のアセットの合計
+
+	// End のたびに増やし、前のシーンの読み込み結果を捨てる
+	uint64_t				m_generation = 0;
+
+	// ワーカースレッドからの完了通知 (セル番号, 世代, 結果)
+	struct Completed
+	{
+		size_t							m_cellIndex = 0;
+		uint64_t						m_generation = 0;
+		std::shared_ptr<LoadResult>		m_spResult;
+	};
+	std::mutex					m_completedMutex;
+	std::condition_variable		m_jobsCondition;
+	std::vector<Completed>		m_completed;
+	int							m_jobsInFlight = 0;		// 前のシーンの分も含む (Release で待つ)
+
+	// Release 中は新しく読み始めない
+	std::atomic<bool>			m_isReleasing = false;
+
+public:
+	static WorldStreamer& Instance()
+	{
+		static WorldStreamer instance;
+		return instance;
+	}
+};
@@ -0,0 +1,729 @@
+﻿#include "SceneBinary.h"
+#include "../../Application/GameObject/Camera/CameraBase.h"
+#include "JsonUtils.h"
+#include "../ECS/Component/Factory/ComponentFactory.h"
+#include "SceneSaver.h"
+
+using json = nlohmann::json;
+
+namespace
+{
+	constexpr char kMagic[4] = { 'K', 'S', 'C', 'B' };
+
+	// ブロックの中身の形式
+	enum class BlockEncoding : uint8_t
+	{
+		Schema,			// スキーマの順に値を詰めたもの
+		MessagePack,	// JSON を MessagePack にしたもの (スキーマを持たないコンポーネント)
+	};
+
+	class BinaryWriter
+	{
+	public:
+		template <typename T>
+		void WritePod(const T& value)
+		{
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+			m_data.insert(m_data.end(), p, p + sizeof(T));
+		}
+
+		void WriteBytes(const uint8_t* pData, size_t size) { m_data.insert(m_data.end(), pData, pData + size); }
+
+		std::vector<uint8_t> m_data;
+	};
+
+	// 同じ文字列は1つにまとめる
+	class StringTable
+	{
+	public:
+		uint32_t Add(const std::string& str)
+		{
+			auto [it, inserted] = m_indices.emplace(str, (uint32_t)m_strings.size());
+			if (inserted) { m_strings.push_back(str); }
+			return it->second;
+		}
+
+		const std::vector<std::string>& GetStrings() const { return m_strings; }
+
+	private:
+		std::vector<std::string>					m_strings;
+		std::unordered_map<std::string, uint32_t>	m_indices;
+	};
+
+	struct FieldInfo
+	{
+		uint32_t		m_name = 0;
+		SceneFieldType	m_type = SceneFieldType::Bool;
+	};
+
+	struct TypeInfo
+	{
+		uint32_t				m_name = 0;
+		uint32_t				m_version = 0;
+		BlockEncoding			m_encoding = BlockEncoding::MessagePack;
+		std::vector<FieldInfo>	m_fields;
+	};
+
+	// ファイルの先頭からエンティティの手前まで
+	struct Tables
+	{
+		std::vector<std::string>	m_strings;
+		std::vector<TypeInfo>		m_types;
+
+		bool			m_hasCamera = false;
+		Math::Vector3	m_cameraPos = Math::Vector3::Zero;
+		Math::Vector3	m_cameraRot = Math::Vector3::Zero;
+
+		uint32_t		m_entityCount = 0;
+	};
+
+	size_t GetFieldSize(SceneFieldType type)
+	{
+		switch (type)
+		{
+		case SceneFieldType::Bool:		return sizeof(uint8_t);
+		case SceneFieldType::Vector3:	return sizeof(float) * 3;
+		default:						return sizeof(uint32_t);
+		}
+	}
+
+	// value が無ければ 0 で埋める
+	void WriteField(BinaryWriter& writer, StringTable& strings, SceneFieldType type, const json* pValue)
+	{
+		if (!pValue || pValue->is_null())
+		{
+			if (type == SceneFieldType::String) { writer.WritePod(strings.Add("")); return; }
+
+			std::vector<uint8_t> zero(GetFieldSize(type), 0);
+			writer.WriteBytes(zero.data(), zero.size());
+			return;
+		}
+
+		const json& value = *pValue;
+		switch (type)
+		{
+		case SceneFieldType::Bool:		writer.WritePod<uint8_t>(value.get<bool>() ? 1 : 0);		break;
+		case SceneFieldType::Int:		writer.WritePod(value.get<int32_t>());						break;
+		case SceneFieldType::UInt:		writer.WritePod(value.get<uint32_t>());						break;
+		case SceneFieldType::Float:		writer.WritePod(value.get<float>());						break;
+		case SceneFieldType::String:	writer.WritePod(strings.Add(value.get<std::string>()));	break;
+		case SceneFieldType::Vector3:
+		{
+			Math::Vector3 v = value.get<Math::Vector3>();
+			writer.WritePod(v.x);
+			writer.WritePod(v.y);
+			writer.WritePod(v.z);
+			break;
+		}
+		}
+	}
+
+	json ReadField(SceneBinaryReader& reader, SceneFieldType type)
+	{
+		switch (type)
+		{
+		case SceneFieldType::Bool:		return reader.ReadBool();
+		case SceneFieldType::Int:		return reader.ReadInt();
+		case SceneFieldType::UInt:		return reader.ReadUInt();
+		case SceneFieldType::Float:		return reader.ReadFloat();
+		case SceneFieldType::Vector3:	return reader.ReadVector3();
+		case SceneFieldType::String:	return reader.ReadString();
+		}
+		return json();
+	}
+
+	const json* FindValue(const json& j, const char* key)
+	{
+		if (!j.is_object()) { return nullptr; }
+
+		auto it = j.find(key);
+		return it != j.end() ? &(*it) : nullptr;
+	}
+
+	// ヘッダ・文字列テーブル・型テーブルを読む (reader は tables.m_strings を参照していること)
+	bool ReadTables(SceneBinaryReader& reader, Tables& tables)
+	{
+		const uint8_t* pMagic = reader.ReadBytes(sizeof(kMagic));
+		if (!pMagic || memcmp(pMagic, kMagic, sizeof(kMagic)) != 0) { return false; }
+		if (reader.ReadUInt() != SceneBinary::kVersion) { return false; }
+
+		tables.m_hasCamera = reader.ReadBool();
+		tables.m_cameraPos = reader.ReadVector3();
+		tables.m_cameraRot = reader.ReadVector3();
+
+		uint32_t stringCount = reader.ReadUInt();
+		if (stringCount > reader.GetRemaining() / sizeof(uint32_t)) { return false; }
+
+		tables.m_strings.resize(stringCount);
+		for (std::string& str : tables.m_strings)
+		{
+			uint32_t length = reader.ReadUInt();
+			const uint8_t* p = reader.ReadBytes(length);
+			if (!p) { return false; }
+
+			str.assign(reinterpret_cast<const char*>(p), length);
+		}
+
+		auto isValidString = [&](uint32_t index) { return index < tables.m_strings.size(); };
+
+		uint32_t typeCount = reader.ReadUInt();
+		if (typeCount > reader.GetRemaining() / sizeof(uint32_t)) { return false; }
+
+		tables.m_types.resize(typeCount);
+		for (TypeInfo& type : tables.m_types)
+		{
+			type.m_name = reader.ReadUInt();
+			type.m_version = reader.ReadUInt();
+			type.m_encoding = (BlockEncoding)reader.ReadPod<uint8_t>();
+
+			uint32_t fieldCount = reader.ReadUInt();
+			if (fieldCount > reader.GetRemaining() / sizeof(uint32_t)) { return false; }
+
+			type.m_fields.resize(fieldCount);
+			for (FieldInfo& field : type.m_fields)
+			{
+				field.m_name = reader.ReadUInt();
+				field.m_type = (SceneFieldType)reader.ReadPod<uint8_t>();
+
+				if (!isValidString(field.m_name) || field.m_type > SceneFieldType::String) { return false; }
+			}
+
+			if (!isValidString(type.m_name) || type.m_encoding > BlockEncoding::MessagePack) { return false; }
+		}
+
+		tables.m_entityCount = reader.ReadUInt();
+
+		return !reader.IsFailed();
+	}
+
+	// ブロック → JSON (ファイル内のスキーマで読む)
+	json BlockToJson(const uint8_t* pBlock, uint32_t size, const TypeInfo& type, const Tables& tables)
+	{
+		if (type.m_encoding == BlockEncoding::MessagePack)
+		{
+			return json::from_msgpack(pBlock, pBlock + size, true, false);
+		}
+
+		SceneBinaryReader reader(pBlock, size, &tables.m_strings);
+
+		json compJson = json::object();
+		for (const FieldInfo& field : type.m_fields)
+		{
+			compJson[tables.m_strings[field.m_name]] = ReadField(reader, field.m_type);
+		}
+
+		if (reader.IsFailed()) { return json(json::value_t::discarded); }
+		return compJson;
+	}
+
+	// エンティティの並びが最後まで読めるか (ブロックの中身は見ない)
+	// outOffsets … 各エンティティの先頭位置 (並列に読む時に使う)
+	bool ValidateEntities(SceneBinaryReader reader, const Tables& tables, std::vector<size_t>& outOffsets)
+	{
+		outOffsets.clear();
+		outOffsets.reserve(std::min<size_t>(tables.m_entityCount, reader.GetRemaining()));
+
+		for (uint32_t e = 0; e < tables.m_entityCount && !reader.IsFailed(); ++e)
+		{
+			outOffsets.push_back(reader.GetPosition());
+
+			reader.ReadString();
+
+			uint32_t componentCount = reader.ReadUInt();
+			for (uint32_t c = 0; c < componentCount && !reader.IsFailed(); ++c)
+			{
+				uint16_t typeId = reader.ReadPod<uint16_t>();
+				reader.ReadBytes(reader.ReadUInt());
+
+				if (typeId >= tables.m_types.size()) { return false; }
+			}
+		}
+		return !reader.IsFailed();
+	}
+
+	// ファイルのスキーマとコンポーネントのスキーマが同じか (同じなら DeserializeBinary で直接読める)
+	bool IsSameSchema(const TypeInfo& type, const std::vector<std::string>& strings, const SceneComponentSchema* pSchema)
+	{
+		if (!pSchema || type.m_encoding != BlockEncoding::Schema) { return false; }
+		if (type.m_version != pSchema->m_version || type.m_fields.size() != pSchema->m_fields.size()) { return false; }
+
+		for (size_t i = 0; i < type.m_fields.size(); ++i)
+		{
+			if (type.m_fields[i].m_type != pSchema->m_fields[i].m_type) { return false; }
+			if (strings[type.m_fields[i].m_name] != pSchema->m_fields[i].m_name) { return false; }
+		}
+		return true;
+	}
+
+	// 型ごとの作り方 (コンポーネントごとに名前で探さない)
+	struct TypeLoader
+	{
+		const ComponentFactory::Creator*	m_pCreator = nullptr;
+		bool								m_isDirect = false;		// DeserializeBinary で直接読める
+	};
+
+	// エンティティ1つ分を読んで作る (ワーカースレッドから呼ばれる)
+	// ・並びが壊れていれば nullptr (その先は位置がずれているので、読み飛ばして続けない)
+	std::shared_ptr<Entity> CreateEntity(SceneBinaryReader& reader, const Tables& tables, const std::vector<TypeLoader>& loaders)
+	{
+		std::shared_ptr<Entity> newEntity = std::make_shared<Entity>();
+		newEntity->SetName(reader.ReadString());
+
+		uint32_t componentCount = reader.ReadUInt();
+		for (uint32_t c = 0; c < componentCount; ++c)
+		{
+			uint16_t typeId = reader.ReadPod<uint16_t>();
+			uint32_t size = reader.ReadUInt();
+			const uint8_t* pBlock = reader.ReadBytes(size);
+			if (!pBlock || typeId >= loaders.size()) { return nullptr; }
+
+			const TypeLoader& loader = loaders[typeId];
+			if (!loader.m_pCreator) { continue; }
+
+			const TypeInfo& type = tables.m_types[typeId];
+			std::shared_ptr<Component> component = (*loader.m_pCreator)();
+			try
+			{
+				if (loader.m_isDirect)
+				{
+					SceneBinaryReader blockReader(pBlock, size, &tables.m_strings);
+					component->DeserializeBinary(blockReader);
+					if (blockReader.IsFailed()) { throw std::runtime_error("block is too short"); }
+				}
+				else
+				{
+					// 版が違う・スキーマが無い → JSON に戻して読む
+					json compJson = BlockToJson(pBlock, size, type, tables);
+					if (compJson.is_discarded()) { throw std::runtime_error("broken block"); }
+
+					component->Deserialize(compJson);
+				}
+				newEntity->AddComponent(component);
+			}
+			catch (const std::exception& error)
+			{
+				Logger::Error("Failed to deserialize component: " + tables.m_strings[type.m_name] + " Error: " + error.what());
+			}
+		}
+
+		if (reader.IsFailed()) { return nullptr; }
+
+		newEntity->Init();
+		return newEntity;
+	}
+}
+
+Math::Vector3 SceneBinaryReader::ReadVector3()
+{
+	Math::Vector3 v;
+	v.x = ReadFloat();
+	v.y = ReadFloat();
+	v.z = ReadFloat();
+	return v;
+}
+
+const std::string& SceneBinaryReader::ReadString()
+{
+	static const std::string empty;
+
+	uint32_t index = ReadUInt();
+	if (!m_pStrings || index >= m_pStrings->size())
+	{
+		m_failed = true;
+		return empty;
+	}
+	return (*m_pStrings)[index];
+}
+
+const uint8_t* SceneBinaryReader::ReadBytes(size_t size)
+{
+	if (m_failed || size > m_size - m_pos)
+	{
+		m_failed = true;
+		return nullptr;
+	}
+
+	const uint8_t* p = m_pData + m_pos;
+	m_pos += size;
+	return p;
+}
+
+std::string SceneBinary::GetBinaryPath(const std::string& scenePath)
+{
+	return std::filesystem::path(scenePath).replace_extension(".scnb").string();
+}
+
+std::string SceneBinary::FindUpToDate(const std::string& scenePath)
+{
+	std::string binaryPath = GetBinaryPath(scenePath);
+
+	KdFileSystem& fileSystem = KdFileSystem::Instance();
+	if (!fileSystem.Exists(binaryPath)) { return {}; }
+
+	// パックファイル内のものはパックファイルの日時で比べる
+	std::filesystem::file_time_type jsonTime;
+	if (!fileSystem.GetWriteTime(scenePath, jsonTime)) { return binaryPath; }
+
+	// JSON を直接編集した後は、作り直すまで JSON を使う
+	std::filesystem::file_time_type binaryTime;
+	if (!fileSystem.GetWriteTime(binaryPath, binaryTime) || binaryTime < jsonTime) { return {}; }
+
+	return binaryPath;
+}
+
+bool SceneBinary::FromJson(const json& sceneJson, std::vector<uint8_t>& outData)
+{
+	StringTable strings;
+	std::vector<TypeInfo> types;
+
+	// 型ごとのスキーマとデフォルト値
+	std::unordered_map<std::string, int> typeIds;
+	std::vector<const SceneComponentSchema*> schemas;
+	std::vector<json> defaults;
+
+	BinaryWriter entityWriter;
+	uint32_t entityCount = 0;
+
+	try
+	{
+		const json* pEntities = FindValue(sceneJson, "Entities");
+		if (pEntities && pEntities->is_array())
+		{
+			for (const json& eJson : *pEntities)
+			{
+				entityWriter.WritePod(strings.Add(eJson.value("Name", std::string("Entity"))));
+
+				// コンポーネント数は後で書き込む
+				size_t countPos = entityWriter.m_data.size();
+				entityWriter.WritePod<uint32_t>(0);
+				uint32_t componentCount = 0;
+
+				for (const auto& [key, value] : eJson.items())
+				{
+					if (key == "Name") { continue; }
+
+					auto itType = typeIds.find(key);
+					if (itType == typeIds.end())
+					{
+						TypeInfo& type = types.emplace_back();
+						type.m_name = strings.Add(key);
+
+						// ComponentFactory に無いもの (消したコンポーネント・登録前のものなど) も、JSON のまま入れておく
+						// (バイナリから JSON に戻した時に無くならないように。読み込みでは作れないので読み飛ばされる)
+						const SceneComponentSchema* pSchema = nullptr;
+						json& defaultJson = defaults.emplace_back();
+
+						std::shared_ptr<Component> spComponent = ComponentFactory::Instance().Create(key);
+						if (spComponent)
+						{
+							pSchema = spComponent->GetBinarySchema();
+							if (pSchema)
+							{
+								type.m_version = pSchema->m_version;
+								type.m_encoding = BlockEncoding::Schema;
+								for (const SceneFieldDesc& desc : pSchema->m_fields)
+								{
+									type.m_fields.push_back({ strings.Add(desc.m_name), desc.m_type });
+								}
+							}
+
+							spComponent->Serialize(defaultJson);
+						}
+						else
+						{
+							Logger::Log("Serializer", "SceneBinary: Unknown component kept as JSON: " + key);
+						}
+						schemas.push_back(pSchema);
+
+						itType = typeIds.emplace(key, (int)types.size() - 1).first;
+					}
+
+					int typeId = itType->second;
+
+					BinaryWriter block;
+					if (const SceneComponentSchema* pSchema = schemas[typeId])
+					{
+						for (const SceneFieldDesc& desc : pSchema->m_fields)
+						{
+							const json* pValue = FindValue(value, desc.m_name);
+							if (!pValue) { pValue = FindValue(defaults[typeId], desc.m_name); }
+
+							WriteField(block, strings, desc.m_type, pValue);
+						}
+					}
+					else
+					{
+						block.m_data = json::to_msgpack(value);
+					}
+
+					entityWriter.WritePod((uint16_t)typeId);
+					entityWriter.WritePod((uint32_t)block.m_data.size());
+					entityWriter.WriteBytes(block.m_data.data(), block.m_data.size());
+					++componentCount;
+				}
+
+				memcpy(entityWriter.m_data.data() + countPos, &componentCount, sizeof(componentCount));
+				++entityCount;
+			}
+		}
+	}
+	catch (const json::exception& e)
+	{
+		Logger::Error(std::string("SceneBinary: Failed to convert scene: ") + e.what());
+		return false;
+	}
+
+	BinaryWriter writer;
+	writer.WriteBytes(reinterpret_cast<const uint8_t*>(kMagic), sizeof(kMagic));
+	writer.WritePod(kVersion);
+
+	// エディタカメラ
+	const json* pCamera = FindValue(sceneJson, "EditorCamera");
+	Math::Vector3 cameraPos = pCamera ? pCamera->value("Position", Math::Vector3::Zero) : Math::Vector3::Zero;
+	Math::Vector3 cameraRot = pCamera ? pCamera->value("Rotation", Math::Vector3::Zero) : Math::Vector3::Zero;
+	writer.WritePod<uint8_t>(pCamera ? 1 : 0);
+	writer.WritePod(cameraPos.x); writer.WritePod(cameraPos.y); writer.WritePod(cameraPos.z);
+	writer.WritePod(cameraRot.x); writer.WritePod(cameraRot.y); writer.WritePod(cameraRot.z);
+
+	// 文字列テーブル
+	writer.WritePod((uint32_t)strings.GetStrings().size());
+	for (const std::string& str : strings.GetStrings())
+	{
+		writer.WritePod((uint32_t)str.size());
+		writer.WriteBytes(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+	}
+
+	// 型テーブル
+	writer.WritePod((uint32_t)types.size());
+	for (const TypeInfo& type : types)
+	{
+		writer.WritePod(type.m_name);
+		writer.WritePod(type.m_version);
+		writer.WritePod((uint8_t)type.m_encoding);
+		writer.WritePod((uint32_t)type.m_fields.size());
+		for (const FieldInfo& field : type.m_fields)
+		{
+			writer.WritePod(field.m_name);
+			writer.WritePod((uint8_t)field.m_type);
+		}
+	}
+
+	// エンティティ
+	writer.WritePod(entityCount);
+	writer.WriteBytes(entityWriter.m_data.data(), entityWriter.m_data.size());
+
+	outData = std::move(writer.m_data);
+	return true;
+}
+
+bool SceneBinary::ToJson(const std::vector<uint8_t>& data, json& outSceneJson)
+{
+	Tables tables;
+	SceneBinaryReader reader(data.data(), data.size(), &tables.m_strings);
+	if (!ReadTables(reader, tables)) { return false; }
+
+	json sceneJson;
+	sceneJson["Scene"] = "Untitled";
+
+	if (tables.m_hasCamera)
+	{
+		sceneJson["EditorCamera"]["Position"] = tables.m_cameraPos;
+		sceneJson["EditorCamera"]["Rotation"] = tables.m_cameraRot;
+	}
+
+	json entitiesJson = json::array();
+	for (uint32_t e = 0; e < tables.m_entityCount; ++e)
+	{
+		json eJson;
+		eJson["Name"] = reader.ReadString();
+
+		uint32_t componentCount = reader.ReadUInt();
+		for (uint32_t c = 0; c < componentCount && !reader.IsFailed(); ++c)
+		{
+			uint16_t typeId = reader.ReadPod<uint16_t>();
+			uint32_t size = reader.ReadUInt();
+			const uint8_t* pBlock = reader.ReadBytes(size);
+			if (!pBlock || typeId >= tables.m_types.size()) { return false; }
+
+			const TypeInfo& type = tables.m_types[typeId];
+			json compJson = BlockToJson(pBlock, size, type, tables);
+			if (compJson.is_discarded()) { return false; }
+
+			eJson[tables.m_strings[type.m_name]] = std::move(compJson);
+		}
+
+		if (reader.IsFailed()) { return false; }
+		entitiesJson.push_back(std::move(eJson));
+	}
+
+	sceneJson["Entities"] = std::move(entitiesJson);
+	outSceneJson = std::move(sceneJson);
+	return true;
+}
+
+bool SceneBinary::ConvertToBinary(const std::string& jsonPath, const std::string& binaryPath)
+{
+	// 保存中の JSON は書き終えてから読む (同じバイナリを書き合わないように)
+	SceneSaver::Instance().Wait(jsonPath);
+
+	std::string text;
+	if (!KdFileSystem::Instance().ReadFile(jsonPath, text)) { return false; }
+
+	json sceneJson = json::parse(text, nullptr, false);
+	if (sceneJson.is_discarded())
+	{
+		Logger::Error("SceneBinary: JSON Parse Error: " + jsonPath);
+		return false;
+	}
+
+	std::vector<uint8_t> data;
+	return FromJson(sceneJson, data) && Save(binaryPath, data);
+}
+
+bool SceneBinary::ConvertToJson(const std::string& binaryPath, const std::string& jsonPath)
+{
+	// 保存中の JSON を上書きしないように
+	SceneSaver::Instance().Wait(jsonPath);
+
+	std::vector<uint8_t> data;
+	if (!KdFileSystem::Instance().ReadFile(binaryPath, data)) { return false; }
+
+	json sceneJson;
+	if (!ToJson(data, sceneJson))
+	{
+		Logger::Error("SceneBinary: Broken scene binary: " + binaryPath);
+		return false;
+	}
+
+	std::ofstream os(jsonPath);
+	if (!os) { return false; }
+
+	os << sceneJson.dump(4);
+	return (bool)os;
+}
+
+size_t SceneBinary::ConvertDirectory(const std::string& dir)
+{
+	size_t converted = 0;
+	size_t failed = 0;
+
+	std::error_code ec;
+	for (auto it = std::filesystem::recursive_directory_iterator(dir, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+	{
+		if (!it->is_regular_file(ec) || it->path().extension() != ".json") { continue; }
+
+		std::string jsonPath = it->path().generic_string();
+		if (ConvertToBinary(jsonPath, GetBinaryPath(jsonPath)))
+		{
+			++converted;
+		}
+		else
+		{
+			Logger::Error("SceneBinary: Failed to convert: " + jsonPath);
+			++failed;
+		}
+	}
+
+	Logger::Log("Serializer", "Converted " + std::to_string(converted) + " scenes to binary (" + std::to_string(failed) + " failed)");
+	return failed;
+}
+
+bool SceneBinary::Load(const std::string& binaryPath,
+	const std::function<void(std::vector<std::shared_ptr<Entity>>&)>& onBatch,
+	std::shared_ptr<CameraBase>& editorCamera,
+	size_t batchSize)
+{
+	std::vector<uint8_t> data;
+	if (!KdFileSystem::Instance().ReadFile(binaryPath, data)) { return false; }
+
+	Tables tables;
+	SceneBinaryReader reader(data.data(), data.size(), &tables.m_strings);
+
+	std::vector<size_t> entityOffsets;
+	if (!ReadTables(reader, tables) || !ValidateEntities(reader, tables, entityOffsets))
+	{
+		Logger::Error("SceneBinary: Unsupported or broken scene binary: " + binaryPath);
+		return false;
+	}
+
+	// 型ごとに、作り方と直接読めるかを先に決めておく
+	std::vector<TypeLoader> loaders(tables.m_types.size());
+	for (size_t i = 0; i < tables.m_types.size(); ++i)
+	{
+		const std::string& typeName = tables.m_strings[tables.m_types[i].m_name];
+
+		loaders[i].m_pCreator = ComponentFactory::Instance().FindCreator(typeName);
+		if (!loaders[i].m_pCreator)
+		{
+			Logger::Error("SceneBinary: Unknown component skipped: " + typeName);
+			continue;
+		}
+
+		std::shared_ptr<Component> spComponent = (*loaders[i].m_pCreator)();
+		loaders[i].m_isDirect = IsSameSchema(tables.m_types[i], tables.m_strings, spComponent->GetBinarySchema());
+	}
+
+	// 並びは ValidateEntities で確かめてあるので、ここからは途中で止まらない
+	// batchSize 個ずつワーカーで並列に作り、ファイルの順に渡す
+	batchSize = std::max<size_t>(batchSize, 1);
+
+	for (size_t begin = 0; begin < entityOffsets.size(); begin += batchSize)
+	{
+		size_t count = std::min(batchSize, entityOffsets.size() - begin);
+
+		std::vector<std::shared_ptr<Entity>> batch(count);
+		KdParallel::Instance().For(count, [&](size_t i)
+			{
+				size_t offset = entityOffsets[begin + i];
+				SceneBinaryReader entityReader(data.data() + offset, data.size() - offset, &tables.m_strings);
+
+				batch[i] = CreateEntity(entityReader, tables, loaders);
+			});
+
+		// ValidateEntities を通っていれば起きないが、ずれたまま読み進めずに失敗にする
+		if (std::find(batch.begin(), batch.end(), nullptr) != batch.end())
+		{
+			Logger::Error("SceneBinary: Broken entity in scene binary: " + binaryPath);
+			return false;
+		}
+
+		onBatch(batch);
+	}
+
+	if (tables.m_hasCamera && editorCamera)
+	{
+		editorCamera->SetPosition(tables.m_cameraPos);
+		editorCamera->SetEulerDeg(tables.m_cameraRot);
+	}
+
+	return true;
+}
+
+bool SceneBinary::Save(const std::string& binaryPath, const std::vector<uint8_t>& data)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(binaryPath).parent_path(), ec);
+
+	// 途中で止まっても壊れたファイルが残らないように、書き終えてから置き換える
+	std::string tmpPath = binaryPath + ".tmp";
+	{
+		std::ofstream os(tmpPath, std::ios::binary);
+		if (!os) { return false; }
+
+		os.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!os)
+		{
+			os.close();
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tmpPath, binaryPath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,125 @@
+﻿#pragma once
+
+class Entity;
+class CameraBase;
+
+//=====================================================
+//
+// バイナリシーン (実行時用)
+//
+// ・JSON のシーン (編集・差分用) から作る。SceneSerializer::Save が JSON と一緒に "<シーン名>.scnb" に書き出す
+// ・文字列は全て文字列テーブルの番号、コンポーネントは型テーブルの番号で持つ
+// ・コンポーネントの中身はスキーマ (キーと型の並び) の順に値を詰めたブロック
+//   スキーマを持たないコンポーネントは JSON を MessagePack にしたものを入れる
+// ・ファイルにスキーマを丸ごと入れておくので、コンポーネントの版が変わっても JSON に戻して読める
+//
+// ファイルの並び (リトルエンディアン)
+//   "KSCB" / 形式の版 / エディタカメラ
+//   文字列テーブル	: 数, { 長さ, 文字列 }...
+//   型テーブル		: 数, { 名前, 版, 形式, フィールド数, { 名前, 型 }... }...
+//   エンティティ		: 数, { 名前, コンポーネント数, { 型番号, サイズ, ブロック }... }...
+//
+//=====================================================
+
+// スキーマのフィールドの型
+enum class SceneFieldType : uint8_t
+{
+	Bool,		// 1 byte
+	Int,		// int32_t
+	UInt,		// uint32_t
+	Float,		// float
+	Vector3,	// float x 3
+	String,		// 文字列テーブルの番号 (uint32_t)
+};
+
+struct SceneFieldDesc
+{
+	const char*		m_name;		// Serialize が書き出す JSON のキー
+	SceneFieldType	m_type;
+};
+
+// コンポーネント1種類分のスキーマ
+// ・フィールドを足す・消す・型を変えた時は m_version を上げる
+struct SceneComponentSchema
+{
+	uint32_t					m_version = 1;
+	std::vector<SceneFieldDesc>	m_fields;
+};
+
+// ブロックの読み込み
+// ・範囲外を読もうとすると、以降は 0 や空文字を返して IsFailed() が true になる
+class SceneBinaryReader
+{
+public:
+	SceneBinaryReader(const uint8_t* pData, size_t size, const std::vector<std::string>* pStrings)
+		: m_pData(pData), m_size(size), m_pStrings(pStrings) {}
+
+	bool				ReadBool()		{ return ReadPod<uint8_t>() != 0; }
+	int32_t				ReadInt()		{ return ReadPod<int32_t>(); }
+	uint32_t			ReadUInt()		{ return ReadPod<uint32_t>(); }
+	float				ReadFloat()		{ return ReadPod<float>(); }
+	Math::Vector3		ReadVector3();
+	const std::string&	ReadString();
+
+	template <typename T>
+	T ReadPod()
+	{
+		T value{};
+		if (const uint8_t* p = ReadBytes(sizeof(T))) { memcpy(&value, p, sizeof(T)); }
+		return value;
+	}
+
+	// size バイト進めて、その先頭を返す (足りなければ nullptr)
+	const uint8_t* ReadBytes(size_t size);
+
+	bool	IsFailed() const		{ return m_failed; }
+	size_t	GetPosition() const		{ return m_pos; }
+	size_t	GetRemaining() const	{ return m_size - m_pos; }
+
+private:
+	const uint8_t*					m_pData = nullptr;
+	size_t							m_size = 0;
+	size_t							m_pos = 0;
+	const std::vector<std::string>*	m_pStrings = nullptr;
+	bool							m_failed = false;
+};
+
+class SceneBinary
+{
+public:
+
+	// 形式を変えたら上げる (古いファイルは読まずに JSON から読む)
+	static constexpr uint32_t kVersion = 1;
+
+	// シーンファイル (JSON) のパス → バイナリのパス
+	static std::string GetBinaryPath(const std::string& scenePath);
+
+	// 使えるバイナリのパス (無い・JSON の方が新しい場合は空)
+	static std::string FindUpToDate(const std::string& scenePath);
+
+	// JSON → バイナリ
+	// ・コンポーネントに無いキーはデフォルト値 (作ったばかりのコンポーネントを Serialize したもの) で埋める
+	// ・ComponentFactory に無いコンポーネントは JSON のまま (MessagePack で) 入れる (ToJson で元に戻る)
+	static bool FromJson(const nlohmann::json& sceneJson, std::vector<uint8_t>& outData);
+
+	// バイナリ → JSON (ファイル内のスキーマだけで戻すので、コンポーネントの版が変わっていても戻せる)
+	static bool ToJson(const std::vector<uint8_t>& data, nlohmann::json& outSceneJson);
+
+	// ファイル単位の変換
+	static bool ConvertToBinary(const std::string& jsonPath, const std::string& binaryPath);
+	static bool ConvertToJson(const std::string& binaryPath, const std::string& jsonPath);
+
+	// path 以下の JSON シーンを全てバイナリにする (戻り値 … 失敗した数)
+	static size_t ConvertDirectory(const std::string& dir);
+
+	// バイナリからエンティティを作り、batchSize 個ずつ onBatch に渡す
+	// ・1つの batch の中はワーカースレッドで並列に作り、ファイルの順に渡す
+	// ・ファイルのスキーマがコンポーネントと同じ版なら DeserializeBinary で直接読み、違えば JSON に戻して Deserialize
+	// ・壊れたファイルは、エンティティを1つも作らずに false (JSON から読み直せるように)
+	static bool Load(const std::string& binaryPath,
+		const std::function<void(std::vector<std::shared_ptr<Entity>>&)>& onBatch,
+		std::shared_ptr<CameraBase>& editorCamera,
+		size_t batchSize);
+
+	static bool Save(const std::string& binaryPath, const std::vector<uint8_t>& data);
+};
@@ -0,0 +1,158 @@
+﻿#include "SceneManifest.h"
+
+using json = nlohmann::json;
+
+namespace
+{
+	const char* kTypeNames[] = { "Model", "Texture", "Sound" };
+
+	// モデルはエンティティの表示に必要なので先に、音は最後
+	int GetDefaultPriority(SceneManifest::AssetType type)
+	{
+		switch (type)
+		{
+		case SceneManifest::AssetType::Model:	return 2;
+		case SceneManifest::AssetType::Texture:	return 1;
+		default:								return 0;
+		}
+	}
+}
+
+std::string SceneManifest::GetManifestPath(const std::string& scenePath)
+{
+	return std::filesystem::path(scenePath).replace_extension(".manifest").string();
+}
+
+bool SceneManifest::FindAssetType(std::string_view path, AssetType& outType)
+{
+	std::string ext = std::filesystem::path(path).extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	if (ext == ".gltf" || ext == ".glb")
+	{
+		outType = AssetType::Model;
+		return true;
+	}
+	if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga" || ext == ".dds" || ext == ".hdr")
+	{
+		outType = AssetType::Texture;
+		return true;
+	}
+	if (ext == ".wav")
+	{
+		outType = AssetType::Sound;
+		return true;
+	}
+	return false;
+}
+
+void SceneManifest::Add(const std::string& path, AssetType type)
+{
+	if (path.empty()) { return; }
+
+	Asset& asset = m_assets.emplace_back();
+	asset.m_path = path;
+	asset.m_type = type;
+	asset.m_priority = GetDefaultPriority(type);
+}
+
+void SceneManifest::CollectFromJson(const json& j)
+{
+	if (j.is_string())
+	{
+		const std::string& str = j.get_ref<const std::string&>();
+
+		AssetType type;
+		if (FindAssetType(str, type)) { Add(str, type); }
+		return;
+	}
+
+	if (j.is_object() || j.is_array())
+	{
+		for (const auto& child : j) { CollectFromJson(child); }
+	}
+}
+
+void SceneManifest::Finalize()
+{
+	// 同じパスは1つに (優先度は高い方)
+	std::sort(m_assets.begin(), m_assets.end(), [](const Asset& a, const Asset& b)
+		{
+			if (a.m_path != b.m_path) { return a.m_path < b.m_path; }
+			return a.m_priority > b.m_priority;
+		});
+	m_assets.erase(std::unique(m_assets.begin(), m_assets.end(), [](const Asset& a, const Asset& b) { return a.m_path == b.m_path; }), m_assets.end());
+
+	for (Asset& asset : m_assets)
+	{
+		if (!KdFileSystem::Instance().GetFileSize(asset.m_path, asset.m_size)) { asset.m_size = 0; }
+	}
+
+	// 大きいものから読み始めると、ワーカースレッドの終わる時間が揃いやすい
+	std::stable_sort(m_assets.begin(), m_assets.end(), [](const Asset& a, const Asset& b)
+		{
+			if (a.m_priority != b.m_priority) { return a.m_priority > b.m_priority; }
+			return a.m_size > b.m_size;
+		});
+}
+
+uint64_t SceneManifest::GetTotalSize() const
+{
+	uint64_t total = 0;
+	for (const Asset& asset : m_assets) { total += asset.m_size; }
+	return total;
+}
+
+bool SceneManifest::Save(const std::string& path) const
+{
+	json assetsJson = json::array();
+	for (const Asset& asset : m_assets)
+	{
+		assetsJson.push_back({
+			{ "Path", asset.m_path },
+			{ "Type", kTypeNames[(int)asset.m_type] },
+			{ "Size", asset.m_size },
+			{ "Priority", asset.m_priority },
+		});
+	}
+
+	json manifestJson;
+	manifestJson["Version"] = kVersion;
+	manifestJson["Assets"] = assetsJson;
+
+	std::ofstream os(path);
+	if (!os) { return false; }
+
+	os << manifestJson.dump(4);
+	return (bool)os;
+}
+
+bool SceneManifest::Load(const std::string& path)
+{
+	m_assets.clear();
+
+	std::string text;
+	if (!KdFileSystem::Instance().ReadFile(path, text)) { return false; }
+
+	json manifestJson = json::parse(text, nullptr, false);
+	if (manifestJson.is_discarded() || manifestJson.value("Version", 0) != kVersion) { return false; }
+
+	if (!manifestJson.contains("Assets") || !manifestJson["Assets"].is_array()) { return false; }
+
+	for (const json& assetJson : manifestJson["Assets"])
+	{
+		std::string typeName = assetJson.value("Type", "");
+		auto it = std::find(std::begin(kTypeNames), std::end(kTypeNames), typeName);
+		if (it == std::end(kTypeNames)) { continue; }
+
+		Asset& asset = m_assets.emplace_back();
+		asset.m_path = assetJson.value("Path", "");
+		asset.m_type = (AssetType)(it - std::begin(kTypeNames));
+		asset.m_size = assetJson.value("Size", (uint64_t)0);
+		asset.m_priority = assetJson.value("Priority", GetDefaultPriority(asset.m_type));
+
+		if (asset.m_path.empty()) { m_assets.pop_back(); }
+	}
+
+	return true;
+}
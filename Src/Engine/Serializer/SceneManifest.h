@@ -0,0 +1,49 @@
+﻿#pragma once
+
+// シーンが使うアセットの一覧 (シーン切り替え時のプリロード用)
+// ・SceneSerializer::Save がシーンと一緒に "<シーン名>.manifest" に書き出す
+// ・中身は JSON { "Version", "Assets": [{ "Path", "Type", "Size", "Priority" }] }
+// ・読み込む順 (優先度の高い順 → サイズの大きい順) に並べて保存する
+struct SceneManifest
+{
+	enum class AssetType
+	{
+		Model,
+		Texture,
+		Sound,
+	};
+
+	struct Asset
+	{
+		std::string	m_path;
+		AssetType	m_type = AssetType::Model;
+		uint64_t	m_size = 0;			// ファイルサイズ (パックファイル内なら展開後)
+		int			m_priority = 0;		// 大きいほど先に読む
+	};
+
+	std::vector<Asset> m_assets;
+
+	// 形式を変えたら上げる
+	static constexpr int kVersion = 1;
+
+	// シーンファイルのパス → マニフェストのパス
+	static std::string GetManifestPath(const std::string& scenePath);
+
+	// 拡張子からアセットの種類を決める (アセットのパスでなければ false)
+	static bool FindAssetType(std::string_view path, AssetType& outType);
+
+	// 追加 (同じパスは Finalize でまとめる)
+	void Add(const std::string& path, AssetType type);
+
+	// コンポーネントを書き出した JSON の文字列からアセットのパスを集める
+	void CollectFromJson(const nlohmann::json& j);
+
+	// 重複を除いてサイズを調べ、読み込む順に並べる
+	void Finalize();
+
+	// 合計サイズ
+	uint64_t GetTotalSize() const;
+
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+};
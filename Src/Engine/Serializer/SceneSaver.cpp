@@ -0,0 +1,453 @@
+﻿#include "SceneSaver.h"
+#include "SceneManifest.h"
+#include "SceneBinary.h"
+#include "JsonUtils.h"
+#include "../../Application/GameObject/Camera/CameraBase.h"
+#include "../Core/Thread/ThreadManager.h"
+
+using json = nlohmann::json;
+
+namespace
+{
+	// dump(4) の1段分
+	constexpr int kIndent = 4;
+
+	// text の各行の頭に indent 文字の空白を足して out に繋げる
+	// (JSON の文字列の中の改行は \n になっているので、行の区切りは値の区切りと一致する)
+	void AppendIndented(std::string& out, const std::string& text, size_t indent, bool indentFirstLine)
+	{
+		size_t begin = 0;
+		bool first = true;
+		while (begin <= text.size())
+		{
+			size_t end = text.find('\n', begin);
+			if (end == std::string::npos) { end = text.size(); }
+
+			if (!first) { out += '\n'; }
+			if (!first || indentFirstLine) { out.append(indent, ' '); }
+			out.append(text, begin, end - begin);
+
+			first = false;
+			begin = end + 1;
+		}
+	}
+
+	void SerializeEntity(const Entity& entity, json& outJson)
+	{
+		outJson["Name"] = entity.GetName();
+
+		for (const auto& [typeIdx, component] : entity.GetAllComponents())
+		{
+			json compJson;
+			component->Serialize(compJson);
+
+			outJson[component->GetType()] = compJson;
+		}
+	}
+
+	// 書き方の違うパス ("./Asset/..." や絶対パス) を同じものとして比べる
+	std::string NormalizeScenePath(const std::string& path)
+	{
+		std::error_code ec;
+		std::filesystem::path absolutePath = std::filesystem::absolute(path, ec);
+		return KdPackFile::NormalizePath(ec ? path : absolutePath.lexically_normal().generic_string());
+	}
+
+	// tmp に書き終えてから path に置き換える
+	bool WriteFileAtomic(const std::string& path, const std::string& text)
+	{
+		std::error_code ec;
+		std::filesystem::path parent = std::filesystem::path(path).parent_path();
+		if (!parent.empty()) { std::filesystem::create_directories(parent, ec); }
+
+		std::string tmpPath = path + ".tmp";
+		{
+			std::ofstream os(tmpPath);
+			if (!os) { return false; }
+
+			os << text;
+			os.close();	// バイナリより後に更新されると、バイナリが古いと判定される
+			if (!os)
+			{
+				std::filesystem::remove(tmpPath, ec);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(tmpPath, path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+		return true;
+	}
+}
+
+void SceneSaver::Save(const std::string& path,
+	const std::vector<std::shared_ptr<Entity>>& entities,
+	const std::shared_ptr<CameraBase>& editorCamera,
+	bool withRuntimeData)
+{
+	auto spSnapshot = std::make_shared<Snapshot>();
+	spSnapshot->m_path = path;
+	spSnapshot->m_withRuntimeData = withRuntimeData;
+
+	// 新しく頼んだので、前に失敗した古い内容は書き直さない
+	if (withRuntimeData)
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		if (m_spFailedSave && NormalizeScenePath(m_spFailedSave->m_path) == NormalizeScenePath(path)) { m_spFailedSave.reset(); }
+	}
+
+	TakeSnapshot(*spSnapshot, entities, editorCamera);
+
+	// モデルが読み込むテクスチャも一緒に読み始められるように
+	// (KdTexture 自体はパスを持っていないので KdAssets から引く。読み込みの状態で変わるので毎回集める)
+	if (withRuntimeData)
+	{
+		std::unordered_map<const KdTexture*, std::string> texturePaths;
+		{
+			std::vector<std::pair<std::string, std::shared_ptr<KdTexture>>> textures;
+			KdAssets::Instance().m_textures.GetLoadedDatas(textures);
+			for (const auto& [texPath, spTexture] : textures) { texturePaths[spTexture.get()] = texPath; }
+		}
+
+		for (const auto& entity : entities)
+		{
+			if (!entity) continue;
+
+			auto render = entity->GetComponent<RenderComponent>();
+			if (!render || !render->GetModelData()) continue;
+
+			for (const KdMaterial& material : render->GetModelData()->GetMaterials())
+			{
+				for (const KdTexture* pTexture : { material.m_baseColorTex.get(), material.m_metallicRoughnessTex.get(),
+					material.m_emissiveTex.get(), material.m_normalTex.get() })
+				{
+					auto it = texturePaths.find(pTexture);
+					if (pTexture && it != texturePaths.end()) { spSnapshot->m_texturePaths.push_back(it->second); }
+				}
+			}
+		}
+	}
+
+	Enqueue(std::move(spSnapshot));
+}
+
+void SceneSaver::UpdateAutosave(const std::string& sceneName,
+	const std::vector<std::shared_ptr<Entity>>& entities,
+	const std::shared_ptr<CameraBase>& editorCamera)
+{
+	if (m_autosaveInterval <= 0.0f || sceneName.empty()) { return; }
+
+	auto now = std::chrono::steady_clock::now();
+	if (std::chrono::duration<float>(now - m_lastAutosaveTime).count() < m_autosaveInterval) { return; }
+
+	// 前の書き込みが終わるまで待たない (手動の保存が長引いていても止めない)
+	if (IsWriting()) { return; }
+
+	m_lastAutosaveTime = now;
+
+	auto spSnapshot = std::make_shared<Snapshot>();
+	spSnapshot->m_path = GetAutosavePath(sceneName);
+
+	bool changed = TakeSnapshot(*spSnapshot, entities, editorCamera);
+	if (!changed && !m_autosaveFailed) { return; }
+
+	m_autosaveFailed = false;
+	Enqueue(std::move(spSnapshot));
+}
+
+std::string SceneSaver::GetAutosavePath(const std::string& sceneName)
+{
+	return "Autosave/" + sceneName + ".json";
+}
+
+bool SceneSaver::IsWriting() const
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	return m_isWriting;
+}
+
+void SceneSaver::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_queueMutex);
+	m_idleCondition.wait(lock, [this] { return !m_isWriting; });
+}
+
+void SceneSaver::Wait(const std::string& path)
+{
+	std::string normalizedPath = NormalizeScenePath(path);
+
+	std::unique_lock<std::mutex> lock(m_queueMutex);
+	m_idleCondition.wait(lock, [this, &normalizedPath] { return !IsPendingLocked(normalizedPath); });
+}
+
+bool SceneSaver::IsPendingLocked(const std::string& normalizedPath) const
+{
+	if (!m_writingPath.empty() && NormalizeScenePath(m_writingPath) == normalizedPath) { return true; }
+
+	for (const auto& spSnapshot : m_queue)
+	{
+		if (NormalizeScenePath(spSnapshot->m_path) == normalizedPath) { return true; }
+	}
+	return false;
+}
+
+void SceneSaver::UpdateRetry()
+{
+	auto now = std::chrono::steady_clock::now();
+	if (std::chrono::duration<float>(now - m_lastRetryTime).count() < kRetryInterval) { return; }
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		if (!m_spFailedSave || m_isWriting) { return; }
+	}
+
+	RetryFailedSave();
+}
+
+bool SceneSaver::GetFailedSavePath(std::string& outPath) const
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	if (!m_spFailedSave) { return false; }
+
+	outPath = m_spFailedSave->m_path;
+	return true;
+}
+
+void SceneSaver::RetryFailedSave()
+{
+	std::shared_ptr<Snapshot> spSnapshot;
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		spSnapshot = std::move(m_spFailedSave);
+	}
+	if (!spSnapshot) { return; }
+
+	m_lastRetryTime = std::chrono::steady_clock::now();
+
+	Logger::Log("Serializer", "Retrying save: " + spSnapshot->m_path);
+	Enqueue(std::move(spSnapshot));
+}
+
+void SceneSaver::Release()
+{
+	Wait();
+	m_cache.clear();
+
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	m_spFailedSave.reset();
+}
+
+bool SceneSaver::TakeSnapshot(Snapshot& snapshot,
+	const std::vector<std::shared_ptr<Entity>>& entities,
+	const std::shared_ptr<CameraBase>& editorCamera)
+{
+	if (editorCamera)
+	{
+		snapshot.m_hasCamera = true;
+		snapshot.m_cameraJson["Position"] = editorCamera->GetPosition();
+		snapshot.m_cameraJson["Rotation"] = editorCamera->GetEulerDeg();
+	}
+
+	bool changed = false;
+
+	// 今回のエンティティの分だけで作り直す (消えたエンティティのチャンクはここで捨てる)
+	std::unordered_map<const Entity*, CacheEntry> cache;
+	cache.reserve(entities.size());
+
+	snapshot.m_chunks.reserve(entities.size());
+	for (const auto& entity : entities)
+	{
+		if (!entity) continue;
+
+		uint64_t revision = entity->GetRevision();
+
+		// 同じアドレスに別のエンティティが作られていることもあるので、weak_ptr で本人か確かめる
+		auto it = m_cache.find(entity.get());
+		if (it != m_cache.end() && it->second.m_revision == revision && it->second.m_wpEntity.lock() == entity)
+		{
+			snapshot.m_chunks.push_back(it->second.m_spChunk);
+			cache.emplace(entity.get(), std::move(it->second));
+			continue;
+		}
+
+		auto spChunk = std::make_shared<Chunk>();
+		SerializeEntity(*entity, spChunk->m_json);
+		snapshot.m_chunks.push_back(spChunk);
+
+		CacheEntry& entry = cache[entity.get()];
+		entry.m_wpEntity = entity;
+		entry.m_revision = revision;
+		entry.m_spChunk = std::move(spChunk);
+
+		changed = true;
+	}
+
+	if (cache.size() != m_cache.size()) { changed = true; }
+	m_cache = std::move(cache);
+
+	return changed;
+}
+
+void SceneSaver::Enqueue(std::shared_ptr<Snapshot> spSnapshot)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_queue.push_back(std::move(spSnapshot));
+
+		if (m_isWriting) { return; }
+		m_isWriting = true;
+	}
+
+	// 書き込みは1つのジョブが順番に行う (チャンクのテキストを同時に作らないように)
+	ThreadManager::Instance().AddJobWithPriority(Job::Priority::Low, [this]() { WriteQueued(); });
+}
+
+void SceneSaver::WriteQueued()
+{
+	while (true)
+	{
+		std::shared_ptr<Snapshot> spSnapshot;
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			if (m_queue.empty())
+			{
+				m_isWriting = false;
+				m_idleCondition.notify_all();
+				return;
+			}
+
+			spSnapshot = std::move(m_queue.front());
+			m_queue.pop_front();
+			m_writingPath = spSnapshot->m_path;
+		}
+
+		bool succeeded = Write(*spSnapshot);
+		if (!succeeded && !spSnapshot->m_withRuntimeData)
+		{
+			m_autosaveFailed = true;
+		}
+
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_writingPath.clear();
+
+		// 失敗した手動保存は UpdateRetry で書き直す (成功したら同じパスの失敗は消す)
+		// ・同じパスに後から頼んだ保存が待っていれば、そちらが新しいので書き直さない
+		if (spSnapshot->m_withRuntimeData)
+		{
+			if (!succeeded)
+			{
+				if (!IsPendingLocked(NormalizeScenePath(spSnapshot->m_path))) { m_spFailedSave = spSnapshot; }
+			}
+			else if (m_spFailedSave && NormalizeScenePath(m_spFailedSave->m_path) == NormalizeScenePath(spSnapshot->m_path))
+			{
+				m_spFailedSave.reset();
+			}
+		}
+
+		// Wait(path) で待っている側を起こす
+		m_idleCondition.notify_all();
+	}
+}
+
+bool SceneSaver::Write(Snapshot& snapshot)
+{
+	PROFILE_SCOPE("SceneSaver::Write");
+
+	// シーン全体を dump(4) したものと同じ並び (キーの順: EditorCamera, Entities, Scene)
+	size_t reserveSize = 64;
+	for (const auto& spChunk : snapshot.m_chunks)
+	{
+		// 変わったエンティティだけ文字列にする
+		if (spChunk->m_text.empty())
+		{
+			AppendIndented(spChunk->m_text, spChunk->m_json.dump(kIndent), kIndent * 2, true);
+		}
+		reserveSize += spChunk->m_text.size() + 2;
+	}
+
+	std::string text;
+	text.reserve(reserveSize);
+
+	text += "{\n";
+	if (snapshot.m_hasCamera)
+	{
+		text.append(kIndent, ' ');
+		text += "\"EditorCamera\": ";
+		AppendIndented(text, snapshot.m_cameraJson.dump(kIndent), kIndent, false);
+		text += ",\n";
+	}
+
+	text.append(kIndent, ' ');
+	if (snapshot.m_chunks.empty())
+	{
+		text += "\"Entities\": [],\n";
+	}
+	else
+	{
+		text += "\"Entities\": [\n";
+		for (size_t i = 0; i < snapshot.m_chunks.size(); ++i)
+		{
+			text += snapshot.m_chunks[i]->m_text;
+			text += (i + 1 < snapshot.m_chunks.size()) ? ",\n" : "\n";
+		}
+		text.append(kIndent, ' ');
+		text += "],\n";
+	}
+
+	text.append(kIndent, ' ');
+	text += "\"Scene\": \"Untitled\"\n}";
+
+	if (!WriteFileAtomic(snapshot.m_path, text))
+	{
+		Logger::Error("Failed to save scene: " + snapshot.m_path);
+		return false;
+	}
+	Logger::Log("Serializer", "Saved Scene to: " + snapshot.m_path + " (" + std::to_string(snapshot.m_chunks.size()) + " entities)");
+
+	if (!snapshot.m_withRuntimeData) { return true; }
+
+	// シーンが使うアセット (プリロード用)
+	SceneManifest manifest;
+	for (const auto& spChunk : snapshot.m_chunks) { manifest.CollectFromJson(spChunk->m_json); }
+	for (const std::string& texPath : snapshot.m_texturePaths) { manifest.Add(texPath, SceneManifest::AssetType::Texture); }
+
+	bool succeeded = true;
+
+	manifest.Finalize();
+	std::string manifestPath = SceneManifest::GetManifestPath(snapshot.m_path);
+	if (manifest.Save(manifestPath))
+	{
+		Logger::Log("Serializer", "Saved Manifest to: " + manifestPath + " (" + std::to_string(manifest.m_assets.size()) + " assets)");
+	}
+	else
+	{
+		Logger::Error("Failed to save manifest: " + manifestPath);
+		succeeded = false;
+	}
+
+	// 実行時用のバイナリ (JSON の方は編集・差分用)
+	json sceneJson;
+	sceneJson["Scene"] = "Untitled";
+	if (snapshot.m_hasCamera) { sceneJson["EditorCamera"] = snapshot.m_cameraJson; }
+
+	json& entitiesJson = sceneJson["Entities"] = json::array();
+	for (const auto& spChunk : snapshot.m_chunks) { entitiesJson.push_back(spChunk->m_json); }
+
+	std::vector<uint8_t> binary;
+	std::string binaryPath = SceneBinary::GetBinaryPath(snapshot.m_path);
+	if (SceneBinary::FromJson(sceneJson, binary) && SceneBinary::Save(binaryPath, binary))
+	{
+		Logger::Log("Serializer", "Saved Binary to: " + binaryPath + " (" + std::to_string(binary.size()) + " bytes)");
+	}
+	else
+	{
+		Logger::Error("Failed to save scene binary: " + binaryPath);
+		succeeded = false;
+	}
+
+	return succeeded;
+}
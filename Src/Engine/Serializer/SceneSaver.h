@@ -0,0 +1,144 @@
+﻿#pragma once
+
+class Entity;
+class CameraBase;
+
+//=====================================================
+//
+// シーンの保存 (バックグラウンド)
+//
+// ・メインスレッドではスナップショットを取るだけで、文字列化・ファイル書き込みはワーカーで行う
+// ・エンティティ1つ分の JSON テキストを「チャンク」として覚えておき、
+//   変更番号 (Entity::GetRevision) が変わっていないエンティティは前回のテキストをそのまま使う
+//   メインスレッドで Serialize するのは変更のあったエンティティだけ
+// ・チャンクを繋げたファイルは、シーン全体を dump(4) したものと同じ中身になる (差分・読み込みは今まで通り)
+// ・一時ファイルに書き終えてから置き換えるので、途中で落ちても前のファイルが残る
+// ・書き込みは1つずつ順番に行う (後から頼んだ保存が先に終わることは無い)
+// ・手動の保存 (withRuntimeData) が失敗したら、同じ内容を kRetryInterval ごとに書き直す
+//   (ファイルが他のアプリに開かれていた時など。エディタはメニューバーに表示する)
+//
+//=====================================================
+class SceneSaver
+{
+public:
+
+	// 保存を頼む (スナップショットはこの中で取る)
+	// withRuntimeData … マニフェストと実行時用のバイナリも書く (自動保存では書かない)
+	void Save(const std::string& path,
+		const std::vector<std::shared_ptr<Entity>>& entities,
+		const std::shared_ptr<CameraBase>& editorCamera,
+		bool withRuntimeData);
+
+	// 自動保存 (毎フレーム呼ぶ)
+	// ・間隔が経っていて、前回の保存から変更があれば GetAutosavePath に保存する
+	// ・前の書き込みが終わっていなければ次のフレームに回す
+	void UpdateAutosave(const std::string& sceneName,
+		const std::vector<std::shared_ptr<Entity>>& entities,
+		const std::shared_ptr<CameraBase>& editorCamera);
+
+	// 自動保存の置き場所 ("Autosave/<シーン名>.json")
+	static std::string GetAutosavePath(const std::string& sceneName);
+
+	// 自動保存の間隔 (秒、0 以下で止める)
+	void SetAutosaveInterval(float seconds) { m_autosaveInterval = seconds; }
+	float GetAutosaveInterval() const { return m_autosaveInterval; }
+
+	// 書き込み中 (待っているものも含む)
+	bool IsWriting() const;
+
+	// 頼まれた書き込みが全て終わるまで待つ
+	void Wait();
+
+	// path (シーンの JSON のパス) への書き込みが終わるまで待つ (待っているものも含む)
+	// ・保存したばかりのシーン (JSON・マニフェスト・バイナリ) を読む前に呼ぶ
+	// ・書き込みはワーカーのジョブなので、ワーカースレッドから保存中のパスで呼ぶと止まることがある
+	//   (ワーカーで読む時は、ジョブを積む前にメインスレッドで待っておく)
+	void Wait(const std::string& path);
+
+	// 失敗した手動保存の書き直し (メインスレッドから毎フレーム呼ぶ)
+	void UpdateRetry();
+
+	// 失敗したままの手動保存のパス (無ければ false)
+	bool GetFailedSavePath(std::string& outPath) const;
+
+	// 失敗した手動保存を今すぐ書き直す
+	void RetryFailedSave();
+
+	// 失敗した手動保存を書き直す間隔 (秒)
+	static constexpr float kRetryInterval = 5.0f;
+
+	// 解放 (書き込みを待ってから、チャンクを捨てる)
+	void Release();
+
+private:
+	SceneSaver() {}
+	~SceneSaver() { Release(); }
+
+	// エンティティ1つ分
+	// ・m_json はメインスレッドで作り、m_text は書き込み側が最初に使う時に作る (以後は変えない)
+	struct Chunk
+	{
+		nlohmann::json	m_json;
+		std::string		m_text;		// m_json.dump(4) を配列の要素の深さに字下げしたもの
+	};
+
+	struct CacheEntry
+	{
+		std::weak_ptr<Entity>	m_wpEntity;
+		uint64_t				m_revision = 0;
+		std::shared_ptr<Chunk>	m_spChunk;
+	};
+
+	// 1回分の保存
+	struct Snapshot
+	{
+		std::string							m_path;
+		bool								m_hasCamera = false;
+		nlohmann::json						m_cameraJson;
+		std::vector<std::shared_ptr<Chunk>>	m_chunks;
+
+		bool								m_withRuntimeData = false;
+		std::vector<std::string>			m_texturePaths;		// モデルのマテリアルが使うテクスチャ (マニフェスト用)
+	};
+
+	// スナップショットを取る (戻り値 … 前回から変わったエンティティがあるか)
+	bool TakeSnapshot(Snapshot& snapshot,
+		const std::vector<std::shared_ptr<Entity>>& entities,
+		const std::shared_ptr<CameraBase>& editorCamera);
+
+	// 書き込み待ちに積み、書き込み側が動いていなければ起こす
+	void Enqueue(std::shared_ptr<Snapshot> spSnapshot);
+
+	// ワーカースレッドで、待ちが無くなるまで書き込む
+	void WriteQueued();
+
+	// path への書き込みが待ち・書き込み中にあるか (m_queueMutex をロックして呼ぶこと)
+	bool IsPendingLocked(const std::string& path) const;
+	bool Write(Snapshot& snapshot);
+
+	// チャンクのキャッシュ (メインスレッドだけが触る)
+	std::unordered_map<const Entity*, CacheEntry> m_cache;
+
+	// 書き込み待ち
+	mutable std::mutex						m_queueMutex;
+	std::condition_variable					m_idleCondition;
+	std::deque<std::shared_ptr<Snapshot>>	m_queue;
+	bool									m_isWriting = false;
+	std::string								m_writingPath;		// 書き込み中のシーン
+
+	// 失敗した手動保存 (m_queueMutex で守る)
+	std::shared_ptr<Snapshot>				m_spFailedSave;
+	std::chrono::steady_clock::time_point	m_lastRetryTime;
+
+	// 自動保存
+	float									m_autosaveInterval = 30.0f;
+	std::chrono::steady_clock::time_point	m_lastAutosaveTime = std::chrono::steady_clock::now();
+	std::atomic<bool>						m_autosaveFailed = false;	// 失敗したら変更が無くても書き直す
+
+public:
+	static SceneSaver& Instance()
+	{
+		static SceneSaver instance;
+		return instance;
+	}
+};
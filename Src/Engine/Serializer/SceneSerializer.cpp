@@ -1,4 +1,6 @@
 ﻿#include "SceneSerializer.h"
+#include "SceneBinary.h"
+#include "SceneSaver.h"
 #include "../../Application/GameObject/Camera/CameraBase.h"
 #include "JsonUtils.h"
 #include "../ECS/Component/Factory/ComponentFactory.h"
@@ -10,62 +12,223 @@ void SceneSerializer::Save(const std::string& filepath,
 	const std::vector<std::shared_ptr<Entity>>& entities, 
 	const std::shared_ptr<CameraBase>& editorCamera)
 {
-	json sceneJson;
-	sceneJson["Scene"] = "Untitled";
-	
-	// 1. エディタカメラの保存 (オプション)
-	if (editorCamera)
-	{
-		json camJson;
-		camJson["Position"] = editorCamera->GetPosition();
-		camJson["Rotation"] = editorCamera->GetEulerDeg();
-		sceneJson["EditorCamera"] = camJson;
-	}
+	// 変更のあったエンティティだけここで Serialize し、書き込みはワーカーで行う
+	SceneSaver::Instance().Save(filepath, entities, editorCamera, true);
+}
 
-	// 2. エンティティの保存
-	json entitiesJson = json::array();
+// --- Load Implementation ---
+namespace
+{
+#ifdef _DEBUG
+	bool s_preferBinary = false;
+#else
+	bool s_preferBinary = true;
+#endif
 
-	for (const auto& entity : entities)
+	// シーン JSON を SAX で読む
+	// ・"Entities" の要素 (エンティティ1つ分) と "EditorCamera" だけを小さな JSON にして、閉じた時点で渡す
+	// ・それ以外の値は読み捨てるので、ファイル全体のツリーは作らない
+	class SceneSaxHandler : public json::json_sax_t
 	{
-		if (!entity) continue;
+	public:
+		std::function<void(json&)>	m_onEntity;
+		std::function<void(json&)>	m_onCamera;
+
+		std::string							m_error;
 
-		json eJson;
-		eJson["Name"] = entity->GetName();
+		bool null() override											{ return AddValue(nullptr); }
+		bool boolean(bool val) override									{ return AddValue(val); }
+		bool number_integer(number_integer_t val) override				{ return AddValue(val); }
+		bool number_unsigned(number_unsigned_t val) override			{ return AddValue(val); }
+		bool number_float(number_float_t val, const string_t&) override	{ return AddValue(val); }
+		bool string(string_t& val) override								{ return AddValue(std::move(val)); }
+		bool binary(binary_t& val) override								{ return AddValue(json::binary(std::move(val))); }
 
-		for (const auto& [typeIdx, component] : entity->GetAllComponents())
+		bool start_object(std::size_t) override	{ return StartContainer(json::value_t::object); }
+		bool end_object() override				{ return EndContainer(); }
+		bool start_array(std::size_t) override	{ return StartContainer(json::value_t::array); }
+		bool end_array() override				{ return EndContainer(); }
+
+		bool key(string_t& val) override
 		{
-			std::string typeName = component->GetType();
-			
-			json compJson;
-			component->Serialize(compJson);
-			
-			eJson[typeName] = compJson;
+			if (m_stack.empty())
+			{
+				if (m_depth == 1) { m_topKey = std::move(val); }
+			}
+			else
+			{
+				m_key = std::move(val);
+			}
+			return true;
 		}
 
-		entitiesJson.push_back(eJson);
-	}
+		bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+		{
+			m_error = ex.what();
+			return false;
+		}
+
+	private:
+		bool StartContainer(json::value_t type)
+		{
+			++m_depth;
 
-	sceneJson["Entities"] = entitiesJson;
+			if (!m_stack.empty())
+			{
+				m_stack.push_back(Insert(json(type)));
+				return true;
+			}
 
-	// ファイルへの書き込み
-	std::filesystem::create_directories(std::filesystem::path(filepath).parent_path());
-	std::ofstream os(filepath);
-	if (os)
-	{
-		os << sceneJson.dump(4);
-		Logger::Log("Serializer", "Saved Scene to: " + filepath);
-	}
-	else
+			// ルート { "EditorCamera": {...}, "Entities": [ {...}, ... ] }
+			bool isObject = (type == json::value_t::object);
+			if (m_depth == 2 && isObject && m_topKey == "EditorCamera")
+			{
+				m_isEntity = false;
+			}
+			else if (m_depth == 3 && isObject && m_inEntities)
+			{
+				m_isEntity = true;
+			}
+			else
+			{
+				if (m_depth == 2) { m_inEntities = (m_topKey == "Entities" && type == json::value_t::array); }
+				return true;
+			}
+
+			m_root = json(type);
+			m_stack.push_back(&m_root);
+			return true;
+		}
+
+		bool EndContainer()
+		{
+			--m_depth;
+
+			if (m_stack.empty())
+			{
+				if (m_depth == 1) { m_inEntities = false; }
+				return true;
+			}
+
+			m_stack.pop_back();
+			if (m_stack.empty())
+			{
+				// 受け取った側で持っていってよい
+				const auto& onComplete = m_isEntity ? m_onEntity : m_onCamera;
+				if (onComplete) { onComplete(m_root); }
+
+				m_root = json();
+			}
+			return true;
+		}
+
+		bool AddValue(json&& value)
+		{
+			if (!m_stack.empty()) { Insert(std::move(value)); }
+			return true;
+		}
+
+		json* Insert(json&& value)
+		{
+			json& parent = *m_stack.back();
+			if (parent.is_array())
+			{
+				parent.push_back(std::move(value));
+				return &parent.back();
+			}
+
+			json& slot = parent[m_key];
+			slot = std::move(value);
+			return &slot;
+		}
+
+		int					m_depth = 0;
+		std::string			m_topKey;
+		bool				m_inEntities = false;
+
+		// 組み立て中の JSON (m_stack が空なら組み立てていない)
+		json				m_root;
+		std::vector<json*>	m_stack;
+		std::string			m_key;
+		bool				m_isEntity = false;
+	};
+
+	// ワーカースレッドから呼ばれる
+	std::shared_ptr<Entity> CreateEntity(const json& eJson)
 	{
-		Logger::Error("Failed to save scene: " + filepath);
+		std::shared_ptr<Entity> newEntity = std::make_shared<Entity>();
+
+		// 名前
+		if (eJson.contains("Name")) newEntity->SetName(eJson["Name"]);
+
+		for (auto& [key, value] : eJson.items())
+		{
+			if (key == "Name") continue; // Skip name
+
+			// Try to create a component with this key
+			auto component = ComponentFactory::Instance().Create(key);
+			if (component)
+			{
+				try 
+				{
+					component->Deserialize(value);
+					newEntity->AddComponent(component);
+				}
+				catch(const std::exception& e)
+				{
+					Logger::Error(std::string("Failed to deserialize component: ") + key + " Error: " + e.what());
+				}
+			}
+		}
+
+		newEntity->Init();
+		return newEntity;
 	}
 }
 
-// --- Load Implementation ---
+void SceneSerializer::SetPreferBinary(bool enable)
+{
+	s_preferBinary = enable;
+}
+
+bool SceneSerializer::IsPreferBinary()
+{
+	return s_preferBinary;
+}
+
 bool SceneSerializer::Load(const std::string& filepath, 
 	std::vector	<std::shared_ptr<Entity>>	& outEntities, 
 	std::shared_ptr<CameraBase>				& editorCamera)
 {
+	// 途中で失敗した時に半端なシーンを返さないように、全て読めてから渡す
+	std::vector<std::shared_ptr<Entity>> entities;
+	bool result = LoadStreaming(filepath, [&entities](std::vector<std::shared_ptr<Entity>>& batch)
+		{
+			entities.insert(entities.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+		}, editorCamera);
+
+	if (result) { outEntities = std::move(entities); }
+	return result;
+}
+
+bool SceneSerializer::LoadStreaming(const std::string& filepath,
+	const EntityBatchCallback& onBatch,
+	std::shared_ptr<CameraBase>& editorCamera,
+	size_t batchSize)
+{
+	batchSize = std::max<size_t>(batchSize, 1);
+
+	// 保存したばかりで書き込み中なら、書き終えてから読む
+	SceneSaver::Instance().Wait(filepath);
+
+	// 実行時用のバイナリが最新ならそちらを読む (読めなければ JSON から)
+	std::string binaryPath = s_preferBinary ? SceneBinary::FindUpToDate(filepath) : std::string();
+	if (!binaryPath.empty() && SceneBinary::Load(binaryPath, onBatch, editorCamera, batchSize))
+	{
+		Logger::Log("Serializer", "ロード完了: " + binaryPath);
+		return true;
+	}
+
 	std::ifstream is(filepath);
 	if (!is)
 	{
@@ -73,70 +236,67 @@ bool SceneSerializer::Load(const std::string& filepath,
 		return false;
 	}
 
-	json sceneJson;
-	try
-	{
-		is >> sceneJson;
-	}
-	catch (json::parse_error& error)
-	{
-		Logger::Error(std::string("JSON Parse Error: ") + error.what());
-		return false;
-	}
+	// 読み終わったエンティティの JSON (batchSize 個溜まったらまとめて作る)
+	std::vector<json> entityJsons;
+	entityJsons.reserve(batchSize);
 
-	// 1. エディタカメラの読み込み
-	if (sceneJson.contains("EditorCamera") && editorCamera)
-	{
-		auto& camJson = sceneJson["EditorCamera"];
-		if (camJson.contains("Position"))
-		{
-			editorCamera->SetPosition(camJson["Position"]);
-		}
-		if (camJson.contains("Rotation")) 
+	auto flushEntities = [&]()
 		{
-			editorCamera->SetEulerDeg(camJson["Rotation"]);
-		}
-	}
+			if (entityJsons.empty()) return;
 
-	// 2. エンティティの読み込み
-	outEntities.clear(); // 現在のシーンをクリア
+			// ワーカーで並列に作り、番号の場所に入れる (渡す順をファイルの順に揃える)
+			std::vector<std::shared_ptr<Entity>> batch(entityJsons.size());
+			KdParallel::Instance().For(entityJsons.size(), [&](size_t i)
+				{
+					batch[i] = CreateEntity(entityJsons[i]);
+				});
+			entityJsons.clear();
 
-	if (sceneJson.contains("Entities"))
-	{
-		for (auto& eJson : sceneJson["Entities"])
-		{
-			std::shared_ptr<Entity> newEntity = std::make_shared<Entity>();
+			onBatch(batch);
+		};
 
-			// 名前
-			if (eJson.contains("Name")) newEntity->SetName(eJson["Name"]);
+	SceneSaxHandler handler;
 
-			for (auto& [key, value] : eJson.items())
+	// 1. エディタカメラの読み込み
+	handler.m_onCamera = [&editorCamera](json& camJson)
+		{
+			if (!editorCamera) return;
+
+			if (camJson.contains("Position"))
+			{
+				editorCamera->SetPosition(camJson["Position"]);
+			}
+			if (camJson.contains("Rotation")) 
 			{
-				if (key == "Name") continue; // Skip name
+				editorCamera->SetEulerDeg(camJson["Rotation"]);
+			}
+		};
 
-				// Try to create a component with this key
-				auto component = ComponentFactory::Instance().Create(key);
-				if (component)
-				{
-					try 
-					{
-						component->Deserialize(value);
-						newEntity->AddComponent(component);
-					}
-					catch(const std::exception& e)
-					{
-						Logger::Error(std::string("Failed to deserialize component: ") + key + " Error: " + e.what());
-					}
-				}
-				else
-				{
+	// 2. エンティティの読み込み
+	handler.m_onEntity = [&](json& eJson)
+		{
+			entityJsons.push_back(std::move(eJson));
+			if (entityJsons.size() >= batchSize) { flushEntities(); }
+		};
 
-				}
-			}
+	bool parsed = false;
+	try
+	{
+		parsed = json::sax_parse(is, &handler);
 
-			newEntity->Init();
-			outEntities.push_back(newEntity);
-		}
+		// 読めたところまでは渡す
+		flushEntities();
+	}
+	catch (const std::exception& e)
+	{
+		Logger::Error(std::string("Failed to load scene: ") + e.what());
+		return false;
+	}
+
+	if (!parsed)
+	{
+		Logger::Error("JSON Parse Error: " + handler.m_error);
+		return false;
 	}
 
 	Logger::Log("Serializer", "ロード完了: " + filepath);
@@ -6,11 +6,37 @@ class CameraBase;
 class SceneSerializer
 {
 public:
+	// 読み込んだエンティティをまとめて受け取る (Init 済み。受け取った側で batch から持っていってよい)
+	using EntityBatchCallback = std::function<void(std::vector<std::shared_ptr<Entity>>& batch)>;
+
+	// LoadStreaming が1回にまとめて作る (ワーカーで並列に作る) エンティティ数
+	static constexpr size_t kDefaultBatchSize = 256;
+
+	// 保存 (JSON・マニフェスト・バイナリ)
+	// ・変更のあったエンティティだけをここで Serialize し、書き込みはワーカーで行う (SceneSaver)
 	static void Save(const std::string& manifestPath, 
 		const std::vector<std::shared_ptr<Entity>>& entities, 
 		const std::shared_ptr<CameraBase>& editorCamera);
 
+	// 全て読めた時だけ outEntities を置き換える
 	static bool Load(const std::string& manifestPath, 
 		std::vector<std::shared_ptr<Entity>>& outEntities, 
 		std::shared_ptr<CameraBase>& editorCamera);
+
+	// 実行時用のバイナリ (SceneBinary) が JSON より新しければ、そちらを読むか
+	// ・エディタでは JSON が編集の元なので読まない (_DEBUG ビルドをエディタ用とする)
+	//   リリースビルドでは読む
+	static void SetPreferBinary(bool enable);
+	static bool IsPreferBinary();
+
+	// エンティティを読めたものから batchSize 個ずつ onBatch に渡す
+	// ・JSON はファイル全体のツリーを作らず、エンティティの JSON を batchSize 個溜めた時点で作る
+	// ・1つの batch の中はワーカースレッドで並列に作る (Deserialize・Init もワーカーで呼ばれる)
+	//   渡す順はファイルの順のまま
+	// ・途中で失敗した場合も、それまでに読めたエンティティは渡し済み
+	// ・SceneSaver が同じパスに書き込み中なら、書き終えるまで待つ
+	static bool LoadStreaming(const std::string& manifestPath,
+		const EntityBatchCallback& onBatch,
+		std::shared_ptr<CameraBase>& editorCamera,
+		size_t batchSize = kDefaultBatchSize);
 };
@@ -245,6 +245,42 @@ std::shared_ptr<KdSoundEffect> KdAudioManager::GetSound(std::string_view fileNam
 // 
 // ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
 
+// メモリ上の wav ファイルから、フォーマットと波形データの場所を探す
+static bool ParseWaveData(const uint8_t* pData, size_t size, const WAVEFORMATEX*& outFormat, const uint8_t*& outAudio, size_t& outAudioBytes)
+{
+	if (size < 12 || memcmp(pData, "RIFF", 4) != 0 || memcmp(pData + 8, "WAVE", 4) != 0) { return false; }
+
+	outFormat = nullptr;
+	outAudio = nullptr;
+	outAudioBytes = 0;
+
+	// チャンクを順に見ていく
+	size_t pos = 12;
+	while (pos + 8 <= size)
+	{
+		const uint8_t* pChunk = pData + pos;
+		uint32_t chunkSize = 0;
+		memcpy(&chunkSize, pChunk + 4, sizeof(chunkSize));
+
+		if (chunkSize > size - pos - 8) { return false; }
+
+		if (memcmp(pChunk, "fmt ", 4) == 0 && chunkSize >= sizeof(PCMWAVEFORMAT))
+		{
+			outFormat = (const WAVEFORMATEX*)(pChunk + 8);
+		}
+		else if (memcmp(pChunk, "data", 4) == 0)
+		{
+			outAudio = pChunk + 8;
+			outAudioBytes = chunkSize;
+		}
+
+		// チャンクは2バイト境界にそろえてある
+		pos += 8 + (size_t)chunkSize + (chunkSize & 1);
+	}
+
+	return outFormat != nullptr && outAudio != nullptr;
+}
+
 // 音データの読み込み
 bool KdSoundEffect::Load(std::string_view fileName, const std::unique_ptr<DirectX::AudioEngine>& engine)
 {
@@ -252,11 +288,31 @@ bool KdSoundEffect::Load(std::string_view fileName, const std::unique_ptr<Direct
 	{
 		try
 		{
-			// wstringに変換
-			std::wstring wFilename = sjis_to_wide(fileName.data());
-
-			// 読み込み
-			m_soundEffect = std::make_unique<DirectX::SoundEffect>(engine.get(), wFilename.c_str());
+			// パックファイル内のものはメモリに読んでから作る
+			if (KdFileSystem::Instance().IsPacked(fileName))
+			{
+				std::vector<uint8_t> data;
+				if (!KdFileSystem::Instance().ReadFile(fileName, data)) { throw std::runtime_error("read error"); }
+
+				// SoundEffect に渡したメモリは SoundEffect が持ち続ける
+				std::unique_ptr<uint8_t[]> wavData(new uint8_t[data.size()]);
+				memcpy(wavData.get(), data.data(), data.size());
+
+				const WAVEFORMATEX* pFormat = nullptr;
+				const uint8_t* pAudio = nullptr;
+				size_t audioBytes = 0;
+				if (!ParseWaveData(wavData.get(), data.size(), pFormat, pAudio, audioBytes)) { throw std::runtime_error("not a wave file"); }
+
+				m_soundEffect = std::make_unique<DirectX::SoundEffect>(engine.get(), wavData, pFormat, pAudio, audioBytes);
+			}
+			else
+			{
+				// wstringに変換
+				std::wstring wFilename = sjis_to_wide(fileName.data());
+
+				// 読み込み
+				m_soundEffect = std::make_unique<DirectX::SoundEffect>(engine.get(), wFilename.c_str());
+			}
 		}
 		catch (...)
 		{
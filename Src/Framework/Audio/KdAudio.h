@@ -53,6 +53,9 @@ public:
 	// サウンドアセットの一括読込
 	void LoadSoundAssets(std::initializer_list<std::string_view>& fileName);
 
+	// サウンドアセットの読込 (読込済みなら何もしない、シーンのプリロード用)
+	bool PreloadSound(std::string_view fileName) { return m_audioEng && GetSound(fileName) != nullptr; }
+
 	// 解放
 	void Release();
 
@@ -559,6 +559,11 @@ void KdDirect3D::DrawVertices(D3D_PRIMITIVE_TOPOLOGY topology, int vertexCount,
 
 	// 描画
 	m_pDeviceContext->Draw(vertexCount, 0);
+
+	UINT triangles = 0;
+	if (topology == D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST) { triangles = vertexCount / 3; }
+	else if (topology == D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP && vertexCount > 2) { triangles = vertexCount - 2; }
+	AddDrawStats(1, triangles);
 }
 
 
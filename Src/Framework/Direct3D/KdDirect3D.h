@@ -142,6 +142,25 @@ public:
 	void SetBackBufferColor(const Math::Color& col) { m_backBafferClearColor = col; }
 	void ClearBackBuffer();
 
+	//==============================================================
+	//
+	// 描画統計 (プロファイラ用、フレームごとにリセットする)
+	//
+	//==============================================================
+	struct DrawStats
+	{
+		UINT m_drawCalls	= 0;	// ドローコール数
+		UINT m_triangles	= 0;	// 描画した三角形の数
+	};
+
+	const DrawStats& GetDrawStats() const { return m_drawStats; }
+	void AddDrawStats(UINT drawCalls, UINT triangles)
+	{
+		m_drawStats.m_drawCalls += drawCalls;
+		m_drawStats.m_triangles += triangles;
+	}
+	void ResetDrawStats() { m_drawStats = DrawStats(); }
+
 private:
 
 	//==============================================================
@@ -189,6 +208,8 @@ private:
 
 	bool						m_isFullScreen	= false;		// フルスクリーン動作かどうか
 
+	DrawStats					m_drawStats;					// 描画統計
+
 //-------------------------------
 // シングルトン
 //-------------------------------
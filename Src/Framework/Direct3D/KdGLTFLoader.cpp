@@ -1,6 +1,7 @@
 ﻿#include "Framework/KdFramework.h"
 
 #include "KdGLTFLoader.h"
+#include "KdMeshOptimize.h"
 
 // TinyGLTF
 #define TINYGLTF_IMPLEMENTATION
@@ -14,6 +15,78 @@
 
 static void Dump(const tinygltf::Model &model);
 
+//===================================================
+// 読み込みのログ
+//===================================================
+static std::mutex		s_importLogMutex;
+static KdImportLogFunc	s_importLog;
+
+void KdSetImportLog(KdImportLogFunc func)
+{
+	std::lock_guard<std::mutex> lock(s_importLogMutex);
+	s_importLog = std::move(func);
+}
+
+void KdImportLog(const std::string& msg)
+{
+	KdImportLogFunc func;
+	{
+		std::lock_guard<std::mutex> lock(s_importLogMutex);
+		func = s_importLog;
+	}
+
+	if (func) { func(msg); }
+	else { OutputDebugStringA((msg + "\n").c_str()); }
+}
+
+//===================================================
+// tinygltf のファイル読み込みを KdFileSystem 経由にする
+// (.gltf から参照される .bin や画像もパックファイルから読める)
+//===================================================
+static bool GLTFFileExists(const std::string& filename, void*)
+{
+	return KdFileSystem::Instance().Exists(filename);
+}
+
+static bool GLTFReadWholeFile(std::vector<unsigned char>* out, std::string* err, const std::string& filename, void*)
+{
+	if (KdFileSystem::Instance().ReadFile(filename, *out)) { return true; }
+
+	if (err) { *err += "File read error : " + filename + "\n"; }
+	return false;
+}
+
+static bool GLTFGetFileSize(size_t* outSize, std::string* err, const std::string& filename, void*)
+{
+	uint64_t size = 0;
+	if (KdFileSystem::Instance().GetFileSize(filename, size))
+	{
+		*outSize = (size_t)size;
+		return true;
+	}
+
+	if (err) { *err += "File not found : " + filename + "\n"; }
+	return false;
+}
+
+template<class FsCallbacks>
+static void SetGLTFFsCallbacks(tinygltf::TinyGLTF& ctx, FsCallbacks& callbacks)
+{
+	callbacks.FileExists = &GLTFFileExists;
+	callbacks.ExpandFilePath = &tinygltf::ExpandFilePath;
+	callbacks.ReadWholeFile = &GLTFReadWholeFile;
+	callbacks.WriteWholeFile = &tinygltf::WriteWholeFile;
+	callbacks.user_data = nullptr;
+
+	// サイズ取得は tinygltf のバージョンによって無い
+	if constexpr (requires { callbacks.GetFileSizeInBytes; })
+	{
+		callbacks.GetFileSizeInBytes = &GLTFGetFileSize;
+	}
+
+	ctx.SetFsCallbacks(callbacks);
+}
+
 //===================================================
 // ファイル名から拡張子を取得
 //===================================================
@@ -143,6 +216,435 @@ static void MatrixMirrorZ(Math::Matrix& mat)
 	mat._43 *= -1;
 }
 
+//===================================================
+// 並列読み込み用の作業データ
+//===================================================
+
+// プリミティブ１つぶん
+struct GLTFPrimitive
+{
+	std::vector<KdMeshVertex>			Vertices;
+	std::vector<KdMeshFace>				Faces;
+
+	UINT								MaterialNo = 0;
+
+	bool								IsSkinMesh = false;
+};
+
+// アニメーションのチャンネル１つぶん
+struct GLTFChannel
+{
+	UINT								AnimationNo = 0;
+	UINT								ChannelNo = 0;
+
+	std::vector<KdAnimKeyVector3>		Translations;
+	std::vector<KdAnimKeyQuaternion>	Rotations;
+	std::vector<KdAnimKeyVector3>		Scales;
+
+	float								MaxLength = 0;
+};
+
+//===================================================
+// 属性のアクセサIndexを取得 (無ければ-1)
+// ※attributesのoperator[]は要素を追加してしまうので、複数スレッドから読む場合は使わない
+//===================================================
+static int FindAttribute(const tinygltf::Primitive& primitive, const char* name)
+{
+	auto it = primitive.attributes.find(name);
+	if (it == primitive.attributes.end())return -1;
+	return it->second;
+}
+
+//===================================================
+// プリミティブ１つの頂点・インデックスを取り出す
+// ※別スレッドから同時に呼ばれるので、destPrimitive以外には書き込まないこと
+//===================================================
+static void DecodePrimitive(const tinygltf::Model& model, const tinygltf::Primitive& srcPrimitive, bool hasSkin, GLTFPrimitive* destPrimitive)
+{
+	// マテリアルNo
+	destPrimitive->MaterialNo = std::max(0, srcPrimitive.material);
+
+	// 頂点バッファ
+	{
+		// 座標
+		{
+			// 座標ゲッター
+			GLTFBufferGetter posGetter(&model, FindAttribute(srcPrimitive, "POSITION"));
+
+			Math::Vector3 pos;
+			destPrimitive->Vertices.resize(posGetter.GetAccessor()->count);
+			for (UINT vi = 0; vi < posGetter.GetAccessor()->count; vi++) {
+				auto& ver = destPrimitive->Vertices[vi];
+
+				if (posGetter.GetAccessor()->type != TINYGLTF_TYPE_VEC3) {
+					assert(0 && "この頂点形式には対応してません");
+				}
+
+				ver.Pos.x = posGetter.GetValue_Float(vi * 3 + 0);
+				ver.Pos.y = posGetter.GetValue_Float(vi * 3 + 1);
+				ver.Pos.z = posGetter.GetValue_Float(vi * 3 + 2) * -1;
+			}
+		}
+
+		// 法線
+		if (srcPrimitive.attributes.count("NORMAL") > 0)
+		{
+			// 法線ゲッター
+			GLTFBufferGetter normalGetter(&model, FindAttribute(srcPrimitive, "NORMAL"));
+
+			for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++) {
+				auto& nor = destPrimitive->Vertices[vi].Normal;
+				nor.x = normalGetter.GetValue_Float(vi * 3 + 0);
+				nor.y = normalGetter.GetValue_Float(vi * 3 + 1);
+				nor.z = normalGetter.GetValue_Float(vi * 3 + 2) * -1;
+			}
+		}
+
+		// UV
+		if (srcPrimitive.attributes.count("TEXCOORD_0") > 0)
+		{
+			// UVゲッター
+			GLTFBufferGetter uvGetter(&model, FindAttribute(srcPrimitive, "TEXCOORD_0"));
+
+			for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++) {
+				auto& uv = destPrimitive->Vertices[vi].UV;
+
+				uv.x = uvGetter.GetValue_UNORM(vi * 2 + 0);
+				uv.y = uvGetter.GetValue_UNORM(vi * 2 + 1);
+			}
+		}
+
+		// 頂点カラー
+		if (srcPrimitive.attributes.count("COLOR_0") > 0)
+		{
+			// 色ゲッター
+			GLTFBufferGetter colorGetter(&model, FindAttribute(srcPrimitive, "COLOR_0"));
+
+			for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++)
+			{
+				Math::Color color(1,1,1,1);
+
+				// RGB
+				if (colorGetter.GetAccessor()->type == TINYGLTF_TYPE_VEC3)
+				{
+					color.x = colorGetter.GetValue_Float(vi * 3 + 0);
+					color.y = colorGetter.GetValue_Float(vi * 3 + 1);
+					color.z = colorGetter.GetValue_Float(vi * 3 + 2);
+				}
+				// RGBA
+				else if (colorGetter.GetAccessor()->type == TINYGLTF_TYPE_VEC4)
+				{
+					color.x = colorGetter.GetValue_Float(vi * 4 + 0);
+					color.y = colorGetter.GetValue_Float(vi * 4 + 1);
+					color.z = colorGetter.GetValue_Float(vi * 4 + 2);
+					color.w = colorGetter.GetValue_Float(vi * 4 + 3);
+				}
+
+				destPrimitive->Vertices[vi].Color = color.RGBA().v;
+			}
+		}
+
+		// スキンメッシュ情報が無ければ現状不要なので無視
+		if (hasSkin)
+		{
+			// Skin INDEX
+			if (srcPrimitive.attributes.count("JOINTS_0") > 0)
+			{
+				destPrimitive->IsSkinMesh = true;
+
+				GLTFBufferGetter jointGetter(&model, FindAttribute(srcPrimitive, "JOINTS_0"));
+
+				for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++)
+				{
+					// ※IndexはボーンリストのIndexになる(ノード全体ではない)
+					auto& skinIndex = destPrimitive->Vertices[vi].SkinIndexList;
+
+					skinIndex[0] = (short)jointGetter.GetValue_Int(vi * 4 + 0);
+					skinIndex[1] = (short)jointGetter.GetValue_Int(vi * 4 + 1);
+					skinIndex[2] = (short)jointGetter.GetValue_Int(vi * 4 + 2);
+					skinIndex[3] = (short)jointGetter.GetValue_Int(vi * 4 + 3);
+				}
+			}
+
+			// Skin WEIGHT
+			if (srcPrimitive.attributes.count("WEIGHTS_0") > 0)
+			{
+				destPrimitive->IsSkinMesh = true;
+
+				GLTFBufferGetter weightGetter(&model, FindAttribute(srcPrimitive, "WEIGHTS_0"));
+
+				for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++)
+				{
+					auto& skinWei = destPrimitive->Vertices[vi].SkinWeightList;
+
+					skinWei[0] = weightGetter.GetValue_UNORM(vi * 4 + 0);
+					skinWei[1] = weightGetter.GetValue_UNORM(vi * 4 + 1);
+					skinWei[2] = weightGetter.GetValue_UNORM(vi * 4 + 2);
+					skinWei[3] = weightGetter.GetValue_UNORM(vi * 4 + 3);
+
+					if (skinWei[0] == 0)skinWei[0] = 1.0f;
+
+					// ウェイト正規化
+					int cnt = 0;
+					for (UINT x = 0; x < 4; x++)
+					{
+						if (skinWei[x] == 0.0f)break;
+						cnt++;
+					}
+					float totalW = 0;
+					for (int x = 0; x < cnt - 1; x++)
+					{
+						totalW += skinWei[x];
+					}
+					skinWei[cnt - 1] = 1.0f - totalW;
+				}
+			}
+		}
+	}
+
+	// インデックスバッファ
+	{
+		GLTFBufferGetter indexGetter(&model, srcPrimitive.indices);
+
+		// 面数ぶんリサイズ
+		destPrimitive->Faces.resize(indexGetter.GetAccessor()->count / 3);
+		for (UINT di = 0; di < destPrimitive->Faces.size(); di++)
+		{
+			// データ型のバイト数求める(Z軸ミラーのため、1と2を入れ替えています)
+			destPrimitive->Faces[di].Idx[0] = (UINT)indexGetter.GetValue_Int(di * 3 + 0);
+			destPrimitive->Faces[di].Idx[2] = (UINT)indexGetter.GetValue_Int(di * 3 + 1);
+			destPrimitive->Faces[di].Idx[1] = (UINT)indexGetter.GetValue_Int(di * 3 + 2);
+		}
+	}
+}
+
+//===================================================
+// ノード１つぶんのプリミティブを合成し、１つのメッシュにする
+// ・合成した後に頂点の結合と面・頂点の並べ替えを行う (pStats に前後の効率)
+//===================================================
+static void MergePrimitives(KdGLTFNode* destNode, std::vector<std::shared_ptr<GLTFPrimitive>>& tempPrimitives, KdMeshOptimizeStats* pStats)
+{
+	// TRIANGLES以外で作成していないものを除く
+	tempPrimitives.erase(std::remove(tempPrimitives.begin(), tempPrimitives.end(), nullptr), tempPrimitives.end());
+
+	// スキンメッシュか
+	for (const auto& prim : tempPrimitives)
+	{
+		if (prim->IsSkinMesh)destNode->Mesh.IsSkinMesh = true;
+	}
+
+	// マテリアルソート
+	std::sort(
+		tempPrimitives.begin(),
+		tempPrimitives.end(),
+		[](const std::shared_ptr<GLTFPrimitive>& v1, const std::shared_ptr<GLTFPrimitive>& v2) {
+			return v1->MaterialNo < v2->MaterialNo;
+		}
+	);
+
+	// マテリアルの最大数ぶんサブセット作成
+	destNode->Mesh.Subsets.resize(tempPrimitives.size());
+	for (UINT pi = 0; pi < tempPrimitives.size(); pi++)
+	{
+		// マテリアル番号
+		destNode->Mesh.Subsets[pi].MaterialNo = tempPrimitives[pi]->MaterialNo;
+	}
+
+	// 全プリミティブを合成し、１つのメッシュにする
+	UINT currentVertexIdx	= 0;
+	UINT currentFaceIdx		= 0;
+	for (UINT pi = 0; pi < tempPrimitives.size(); pi++)
+	{
+		const auto& prim = tempPrimitives[pi];
+
+		// 頂点バッファ合成
+		if (prim->Vertices.size() >= 1) {
+			UINT st = (UINT)destNode->Mesh.Vertices.size();
+			destNode->Mesh.Vertices.resize(destNode->Mesh.Vertices.size() + prim->Vertices.size());
+			memcpy(&destNode->Mesh.Vertices[st], &prim->Vertices[0], prim->Vertices.size() * sizeof(KdMeshVertex));
+		}
+
+		// インデックス合成
+		if (prim->Faces.size() >= 1) {
+			UINT st = (UINT)destNode->Mesh.Faces.size();
+			destNode->Mesh.Faces.resize(destNode->Mesh.Faces.size() + prim->Faces.size());
+			// 反転するため 0, 2, 1の順番にする(通常は0, 1, 2の順番)
+			for (UINT fi = 0; fi < prim->Faces.size(); fi++) {
+				destNode->Mesh.Faces[st + fi].Idx[0] = prim->Faces[fi].Idx[0] + currentVertexIdx;
+				destNode->Mesh.Faces[st + fi].Idx[1] = prim->Faces[fi].Idx[1] + currentVertexIdx;
+				destNode->Mesh.Faces[st + fi].Idx[2] = prim->Faces[fi].Idx[2] + currentVertexIdx;
+			}
+		}
+
+		// Subset
+		destNode->Mesh.Subsets[pi].FaceCount += (UINT)prim->Faces.size();	// 面数を加算
+
+		// 
+		currentVertexIdx	+= (UINT)prim->Vertices.size();
+		currentFaceIdx		+= (UINT)prim->Faces.size();
+
+	}
+
+	// サブセットのオフセットを求める
+	{
+		UINT offset = 0;
+		for (UINT pi = 0; pi < destNode->Mesh.Subsets.size(); pi++)
+		{
+			destNode->Mesh.Subsets[pi].FaceStart = offset;	// 開始Index
+
+			offset += destNode->Mesh.Subsets[pi].FaceCount;
+		}
+	}
+
+	// メッシュの全頂点の接線を計算する
+	for (auto&& v : destNode->Mesh.Vertices)
+	{
+		// 接線が存在する場合はスキップ
+		if (v.Tangent.Length()) { continue; }
+
+		Math::Vector3( 0.0f, 1.0f, 0.0f ).Cross(v.Normal, v.Tangent);
+		
+		if (v.Tangent.x == 0 && v.Tangent.y == 0 && v.Tangent.z == 0)
+		{
+			Math::Vector3( 0.0f, 0.0f, -1.0f).Cross(v.Normal, v.Tangent);
+		}
+	}
+
+	// 頂点の結合・キャッシュ効率の良い順に並べ替え
+	if (!KdOptimizeMesh(destNode->Mesh.Vertices, destNode->Mesh.Faces, destNode->Mesh.Subsets, pStats))
+	{
+		assert(0 && "KdOptimizeMesh: 範囲外の頂点番号があります");
+	}
+}
+
+//===================================================
+// アニメーションのチャンネル１つのキーを取り出す
+// ※別スレッドから同時に呼ばれるので、destChannel以外には書き込まないこと
+//===================================================
+static void DecodeChannel(const tinygltf::Model& model, GLTFChannel* destChannel)
+{
+	const auto& srcAni = model.animations[destChannel->AnimationNo];
+	const auto& channel = srcAni.channels[destChannel->ChannelNo];
+	const auto& sampler = srcAni.samplers[channel.sampler];
+
+	// 時間アクセサ
+	GLTFBufferGetter timeGetter(&model, sampler.input);
+	// データアクセサ
+	GLTFBufferGetter valueGetter(&model, sampler.output);
+
+	if (channel.target_path == "translation")
+	{
+
+		for (UINT ki = 0; ki < timeGetter.GetAccessor()->count; ki++)
+		{
+			KdAnimKeyVector3 v;
+			// 時間
+			v.m_time = timeGetter.GetValue_Float(ki) * 60.0f;	// 元が60fpsとして変換
+			if (v.m_time > destChannel->MaxLength)
+			{
+				destChannel->MaxLength = v.m_time;
+			}
+
+			// 値
+			if (sampler.interpolation == "STEP")
+			{
+				v.m_vec.x = valueGetter.GetValue_Float(ki * 3 + 0);
+				v.m_vec.y = valueGetter.GetValue_Float(ki * 3 + 1);
+				v.m_vec.z = valueGetter.GetValue_Float(ki * 3 + 2) * -1;
+				destChannel->Translations.push_back(v);
+			}
+			else if (sampler.interpolation == "LINEAR")
+			{
+				v.m_vec.x = valueGetter.GetValue_Float(ki * 3 + 0);
+				v.m_vec.y = valueGetter.GetValue_Float(ki * 3 + 1);
+				v.m_vec.z = valueGetter.GetValue_Float(ki * 3 + 2) * -1;
+				destChannel->Translations.push_back(v);
+			}
+			else if (sampler.interpolation == "CUBICSPLINE")
+			{
+				v.m_vec.x = valueGetter.GetValue_Float(ki * 9 + 3);
+				v.m_vec.y = valueGetter.GetValue_Float(ki * 9 + 4);
+				v.m_vec.z = valueGetter.GetValue_Float(ki * 9 + 5) * -1;
+				destChannel->Translations.push_back(v);
+			}
+		}
+	}
+	else if (channel.target_path == "scale")
+	{
+		for (UINT ki = 0; ki < timeGetter.GetAccessor()->count; ki++)
+		{
+			KdAnimKeyVector3 v;
+			// 時間
+			v.m_time = timeGetter.GetValue_Float(ki) * 60.0f;	// 元が60fpsとして変換
+			if (v.m_time > destChannel->MaxLength)
+			{
+				destChannel->MaxLength = v.m_time;
+			}
+
+			// 値
+			if (sampler.interpolation == "STEP")
+			{
+				v.m_vec.x = valueGetter.GetValue_Float(ki * 3 + 0);
+				v.m_vec.y = valueGetter.GetValue_Float(ki * 3 + 1);
+				v.m_vec.z = valueGetter.GetValue_Float(ki * 3 + 2);
+				destChannel->Scales.push_back(v);
+			}
+			else if (sampler.interpolation == "LINEAR")
+			{
+				v.m_vec.x = valueGetter.GetValue_Float(ki * 3 + 0);
+				v.m_vec.y = valueGetter.GetValue_Float(ki * 3 + 1);
+				v.m_vec.z = valueGetter.GetValue_Float(ki * 3 + 2);
+				destChannel->Scales.push_back(v);
+			}
+			else if (sampler.interpolation == "CUBICSPLINE")
+			{
+				v.m_vec.x = valueGetter.GetValue_Float(ki * 9 + 3);
+				v.m_vec.y = valueGetter.GetValue_Float(ki * 9 + 4);
+				v.m_vec.z = valueGetter.GetValue_Float(ki * 9 + 5);
+				destChannel->Scales.push_back(v);
+			}
+		}
+	}
+	else if (channel.target_path == "rotation")
+	{
+		for (UINT ki = 0; ki < timeGetter.GetAccessor()->count; ki++)
+		{
+			KdAnimKeyQuaternion q;
+			// 時間
+			q.m_time = timeGetter.GetValue_Float(ki) * 60.0f;	// 元が60fpsとして変換
+			if (q.m_time > destChannel->MaxLength)
+			{
+				destChannel->MaxLength = q.m_time;
+			}
+
+			if (sampler.interpolation == "STEP")
+			{
+				q.m_quat.y = valueGetter.GetValue_Float(ki * 4 + 1) * -1;
+				q.m_quat.x = valueGetter.GetValue_Float(ki * 4 + 0) * -1;
+				q.m_quat.z = valueGetter.GetValue_Float(ki * 4 + 2);
+				q.m_quat.w = valueGetter.GetValue_Float(ki * 4 + 3);
+				destChannel->Rotations.push_back(q);
+			}
+			else if (sampler.interpolation == "LINEAR")
+			{
+				q.m_quat.x = valueGetter.GetValue_Float(ki * 4 + 0) * -1;
+				q.m_quat.y = valueGetter.GetValue_Float(ki * 4 + 1) * -1;
+				q.m_quat.z = valueGetter.GetValue_Float(ki * 4 + 2);
+				q.m_quat.w = valueGetter.GetValue_Float(ki * 4 + 3);
+				destChannel->Rotations.push_back(q);
+			}
+			else if (sampler.interpolation == "CUBICSPLINE")
+			{
+				q.m_quat.x = valueGetter.GetValue_Float(ki * 12 + 4) * -1;
+				q.m_quat.y = valueGetter.GetValue_Float(ki * 12 + 5) * -1;
+				q.m_quat.z = valueGetter.GetValue_Float(ki * 12 + 6);
+				q.m_quat.w = valueGetter.GetValue_Float(ki * 12 + 7);
+				destChannel->Rotations.push_back(q);
+			}
+		}
+	}
+}
+
 //===================================================
 // GLTF形式の3Dモデルを読み込む
 // ※左手座標系にするため下記の仕様でZ軸反転も行う(アニメーションやボーンを使用するときも同様にすること)
@@ -162,6 +664,9 @@ std::shared_ptr<KdGLTFModel> KdLoadGLTFModel(std::string_view path)
 	tinygltf::Model model;
 	{
 		tinygltf::TinyGLTF gltf_ctx;
+		tinygltf::FsCallbacks fsCallbacks = {};
+		SetGLTFFsCallbacks(gltf_ctx, fsCallbacks);
+
 		std::string err;
 		std::string warn;
 		std::string input_filename(path);
@@ -437,285 +942,67 @@ std::shared_ptr<KdGLTFModel> KdLoadGLTFModel(std::string_view path)
 
 	//----------------------------------
 	// メッシュ
+	// ・プリミティブごとに並列で頂点とインデックスを取り出し、ノードごとに並列で合成する
+	// ・結果は番号ごとの場所に書き込むので、スレッド数や実行順に関係なく同じ結果になる
 	//----------------------------------
+
+	// ノードごとの作業データ
+	std::vector<std::vector<std::shared_ptr<GLTFPrimitive>>>	tempPrimitives(destModel->Nodes.size());
+	// 並列で処理するプリミティブ (ノードIndex, プリミティブIndex)
+	std::vector<std::pair<UINT, UINT>>							primitiveJobs;
+	// メッシュを持つノード
+	std::vector<UINT>											meshNodeIndices;
+
 	for (UINT nodei = 0; nodei < destModel->Nodes.size(); nodei++)
 	{
-		auto* destNode = &destModel->Nodes[nodei];
-
-		//--------------------------------
-		// メッシュの場合
-		//--------------------------------
 		// メッシュIndex
 		int msi = model.nodes[nodei].mesh;
 		if (msi < 0)continue;	// メッシュなし
 
 		// MeshフラグOn
-		destNode->IsMesh = true;
+		destModel->Nodes[nodei].IsMesh = true;
+		meshNodeIndices.push_back(nodei);
 
-		// 作業データ
-		struct GLTFPrimitive
-		{
-			std::vector<KdMeshVertex>			Vertices;
-			std::vector<KdMeshFace>				Faces;
-
-			UINT								MaterialNo = 0;
-
-			std::map<std::string, int>			Attributes;
-		};
-		std::vector<std::shared_ptr<GLTFPrimitive>>	tempPrimitives(model.meshes[msi].primitives.size());
+		const auto& srcMesh = model.meshes[msi];
+		tempPrimitives[nodei].resize(srcMesh.primitives.size());
 
 		// 全プリミティブ(Subset)
-		for (size_t pri = 0; pri < model.meshes[msi].primitives.size(); pri++)
+		for (UINT pri = 0; pri < srcMesh.primitives.size(); pri++)
 		{
-			auto& srcPrimitive = model.meshes[msi].primitives[pri];
-
 			// 今回はTRIANGLES以外は無視する
-			if (srcPrimitive.mode != TINYGLTF_MODE_TRIANGLES)continue;
+			if (srcMesh.primitives[pri].mode != TINYGLTF_MODE_TRIANGLES)continue;
 
-			// 作成
-			std::shared_ptr<GLTFPrimitive> destPrimitive = std::make_shared<GLTFPrimitive>();
-			tempPrimitives[pri] = destPrimitive;
-			destPrimitive->Attributes = srcPrimitive.attributes;
-
-			// マテリアルNo
-			destPrimitive->MaterialNo = std::max(0, srcPrimitive.material);
-
-			// 頂点バッファ
-			{
-				// 座標
-				{
-					// 座標ゲッター
-					GLTFBufferGetter posGetter(&model, srcPrimitive.attributes["POSITION"]);
-
-					Math::Vector3 pos;
-					destPrimitive->Vertices.resize(posGetter.GetAccessor()->count);
-					for (UINT vi = 0; vi < posGetter.GetAccessor()->count; vi++) {
-						auto& ver = destPrimitive->Vertices[vi];
-
-						if (posGetter.GetAccessor()->type != TINYGLTF_TYPE_VEC3) {
-							assert(0 && "この頂点形式には対応してません");
-						}
-
-						ver.Pos.x = posGetter.GetValue_Float(vi * 3 + 0);
-						ver.Pos.y = posGetter.GetValue_Float(vi * 3 + 1);
-						ver.Pos.z = posGetter.GetValue_Float(vi * 3 + 2) * -1;
-					}
-				}
-
-				// 法線
-				if (srcPrimitive.attributes.count("NORMAL") > 0)
-				{
-					// 法線ゲッター
-					GLTFBufferGetter normalGetter(&model, srcPrimitive.attributes["NORMAL"]);
-
-					for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++) {
-						auto& nor = destPrimitive->Vertices[vi].Normal;
-						nor.x = normalGetter.GetValue_Float(vi * 3 + 0);
-						nor.y = normalGetter.GetValue_Float(vi * 3 + 1);
-						nor.z = normalGetter.GetValue_Float(vi * 3 + 2) * -1;
-					}
-				}
-
-				// UV
-				if (srcPrimitive.attributes.count("TEXCOORD_0") > 0)
-				{
-					// UVゲッター
-					GLTFBufferGetter uvGetter(&model, srcPrimitive.attributes["TEXCOORD_0"]);
-
-					for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++) {
-						auto& uv = destPrimitive->Vertices[vi].UV;
-
-						uv.x = uvGetter.GetValue_UNORM(vi * 2 + 0);
-						uv.y = uvGetter.GetValue_UNORM(vi * 2 + 1);
-					}
-				}
-
-				// 頂点カラー
-				if (srcPrimitive.attributes.count("COLOR_0") > 0)
-				{
-					// 色ゲッター
-					GLTFBufferGetter colorGetter(&model, srcPrimitive.attributes["COLOR_0"]);
-
-					for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++)
-					{
-						Math::Color color(1,1,1,1);
-
-						// RGB
-						if (colorGetter.GetAccessor()->type == TINYGLTF_TYPE_VEC3)
-						{
-							color.x = colorGetter.GetValue_Float(vi * 3 + 0);
-							color.y = colorGetter.GetValue_Float(vi * 3 + 1);
-							color.z = colorGetter.GetValue_Float(vi * 3 + 2);
-						}
-						// RGBA
-						else if (colorGetter.GetAccessor()->type == TINYGLTF_TYPE_VEC4)
-						{
-							color.x = colorGetter.GetValue_Float(vi * 4 + 0);
-							color.y = colorGetter.GetValue_Float(vi * 4 + 1);
-							color.z = colorGetter.GetValue_Float(vi * 4 + 2);
-							color.w = colorGetter.GetValue_Float(vi * 4 + 3);
-						}
-
-						destPrimitive->Vertices[vi].Color = color.RGBA().v;
-					}
-				}
-
-				// スキンメッシュ情報が無ければ現状不要なので無視
-				if (model.skins.size() > 0)
-				{
-					// Skin INDEX
-					if (srcPrimitive.attributes.count("JOINTS_0") > 0)
-					{
-						destNode->Mesh.IsSkinMesh = true;
-
-						GLTFBufferGetter jointGetter(&model, srcPrimitive.attributes["JOINTS_0"]);
-
-						for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++)
-						{
-							// ※IndexはボーンリストのIndexになる(ノード全体ではない)
-							auto& skinIndex = destPrimitive->Vertices[vi].SkinIndexList;
-
-							skinIndex[0] = (short)jointGetter.GetValue_Int(vi * 4 + 0);
-							skinIndex[1] = (short)jointGetter.GetValue_Int(vi * 4 + 1);
-							skinIndex[2] = (short)jointGetter.GetValue_Int(vi * 4 + 2);
-							skinIndex[3] = (short)jointGetter.GetValue_Int(vi * 4 + 3);
-						}
-					}
-
-					// Skin WEIGHT
-					if (srcPrimitive.attributes.count("WEIGHTS_0") > 0)
-					{
-						destNode->Mesh.IsSkinMesh = true;
-
-						GLTFBufferGetter weightGetter(&model, srcPrimitive.attributes["WEIGHTS_0"]);
-
-						for (UINT vi = 0; vi < destPrimitive->Vertices.size(); vi++)
-						{
-							auto& skinWei = destPrimitive->Vertices[vi].SkinWeightList;
-
-							skinWei[0] = weightGetter.GetValue_UNORM(vi * 4 + 0);
-							skinWei[1] = weightGetter.GetValue_UNORM(vi * 4 + 1);
-							skinWei[2] = weightGetter.GetValue_UNORM(vi * 4 + 2);
-							skinWei[3] = weightGetter.GetValue_UNORM(vi * 4 + 3);
-
-							if (skinWei[0] == 0)skinWei[0] = 1.0f;
-
-							// ウェイト正規化
-							int cnt = 0;
-							for (UINT x = 0; x < 4; x++)
-							{
-								if (skinWei[x] == 0.0f)break;
-								cnt++;
-							}
-							float totalW = 0;
-							for (int x = 0; x < cnt - 1; x++)
-							{
-								totalW += skinWei[x];
-							}
-							skinWei[cnt - 1] = 1.0f - totalW;
-						}
-					}
-				}
-			}
-
-			// インデックスバッファ
-			{
-				GLTFBufferGetter indexGetter(&model, srcPrimitive.indices);
-
-				// 面数ぶんリサイズ
-				destPrimitive->Faces.resize(indexGetter.GetAccessor()->count / 3);
-				for (UINT di = 0; di < destPrimitive->Faces.size(); di++)
-				{
-					// データ型のバイト数求める(Z軸ミラーのため、1と2を入れ替えています)
-					destPrimitive->Faces[di].Idx[0] = (UINT)indexGetter.GetValue_Int(di * 3 + 0);
-					destPrimitive->Faces[di].Idx[2] = (UINT)indexGetter.GetValue_Int(di * 3 + 1);
-					destPrimitive->Faces[di].Idx[1] = (UINT)indexGetter.GetValue_Int(di * 3 + 2);
-				}
-			}
+			tempPrimitives[nodei][pri] = std::make_shared<GLTFPrimitive>();
+			primitiveJobs.push_back({ nodei, pri });
 		}
+	}
 
-		// マテリアルソート
-		std::sort(
-			tempPrimitives.begin(),
-			tempPrimitives.end(),
-			[](std::shared_ptr<GLTFPrimitive> v1, std::shared_ptr<GLTFPrimitive> v2) {
-				return v1->MaterialNo < v2->MaterialNo;
-			}
-		);
-
-		// マテリアルの最大数ぶんサブセット作成
-		destNode->Mesh.Subsets.resize(tempPrimitives.size());
-		for (UINT pi = 0; pi < tempPrimitives.size(); pi++)
-		{
-			// マテリアル番号
-			destNode->Mesh.Subsets[pi].MaterialNo = tempPrimitives[pi]->MaterialNo;
-		}
-
-		// 全プリミティブを合成し、１つのメッシュにする
-		UINT currentVertexIdx	= 0;
-		UINT currentFaceIdx		= 0;
-		for (UINT pi = 0; pi < tempPrimitives.size(); pi++)
-		{
-			const auto& prim = tempPrimitives[pi];
-
-			// 頂点バッファ合成
-			if (prim->Vertices.size() >= 1) {
-				UINT st = (UINT)destNode->Mesh.Vertices.size();
-				destNode->Mesh.Vertices.resize(destNode->Mesh.Vertices.size() + prim->Vertices.size());
-				memcpy(&destNode->Mesh.Vertices[st], &prim->Vertices[0], prim->Vertices.size() * sizeof(KdMeshVertex));
-			}
-
-			// インデックス合成
-			if (prim->Faces.size() >= 1) {
-				UINT st = (UINT)destNode->Mesh.Faces.size();
-				destNode->Mesh.Faces.resize(destNode->Mesh.Faces.size() + prim->Faces.size());
-				// 反転するため 0, 2, 1の順番にする(通常は0, 1, 2の順番)
-				for (UINT fi = 0; fi < prim->Faces.size(); fi++) {
-					destNode->Mesh.Faces[st + fi].Idx[0] = prim->Faces[fi].Idx[0] + currentVertexIdx;
-					destNode->Mesh.Faces[st + fi].Idx[1] = prim->Faces[fi].Idx[1] + currentVertexIdx;
-					destNode->Mesh.Faces[st + fi].Idx[2] = prim->Faces[fi].Idx[2] + currentVertexIdx;
-				}
-			}
-
-			// Subset
-			destNode->Mesh.Subsets[pi].FaceCount += (UINT)prim->Faces.size();	// 面数を加算
+	// スキンメッシュ情報が無ければ現状不要なので無視
+	const bool hasSkin = model.skins.size() > 0;
 
-			// 
-			currentVertexIdx	+= (UINT)prim->Vertices.size();
-			currentFaceIdx		+= (UINT)prim->Faces.size();
+	KdParallel::Instance().For(primitiveJobs.size(), [&](size_t jobi)
+	{
+		auto [nodei, pri] = primitiveJobs[jobi];
+		const auto& srcPrimitive = model.meshes[model.nodes[nodei].mesh].primitives[pri];
 
-		}
-		tempPrimitives.clear();
+		DecodePrimitive(model, srcPrimitive, hasSkin, tempPrimitives[nodei][pri].get());
+	});
 
-		// サブセットのオフセットを求める
-		{
-			UINT offset = 0;
-			for (UINT pi = 0; pi < destNode->Mesh.Subsets.size(); pi++)
-			{
-				destNode->Mesh.Subsets[pi].FaceStart = offset;	// 開始Index
+	std::vector<KdMeshOptimizeStats> optimizeStats(meshNodeIndices.size());
 
-				offset += destNode->Mesh.Subsets[pi].FaceCount;
-			}
-		}
+	KdParallel::Instance().For(meshNodeIndices.size(), [&](size_t i)
+	{
+		UINT nodei = meshNodeIndices[i];
 
-		// メッシュの全頂点の接線を計算する
-		for (auto&& v : destNode->Mesh.Vertices)
-		{
-			// 接線が存在する場合はスキップ
-			if (v.Tangent.Length()) { continue; }
-
-			Math::Vector3( 0.0f, 1.0f, 0.0f ).Cross(v.Normal, v.Tangent);
-			
-			if (v.Tangent.x == 0 && v.Tangent.y == 0 && v.Tangent.z == 0)
-			{
-				Math::Vector3( 0.0f, 0.0f, -1.0f).Cross(v.Normal, v.Tangent);
-			}
-		}
-	}
+		MergePrimitives(&destModel->Nodes[nodei], tempPrimitives[nodei], &optimizeStats[i]);
+	});
+	tempPrimitives.clear();
 
 	//----------------------------------
 	// アニメーション
+	// ・チャンネルごとに並列でキーを取り出し、チャンネル順に合成する
 	//----------------------------------
+	std::vector<GLTFChannel> tempChannels;
 	for (UINT ani = 0; ani < model.animations.size(); ani++)
 	{
 		const auto& srcAni = model.animations[ani];
@@ -726,141 +1013,50 @@ std::shared_ptr<KdGLTFModel> KdLoadGLTFModel(std::string_view path)
 		// 名前
 		animation->m_name = srcAni.name;
 
+		// 全チャンネル
+		for (UINT chi = 0; chi < srcAni.channels.size(); chi++)
+		{
+			GLTFChannel& channel = tempChannels.emplace_back();
+			channel.AnimationNo = ani;
+			channel.ChannelNo = chi;
+		}
+	}
+
+	KdParallel::Instance().For(tempChannels.size(), [&](size_t i)
+	{
+		DecodeChannel(model, &tempChannels[i]);
+	});
+
+	// 合成 (同じノードへのキーは、元のチャンネル順に後ろへ足していく)
+	size_t channeli = 0;
+	for (UINT ani = 0; ani < model.animations.size(); ani++)
+	{
+		const auto& animation = destModel->Animations[ani];
+
 		// 
 		std::vector<std::shared_ptr<KdGLTFAnimationData::Node>> tempNodes;
 		tempNodes.resize(destModel->Nodes.size());
 
-		// 全チャンネル
-		for (const auto& channel : srcAni.channels)
+		for (; channeli < tempChannels.size() && tempChannels[channeli].AnimationNo == ani; channeli++)
 		{
-			const auto& sampler = srcAni.samplers[channel.sampler];
+			const auto& channel = tempChannels[channeli];
+			int targetNode = model.animations[ani].channels[channel.ChannelNo].target_node;
 
 			// 対象ノードのIndex
-			auto& destAnimNode = tempNodes[channel.target_node];
+			auto& destAnimNode = tempNodes[targetNode];
 
 			// 初回
 			if (destAnimNode == nullptr)
 			{
 				destAnimNode = std::make_shared<KdGLTFAnimationData::Node>();
-				destAnimNode->m_nodeOffset = channel.target_node;
+				destAnimNode->m_nodeOffset = targetNode;
 			}
 
-			// 時間アクセサ
-			GLTFBufferGetter timeGetter(&model, sampler.input);
-			// データアクセサ
-			GLTFBufferGetter valueGetter(&model, sampler.output);
-
-			if (channel.target_path == "translation")
-			{
-
-				for (UINT ki = 0; ki < timeGetter.GetAccessor()->count; ki++)
-				{
-					KdAnimKeyVector3 v;
-					// 時間
-					v.m_time = timeGetter.GetValue_Float(ki) * 60.0f;	// 元が60fpsとして変換
-					if (v.m_time > animation->m_maxLength)
-					{
-						animation->m_maxLength = v.m_time;
-					}
+			destAnimNode->m_translations.insert(destAnimNode->m_translations.end(), channel.Translations.begin(), channel.Translations.end());
+			destAnimNode->m_rotations.insert(destAnimNode->m_rotations.end(), channel.Rotations.begin(), channel.Rotations.end());
+			destAnimNode->m_scales.insert(destAnimNode->m_scales.end(), channel.Scales.begin(), channel.Scales.end());
 
-					// 値
-					if (sampler.interpolation == "STEP")
-					{
-						v.m_vec.x = valueGetter.GetValue_Float(ki * 3 + 0);
-						v.m_vec.y = valueGetter.GetValue_Float(ki * 3 + 1);
-						v.m_vec.z = valueGetter.GetValue_Float(ki * 3 + 2) * -1;
-						destAnimNode->m_translations.push_back(v);
-					}
-					else if (sampler.interpolation == "LINEAR")
-					{
-						v.m_vec.x = valueGetter.GetValue_Float(ki * 3 + 0);
-						v.m_vec.y = valueGetter.GetValue_Float(ki * 3 + 1);
-						v.m_vec.z = valueGetter.GetValue_Float(ki * 3 + 2) * -1;
-						destAnimNode->m_translations.push_back(v);
-					}
-					else if (sampler.interpolation == "CUBICSPLINE")
-					{
-						v.m_vec.x = valueGetter.GetValue_Float(ki * 9 + 3);
-						v.m_vec.y = valueGetter.GetValue_Float(ki * 9 + 4);
-						v.m_vec.z = valueGetter.GetValue_Float(ki * 9 + 5) * -1;
-						destAnimNode->m_translations.push_back(v);
-					}
-				}
-			}
-			else if (channel.target_path == "scale")
-			{
-				for (UINT ki = 0; ki < timeGetter.GetAccessor()->count; ki++)
-				{
-					KdAnimKeyVector3 v;
-					// 時間
-					v.m_time = timeGetter.GetValue_Float(ki) * 60.0f;	// 元が60fpsとして変換
-					if (v.m_time > animation->m_maxLength)
-					{
-						animation->m_maxLength = v.m_time;
-					}
-
-					// 値
-					if (sampler.interpolation == "STEP")
-					{
-						v.m_vec.x = valueGetter.GetValue_Float(ki * 3 + 0);
-						v.m_vec.y = valueGetter.GetValue_Float(ki * 3 + 1);
-						v.m_vec.z = valueGetter.GetValue_Float(ki * 3 + 2);
-						destAnimNode->m_scales.push_back(v);
-					}
-					else if (sampler.interpolation == "LINEAR")
-					{
-						v.m_vec.x = valueGetter.GetValue_Float(ki * 3 + 0);
-						v.m_vec.y = valueGetter.GetValue_Float(ki * 3 + 1);
-						v.m_vec.z = valueGetter.GetValue_Float(ki * 3 + 2);
-						destAnimNode->m_scales.push_back(v);
-					}
-					else if (sampler.interpolation == "CUBICSPLINE")
-					{
-						v.m_vec.x = valueGetter.GetValue_Float(ki * 9 + 3);
-						v.m_vec.y = valueGetter.GetValue_Float(ki * 9 + 4);
-						v.m_vec.z = valueGetter.GetValue_Float(ki * 9 + 5);
-						destAnimNode->m_scales.push_back(v);
-					}
-				}
-			}
-			else if (channel.target_path == "rotation")
-			{
-				for (UINT ki = 0; ki < timeGetter.GetAccessor()->count; ki++)
-				{
-					KdAnimKeyQuaternion q;
-					// 時間
-					q.m_time = timeGetter.GetValue_Float(ki) * 60.0f;	// 元が60fpsとして変換
-					if (q.m_time > animation->m_maxLength)
-					{
-						animation->m_maxLength = q.m_time;
-					}
-
-					if (sampler.interpolation == "STEP")
-					{
-						q.m_quat.y = valueGetter.GetValue_Float(ki * 4 + 1) * -1;
-						q.m_quat.x = valueGetter.GetValue_Float(ki * 4 + 0) * -1;
-						q.m_quat.z = valueGetter.GetValue_Float(ki * 4 + 2);
-						q.m_quat.w = valueGetter.GetValue_Float(ki * 4 + 3);
-						destAnimNode->m_rotations.push_back(q);
-					}
-					else if (sampler.interpolation == "LINEAR")
-					{
-						q.m_quat.x = valueGetter.GetValue_Float(ki * 4 + 0) * -1;
-						q.m_quat.y = valueGetter.GetValue_Float(ki * 4 + 1) * -1;
-						q.m_quat.z = valueGetter.GetValue_Float(ki * 4 + 2);
-						q.m_quat.w = valueGetter.GetValue_Float(ki * 4 + 3);
-						destAnimNode->m_rotations.push_back(q);
-					}
-					else if (sampler.interpolation == "CUBICSPLINE")
-					{
-						q.m_quat.x = valueGetter.GetValue_Float(ki * 12 + 4) * -1;
-						q.m_quat.y = valueGetter.GetValue_Float(ki * 12 + 5) * -1;
-						q.m_quat.z = valueGetter.GetValue_Float(ki * 12 + 6);
-						q.m_quat.w = valueGetter.GetValue_Float(ki * 12 + 7);
-						destAnimNode->m_rotations.push_back(q);
-					}
-				}
-			}
+			animation->m_maxLength = std::max(animation->m_maxLength, channel.MaxLength);
 		}
 
 		// アニメーションで使用していない不必要なノードを除外したリスト作成
@@ -871,6 +1067,33 @@ std::shared_ptr<KdGLTFModel> KdLoadGLTFModel(std::string_view path)
 		}
 	}
 
+	// メッシュ最適化の前後 (全メッシュ合計の ACMR / ATVR)
+	if (!optimizeStats.empty())
+	{
+		double faces = 0.0, missesBefore = 0.0, missesAfter = 0.0, usedBefore = 0.0, usedAfter = 0.0;
+		UINT verticesBefore = 0, verticesAfter = 0;
+		for (const KdMeshOptimizeStats& stats : optimizeStats)
+		{
+			faces += stats.FaceCount;
+			missesBefore += (double)stats.ACMRBefore * stats.FaceCount;
+			missesAfter += (double)stats.ACMRAfter * stats.FaceCount;
+			if (stats.ATVRBefore > 0.0f) { usedBefore += (double)stats.ACMRBefore * stats.FaceCount / stats.ATVRBefore; }
+			if (stats.ATVRAfter > 0.0f) { usedAfter += (double)stats.ACMRAfter * stats.FaceCount / stats.ATVRAfter; }
+			verticesBefore += stats.VertexCountBefore;
+			verticesAfter += stats.VertexCountAfter;
+		}
+
+		if (faces > 0.0)
+		{
+			char msg[512];
+			snprintf(msg, sizeof(msg), "%s: optimize vertices %u -> %u / ACMR %.3f -> %.3f / ATVR %.3f -> %.3f",
+				std::string(path).c_str(), verticesBefore, verticesAfter,
+				missesBefore / faces, missesAfter / faces,
+				usedBefore > 0.0 ? missesBefore / usedBefore : 0.0, usedAfter > 0.0 ? missesAfter / usedAfter : 0.0);
+			KdImportLog(msg);
+		}
+	}
+
 	return destModel;
 }
 
@@ -138,3 +138,17 @@ struct KdGLTFModel
 // ・path				… .glflファイルのパス
 //===================================================
 std::shared_ptr<KdGLTFModel> KdLoadGLTFModel(std::string_view path);
+
+//===================================================
+// 読み込みのログ (メッシュ最適化の前後の ACMR / ATVR、変換済みモデルの書き出し失敗など)
+// ・Framework は Engine のログを直接使えないので、出力先を外から登録してもらう
+// ・未登録ならデバッグ出力に書く
+// ・ワーカースレッドから呼ばれるので、登録する関数は複数のスレッドから呼べること
+//===================================================
+using KdImportLogFunc = std::function<void(const std::string&)>;
+
+// 登録 (解除する時は nullptr を渡す)
+void KdSetImportLog(KdImportLogFunc func);
+
+// 書き込み
+void KdImportLog(const std::string& msg);
@@ -13,7 +13,7 @@
 void KdMesh::SetToDevice() const
 {
 	// 頂点バッファセット
-	UINT stride = sizeof(KdMeshVertex);	// 1頂点のサイズ
+	UINT stride = m_vertexStride;		// 1頂点のサイズ
 	UINT offset = 0;					// オフセット
 	KdDirect3D::Instance().WorkDevContext()->IASetVertexBuffers(0, 1, m_vertBuf.GetAddress(), &stride, &offset);
 
@@ -28,38 +28,54 @@ void KdMesh::SetToDevice() const
 // 生成
 // 頂点配列、インデックス配列、サブセット配列（マテリアルなど）の生成
 //=============================================================
-bool KdMesh::Create(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets, bool isSkinMesh)
+bool KdMesh::Create(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets, bool isSkinMesh,
+	KdVertexLayout layout)
+{
+	return Create(vertices.data(), (UINT)vertices.size(), faces.data(), (UINT)faces.size(),
+		subsets.data(), (UINT)subsets.size(), isSkinMesh, layout);
+}
+
+bool KdMesh::Create(const KdMeshVertex* pVertices, UINT vertexCount, const KdMeshFace* pFaces, UINT faceCount,
+	const KdMeshSubset* pSubsets, UINT subsetCount, bool isSkinMesh, KdVertexLayout layout)
 {
 	Release();
 
 	//------------------------------
 	// サブセット情報
 	//------------------------------
-	m_subsets = subsets;
+	if (subsetCount > 0)
+	{
+		m_subsets.assign(pSubsets, pSubsets + subsetCount);
+	}
 
 	//------------------------------
 	// 頂点バッファ作成
 	//------------------------------
-	if(vertices.size() > 0)
+	if(vertexCount > 0)
 	{
+		// GPU に置く形式に変換
+		std::vector<uint8_t> packedVertices;
+		m_vertexStride = KdVertexCompression::Encode(pVertices, vertexCount, layout, packedVertices);
+		m_vertexLayout = layout;
+
 		// 書き込むデータ
 		D3D11_SUBRESOURCE_DATA initData;
-		initData.pSysMem = &vertices[0];				// バッファに書き込む頂点配列の先頭アドレス
+		initData.pSysMem = packedVertices.data();		// バッファに書き込む頂点配列の先頭アドレス
 		initData.SysMemPitch = 0;
 		initData.SysMemSlicePitch = 0;
 
 		// 頂点バッファ作成
-		if (FAILED(m_vertBuf.Create(D3D11_BIND_VERTEX_BUFFER, sizeof(KdMeshVertex) * (UINT)vertices.size(), D3D11_USAGE_DEFAULT, &initData)))
+		if (FAILED(m_vertBuf.Create(D3D11_BIND_VERTEX_BUFFER, (UINT)packedVertices.size(), D3D11_USAGE_DEFAULT, &initData)))
 		{
 			Release();
 			return false;
 		}
 
 		// 座標のみの配列
-		m_positions.resize(vertices.size());
+		m_positions.resize(vertexCount);
 		for (UINT i = 0; i < m_positions.size(); i++)
 		{
-			m_positions[i] = vertices[i].Pos;
+			m_positions[i] = pVertices[i].Pos;
 		}
 
 		// AA境界データ作成
@@ -71,23 +87,23 @@ bool KdMesh::Create(const std::vector<KdMeshVertex>& vertices, const std::vector
 	//------------------------------
 	// インデックスバッファ作成
 	//------------------------------
-	if(faces.size() > 0)
+	if(faceCount > 0)
 	{
 		// 書き込むデータ
 		D3D11_SUBRESOURCE_DATA initData;
-		initData.pSysMem = &faces[0];				// バッファに書き込む頂点配列の先頭アドレス
+		initData.pSysMem = pFaces;					// バッファに書き込む頂点配列の先頭アドレス
 		initData.SysMemPitch = 0;
 		initData.SysMemSlicePitch = 0;
 
 		// バッファ作成
-		if (FAILED(m_indxBuf.Create(D3D11_BIND_INDEX_BUFFER, (UINT)faces.size() * sizeof(KdMeshFace), D3D11_USAGE_DEFAULT, &initData)))
+		if (FAILED(m_indxBuf.Create(D3D11_BIND_INDEX_BUFFER, faceCount * sizeof(KdMeshFace), D3D11_USAGE_DEFAULT, &initData)))
 		{
 			Release();
 			return false;
 		}
 
-		// 面情報コピー
-		m_faces = faces;
+		// 面情報コピー (当たり判定用)
+		m_faces.assign(pFaces, pFaces + faceCount);
 	}
 
 
@@ -96,6 +112,37 @@ bool KdMesh::Create(const std::vector<KdMeshVertex>& vertices, const std::vector
 	return true;
 }
 
+bool KdMesh::CreateCollision(const KdMeshVertex* pVertices, UINT vertexCount, const KdMeshFace* pFaces, UINT faceCount)
+{
+	Release();
+
+	if (vertexCount > 0)
+	{
+		m_positions.resize(vertexCount);
+		for (UINT i = 0; i < m_positions.size(); i++)
+		{
+			m_positions[i] = pVertices[i].Pos;
+		}
+
+		DirectX::BoundingBox::CreateFromPoints(m_aabb, m_positions.size(), &m_positions[0], sizeof(Math::Vector3));
+		DirectX::BoundingSphere::CreateFromPoints(m_bs, m_positions.size(), &m_positions[0], sizeof(Math::Vector3));
+	}
+
+	if (faceCount > 0)
+	{
+		m_faces.assign(pFaces, pFaces + faceCount);
+	}
+
+	return true;
+}
+
+uint64_t KdMesh::GetMemorySize() const
+{
+	return (uint64_t)m_vertBuf.GetBufferSize() + m_indxBuf.GetBufferSize() +
+		m_positions.size() * sizeof(Math::Vector3) +
+		m_faces.size() * sizeof(KdMeshFace) +
+		m_subsets.size() * sizeof(KdMeshSubset);
+}
 
 void KdMesh::DrawSubset(int subsetNo) const
 {
@@ -106,4 +153,6 @@ void KdMesh::DrawSubset(int subsetNo) const
 
 	// 描画
 	KdDirect3D::Instance().WorkDevContext()->DrawIndexed(m_subsets[subsetNo].FaceCount * 3, m_subsets[subsetNo].FaceStart * 3, 0);
+
+	KdDirect3D::Instance().AddDrawStats(1, m_subsets[subsetNo].FaceCount);
 }
@@ -15,6 +15,17 @@ struct KdMeshVertex
 	std::array<float, 4>	SkinWeightList;		// スキニングウェイトリスト
 };
 
+//==========================================================
+// GPU に置く頂点の形式 (KdVertexCompression.h)
+//==========================================================
+enum class KdVertexLayout : uint8_t
+{
+	Auto,			// UV の誤差を見て PackedHalfUV か Packed を選ぶ
+	Full,			// KdMeshVertex のまま (72 バイト)
+	Packed,			// 法線・接線を八面体圧縮 (32 バイト)
+	PackedHalfUV,	// Packed の UV を半精度にしたもの (28 バイト)
+};
+
 //==========================================================
 // メッシュ用 面情報
 //==========================================================
@@ -55,6 +66,9 @@ public:
 	// 面の配列を取得
 	const std::vector<KdMeshFace>&		GetFaces() const { return m_faces; }
 
+	// メモリ上のおおよそのサイズ (GPUバッファと当たり判定用のコピーの合計)
+	uint64_t							GetMemorySize() const;
+
 	// 軸平行境界ボックス取得
 	const DirectX::BoundingBox&			GetBoundingBox() const { return m_aabb; }
 	// 境界球取得
@@ -66,6 +80,9 @@ public:
 	// スキンメッシュ？
 	bool IsSkinMesh() const { return m_isSkinMesh; }
 
+	// GPU に置いた頂点の形式
+	KdVertexLayout GetVertexLayout() const { return m_vertexLayout; }
+
 	//=================================================
 	// 作成・解放
 	//=================================================
@@ -74,8 +91,18 @@ public:
 	// ・vertices		… 頂点配列
 	// ・faces			… 面インデックス情報配列
 	// ・subsets		… サブセット情報配列
+	// ・layout			… GPU に置く頂点の形式 (Full 以外はスキン情報を GPU に置かない)
 	// 戻り値			… 成功：true
-	bool Create(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets, bool isSkinMesh);
+	bool Create(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets, bool isSkinMesh,
+		KdVertexLayout layout = KdVertexLayout::Auto);
+
+	// メッシュ作成 (配列の先頭アドレス指定版)
+	// ・メモリマップしたファイルなど、vectorを経由せずに直接バッファを作成する
+	bool Create(const KdMeshVertex* pVertices, UINT vertexCount, const KdMeshFace* pFaces, UINT faceCount,
+		const KdMeshSubset* pSubsets, UINT subsetCount, bool isSkinMesh, KdVertexLayout layout = KdVertexLayout::Auto);
+
+	// 当たり判定用のメッシュ作成 (座標と面だけを持ち、GPUバッファは作らないので描画はできない)
+	bool CreateCollision(const KdMeshVertex* pVertices, UINT vertexCount, const KdMeshFace* pFaces, UINT faceCount);
 
 	// 解放
 	void Release()
@@ -85,6 +112,8 @@ public:
 		m_subsets.clear();
 		m_positions.clear();
 		m_faces.clear();
+		m_vertexLayout = KdVertexLayout::Full;
+		m_vertexStride = sizeof(KdMeshVertex);
 	}
 
 	~KdMesh()
@@ -123,6 +152,9 @@ private:
 
 	bool						m_isSkinMesh = false;
 
+	KdVertexLayout				m_vertexLayout = KdVertexLayout::Full;
+	UINT						m_vertexStride = sizeof(KdMeshVertex);
+
 private:
 	// コピー禁止用
 	KdMesh(const KdMesh& src) = delete;
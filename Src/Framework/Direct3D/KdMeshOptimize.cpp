@@ -0,0 +1,522 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdMeshOptimize.h"
+
+namespace
+{
+	// 計測に使うキャッシュの大きさ
+	constexpr UINT kMeasureCacheSize = 16;
+
+	// 並べ替えで想定するキャッシュの大きさと、スコアの係数 (Forsyth の論文の値)
+	constexpr int	kCacheSize = 32;
+	constexpr float	kCacheDecayPower = 1.5f;
+	constexpr float	kLastTriangleScore = 0.75f;
+	constexpr float	kValenceBoostScale = 2.0f;
+	constexpr float	kValenceBoostPower = 0.5f;
+
+	// オーバードローの並べ替えで ACMR がこの倍率より悪くなるなら並べ替えない
+	constexpr float kOverdrawMaxACMRRatio = 1.05f;
+
+	//-------------------------------------------
+	// 頂点の結合
+	//-------------------------------------------
+
+	// 全く同じ内容の頂点を同じ番号にする (outRemap[元の番号] = 結合後の番号)
+	UINT WeldVertices(const std::vector<KdMeshVertex>& vertices, std::vector<UINT>& outRemap)
+	{
+		static_assert(sizeof(KdMeshVertex) == 72, "KdMeshOptimize: KdMeshVertex に詰め物が入ると比較できない");
+
+		auto hashVertex = [](const KdMeshVertex* pVertex)
+		{
+			// FNV-1a
+			const uint8_t* p = reinterpret_cast<const uint8_t*>(pVertex);
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(KdMeshVertex); ++i)
+			{
+				hash ^= p[i];
+				hash *= 1099511628211ull;
+			}
+			return (size_t)hash;
+		};
+		auto equalVertex = [](const KdMeshVertex* a, const KdMeshVertex* b)
+		{
+			return memcmp(a, b, sizeof(KdMeshVertex)) == 0;
+		};
+
+		std::unordered_map<const KdMeshVertex*, UINT, decltype(hashVertex), decltype(equalVertex)>
+			uniqueVertices(vertices.size(), hashVertex, equalVertex);
+
+		outRemap.resize(vertices.size());
+
+		UINT uniqueCount = 0;
+		for (UINT vi = 0; vi < vertices.size(); ++vi)
+		{
+			auto [it, inserted] = uniqueVertices.emplace(&vertices[vi], uniqueCount);
+			if (inserted) { ++uniqueCount; }
+			outRemap[vi] = it->second;
+		}
+
+		return uniqueCount;
+	}
+
+	//-------------------------------------------
+	// 頂点キャッシュ (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+	//-------------------------------------------
+	float VertexScore(int cachePos, UINT remainingTriangles)
+	{
+		// もう使う面が無い
+		if (remainingTriangles == 0) { return -1.0f; }
+
+		float score = 0.0f;
+		if (cachePos >= 0)
+		{
+			// 直前の面の3頂点はどれから使っても同じなので一定の値
+			if (cachePos < 3)
+			{
+				score = kLastTriangleScore;
+			}
+			else
+			{
+				float scaler = 1.0f - (float)(cachePos - 3) / (float)(kCacheSize - 3);
+				score = std::pow(scaler, kCacheDecayPower);
+			}
+		}
+
+		// 残りの面が少ない頂点を早く使い切る (孤立した面が最後に残らないように)
+		score += kValenceBoostScale * std::pow((float)remainingTriangles, -kValenceBoostPower);
+
+		return score;
+	}
+
+	// faces を並べ替える (頂点番号は vertexCount 未満に詰めたもの)
+	void OptimizeVertexCache(std::vector<KdMeshFace>& faces, UINT vertexCount)
+	{
+		const UINT faceStart = 0;
+		const UINT faceCount = (UINT)faces.size();
+		const UINT faceEnd = faceCount;
+		if (faceCount <= 1) { return; }
+
+		// 頂点 → 使っている面の一覧 (CSR 形式)
+		std::vector<UINT> adjacencyOffsets(vertexCount + 1, 0);
+		for (UINT fi = faceStart; fi < faceEnd; ++fi)
+		{
+			for (UINT vi : faces[fi].Idx) { ++adjacencyOffsets[vi + 1]; }
+		}
+		for (UINT vi = 0; vi < vertexCount; ++vi) { adjacencyOffsets[vi + 1] += adjacencyOffsets[vi]; }
+
+		// 残りの面数 (使い終わった面は一覧の後ろから詰めて消す)
+		std::vector<UINT> remaining(vertexCount, 0);
+		std::vector<UINT> adjacency(adjacencyOffsets[vertexCount]);
+		for (UINT ti = 0; ti < faceCount; ++ti)
+		{
+			for (UINT vi : faces[faceStart + ti].Idx)
+			{
+				adjacency[adjacencyOffsets[vi] + remaining[vi]++] = ti;
+			}
+		}
+
+		std::vector<int>	cachePos(vertexCount, -1);
+		std::vector<float>	vertexScores(vertexCount, 0.0f);
+		for (UINT vi = 0; vi < vertexCount; ++vi) { vertexScores[vi] = VertexScore(-1, remaining[vi]); }
+
+		std::vector<float>	triangleScores(faceCount);
+		std::vector<bool>	triangleAdded(faceCount, false);
+		for (UINT ti = 0; ti < faceCount; ++ti)
+		{
+			const UINT* idx = faces[faceStart + ti].Idx;
+			triangleScores[ti] = vertexScores[idx[0]] + vertexScores[idx[1]] + vertexScores[idx[2]];
+		}
+
+		// スコアが同じなら番号の小さい面 (結果を決まったものにする)
+		auto isBetter = [&](UINT a, UINT b)
+		{
+			if (b == UINT_MAX) { return true; }
+			if (triangleScores[a] != triangleScores[b]) { return triangleScores[a] > triangleScores[b]; }
+			return a < b;
+		};
+
+		UINT bestTriangle = UINT_MAX;
+		for (UINT ti = 0; ti < faceCount; ++ti)
+		{
+			if (isBetter(ti, bestTriangle)) { bestTriangle = ti; }
+		}
+
+		std::vector<UINT> cache;
+		cache.reserve(kCacheSize + 3);
+		std::vector<UINT> newCache;
+		newCache.reserve(kCacheSize + 3);
+
+		std::vector<KdMeshFace> sortedFaces;
+		sortedFaces.reserve(faceCount);
+
+		// 候補が無くなった時に、まだ使っていない面を前から探す位置
+		UINT fallbackCursor = 0;
+
+		while (sortedFaces.size() < faceCount)
+		{
+			if (bestTriangle == UINT_MAX)
+			{
+				while (triangleAdded[fallbackCursor]) { ++fallbackCursor; }
+				bestTriangle = fallbackCursor;
+			}
+
+			const KdMeshFace& face = faces[faceStart + bestTriangle];
+			triangleAdded[bestTriangle] = true;
+			sortedFaces.push_back(face);
+
+			// 使い終わった面を頂点の一覧から外す
+			for (UINT vi : face.Idx)
+			{
+				UINT* list = &adjacency[adjacencyOffsets[vi]];
+				for (UINT i = 0; i < remaining[vi]; ++i)
+				{
+					if (list[i] == bestTriangle)
+					{
+						list[i] = list[remaining[vi] - 1];
+						--remaining[vi];
+						break;
+					}
+				}
+			}
+
+			// 今の面の3頂点を先頭にして、残りを後ろにずらす
+			auto isInFace = [&face](UINT vi) { return face.Idx[0] == vi || face.Idx[1] == vi || face.Idx[2] == vi; };
+
+			newCache.clear();
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				UINT vi = face.Idx[corner];
+				if (corner >= 1 && face.Idx[0] == vi) { continue; }
+				if (corner >= 2 && face.Idx[1] == vi) { continue; }
+				newCache.push_back(vi);
+			}
+			for (UINT vi : cache)
+			{
+				if (!isInFace(vi)) { newCache.push_back(vi); }
+			}
+
+			// 押し出された頂点
+			for (size_t i = kCacheSize; i < newCache.size(); ++i)
+			{
+				UINT vi = newCache[i];
+				cachePos[vi] = -1;
+				vertexScores[vi] = VertexScore(-1, remaining[vi]);
+			}
+			if (newCache.size() > kCacheSize) { newCache.resize(kCacheSize); }
+
+			for (size_t i = 0; i < newCache.size(); ++i)
+			{
+				UINT vi = newCache[i];
+				cachePos[vi] = (int)i;
+				vertexScores[vi] = VertexScore((int)i, remaining[vi]);
+			}
+
+			// スコアが変わる面は、キャッシュ内と押し出された頂点を使う面だけ
+			bestTriangle = UINT_MAX;
+			auto updateTriangles = [&](UINT vi)
+			{
+				const UINT* list = &adjacency[adjacencyOffsets[vi]];
+				for (UINT i = 0; i < remaining[vi]; ++i)
+				{
+					UINT ti = list[i];
+					const UINT* idx = faces[faceStart + ti].Idx;
+					triangleScores[ti] = vertexScores[idx[0]] + vertexScores[idx[1]] + vertexScores[idx[2]];
+					if (isBetter(ti, bestTriangle)) { bestTriangle = ti; }
+				}
+			};
+			for (UINT vi : newCache) { updateTriangles(vi); }
+			for (UINT vi : cache)
+			{
+				if (cachePos[vi] < 0) { updateTriangles(vi); }
+			}
+
+			std::swap(cache, newCache);
+		}
+
+		std::copy(sortedFaces.begin(), sortedFaces.end(), faces.begin() + faceStart);
+	}
+
+	//-------------------------------------------
+	// オーバードロー (Sander らの "Fast Triangle Reordering" を簡単にしたもの)
+	// ・頂点キャッシュの順番を、3頂点とも入っていない面の所で塊に分ける
+	//   (塊の中の順番は変えないので、塊の中のキャッシュ効率はほぼ変わらない)
+	// ・外側を向いている塊ほど手前に来やすいので先に描く
+	//-------------------------------------------
+	void OptimizeOverdraw(const std::vector<Math::Vector3>& positions, std::vector<KdMeshFace>& faces)
+	{
+		const UINT faceStart = 0;
+		const UINT faceCount = (UINT)faces.size();
+		if (faceCount <= 1) { return; }
+
+		// 塊の区切り
+		std::vector<UINT> clusterStarts;
+		{
+			std::vector<UINT> timeStamps(positions.size(), 0);
+			UINT time = kMeasureCacheSize + 1;
+			for (UINT ti = 0; ti < faceCount; ++ti)
+			{
+				int misses = 0;
+				for (UINT vi : faces[faceStart + ti].Idx)
+				{
+					if (time - timeStamps[vi] > kMeasureCacheSize)
+					{
+						timeStamps[vi] = time++;
+						++misses;
+					}
+				}
+				if (misses == 3) { clusterStarts.push_back(ti); }
+			}
+		}
+		if (clusterStarts.empty() || clusterStarts[0] != 0) { clusterStarts.insert(clusterStarts.begin(), 0); }
+		if (clusterStarts.size() <= 1) { return; }
+		clusterStarts.push_back(faceCount);
+
+		// 面積で重み付けした中心と法線
+		struct Cluster
+		{
+			Math::Vector3	m_centroid;
+			Math::Vector3	m_normal;
+			float			m_area = 0.0f;
+			float			m_sortKey = 0.0f;
+			UINT			m_start = 0;
+			UINT			m_end = 0;
+		};
+		std::vector<Cluster> clusters(clusterStarts.size() - 1);
+
+		Math::Vector3 meshCentroid;
+		float meshArea = 0.0f;
+
+		for (size_t ci = 0; ci < clusters.size(); ++ci)
+		{
+			Cluster& cluster = clusters[ci];
+			cluster.m_start = clusterStarts[ci];
+			cluster.m_end = clusterStarts[ci + 1];
+
+			for (UINT ti = cluster.m_start; ti < cluster.m_end; ++ti)
+			{
+				const UINT* idx = faces[faceStart + ti].Idx;
+				const Math::Vector3& p0 = positions[idx[0]];
+				const Math::Vector3& p1 = positions[idx[1]];
+				const Math::Vector3& p2 = positions[idx[2]];
+
+				// 左手座標系・時計回りが表なので、この外積が外向き
+				Math::Vector3 normal = (p1 - p0).Cross(p2 - p0);
+				float area = normal.Length();
+
+				cluster.m_centroid += (p0 + p1 + p2) * (area / 3.0f);
+				cluster.m_normal += normal;
+				cluster.m_area += area;
+			}
+
+			meshCentroid += cluster.m_centroid;
+			meshArea += cluster.m_area;
+
+			if (cluster.m_area > 0.0f) { cluster.m_centroid /= cluster.m_area; }
+			cluster.m_normal.Normalize();
+		}
+
+		if (meshArea <= 0.0f) { return; }
+		meshCentroid /= meshArea;
+
+		for (Cluster& cluster : clusters)
+		{
+			cluster.m_sortKey = (cluster.m_centroid - meshCentroid).Dot(cluster.m_normal);
+		}
+
+		// 元の順番を保つので結果は決まったものになる
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b)
+		{
+			return a.m_sortKey > b.m_sortKey;
+		});
+
+		std::vector<KdMeshFace> sortedFaces;
+		sortedFaces.reserve(faceCount);
+		for (const Cluster& cluster : clusters)
+		{
+			sortedFaces.insert(sortedFaces.end(), faces.begin() + faceStart + cluster.m_start, faces.begin() + faceStart + cluster.m_end);
+		}
+		std::copy(sortedFaces.begin(), sortedFaces.end(), faces.begin() + faceStart);
+	}
+
+	// 面に使われている頂点の数
+	UINT CountUsedVertices(const std::vector<KdMeshFace>& faces)
+	{
+		UINT maxIndex = 0;
+		for (const KdMeshFace& face : faces)
+		{
+			for (UINT vi : face.Idx) { maxIndex = std::max(maxIndex, vi); }
+		}
+
+		std::vector<bool> used(faces.empty() ? 0 : (size_t)maxIndex + 1, false);
+		UINT count = 0;
+		for (const KdMeshFace& face : faces)
+		{
+			for (UINT vi : face.Idx)
+			{
+				if (!used[vi])
+				{
+					used[vi] = true;
+					++count;
+				}
+			}
+		}
+		return count;
+	}
+}
+
+void KdMeasureVertexCache(const std::vector<KdMeshFace>& faces, UINT cacheSize, float& outACMR, float& outATVR)
+{
+	outACMR = 0.0f;
+	outATVR = 0.0f;
+	if (faces.empty() || cacheSize == 0) { return; }
+
+	// 頂点が入った時刻 (キャッシュに入るたびに時刻を進めると、FIFO の判定が差だけで済む)
+	std::unordered_map<UINT, uint64_t> timeStamps;
+	uint64_t time = cacheSize + 1;
+	uint64_t misses = 0;
+
+	for (const KdMeshFace& face : faces)
+	{
+		for (UINT vi : face.Idx)
+		{
+			auto it = timeStamps.find(vi);
+			if (it == timeStamps.end() || time - it->second > cacheSize)
+			{
+				timeStamps[vi] = time++;
+				++misses;
+			}
+		}
+	}
+
+	outACMR = (float)misses / (float)faces.size();
+	outATVR = (float)misses / (float)CountUsedVertices(faces);
+}
+
+bool KdOptimizeMesh(std::vector<KdMeshVertex>& vertices, std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets,
+	KdMeshOptimizeStats* pStats)
+{
+	for (const KdMeshFace& face : faces)
+	{
+		for (UINT vi : face.Idx)
+		{
+			if (vi >= vertices.size()) { return false; }
+		}
+	}
+
+	if (pStats)
+	{
+		*pStats = {};
+		pStats->VertexCountBefore = (UINT)vertices.size();
+		pStats->FaceCount = (UINT)faces.size();
+		KdMeasureVertexCache(faces, kMeasureCacheSize, pStats->ACMRBefore, pStats->ATVRBefore);
+	}
+
+	if (faces.empty())
+	{
+		if (pStats) { pStats->VertexCountAfter = pStats->VertexCountBefore; }
+		return true;
+	}
+
+	// 頂点の結合 (面が参照する番号だけ差し替え、頂点は最後に詰める)
+	std::vector<UINT> weldRemap;
+	const UINT weldedCount = WeldVertices(vertices, weldRemap);
+	{
+		std::vector<KdMeshVertex> weldedVertices(weldedCount);
+		for (UINT vi = 0; vi < vertices.size(); ++vi) { weldedVertices[weldRemap[vi]] = vertices[vi]; }
+		vertices.swap(weldedVertices);
+
+		for (KdMeshFace& face : faces)
+		{
+			for (UINT& vi : face.Idx) { vi = weldRemap[vi]; }
+		}
+	}
+
+	// サブセットごとに面を並べ替える
+	// ・サブセットが使う頂点だけに番号を振り直してから並べ替えるので、頂点ごとの作業用の配列はサブセットの大きさで済む
+	//   (小さなサブセットが沢山ある大きなメッシュで、サブセットごとに全頂点ぶんを確保しない)
+	std::vector<UINT>			toLocal(vertices.size(), UINT_MAX);
+	std::vector<UINT>			toGlobal;
+	std::vector<KdMeshFace>		localFaces;
+	std::vector<KdMeshFace>		cacheOptimized;
+	std::vector<Math::Vector3>	localPositions;
+
+	for (const KdMeshSubset& subset : subsets)
+	{
+		UINT faceStart = std::min(subset.FaceStart, (UINT)faces.size());
+		UINT faceEnd = std::min(subset.FaceStart + subset.FaceCount, (UINT)faces.size());
+		if (faceEnd <= faceStart) { continue; }
+
+		// 最初に使われる順に番号を振る
+		toGlobal.clear();
+		localFaces.assign(faces.begin() + faceStart, faces.begin() + faceEnd);
+		for (KdMeshFace& face : localFaces)
+		{
+			for (UINT& vi : face.Idx)
+			{
+				if (toLocal[vi] == UINT_MAX)
+				{
+					toLocal[vi] = (UINT)toGlobal.size();
+					toGlobal.push_back(vi);
+				}
+				vi = toLocal[vi];
+			}
+		}
+
+		localPositions.resize(toGlobal.size());
+		for (UINT li = 0; li < toGlobal.size(); ++li) { localPositions[li] = vertices[toGlobal[li]].Pos; }
+
+		OptimizeVertexCache(localFaces, (UINT)toGlobal.size());
+
+		// オーバードローの並べ替えでキャッシュ効率が落ちすぎたら戻す
+		cacheOptimized = localFaces;
+		OptimizeOverdraw(localPositions, localFaces);
+
+		float cacheACMR, overdrawACMR, unusedATVR;
+		KdMeasureVertexCache(cacheOptimized, kMeasureCacheSize, cacheACMR, unusedATVR);
+		KdMeasureVertexCache(localFaces, kMeasureCacheSize, overdrawACMR, unusedATVR);
+		if (overdrawACMR > cacheACMR * kOverdrawMaxACMRRatio)
+		{
+			localFaces.swap(cacheOptimized);
+		}
+
+		// 元の番号に戻して書き戻す
+		for (UINT fi = 0; fi < localFaces.size(); ++fi)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				faces[faceStart + fi].Idx[corner] = toGlobal[localFaces[fi].Idx[corner]];
+			}
+		}
+
+		for (UINT vi : toGlobal) { toLocal[vi] = UINT_MAX; }
+	}
+
+	// 頂点を最初に使われる順に並べ替える (使われない頂点はここで消える)
+	{
+		std::vector<UINT> fetchRemap(vertices.size(), UINT_MAX);
+		std::vector<KdMeshVertex> sortedVertices;
+		sortedVertices.reserve(vertices.size());
+
+		for (KdMeshFace& face : faces)
+		{
+			for (UINT& vi : face.Idx)
+			{
+				if (fetchRemap[vi] == UINT_MAX)
+				{
+					fetchRemap[vi] = (UINT)sortedVertices.size();
+					sortedVertices.push_back(vertices[vi]);
+				}
+				vi = fetchRemap[vi];
+			}
+		}
+		vertices.swap(sortedVertices);
+	}
+
+	if (pStats)
+	{
+		pStats->VertexCountAfter = (UINT)vertices.size();
+		KdMeasureVertexCache(faces, kMeasureCacheSize, pStats->ACMRAfter, pStats->ATVRAfter);
+	}
+
+	return true;
+}
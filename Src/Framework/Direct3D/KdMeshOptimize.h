@@ -0,0 +1,39 @@
+﻿#pragma once
+
+//=====================================================
+//
+// メッシュの最適化 (読み込み時に1回だけ行う)
+//
+// ・頂点の結合：全く同じ内容の頂点を1つにまとめる
+// ・頂点キャッシュ：変換済みの頂点が再利用されやすい順に面を並べ替える (Forsyth 方式)
+// ・オーバードロー：頂点キャッシュの効率をほとんど落とさない範囲で、外側を向いた面の塊を先に描く
+// ・頂点フェッチ：頂点を面で最初に使われる順に並べ替え、使われない頂点を取り除く
+// ・面の並べ替えはサブセットの中だけで行う (サブセットの範囲は変わらない)
+// ・乱数やハッシュの順番に頼らないので、同じ入力からは常に同じ結果になる
+//
+//=====================================================
+
+// 最適化前後の頂点キャッシュ効率
+// ・ACMR … 面1つあたりの頂点シェーダ実行回数 (理想は 0.5 前後、最悪 3.0)
+// ・ATVR … 頂点1つあたりの頂点シェーダ実行回数 (理想は 1.0)
+struct KdMeshOptimizeStats
+{
+	UINT	VertexCountBefore = 0;
+	UINT	VertexCountAfter = 0;
+	UINT	FaceCount = 0;
+
+	float	ACMRBefore = 0.0f;
+	float	ACMRAfter = 0.0f;
+	float	ATVRBefore = 0.0f;
+	float	ATVRAfter = 0.0f;
+};
+
+// 頂点キャッシュ効率を FIFO キャッシュで数える
+// cacheSize	… 計測に使うキャッシュの大きさ (一般的な GPU に近い 16)
+void KdMeasureVertexCache(const std::vector<KdMeshFace>& faces, UINT cacheSize, float& outACMR, float& outATVR);
+
+// メッシュを最適化する (vertices と faces を書き換える)
+// pStats	… 最適化前後の効率 (不要なら nullptr)
+// 戻り値	… 範囲外の頂点番号があれば何もせずに false
+bool KdOptimizeMesh(std::vector<KdMeshVertex>& vertices, std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets,
+	KdMeshOptimizeStats* pStats = nullptr);
@@ -0,0 +1,145 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdMeshSimplify.h"
+
+namespace
+{
+	// まとめた頂点の合計 (最後に平均する)
+	struct Cluster
+	{
+		Math::Vector3	m_pos;
+		Math::Vector2	m_uv;
+		Math::Vector3	m_normal;
+		Math::Vector3	m_tangent;
+		unsigned int	m_color = 0xFFFFFFFF;
+		UINT			m_count = 0;
+	};
+}
+
+bool KdSimplifyMesh(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets,
+	UINT gridResolution,
+	std::vector<KdMeshVertex>& outVertices, std::vector<KdMeshFace>& outFaces, std::vector<KdMeshSubset>& outSubsets)
+{
+	outVertices.clear();
+	outFaces.clear();
+	outSubsets.clear();
+
+	if (vertices.empty() || faces.empty() || gridResolution == 0) { return false; }
+
+	// 格子の大きさ
+	Math::Vector3 minPos = vertices[0].Pos;
+	Math::Vector3 maxPos = vertices[0].Pos;
+	for (const KdMeshVertex& v : vertices)
+	{
+		minPos = Math::Vector3::Min(minPos, v.Pos);
+		maxPos = Math::Vector3::Max(maxPos, v.Pos);
+	}
+
+	Math::Vector3 extent = maxPos - minPos;
+	float cellSize = std::max({ extent.x, extent.y, extent.z }) / (float)std::min(gridResolution, 0xFFFFu);
+	if (cellSize <= 0.0f) { return false; }
+
+	// (サブセット, マス) → まとめた頂点の番号
+	auto MakeKey = [&](UINT subsetNo, const Math::Vector3& pos)
+	{
+		uint64_t x = (uint64_t)((pos.x - minPos.x) / cellSize) & 0xFFFF;
+		uint64_t y = (uint64_t)((pos.y - minPos.y) / cellSize) & 0xFFFF;
+		uint64_t z = (uint64_t)((pos.z - minPos.z) / cellSize) & 0xFFFF;
+		return ((uint64_t)(subsetNo & 0xFFFF) << 48) | (x << 32) | (y << 16) | z;
+	};
+
+	std::unordered_map<uint64_t, UINT>	clusterIndices;
+	std::vector<Cluster>				clusters;
+	std::vector<UINT>					remap(vertices.size(), UINT_MAX);
+
+	// 同じ面を2回出さないための記録 (頂点番号を小さい順に並べたもの)
+	std::set<std::array<UINT, 3>>		usedFaces;
+
+	for (UINT si = 0; si < subsets.size(); ++si)
+	{
+		const KdMeshSubset& srcSubset = subsets[si];
+
+		KdMeshSubset dstSubset;
+		dstSubset.MaterialNo = srcSubset.MaterialNo;
+		dstSubset.FaceStart = (UINT)outFaces.size();
+
+		// サブセットごとに頂点の割り当てをやり直す
+		std::fill(remap.begin(), remap.end(), UINT_MAX);
+
+		UINT faceEnd = std::min(srcSubset.FaceStart + srcSubset.FaceCount, (UINT)faces.size());
+		for (UINT fi = srcSubset.FaceStart; fi < faceEnd; ++fi)
+		{
+			KdMeshFace dstFace;
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				UINT vi = faces[fi].Idx[corner];
+				if (vi >= vertices.size()) { return false; }
+
+				if (remap[vi] == UINT_MAX)
+				{
+					const KdMeshVertex& v = vertices[vi];
+
+					auto [it, isNew] = clusterIndices.emplace(MakeKey(si, v.Pos), (UINT)clusters.size());
+					if (isNew)
+					{
+						clusters.emplace_back();
+						clusters.back().m_color = v.Color;
+					}
+
+					Cluster& cluster = clusters[it->second];
+					cluster.m_pos += v.Pos;
+					cluster.m_uv += v.UV;
+					cluster.m_normal += v.Normal;
+					cluster.m_tangent += v.Tangent;
+					++cluster.m_count;
+
+					remap[vi] = it->second;
+				}
+
+				dstFace.Idx[corner] = remap[vi];
+			}
+
+			// 潰れた面
+			if (dstFace.Idx[0] == dstFace.Idx[1] || dstFace.Idx[1] == dstFace.Idx[2] || dstFace.Idx[2] == dstFace.Idx[0]) { continue; }
+
+			// 重複した面
+			std::array<UINT, 3> sorted = { dstFace.Idx[0], dstFace.Idx[1], dstFace.Idx[2] };
+			std::sort(sorted.begin(), sorted.end());
+			if (!usedFaces.insert(sorted).second) { continue; }
+
+			outFaces.push_back(dstFace);
+		}
+
+		dstSubset.FaceCount = (UINT)outFaces.size() - dstSubset.FaceStart;
+
+		// 面が全て無くなったサブセットは描画しない
+		if (dstSubset.FaceCount > 0) { outSubsets.push_back(dstSubset); }
+	}
+
+	if (outFaces.empty()) { return false; }
+
+	// 平均を取って頂点にする
+	outVertices.resize(clusters.size());
+	for (size_t i = 0; i < clusters.size(); ++i)
+	{
+		const Cluster& cluster = clusters[i];
+		KdMeshVertex& v = outVertices[i];
+
+		float rate = 1.0f / cluster.m_count;
+		v.Pos = cluster.m_pos * rate;
+		v.UV = cluster.m_uv * rate;
+		v.Color = cluster.m_color;
+
+		v.Normal = cluster.m_normal;
+		v.Normal.Normalize();
+		v.Tangent = cluster.m_tangent;
+		v.Tangent.Normalize();
+
+		// スキンメッシュは対象外 (ウェイトは平均できない)
+		v.SkinIndexList = { 0, 0, 0, 0 };
+		v.SkinWeightList = { 1.0f, 0.0f, 0.0f, 0.0f };
+	}
+
+	return true;
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+//=====================================================
+//
+// メッシュの簡略化 (LOD作成用)
+//
+// ・頂点クラスタリング：バウンディングボックスを格子に分け、同じマスに入った頂点を1つにまとめる
+//   (形は多少崩れるが、処理が速く、どんなメッシュでも破綻しない)
+// ・マテリアル(サブセット)をまたいだ頂点はまとめない
+// ・潰れた面と重複した面は取り除く
+//
+//=====================================================
+
+// gridResolution	… 一番長い辺を何マスに分けるか (小さいほど粗くなる)
+// 戻り値			… 面が1つも残らなければ false
+bool KdSimplifyMesh(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets,
+	UINT gridResolution,
+	std::vector<KdMeshVertex>& outVertices, std::vector<KdMeshFace>& outFaces, std::vector<KdMeshSubset>& outSubsets);
@@ -1,5 +1,47 @@
 ﻿#include "KdModel.h"
 #include "KdGLTFLoader.h"
+#include "KdModelBinary.h"
+
+// ノードのLOD (ノードごとにLOD数が違うので、足りない場合は一番粗いもの)
+static int GetNodeLod(int lod, UINT nodeLodCount)
+{
+	return std::min(lod, (int)nodeLodCount - 1);
+}
+
+// 変換済みバイナリのノードから lod のメッシュを作る (範囲外なら nullptr)
+static std::shared_ptr<KdMesh> CreateCookedMesh(const KdModelBinary::Reader& reader, const KdModelBinary::NodeEntry& node, int lod)
+{
+	const KdModelBinary::Range* pVertices = &node.m_vertices;
+	const KdModelBinary::Range* pFaces = &node.m_faces;
+	const KdModelBinary::Range* pSubsets = &node.m_subsets;
+
+	if (lod > 0)
+	{
+		const KdModelBinary::LodEntry* pLods = reader.Get<KdModelBinary::LodEntry>(node.m_lods);
+		if (!pLods || lod > (int)node.m_lods.m_count) { return nullptr; }
+
+		pVertices = &pLods[lod - 1].m_vertices;
+		pFaces = &pLods[lod - 1].m_faces;
+		pSubsets = &pLods[lod - 1].m_subsets;
+	}
+
+	if (!reader.IsValid<KdMeshVertex>(*pVertices) ||
+		!reader.IsValid<KdMeshFace>(*pFaces) ||
+		!reader.IsValid<KdMeshSubset>(*pSubsets))
+	{
+		return nullptr;
+	}
+
+	// マップしたメモリから直接バッファを作成
+	std::shared_ptr<KdMesh> spMesh = std::make_shared<KdMesh>();
+	spMesh->Create(
+		reader.Get<KdMeshVertex>(*pVertices), (UINT)pVertices->m_count,
+		reader.Get<KdMeshFace>(*pFaces), (UINT)pFaces->m_count,
+		reader.Get<KdMeshSubset>(*pSubsets), (UINT)pSubsets->m_count,
+		(node.m_flags & KdModelBinary::NodeFlag_SkinMesh) != 0);
+
+	return spMesh;
+}
 
 //コンストラクター
 KdModelData::KdModelData()
@@ -13,11 +55,24 @@ KdModelData::~KdModelData()
 }
 
 //ロード関数
-bool KdModelData::Load(std::string_view filename)
+bool KdModelData::Load(std::string_view filename, int firstLod)
 {
 	Release();
 
 	std::string fileDir = KdGetDirFromPath(filename.data());
+
+	// 派生データキャッシュに変換済みのバイナリがあればそちらを使う
+	KdDerivedDataCache& ddc = KdDerivedDataCache::Instance();
+	std::string cacheKey = ddc.MakeKey(KdModelBinary::GetSourceFiles(filename), "KdGLTF;Optimize=1", KdModelBinary::kVersion);
+
+	std::string cookedPath = ddc.Find(cacheKey, "kdm");
+	if (!cookedPath.empty())
+	{
+		if (LoadCooked(cookedPath, fileDir, firstLod)) { return true; }
+
+		// 壊れている場合はglTFから作り直す
+		Release();
+	}
 	
 	std::shared_ptr<KdGLTFModel> spGltfModel = KdLoadGLTFModel(filename.data());
 	if (spGltfModel == nullptr) { return false; }
@@ -28,9 +83,218 @@ bool KdModelData::Load(std::string_view filename)
 
 	CreateAnimations(spGltfModel);
 
+	CalcBoundingSphere();
+
+	// 次回以降のためにバイナリを書き出しておく (失敗しても読み込み自体は成功)
+	if (!cacheKey.empty())
+	{
+		std::string writePath = ddc.GetWritePath(cacheKey, "kdm");
+		if (!KdModelBinary::Write(*spGltfModel, writePath) || !ddc.Commit(cacheKey, "kdm", writePath))
+		{
+			KdImportLog(std::string(filename) + ": failed to write cooked model cache");
+		}
+	}
+
+	return true;
+}
+
+bool KdModelData::LoadCooked(const std::string& cookedPath, const std::string& fileDir, int firstLod)
+{
+	KdMappedFile file;
+	if (!file.Open(cookedPath)) { return false; }
+
+	// ノード番号 (親/子/ボーン/アニメーション対象) の範囲と親子の循環もここで検証される
+	KdModelBinary::Reader reader;
+	if (!reader.Open(file.GetData(), file.GetSize())) { return false; }
+
+	const KdModelBinary::Header& header = reader.GetHeader();
+
+	m_lodCount = std::max((int)header.m_lodCount, 1);
+	m_residentLod = std::clamp(firstLod, 0, m_lodCount - 1);
+
+	//------------------------------
+	// ノード
+	//------------------------------
+	const KdModelBinary::NodeEntry* pNodes = reader.Get<KdModelBinary::NodeEntry>(header.m_nodes);
+	m_originalNodes.resize(header.m_nodes.m_count);
+
+	for (UINT i = 0; i < m_originalNodes.size(); ++i)
+	{
+		const KdModelBinary::NodeEntry& rSrcNode = pNodes[i];
+		Node& rDstNode = m_originalNodes[i];
+
+		if (!reader.IsValid<int32_t>(rSrcNode.m_children) ||
+			!reader.IsValid<KdModelBinary::LodEntry>(rSrcNode.m_lods))
+		{
+			return false;
+		}
+
+		rDstNode.m_lodCount = (UINT)rSrcNode.m_lods.m_count + 1;
+
+		if (rSrcNode.m_flags & KdModelBinary::NodeFlag_Mesh)
+		{
+			rDstNode.m_spMesh = CreateCookedMesh(reader, rSrcNode, GetNodeLod(m_residentLod, rDstNode.m_lodCount));
+			if (!rDstNode.m_spMesh) { return false; }
+		}
+
+		rDstNode.m_name = reader.GetString(rSrcNode.m_name);
+
+		rDstNode.m_localTransform = rSrcNode.m_localTransform;
+		rDstNode.m_worldTransform = rSrcNode.m_worldTransform;
+		rDstNode.m_boneInverseWorldMatrix = rSrcNode.m_inverseBindMatrix;
+
+		rDstNode.m_isSkinMesh = (rSrcNode.m_flags & KdModelBinary::NodeFlag_SkinMesh) != 0;
+
+		rDstNode.m_boneIndex = rSrcNode.m_boneIndex;
+
+		rDstNode.m_parent = rSrcNode.m_parent;
+		if (const int32_t* pChildren = reader.Get<int32_t>(rSrcNode.m_children))
+		{
+			rDstNode.m_children.assign(pChildren, pChildren + rSrcNode.m_children.m_count);
+		}
+	}
+
+	BuildNodeIndexLists();
+
+	// 当たり判定は描画のLODに関係なく LOD0 で行う
+	// ・粗いLODで描画するノードは、LOD0 の座標と面だけを別に持つ (細かいLODに切り替えても持ったまま)
+	for (int nodeIdx : m_collisionMeshNodeIndices)
+	{
+		Node& rDstNode = m_originalNodes[nodeIdx];
+		if (!rDstNode.m_spMesh || GetNodeLod(m_residentLod, rDstNode.m_lodCount) == 0) { continue; }
+
+		const KdModelBinary::NodeEntry& rSrcNode = pNodes[nodeIdx];
+		if (!reader.IsValid<KdMeshVertex>(rSrcNode.m_vertices) || !reader.IsValid<KdMeshFace>(rSrcNode.m_faces)) { return false; }
+
+		rDstNode.m_spCollisionMesh = std::make_shared<KdMesh>();
+		rDstNode.m_spCollisionMesh->CreateCollision(
+			reader.Get<KdMeshVertex>(rSrcNode.m_vertices), (UINT)rSrcNode.m_vertices.m_count,
+			reader.Get<KdMeshFace>(rSrcNode.m_faces), (UINT)rSrcNode.m_faces.m_count);
+	}
+
+	CalcBoundingSphere();
+
+	//------------------------------
+	// マテリアル
+	//------------------------------
+	const KdModelBinary::MaterialEntry* pMaterials = reader.Get<KdModelBinary::MaterialEntry>(header.m_materials);
+	m_materials.resize(header.m_materials.m_count);
+
+	for (UINT i = 0; i < m_materials.size(); ++i)
+	{
+		const KdModelBinary::MaterialEntry& rSrcMaterial = pMaterials[i];
+		KdMaterial& rDstMaterial = m_materials[i];
+
+		rDstMaterial.m_name = reader.GetString(rSrcMaterial.m_name);
+
+		rDstMaterial.SetTextures(fileDir, reader.GetString(rSrcMaterial.m_baseColorTex),
+			reader.GetString(rSrcMaterial.m_metallicRoughnessTex), reader.GetString(rSrcMaterial.m_emissiveTex),
+			reader.GetString(rSrcMaterial.m_normalTex));
+
+		rDstMaterial.m_baseColorRate = rSrcMaterial.m_baseColor;
+		rDstMaterial.m_metallicRate = rSrcMaterial.m_metallic;
+		rDstMaterial.m_roughnessRate = rSrcMaterial.m_roughness;
+		rDstMaterial.m_emissiveRate = rSrcMaterial.m_emissive;
+	}
+
+	//------------------------------
+	// アニメーション
+	//------------------------------
+	const KdModelBinary::AnimationEntry* pAnimations = reader.Get<KdModelBinary::AnimationEntry>(header.m_animations);
+	m_spAnimations.resize(header.m_animations.m_count);
+
+	for (UINT i = 0; i < m_spAnimations.size(); ++i)
+	{
+		const KdModelBinary::AnimationEntry& rSrcAnimation = pAnimations[i];
+		if (!reader.IsValid<KdModelBinary::AnimationNodeEntry>(rSrcAnimation.m_nodes)) { return false; }
+
+		m_spAnimations[i] = std::make_shared<KdAnimationData>();
+		KdAnimationData& rDstAnimation = *(m_spAnimations[i]);
+
+		rDstAnimation.m_name = reader.GetString(rSrcAnimation.m_name);
+		rDstAnimation.m_maxLength = rSrcAnimation.m_maxLength;
+
+		const KdModelBinary::AnimationNodeEntry* pAnimNodes = reader.Get<KdModelBinary::AnimationNodeEntry>(rSrcAnimation.m_nodes);
+		rDstAnimation.m_nodes.resize(rSrcAnimation.m_nodes.m_count);
+
+		for (UINT j = 0; j < rDstAnimation.m_nodes.size(); ++j)
+		{
+			const KdModelBinary::AnimationNodeEntry& rSrcNode = pAnimNodes[j];
+			KdAnimationData::Node& rDstNode = rDstAnimation.m_nodes[j];
+
+			if (!reader.IsValid<KdAnimKeyVector3>(rSrcNode.m_translations) ||
+				!reader.IsValid<KdAnimKeyQuaternion>(rSrcNode.m_rotations) ||
+				!reader.IsValid<KdAnimKeyVector3>(rSrcNode.m_scales))
+			{
+				return false;
+			}
+
+			rDstNode.m_nodeOffset = rSrcNode.m_nodeOffset;
+
+			if (auto pKeys = reader.Get<KdAnimKeyVector3>(rSrcNode.m_translations))
+			{
+				rDstNode.m_translations.assign(pKeys, pKeys + rSrcNode.m_translations.m_count);
+			}
+			if (auto pKeys = reader.Get<KdAnimKeyQuaternion>(rSrcNode.m_rotations))
+			{
+				rDstNode.m_rotations.assign(pKeys, pKeys + rSrcNode.m_rotations.m_count);
+			}
+			if (auto pKeys = reader.Get<KdAnimKeyVector3>(rSrcNode.m_scales))
+			{
+				rDstNode.m_scales.assign(pKeys, pKeys + rSrcNode.m_scales.m_count);
+			}
+		}
+	}
+
+	m_cookedPath = cookedPath;
+
+	return true;
+}
+
+bool KdModelData::LoadLodMeshes(const std::string& cookedPath, int lod, int currentLod, std::vector<std::shared_ptr<KdMesh>>& outMeshes)
+{
+	outMeshes.clear();
+
+	KdMappedFile file;
+	if (!file.Open(cookedPath)) { return false; }
+
+	KdModelBinary::Reader reader;
+	if (!reader.Open(file.GetData(), file.GetSize())) { return false; }
+
+	const KdModelBinary::Header& header = reader.GetHeader();
+	const KdModelBinary::NodeEntry* pNodes = reader.Get<KdModelBinary::NodeEntry>(header.m_nodes);
+	outMeshes.resize(header.m_nodes.m_count);
+
+	for (UINT i = 0; i < outMeshes.size(); ++i)
+	{
+		const KdModelBinary::NodeEntry& rSrcNode = pNodes[i];
+		if (!(rSrcNode.m_flags & KdModelBinary::NodeFlag_Mesh)) { continue; }
+
+		// 切り替えても同じメッシュのままのノードは作らない
+		UINT nodeLodCount = (UINT)rSrcNode.m_lods.m_count + 1;
+		int nodeLod = GetNodeLod(lod, nodeLodCount);
+		if (nodeLod == GetNodeLod(currentLod, nodeLodCount)) { continue; }
+
+		outMeshes[i] = CreateCookedMesh(reader, rSrcNode, nodeLod);
+		if (!outMeshes[i]) { return false; }
+	}
+
 	return true;
 }
 
+void KdModelData::ApplyLodMeshes(int lod, const std::vector<std::shared_ptr<KdMesh>>& meshes)
+{
+	// 読み込み中に中身が入れ替わった
+	if (meshes.size() != m_originalNodes.size()) { return; }
+
+	for (UINT i = 0; i < meshes.size(); ++i)
+	{
+		if (meshes[i]) { m_originalNodes[i].m_spMesh = meshes[i]; }
+	}
+
+	m_residentLod = std::clamp(lod, 0, m_lodCount - 1);
+}
+
 void KdModelData::Swap(KdModelData& other)
 {
 	using std::swap;
@@ -42,6 +306,13 @@ void KdModelData::Swap(KdModelData& other)
 	swap(m_meshNodeIndices, other.m_meshNodeIndices);
 	swap(m_collisionMeshNodeIndices, other.m_collisionMeshNodeIndices);
 	swap(m_drawMeshNodeIndices, other.m_drawMeshNodeIndices);
+	swap(m_cookedPath, other.m_cookedPath);
+	swap(m_lodCount, other.m_lodCount);
+	swap(m_residentLod, other.m_residentLod);
+	swap(m_boundingSphere, other.m_boundingSphere);
+
+	++m_revision;
+	++other.m_revision;
 }
 
 // ノード作成
@@ -67,9 +338,6 @@ void KdModelData::CreateNodes(const std::shared_ptr<KdGLTFModel>& spGltfModel)
 				rDstNode.m_spMesh->Create(rSrcNode.Mesh.Vertices, rSrcNode.Mesh.Faces, rSrcNode.Mesh.Subsets, rSrcNode.Mesh.IsSkinMesh);
 			}
 
-			// メッシュノードリストにインデックス登録
-			m_meshNodeIndices.push_back(i);
-
 		}
 
 		// ノード情報セット
@@ -85,9 +353,23 @@ void KdModelData::CreateNodes(const std::shared_ptr<KdGLTFModel>& spGltfModel)
 
 		rDstNode.m_parent = rSrcNode.Parent;
 		rDstNode.m_children = rSrcNode.Children;
+	}
+
+	BuildNodeIndexLists();
+}
+
+// 各ノードのインデックスリスト作成
+void KdModelData::BuildNodeIndexLists()
+{
+	for (UINT i = 0; i < m_originalNodes.size(); i++)
+	{
+		const Node& rNode = m_originalNodes[i];
+
+		// メッシュノードリストにインデックス登録
+		if (rNode.m_spMesh) { m_meshNodeIndices.push_back(i); }
 
 		// 当たり判定用ノード検索
-		if (rDstNode.m_name.find("COL") != std::string::npos)
+		if (rNode.m_name.find("COL") != std::string::npos)
 		{
 			// 判定用ノードに割り当て
 			m_collisionMeshNodeIndices.push_back(i);
@@ -99,13 +381,13 @@ void KdModelData::CreateNodes(const std::shared_ptr<KdGLTFModel>& spGltfModel)
 		}
 	}
 
-	for (UINT nodeIdx = 0; nodeIdx < spGltfModel->Nodes.size(); nodeIdx++)
+	for (UINT nodeIdx = 0; nodeIdx < m_originalNodes.size(); nodeIdx++)
 	{
 		// ルートノードのIndexリスト
-		if (spGltfModel->Nodes[nodeIdx].Parent == -1) { m_rootNodeIndices.push_back(nodeIdx); }
+		if (m_originalNodes[nodeIdx].m_parent == -1) { m_rootNodeIndices.push_back(nodeIdx); }
 
 		// ボーンノードのIndexリスト
-		int boneIdx = spGltfModel->Nodes[nodeIdx].BoneNodeIndex;
+		int boneIdx = m_originalNodes[nodeIdx].m_boneIndex;
 
 		if (boneIdx >= 0)
 		{
@@ -123,6 +405,29 @@ void KdModelData::CreateNodes(const std::shared_ptr<KdGLTFModel>& spGltfModel)
 	}
 }
 
+// 境界球作成
+void KdModelData::CalcBoundingSphere()
+{
+	bool isFirst = true;
+	for (int nodeIdx : m_meshNodeIndices)
+	{
+		const Node& rNode = m_originalNodes[nodeIdx];
+
+		DirectX::BoundingSphere sphere;
+		rNode.m_spMesh->GetBoundingSphere().Transform(sphere, rNode.m_worldTransform);
+
+		if (isFirst)
+		{
+			m_boundingSphere = sphere;
+			isFirst = false;
+		}
+		else
+		{
+			DirectX::BoundingSphere::CreateMerged(m_boundingSphere, m_boundingSphere, sphere);
+		}
+	}
+}
+
 // マテリアル作成
 void KdModelData::CreateMaterials(const std::shared_ptr<KdGLTFModel>& spGltfModel, const std::string& fileDir)
 {
@@ -208,12 +513,47 @@ const std::shared_ptr<KdAnimationData> KdModelData::GetAnimation(UINT index) con
 void KdModelData::Release()
 {
 	m_materials.clear();
+	m_spAnimations.clear();
 	m_originalNodes.clear();
 
 	m_rootNodeIndices.clear();
 	m_boneNodeIndices.clear();
 	m_meshNodeIndices.clear();
+	m_collisionMeshNodeIndices.clear();
 	m_drawMeshNodeIndices.clear();
+
+	m_cookedPath.clear();
+	m_lodCount = 1;
+	m_residentLod = 0;
+	m_boundingSphere = DirectX::BoundingSphere();
+}
+
+uint64_t KdModelData::GetMeshMemorySize() const
+{
+	uint64_t total = 0;
+	for (const Node& node : m_originalNodes)
+	{
+		if (node.m_spMesh) { total += node.m_spMesh->GetMemorySize(); }
+		if (node.m_spCollisionMesh) { total += node.m_spCollisionMesh->GetMemorySize(); }
+	}
+	return total;
+}
+
+uint64_t KdModelData::GetAnimationMemorySize() const
+{
+	uint64_t total = 0;
+	for (const auto& spAnimation : m_spAnimations)
+	{
+		if (!spAnimation) { continue; }
+
+		for (const KdAnimationData::Node& node : spAnimation->m_nodes)
+		{
+			total += node.m_translations.size() * sizeof(KdAnimKeyVector3);
+			total += node.m_rotations.size() * sizeof(KdAnimKeyQuaternion);
+			total += node.m_scales.size() * sizeof(KdAnimKeyVector3);
+		}
+	}
+	return total;
 }
 
 bool KdModelData::IsSkinMesh()
@@ -273,6 +613,9 @@ KdModelWork::Node* KdModelWork::FindWorkNode(std::string_view name)
 void KdModelWork::SetModelData(const std::shared_ptr<KdModelData>& rModel)
 { 
 	m_spData = rModel;
+	if (!rModel) { m_coppiedNodes.clear(); return; }
+
+	m_dataRevision = rModel->GetRevision();
 
 	size_t nodeSize = rModel->GetOriginalNodes().size();
 
@@ -287,6 +630,14 @@ void KdModelWork::SetModelData(const std::shared_ptr<KdModelData>& rModel)
 	m_needCalcNode = true;
 }
 
+bool KdModelWork::SyncModelData()
+{
+	if (!m_spData || m_spData->GetRevision() == m_dataRevision) { return false; }
+
+	SetModelData(m_spData);
+	return true;
+}
+
 void KdModelWork::SetModelData(std::string_view fileName)
 {
 	// モデルのセット
@@ -300,6 +651,8 @@ void KdModelWork::CalcNodeMatrices()
 {
 	if (!m_spData) { assert(0 && "モデルのないノード行列計算"); return; }
 
+	SyncModelData();
+
 	// 全ボーン行列を書き込み
 	for (auto&& nodeIdx : m_spData->GetRootNodeIndices())
 	{
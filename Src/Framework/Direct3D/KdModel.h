@@ -13,6 +13,7 @@ public:
 		std::string		m_name;				// ノード名
 
 		std::shared_ptr<KdMesh>	m_spMesh;	// メッシュ
+		std::shared_ptr<KdMesh>	m_spCollisionMesh;	// 当たり判定用の LOD0 (描画用のメッシュが粗いLODの時だけ)
 
 		Math::Matrix	m_localTransform;			// 直属の親ボーンからの行列
 		Math::Matrix	m_worldTransform;			// 原点からの行列
@@ -25,15 +26,50 @@ public:
 		int		m_boneIndex = -1;			// ボーンノードの時、先頭から何番目のボーンか？
 
 		bool	m_isSkinMesh = false;
+
+		UINT	m_lodCount = 1;				// メッシュのLOD数 (LOD0 を含む)
+
+		// 当たり判定に使うメッシュ (描画のLODに関係なく常に LOD0 の形)
+		const std::shared_ptr<KdMesh>& GetCollisionMesh() const { return m_spCollisionMesh ? m_spCollisionMesh : m_spMesh; }
 	};
 
 	KdModelData();
 	~KdModelData();
 
-	bool Load(std::string_view filename);
+	// Load / LoadCooked の firstLod に渡すと最も粗いLODから読み込む
+	static constexpr int kCoarsestLod = INT_MAX;
+
+	// firstLod … 変換済みバイナリから読み込む場合に、最初に読み込むLOD (LOD数以上なら最も粗いもの)
+	bool Load(std::string_view filename, int firstLod = 0);
+
+	// 変換済みバイナリ(KdModelBinary)から読み込む
+	// ・ファイルをメモリマップし、頂点/インデックスはコピーせずにそのままGPUバッファへ転送する
+	bool LoadCooked(const std::string& cookedPath, const std::string& fileDir, int firstLod = 0);
+
+	//------------------------------
+	// LOD (0 が最も詳細)
+	// ・変換済みバイナリから読み込んだ場合のみ、後から別のLODに切り替えられる
+	// ・当たり判定は常に LOD0 の形で行う (粗いLODで描画している間は、当たり判定用に LOD0 の座標と面だけを持つ)
+	//------------------------------
+	int GetLodCount() const { return m_lodCount; }
+	int GetResidentLod() const { return m_residentLod; }
+	bool CanStreamLod() const { return m_lodCount > 1 && !m_cookedPath.empty(); }
+	const std::string& GetCookedPath() const { return m_cookedPath; }
+
+	// 変換済みバイナリから lod のメッシュを作る (別スレッドから呼べる)
+	// ・currentLod から切り替えて形が変わるノードだけ作り、それ以外は nullptr のまま
+	static bool LoadLodMeshes(const std::string& cookedPath, int lod, int currentLod, std::vector<std::shared_ptr<KdMesh>>& outMeshes);
+
+	// LoadLodMeshes で作ったメッシュに差し替える
+	void ApplyLodMeshes(int lod, const std::vector<std::shared_ptr<KdMesh>>& meshes);
+
+	// モデル全体の境界球 (ノードの初期姿勢での値)
+	const DirectX::BoundingSphere& GetBoundingSphere() const { return m_boundingSphere; }
 
 	// 他のモデルデータと中身を入れ替える
+	// ・入れ替えるたびにリビジョンが変わるので、KdModelWork はそれを見てノードを作り直す
 	void Swap(KdModelData& other);
+	uint32_t GetRevision() const { return m_revision; }
 
 	void CreateNodes(const std::shared_ptr<KdGLTFModel>& spGltfModel);									// ノード作成
 	void CreateMaterials(const std::shared_ptr<KdGLTFModel>& spGltfModel, const  std::string& fileDir);	// マテリアル作成
@@ -75,10 +111,20 @@ public:
 
 	bool IsSkinMesh();
 
+	// メモリ上のおおよそのサイズ (アセットの常駐管理用)
+	uint64_t GetMeshMemorySize() const;
+	uint64_t GetAnimationMemorySize() const;
+
 private:
 	// 解放
 	void Release();
 
+	// m_originalNodes からルート/ボーン/メッシュ/判定/描画の各インデックスリストを作る
+	void BuildNodeIndexLists();
+
+	// メッシュノードの境界球をまとめる
+	void CalcBoundingSphere();
+
 	//マテリアル配列
 	std::vector<KdMaterial> m_materials;
 
@@ -98,6 +144,16 @@ private:
 	std::vector<int>		m_collisionMeshNodeIndices;
 	// 全ノード中、描画するノードのみのIndexn配列
 	std::vector<int>		m_drawMeshNodeIndices;
+
+	// 中身が入れ替わった回数
+	uint32_t				m_revision = 0;
+
+	// LOD
+	std::string				m_cookedPath;		// 読み込んだ変換済みバイナリ (glTFから読んだ場合は空)
+	int						m_lodCount = 1;
+	int						m_residentLod = 0;	// 今読み込まれているLOD
+
+	DirectX::BoundingSphere	m_boundingSphere;
 };
 
 class KdModelWork
@@ -149,7 +205,7 @@ public:
 	const std::vector<KdModelData::Node>& GetDataNodes() const { assert(m_spData && "モデルデータが存在しません"); return m_spData->GetOriginalNodes(); }
 	// コピーノードリスト取得
 	const std::vector<Node>& GetNodes() const { return m_coppiedNodes; }
-	std::vector<Node>& WorkNodes() { m_needCalcNode = true; return m_coppiedNodes; }
+	std::vector<Node>& WorkNodes() { SyncModelData(); m_needCalcNode = true; return m_coppiedNodes; }
 
 	// アニメーションデータ取得
 	const std::shared_ptr<KdAnimationData> GetAnimation(std::string_view animName) const { return !m_spData ? nullptr : m_spData->GetAnimation(animName); }
@@ -161,6 +217,10 @@ public:
 
 	bool NeedCalcNodeMatrices() { return m_needCalcNode; }
 
+	// モデルデータの中身が入れ替わっていたら (非同期ロードの完了・ホットリロード) ノードを作り直す
+	// 戻り値 … 作り直した場合 true
+	bool SyncModelData();
+
 private:
 
 	// 再帰呼び出し用計算関数
@@ -176,4 +236,7 @@ private:
 	std::vector<Node>	m_coppiedNodes;
 
 	bool m_needCalcNode = false;
+
+	// コピーノードを作った時のモデルデータのリビジョン
+	uint32_t m_dataRevision = 0;
 };
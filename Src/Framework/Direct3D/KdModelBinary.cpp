@@ -0,0 +1,287 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdModelBinary.h"
+#include "KdGLTFLoader.h"
+#include "KdMeshSimplify.h"
+#include "KdMeshOptimize.h"
+
+namespace KdModelBinary
+{
+	namespace
+	{
+		constexpr size_t kBlockAlignment = 16;
+
+		// LOD作成 (一番長い辺の分割数を段ごとに減らしていく)
+		constexpr UINT kLodGridResolutions[] = { 64, 24, 8 };
+		// これより面が少ないメッシュはそれ以上粗くしない
+		constexpr size_t kLodMinFaceCount = 256;
+		// 前の段から面がこの割合までしか減らなければ作らない
+		constexpr float kLodMinReduction = 0.75f;
+
+		struct LodMesh
+		{
+			std::vector<KdMeshVertex>	m_vertices;
+			std::vector<KdMeshFace>		m_faces;
+			std::vector<KdMeshSubset>	m_subsets;
+		};
+
+		// ノード1つぶんのLOD1以降を作る
+		void BuildLods(const KdGLTFNode& node, std::vector<LodMesh>& outLods)
+		{
+			if (!node.IsMesh || node.Mesh.IsSkinMesh) { return; }
+
+			// 当たり判定用のメッシュは形を変えない
+			if (node.Name.find("COL") != std::string::npos) { return; }
+
+			size_t prevFaceCount = node.Mesh.Faces.size();
+			for (UINT resolution : kLodGridResolutions)
+			{
+				if (prevFaceCount < kLodMinFaceCount) { break; }
+
+				LodMesh lod;
+				if (!KdSimplifyMesh(node.Mesh.Vertices, node.Mesh.Faces, node.Mesh.Subsets, resolution, lod.m_vertices, lod.m_faces, lod.m_subsets)) { break; }
+
+				if (lod.m_faces.size() > prevFaceCount * kLodMinReduction) { continue; }
+
+				// 簡略化で面の順番が崩れるので、LOD も並べ替え直す
+				// ・失敗するのは範囲外の頂点番号がある時なので、そのLOD以降は作らない
+				if (!KdOptimizeMesh(lod.m_vertices, lod.m_faces, lod.m_subsets))
+				{
+					KdImportLog(node.Name + ": LOD" + std::to_string(outLods.size() + 1) + " has out-of-range vertex indices, skipped");
+					break;
+				}
+
+				prevFaceCount = lod.m_faces.size();
+				outLods.push_back(std::move(lod));
+			}
+		}
+
+		// 書き出し用バッファ
+		class Writer
+		{
+		public:
+			Writer()
+			{
+				// ヘッダ分を空けておく (最後に書き込む)
+				m_buffer.resize(sizeof(Header));
+			}
+
+			template<class T>
+			Range WriteArray(const T* pData, size_t count)
+			{
+				static_assert(std::is_trivially_copyable_v<T>, "KdModelBinary: 書き出せるのはコピー可能な型のみ");
+
+				Range range;
+				if (count == 0) { return range; }
+
+				Align();
+				range.m_offset = m_buffer.size();
+				range.m_count = count;
+
+				const uint8_t* pBytes = (const uint8_t*)pData;
+				m_buffer.insert(m_buffer.end(), pBytes, pBytes + sizeof(T) * count);
+				return range;
+			}
+
+			template<class T>
+			Range WriteArray(const std::vector<T>& data)
+			{
+				return WriteArray(data.data(), data.size());
+			}
+
+			// 文字列テーブルに追加 (書き出しは Finish 時)
+			StringRef AddString(const std::string& str)
+			{
+				StringRef ref;
+				ref.m_offset = (uint32_t)m_strings.size();
+				ref.m_length = (uint32_t)str.size();
+				m_strings.insert(m_strings.end(), str.begin(), str.end());
+				return ref;
+			}
+
+			std::vector<uint8_t>& Finish(Header& header)
+			{
+				header.m_strings = WriteArray(m_strings);
+				memcpy(m_buffer.data(), &header, sizeof(Header));
+				return m_buffer;
+			}
+
+		private:
+			void Align()
+			{
+				size_t padding = (kBlockAlignment - (m_buffer.size() % kBlockAlignment)) % kBlockAlignment;
+				m_buffer.insert(m_buffer.end(), padding, 0);
+			}
+
+			std::vector<uint8_t>	m_buffer;
+			std::vector<char>		m_strings;
+		};
+	}
+
+	bool Write(const KdGLTFModel& model, const std::string& path)
+	{
+		Writer writer;
+
+		// LOD作成 (ノードごとに並列)
+		std::vector<std::vector<LodMesh>> lods(model.Nodes.size());
+		KdParallel::Instance().For(model.Nodes.size(), [&](size_t i)
+		{
+			BuildLods(model.Nodes[i], lods[i]);
+		});
+
+		uint32_t lodCount = 1;
+
+		// ノード (頂点などの大きなブロックを先に書き出す)
+		std::vector<NodeEntry> nodes(model.Nodes.size());
+		for (size_t i = 0; i < model.Nodes.size(); ++i)
+		{
+			const KdGLTFNode& rSrcNode = model.Nodes[i];
+			NodeEntry& rDstNode = nodes[i];
+
+			rDstNode.m_name = writer.AddString(rSrcNode.Name);
+			rDstNode.m_parent = rSrcNode.Parent;
+			rDstNode.m_boneIndex = rSrcNode.BoneNodeIndex;
+			rDstNode.m_localTransform = rSrcNode.LocalTransform;
+			rDstNode.m_worldTransform = rSrcNode.WorldTransform;
+			rDstNode.m_inverseBindMatrix = rSrcNode.InverseBindMatrix;
+
+			std::vector<int32_t> children(rSrcNode.Children.begin(), rSrcNode.Children.end());
+			rDstNode.m_children = writer.WriteArray(children);
+
+			if (rSrcNode.IsMesh)
+			{
+				rDstNode.m_flags |= NodeFlag_Mesh;
+				rDstNode.m_vertices = writer.WriteArray(rSrcNode.Mesh.Vertices);
+				rDstNode.m_faces = writer.WriteArray(rSrcNode.Mesh.Faces);
+				rDstNode.m_subsets = writer.WriteArray(rSrcNode.Mesh.Subsets);
+
+				std::vector<LodEntry> lodEntries(lods[i].size());
+				for (size_t lodi = 0; lodi < lods[i].size(); ++lodi)
+				{
+					lodEntries[lodi].m_vertices = writer.WriteArray(lods[i][lodi].m_vertices);
+					lodEntries[lodi].m_faces = writer.WriteArray(lods[i][lodi].m_faces);
+					lodEntries[lodi].m_subsets = writer.WriteArray(lods[i][lodi].m_subsets);
+				}
+				rDstNode.m_lods = writer.WriteArray(lodEntries);
+
+				lodCount = std::max(lodCount, (uint32_t)lodEntries.size() + 1);
+			}
+			if (rSrcNode.Mesh.IsSkinMesh)
+			{
+				rDstNode.m_flags |= NodeFlag_SkinMesh;
+			}
+		}
+
+		// マテリアル (テクスチャはファイル名のみ)
+		std::vector<MaterialEntry> materials(model.Materials.size());
+		for (size_t i = 0; i < model.Materials.size(); ++i)
+		{
+			const KdGLTFMaterial& rSrcMaterial = model.Materials[i];
+			MaterialEntry& rDstMaterial = materials[i];
+
+			rDstMaterial.m_name = writer.AddString(rSrcMaterial.Name);
+			rDstMaterial.m_baseColorTex = writer.AddString(rSrcMaterial.BaseColorTexName);
+			rDstMaterial.m_metallicRoughnessTex = writer.AddString(rSrcMaterial.MetallicRoughnessTexName);
+			rDstMaterial.m_emissiveTex = writer.AddString(rSrcMaterial.EmissiveTexName);
+			rDstMaterial.m_normalTex = writer.AddString(rSrcMaterial.NormalTexName);
+			rDstMaterial.m_baseColor = rSrcMaterial.BaseColor;
+			rDstMaterial.m_metallic = rSrcMaterial.Metallic;
+			rDstMaterial.m_roughness = rSrcMaterial.Roughness;
+			rDstMaterial.m_emissive = rSrcMaterial.Emissive;
+		}
+
+		// アニメーション
+		std::vector<AnimationEntry> animations(model.Animations.size());
+		for (size_t i = 0; i < model.Animations.size(); ++i)
+		{
+			const KdGLTFAnimationData& rSrcAnimation = *model.Animations[i];
+			AnimationEntry& rDstAnimation = animations[i];
+
+			rDstAnimation.m_name = writer.AddString(rSrcAnimation.m_name);
+			rDstAnimation.m_maxLength = rSrcAnimation.m_maxLength;
+
+			std::vector<AnimationNodeEntry> animNodes(rSrcAnimation.m_nodes.size());
+			for (size_t j = 0; j < rSrcAnimation.m_nodes.size(); ++j)
+			{
+				const KdGLTFAnimationData::Node& rSrcNode = *rSrcAnimation.m_nodes[j];
+
+				animNodes[j].m_nodeOffset = rSrcNode.m_nodeOffset;
+				animNodes[j].m_translations = writer.WriteArray(rSrcNode.m_translations);
+				animNodes[j].m_rotations = writer.WriteArray(rSrcNode.m_rotations);
+				animNodes[j].m_scales = writer.WriteArray(rSrcNode.m_scales);
+			}
+			rDstAnimation.m_nodes = writer.WriteArray(animNodes);
+		}
+
+		Header header;
+		memcpy(header.m_magic, kMagic, sizeof(kMagic));
+		header.m_version = kVersion;
+		header.m_vertexStride = sizeof(KdMeshVertex);
+		header.m_lodCount = lodCount;
+		header.m_nodes = writer.WriteArray(nodes);
+		header.m_materials = writer.WriteArray(materials);
+		header.m_animations = writer.WriteArray(animations);
+
+		const std::vector<uint8_t>& buffer = writer.Finish(header);
+
+		// 一時ファイルに書き出してから置き換える
+		std::filesystem::path dstPath(path);
+		std::error_code ec;
+		if (dstPath.has_parent_path())
+		{
+			std::filesystem::create_directories(dstPath.parent_path(), ec);
+		}
+
+		std::ostringstream tmpName;
+		tmpName << path << "." << std::this_thread::get_id() << ".tmp";
+		std::string tmpPath = tmpName.str();
+
+		{
+			std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+			if (!ofs) { return false; }
+
+			ofs.write((const char*)buffer.data(), (std::streamsize)buffer.size());
+			if (!ofs)
+			{
+				ofs.close();
+				std::filesystem::remove(tmpPath, ec);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(tmpPath, dstPath, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+
+		return true;
+	}
+
+	std::vector<std::string> GetSourceFiles(std::string_view sourcePath)
+	{
+		std::vector<std::string> files;
+		files.emplace_back(sourcePath);
+
+		std::filesystem::path path(sourcePath);
+		if (path.extension() != ".gltf") { return files; }
+
+		// バッファの参照先を調べるにはjsonの解析が必要なので、同じフォルダの .bin を全て含める
+		std::vector<std::string> buffers;
+		std::error_code ec;
+		for (const auto& entry : std::filesystem::directory_iterator(path.has_parent_path() ? path.parent_path() : ".", ec))
+		{
+			if (entry.path().extension() == ".bin")
+			{
+				buffers.push_back(entry.path().string());
+			}
+		}
+
+		// 列挙順に依存しないように並べる
+		std::sort(buffers.begin(), buffers.end());
+		files.insert(files.end(), buffers.begin(), buffers.end());
+
+		return files;
+	}
+}
@@ -0,0 +1,171 @@
+﻿#pragma once
+
+struct KdGLTFModel;
+
+//=====================================================
+//
+// 変換済み(クック済み)モデルのバイナリ形式
+//
+// ・glTFの読み込み結果をそのまま書き出したもの
+// ・頂点/インデックスは KdMeshVertex / KdMeshFace の並びのまま格納しているので、
+//   メモリマップしたファイルから直接 KdMesh::Create に渡せる
+// ・各ブロックは16byte境界に配置する
+// ・メッシュノードには書き出し時に作った詳細度の低いメッシュ (LOD1 以降) も入れておき、
+//   遠くのものは粗いメッシュだけを読み込めるようにする
+//
+// [Header][各ブロック...][文字列テーブル][ノード表][マテリアル表][アニメーション表]
+//
+//=====================================================
+namespace KdModelBinary
+{
+	// 形式を変えたら上げる (古いファイルは読み込まずに作り直す)
+	constexpr uint32_t kVersion = 2;
+	constexpr char kMagic[4] = { 'K', 'D', 'M', 'B' };
+
+	// ファイル内の配列 (先頭からのバイト位置と要素数)
+	struct Range
+	{
+		uint64_t	m_offset	= 0;
+		uint64_t	m_count		= 0;
+	};
+
+	// 文字列テーブル内の文字列
+	struct StringRef
+	{
+		uint32_t	m_offset	= 0;
+		uint32_t	m_length	= 0;
+	};
+
+	struct Header
+	{
+		char		m_magic[4]		= {};
+		uint32_t	m_version		= 0;
+		uint32_t	m_vertexStride	= 0;	// sizeof(KdMeshVertex) (構造体が変わったら読まない)
+		uint32_t	m_lodCount		= 1;	// 一番多いノードのLOD数 (LOD0 を含む)
+
+		Range		m_strings;				// char
+		Range		m_nodes;				// NodeEntry
+		Range		m_materials;			// MaterialEntry
+		Range		m_animations;			// AnimationEntry
+	};
+
+	enum NodeFlags : uint32_t
+	{
+		NodeFlag_Mesh		= 1 << 0,
+		NodeFlag_SkinMesh	= 1 << 1,
+	};
+
+	// 詳細度の低いメッシュ1段ぶん
+	struct LodEntry
+	{
+		Range			m_vertices;			// KdMeshVertex
+		Range			m_faces;			// KdMeshFace
+		Range			m_subsets;			// KdMeshSubset
+	};
+
+	struct NodeEntry
+	{
+		StringRef		m_name;
+		int32_t			m_parent		= -1;
+		int32_t			m_boneIndex		= -1;
+		uint32_t		m_flags			= 0;
+		uint32_t		m_reserved		= 0;
+
+		Math::Matrix	m_localTransform;
+		Math::Matrix	m_worldTransform;
+		Math::Matrix	m_inverseBindMatrix;
+
+		Range			m_children;			// int32_t
+		Range			m_vertices;			// KdMeshVertex
+		Range			m_faces;			// KdMeshFace
+		Range			m_subsets;			// KdMeshSubset
+
+		Range			m_lods;				// LodEntry (LOD1, LOD2, ... の順)
+	};
+
+	struct MaterialEntry
+	{
+		StringRef		m_name;
+		StringRef		m_baseColorTex;
+		StringRef		m_metallicRoughnessTex;
+		StringRef		m_emissiveTex;
+		StringRef		m_normalTex;
+
+		Math::Vector4	m_baseColor;
+		float			m_metallic		= 1.0f;
+		float			m_roughness		= 1.0f;
+		Math::Vector3	m_emissive;
+	};
+
+	struct AnimationNodeEntry
+	{
+		int32_t			m_nodeOffset	= -1;
+		uint32_t		m_reserved		= 0;
+
+		Range			m_translations;		// KdAnimKeyVector3
+		Range			m_rotations;		// KdAnimKeyQuaternion
+		Range			m_scales;			// KdAnimKeyVector3
+	};
+
+	struct AnimationEntry
+	{
+		StringRef		m_name;
+		float			m_maxLength		= 0;
+		uint32_t		m_reserved		= 0;
+
+		Range			m_nodes;			// AnimationNodeEntry
+	};
+
+	//=================================================
+	// 読み込み用ビュー
+	// ・メモリ上のバイナリを検証し、範囲チェック付きで参照する
+	// ・データはコピーしないので、元のメモリが有効な間だけ使える
+	//=================================================
+	class Reader
+	{
+	public:
+		// ヘッダとノード/アニメーションの参照番号を検証する
+		// ・形式違い・バージョン違い、範囲外の番号や親子の循環がある場合は false
+		bool Open(const uint8_t* pData, size_t size);
+
+		const Header& GetHeader() const { return *m_pHeader; }
+
+		// 配列の先頭を取得 (範囲外なら nullptr)
+		template<class T>
+		const T* Get(const Range& range) const
+		{
+			if (range.m_count == 0) { return nullptr; }
+			if (range.m_offset % alignof(T) != 0) { return nullptr; }
+			if (range.m_offset > m_size) { return nullptr; }
+			if (range.m_count > (m_size - range.m_offset) / sizeof(T)) { return nullptr; }
+
+			return (const T*)(m_pData + range.m_offset);
+		}
+
+		// 配列が範囲内に収まっているか (空の配列も有効)
+		template<class T>
+		bool IsValid(const Range& range) const
+		{
+			return range.m_count == 0 || Get<T>(range) != nullptr;
+		}
+
+		std::string GetString(const StringRef& ref) const;
+
+	private:
+		// 親/子/ボーン/アニメーション対象のノード番号がノード表の範囲内で、親子が循環していないか
+		bool ValidateIndices() const;
+
+		const uint8_t*	m_pData		= nullptr;
+		size_t			m_size		= 0;
+		const Header*	m_pHeader	= nullptr;
+	};
+
+	// glTFの読み込み結果をバイナリで書き出す
+	// ・スキンメッシュと当たり判定用 ("COL") 以外のメッシュはLODを作って一緒に書き出す
+	// ・一時ファイルに書いてから置き換えるので、同時に書き出しても壊れたファイルは残らない
+	bool Write(const KdGLTFModel& model, const std::string& path);
+
+	// 変換結果に影響するファイルの一覧 (派生データキャッシュのキー用)
+	// ・.gltf の場合は同じフォルダの .bin も含める
+	std::vector<std::string> GetSourceFiles(std::string_view sourcePath);
+}
@@ -0,0 +1,105 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdModelBinary.h"
+
+namespace KdModelBinary
+{
+	bool Reader::Open(const uint8_t* pData, size_t size)
+	{
+		m_pData = pData;
+		m_size = size;
+		m_pHeader = nullptr;
+
+		if (!pData || size < sizeof(Header)) { return false; }
+
+		const Header* pHeader = (const Header*)pData;
+		if (memcmp(pHeader->m_magic, kMagic, sizeof(kMagic)) != 0) { return false; }
+		if (pHeader->m_version != kVersion) { return false; }
+		if (pHeader->m_vertexStride != sizeof(KdMeshVertex)) { return false; }
+
+		m_pHeader = pHeader;
+
+		if (!IsValid<char>(pHeader->m_strings) ||
+			!IsValid<NodeEntry>(pHeader->m_nodes) ||
+			!IsValid<MaterialEntry>(pHeader->m_materials) ||
+			!IsValid<AnimationEntry>(pHeader->m_animations) ||
+			!ValidateIndices())
+		{
+			m_pHeader = nullptr;
+			return false;
+		}
+
+		return true;
+	}
+
+	std::string Reader::GetString(const StringRef& ref) const
+	{
+		if (ref.m_length == 0) { return std::string(); }
+
+		const char* pStrings = Get<char>(m_pHeader->m_strings);
+		if (!pStrings || (uint64_t)ref.m_offset + ref.m_length > m_pHeader->m_strings.m_count) { return std::string(); }
+
+		return std::string(pStrings + ref.m_offset, ref.m_length);
+	}
+
+	bool Reader::ValidateIndices() const
+	{
+		const uint64_t nodeCount = m_pHeader->m_nodes.m_count;
+		const NodeEntry* pNodes = Get<NodeEntry>(m_pHeader->m_nodes);
+
+		auto isNodeIndex = [nodeCount](int32_t idx) { return idx >= 0 && (uint64_t)idx < nodeCount; };
+
+		//------------------------------
+		// ノード
+		//------------------------------
+		for (uint64_t i = 0; i < nodeCount; ++i)
+		{
+			const NodeEntry& rNode = pNodes[i];
+
+			if (rNode.m_parent != -1 && !isNodeIndex(rNode.m_parent)) { return false; }
+			if (rNode.m_boneIndex != -1 && !isNodeIndex(rNode.m_boneIndex)) { return false; }
+
+			if (!IsValid<int32_t>(rNode.m_children)) { return false; }
+
+			const int32_t* pChildren = Get<int32_t>(rNode.m_children);
+			for (uint64_t c = 0; c < rNode.m_children.m_count; ++c)
+			{
+				int32_t child = pChildren[c];
+				if (!isNodeIndex(child) || (uint64_t)child == i) { return false; }
+
+				// 子の親は自分 (書き出し時に必ずそうなっている)
+				// ・子から見た親が1つに決まるので、親をたどって循環が無ければ子をたどっても循環しない
+				if ((uint64_t)pNodes[child].m_parent != i) { return false; }
+			}
+		}
+
+		// 親をたどってノード数より深くなるなら循環している
+		for (uint64_t i = 0; i < nodeCount; ++i)
+		{
+			int32_t parent = pNodes[i].m_parent;
+			for (uint64_t depth = 0; parent != -1; ++depth)
+			{
+				if (depth >= nodeCount) { return false; }
+				parent = pNodes[parent].m_parent;
+			}
+		}
+
+		//------------------------------
+		// アニメーション
+		//------------------------------
+		const AnimationEntry* pAnimations = Get<AnimationEntry>(m_pHeader->m_animations);
+		for (uint64_t i = 0; i < m_pHeader->m_animations.m_count; ++i)
+		{
+			const Range& rNodes = pAnimations[i].m_nodes;
+			if (!IsValid<AnimationNodeEntry>(rNodes)) { return false; }
+
+			const AnimationNodeEntry* pAnimNodes = Get<AnimationNodeEntry>(rNodes);
+			for (uint64_t j = 0; j < rNodes.m_count; ++j)
+			{
+				if (!isNodeIndex(pAnimNodes[j].m_nodeOffset)) { return false; }
+			}
+		}
+
+		return true;
+	}
+}
@@ -202,14 +202,34 @@ ID3D11Texture2D* KdTexture::WorkResource() const
 	return tex2D;
 }
 
+bool KdTexture::LoadImageFile(std::string_view filename, DirectX::TexMetadata& meta, DirectX::ScratchImage& image, size_t* pReadBytes)
+{
+	std::vector<uint8_t> data;
+	if (!KdFileSystem::Instance().ReadFile(filename, data) || data.empty()) { return false; }
+
+	if (pReadBytes) { *pReadBytes = data.size(); }
+
+	// WIC画像読み込み
+	//  WIC_FLAGS_ALL_FRAMES … gifアニメなどの複数フレームを読み込んでくれる
+	if (SUCCEEDED(DirectX::LoadFromWICMemory(data.data(), data.size(), DirectX::WIC_FLAGS_ALL_FRAMES, &meta, image))) { return true; }
+
+	// DDS画像読み込み
+	if (SUCCEEDED(DirectX::LoadFromDDSMemory(data.data(), data.size(), DirectX::DDS_FLAGS_NONE, &meta, image))) { return true; }
+
+	// TGA画像読み込み
+	if (SUCCEEDED(DirectX::LoadFromTGAMemory(data.data(), data.size(), &meta, image))) { return true; }
+
+	// HDR画像読み込み
+	if (SUCCEEDED(DirectX::LoadFromHDRMemory(data.data(), data.size(), &meta, image))) { return true; }
+
+	return false;
+}
+
 bool KdTexture::Load(std::string_view filename, bool renderTarget, bool depthStencil, bool generateMipmap)
 {
 	Release();
 	if (filename.empty())return false;
 
-	// ファイル名をWideCharへ変換
-	std::wstring wFilename = sjis_to_wide(filename.data());
-
 	//------------------------------------
 	// 画像読み込み
 	//------------------------------------
@@ -226,41 +246,8 @@ bool KdTexture::Load(std::string_view filename, bool renderTarget, bool depthSte
 	DirectX::TexMetadata meta;
 	DirectX::ScratchImage image;
 
-	bool bLoaded = false;
-
-	// WIC画像読み込み
-	//  WIC_FLAGS_ALL_FRAMES … gifアニメなどの複数フレームを読み込んでくれる
-	if (SUCCEEDED(DirectX::LoadFromWICFile(wFilename.c_str(), DirectX::WIC_FLAGS_ALL_FRAMES, &meta, image)))
-	{
-		bLoaded = true;
-	}
-
-	// DDS画像読み込み
-	if (bLoaded == false) {
-		if (SUCCEEDED(DirectX::LoadFromDDSFile(wFilename.c_str(), DirectX::DDS_FLAGS_NONE, &meta, image)))
-		{
-			bLoaded = true;
-		}
-	}
-
-	// TGA画像読み込み
-	if (bLoaded == false) {
-		if (SUCCEEDED(DirectX::LoadFromTGAFile(wFilename.c_str(), &meta, image)))
-		{
-			bLoaded = true;
-		}
-	}
-
-	// HDR画像読み込み
-	if (bLoaded == false) {
-		if (SUCCEEDED(DirectX::LoadFromHDRFile(wFilename.c_str(), &meta, image)))
-		{
-			bLoaded = true;
-		}
-	}
-
 	// 読み込み失敗
-	if (bLoaded == false)
+	if (LoadImageFile(filename, meta, image) == false)
 	{
 		return false;
 	}
@@ -446,6 +433,25 @@ bool KdTexture::CreateDepthStencil(int w, int h, DXGI_FORMAT format, UINT arrayC
 	return true;
 }
 
+uint64_t KdTexture::GetMemorySize() const
+{
+	if (!m_srv) { return 0; }
+
+	uint64_t total = 0;
+	for (UINT mip = 0; mip < m_desc.MipLevels; ++mip)
+	{
+		size_t rowPitch = 0;
+		size_t slicePitch = 0;
+		if (FAILED(DirectX::ComputePitch(m_desc.Format, std::max(1u, m_desc.Width >> mip), std::max(1u, m_desc.Height >> mip), rowPitch, slicePitch)))
+		{
+			break;
+		}
+		total += slicePitch;
+	}
+
+	return total * std::max(1u, m_desc.ArraySize);
+}
+
 void KdTexture::SetSRView(ID3D11ShaderResourceView* srv)
 {
 	if (srv == nullptr)return;
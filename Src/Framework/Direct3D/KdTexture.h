@@ -22,6 +22,8 @@ public:
 	UINT								GetHeight() const { return m_desc.Height; }
 	// 画像の全情報を取得
 	const D3D11_TEXTURE2D_DESC&			GetInfo() const { return m_desc; }
+	// GPUメモリ上のおおよそのサイズ (全ミップ・全配列要素の合計)
+	uint64_t							GetMemorySize() const;
 	// ファイルパス取得(Load時のみ)
 	const std::string&					GetFilepath() const { return m_filepath; }
 
@@ -60,6 +62,12 @@ public:
 	// ・generateMipmap	… ミップマップ生成する？
 	bool Load(std::string_view filename, bool renderTarget = false, bool depthStencil = false, bool generateMipmap = true);
 
+	// 画像ファイルの中身を読み込む (テクスチャは作らない)
+	// ・KdFileSystem 経由で読むので、パックファイル内の画像も読める
+	// ・WIC(png/jpg など)・DDS・TGA・HDR の順に試す
+	// ・pReadBytes		… 読んだファイルのサイズ
+	static bool LoadImageFile(std::string_view filename, DirectX::TexMetadata& meta, DirectX::ScratchImage& image, size_t* pReadBytes = nullptr);
+
 	//====================================================
 	//
 	// テクスチャ作成
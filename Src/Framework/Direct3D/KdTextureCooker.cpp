@@ -0,0 +1,232 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdTextureCooker.h"
+#include "KdGLTFLoader.h"
+
+std::string KdTextureCooker::GetCookedPath(std::string_view srcPath)
+{
+	std::string relative = std::filesystem::path(srcPath).lexically_normal().generic_string();
+
+	// "Asset/" 以下はそこからの相対パスにする
+	constexpr std::string_view kAssetDir = "Asset/";
+	if (relative.compare(0, kAssetDir.size(), kAssetDir) == 0) { relative.erase(0, kAssetDir.size()); }
+
+	return std::string(kCookedDir) + relative + ".dds";
+}
+
+std::string KdTextureCooker::FindCooked(std::string_view srcPath)
+{
+	std::string cookedPath = GetCookedPath(srcPath);
+
+	KdFileSystem& fileSystem = KdFileSystem::Instance();
+	if (!fileSystem.Exists(cookedPath)) { return {}; }
+
+	// パックファイル内のものはパックファイルの日時で比べる
+	// ・元ファイルが見つからなければそのまま使う
+	std::filesystem::file_time_type srcTime;
+	if (!fileSystem.GetWriteTime(srcPath, srcTime)) { return cookedPath; }
+
+	// 元ファイルを編集した後は、変換し直すまで元ファイルを使う
+	std::filesystem::file_time_type cookedTime;
+	if (!fileSystem.GetWriteTime(cookedPath, cookedTime) || cookedTime < srcTime) { return {}; }
+
+	return cookedPath;
+}
+
+DXGI_FORMAT KdTextureCooker::ChooseFormat(KdTextureRole role, const DirectX::ScratchImage& image)
+{
+	const DirectX::TexMetadata& meta = image.GetMetadata();
+
+	// BC は 4x4 のブロック単位なので、一番大きいミップが 4 の倍数でなければ圧縮しない
+	if (meta.width % 4 != 0 || meta.height % 4 != 0) { return meta.format; }
+
+	// HDR などの 8bit より細かい画像は BC1/3/5/7 に入らない
+	if (DirectX::IsCompressed(meta.format) || DirectX::BitsPerColor(meta.format) > 8) { return meta.format; }
+
+	DXGI_FORMAT format = DXGI_FORMAT_BC7_UNORM;
+	switch (role)
+	{
+	case KdTextureRole::Albedo:
+		format = image.IsAlphaAllOpaque() ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM;
+		break;
+	case KdTextureRole::Normal:
+		// BC5 には sRGB が無い (法線は元々線形)
+		return DXGI_FORMAT_BC5_UNORM;
+	case KdTextureRole::ORM:
+		format = DXGI_FORMAT_BC7_UNORM;
+		break;
+	case KdTextureRole::Emissive:
+		format = DXGI_FORMAT_BC1_UNORM;
+		break;
+	default:
+		format = DXGI_FORMAT_BC7_UNORM;
+		break;
+	}
+
+	// 実行時に読み込んでいた時と同じ色空間にする (見た目を変えない)
+	return DirectX::IsSRGB(meta.format) ? DirectX::MakeSRGB(format) : format;
+}
+
+bool KdTextureCooker::Cook(std::string_view srcPath, KdTextureRole role, DirectX::ScratchImage& outImage)
+{
+	DirectX::TexMetadata meta;
+	DirectX::ScratchImage image;
+	if (!KdTexture::LoadImageFile(srcPath, meta, image)) { return false; }
+
+	// 圧縮済みの DDS は一度展開する
+	if (DirectX::IsCompressed(meta.format))
+	{
+		DirectX::ScratchImage decompressed;
+		if (FAILED(DirectX::Decompress(image.GetImages(), image.GetImageCount(), meta, DXGI_FORMAT_UNKNOWN, decompressed))) { return false; }
+
+		image = std::move(decompressed);
+		meta = image.GetMetadata();
+	}
+
+	// ミップマップを全て作る (元から持っている場合はそのまま)
+	if (meta.mipLevels == 1)
+	{
+		DirectX::ScratchImage mipChain;
+		if (FAILED(DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), meta, DirectX::TEX_FILTER_DEFAULT, 0, mipChain))) { return false; }
+
+		image = std::move(mipChain);
+		meta = image.GetMetadata();
+	}
+
+	DXGI_FORMAT format = ChooseFormat(role, image);
+	if (format == meta.format)
+	{
+		outImage = std::move(image);
+		return true;
+	}
+
+	return SUCCEEDED(DirectX::Compress(image.GetImages(), image.GetImageCount(), meta, format,
+		DirectX::TEX_COMPRESS_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, outImage));
+}
+
+bool KdTextureCooker::CookFile(std::string_view srcPath, KdTextureRole role)
+{
+	DirectX::ScratchImage image;
+	if (!Cook(srcPath, role, image))
+	{
+		OutputDebugStringA(("KdTextureCooker: 変換に失敗しました " + std::string(srcPath) + "\n").c_str());
+		return false;
+	}
+
+	std::string cookedPath = GetCookedPath(srcPath);
+	std::string tmpPath = cookedPath + ".tmp";
+
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(cookedPath).parent_path(), ec);
+
+	// 途中で止まっても壊れたファイルが残らないように、書き終えてから置き換える
+	if (FAILED(DirectX::SaveToDDSFile(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+		DirectX::DDS_FLAGS_NONE, sjis_to_wide(tmpPath).c_str())))
+	{
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+
+	std::filesystem::rename(tmpPath, cookedPath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+
+	return true;
+}
+
+void KdTextureCooker::CollectRoles(std::string_view modelPath, std::map<std::string, KdTextureRole>& outRoles)
+{
+	std::shared_ptr<KdGLTFModel> spModel = KdLoadGLTFModel(modelPath);
+	if (!spModel) { return; }
+
+	// KdMaterial::SetTextures と同じパスにする (実行時に同じ名前で探せるように)
+	std::string fileDir = KdGetDirFromPath(std::string(modelPath));
+
+	auto addTexture = [&](const std::string& name, KdTextureRole role)
+	{
+		if (name.empty()) { return; }
+
+		// glb に埋め込まれた画像などファイルが無いものは変換できない
+		std::string path = fileDir + name;
+		if (!KdFileSystem::Instance().Exists(path)) { return; }
+
+		auto [it, inserted] = outRoles.emplace(path, role);
+		if (!inserted && it->second != role) { it->second = KdTextureRole::Generic; }
+	};
+
+	for (const KdGLTFMaterial& material : spModel->Materials)
+	{
+		addTexture(material.BaseColorTexName, KdTextureRole::Albedo);
+		addTexture(material.MetallicRoughnessTexName, KdTextureRole::ORM);
+		addTexture(material.OcclusionTexName, KdTextureRole::ORM);
+		addTexture(material.EmissiveTexName, KdTextureRole::Emissive);
+		addTexture(material.NormalTexName, KdTextureRole::Normal);
+	}
+}
+
+KdTextureCooker::Result KdTextureCooker::CookDirectory(const std::string& dir, bool force)
+{
+	Result result;
+
+	// モデルを探す (変換済みの置き場所は見ない)
+	std::vector<std::string> modelPaths;
+	{
+		std::error_code ec;
+		const std::string cookedDir = std::filesystem::path(kCookedDir).lexically_normal().generic_string();
+
+		for (auto it = std::filesystem::recursive_directory_iterator(dir, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+		{
+			if (!it->is_regular_file(ec)) { continue; }
+
+			std::string path = it->path().lexically_normal().generic_string();
+			if (path.compare(0, cookedDir.size(), cookedDir) == 0) { continue; }
+
+			std::string ext = it->path().extension().string();
+			std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+			if (ext == ".gltf" || ext == ".glb") { modelPaths.push_back(path); }
+		}
+	}
+	std::sort(modelPaths.begin(), modelPaths.end());
+
+	std::map<std::string, KdTextureRole> roles;
+	for (const std::string& modelPath : modelPaths) { CollectRoles(modelPath, roles); }
+
+	// テクスチャごとに並列で変換する
+	std::vector<std::pair<std::string, KdTextureRole>> textures(roles.begin(), roles.end());
+
+	enum class Outcome : uint8_t { Cooked, Skipped, Failed };
+	std::vector<Outcome> outcomes(textures.size(), Outcome::Failed);
+
+	KdParallel::Instance().For(textures.size(), [&](size_t i)
+	{
+		const auto& [path, role] = textures[i];
+
+		if (!force && !FindCooked(path).empty())
+		{
+			outcomes[i] = Outcome::Skipped;
+			return;
+		}
+
+		outcomes[i] = CookFile(path, role) ? Outcome::Cooked : Outcome::Failed;
+	});
+
+	for (Outcome outcome : outcomes)
+	{
+		switch (outcome)
+		{
+		case Outcome::Cooked:	++result.m_cooked;	break;
+		case Outcome::Skipped:	++result.m_skipped;	break;
+		default:				++result.m_failed;	break;
+		}
+	}
+
+	char msg[256];
+	snprintf(msg, sizeof(msg), "KdTextureCooker: %s cooked %zu / skipped %zu / failed %zu (%zu models)\n",
+		dir.c_str(), result.m_cooked, result.m_skipped, result.m_failed, modelPaths.size());
+	OutputDebugStringA(msg);
+
+	return result;
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+
+//=====================================================
+//
+// テクスチャの事前変換 (クック)
+//
+// ・ミップマップを全て作り、用途に合わせた BC 形式に圧縮した DDS を書き出す
+//   実行時は読み込んだ DDS をそのまま GPU に送るだけになる (展開・ミップ生成が要らず、VRAM も 1/4～1/8)
+// ・用途は glTF のマテリアル (KdGLTFMaterial) のどの枠で使われているかで決める
+// ・書き出し先は "Asset/Cooked/" 以下 (元ファイルのパス + ".dds")
+//   パックファイルにも一緒に入り、元ファイルの方が新しい間は使わない
+// ・GPU を使わないので、デバイスを作らずに実行できる
+//
+//=====================================================
+
+// テクスチャの用途
+enum class KdTextureRole : uint8_t
+{
+	Generic,	// 用途が決まらない (BC7)
+	Albedo,		// 基本色 (不透明なら BC1、半透明なら BC3)
+	Normal,		// 法線マップ (XY だけを BC5、Z はシェーダで求める)
+	ORM,		// メタリック・ラフネス (チャンネルが独立しているので BC7)
+	Emissive,	// 自己発光 (BC1)
+};
+
+namespace KdTextureCooker
+{
+	// 変換済みファイルの置き場所
+	constexpr const char* kCookedDir = "Asset/Cooked/";
+
+	// 変換済みファイルのパス ("Asset/Textures/a.png" → "Asset/Cooked/Textures/a.png.dds")
+	std::string GetCookedPath(std::string_view srcPath);
+
+	// 使える変換済みファイルのパス (無い・元ファイルの方が新しい場合は空)
+	std::string FindCooked(std::string_view srcPath);
+
+	// 用途と元画像から圧縮形式を決める (BC にできない大きさなら元の形式のまま)
+	DXGI_FORMAT ChooseFormat(KdTextureRole role, const DirectX::ScratchImage& image);
+
+	// 読み込み・ミップ生成・圧縮
+	bool Cook(std::string_view srcPath, KdTextureRole role, DirectX::ScratchImage& outImage);
+
+	// 変換して GetCookedPath に書き出す
+	bool CookFile(std::string_view srcPath, KdTextureRole role);
+
+	// glTF のマテリアルから、テクスチャのパスと用途を集める
+	// ・違う用途で使われているテクスチャは Generic にする
+	void CollectRoles(std::string_view modelPath, std::map<std::string, KdTextureRole>& outRoles);
+
+	struct Result
+	{
+		size_t	m_cooked = 0;
+		size_t	m_skipped = 0;		// 変換済みのものが最新だった
+		size_t	m_failed = 0;
+	};
+
+	// dir 以下のモデルが使うテクスチャを全て変換する
+	// force … 変換済みのものが最新でも変換し直す
+	Result CookDirectory(const std::string& dir, bool force);
+}
@@ -0,0 +1,228 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdVertexCompression.h"
+
+namespace
+{
+	int16_t ToSnorm16(float value)
+	{
+		value = std::clamp(value, -1.0f, 1.0f);
+		return (int16_t)std::lround(value * 32767.0f);
+	}
+
+	// D3D の SNORM と同じ戻し方 (-32768 は -1 として扱う)
+	float FromSnorm16(int16_t value)
+	{
+		return std::max(value / 32767.0f, -1.0f);
+	}
+
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	template<class PackedVertex>
+	void EncodeCommon(const KdMeshVertex& src, PackedVertex& dst)
+	{
+		dst.Pos = src.Pos;
+		dst.Color = src.Color;
+		dst.Normal = KdVertexCompression::EncodeOctahedral(src.Normal);
+		dst.Tangent = KdVertexCompression::EncodeOctahedral(src.Tangent);
+	}
+
+	template<class PackedVertex>
+	void AppendVertices(const std::vector<PackedVertex>& vertices, std::vector<uint8_t>& out)
+	{
+		out.resize(vertices.size() * sizeof(PackedVertex));
+		if (!vertices.empty()) { memcpy(out.data(), vertices.data(), out.size()); }
+	}
+}
+
+std::array<int16_t, 2> KdVertexCompression::EncodeOctahedral(const Math::Vector3& dir)
+{
+	float length = std::abs(dir.x) + std::abs(dir.y) + std::abs(dir.z);
+	if (length < 1e-8f) { return { 0, 0 }; }
+
+	// 正八面体に投影して、下半分は外側に折り返す
+	float x = dir.x / length;
+	float y = dir.y / length;
+	if (dir.z < 0.0f)
+	{
+		float foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+		float foldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	return { ToSnorm16(x), ToSnorm16(y) };
+}
+
+Math::Vector3 KdVertexCompression::DecodeOctahedral(const std::array<int16_t, 2>& encoded)
+{
+	// inc_KdStandardShader.hlsli の DecodeOctahedral と同じ計算
+	Math::Vector3 dir(FromSnorm16(encoded[0]), FromSnorm16(encoded[1]), 0.0f);
+	dir.z = 1.0f - std::abs(dir.x) - std::abs(dir.y);
+
+	float t = std::clamp(-dir.z, 0.0f, 1.0f);
+	dir.x += dir.x >= 0.0f ? -t : t;
+	dir.y += dir.y >= 0.0f ? -t : t;
+
+	dir.Normalize();
+	return dir;
+}
+
+uint16_t KdVertexCompression::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	// NaN / 無限大
+	if (((bits >> 23) & 0xFF) == 0xFF) { return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0)); }
+
+	// 大きすぎる値は無限大
+	if (exponent >= 31) { return (uint16_t)(sign | 0x7C00); }
+
+	// 非正規化数 (小さすぎる値は 0)
+	if (exponent <= 0)
+	{
+		if (exponent < -10) { return (uint16_t)sign; }
+
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) { ++half; }
+		return (uint16_t)(sign | half);
+	}
+
+	// 最近接偶数丸め (繰り上がりで指数が増えても正しい値になる)
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) { ++half; }
+
+	return (uint16_t)(sign | half);
+}
+
+float KdVertexCompression::HalfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+
+	uint32_t bits;
+	if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0)
+	{
+		bits = sign;
+	}
+	else
+	{
+		// 非正規化数は正規化し直す
+		exponent = 127 - 15 + 1;
+		while ((mantissa & 0x400) == 0)
+		{
+			mantissa <<= 1;
+			--exponent;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+UINT KdVertexCompression::Encode(const KdMeshVertex* pVertices, UINT vertexCount, KdVertexLayout& layout, std::vector<uint8_t>& outVertices)
+{
+	outVertices.clear();
+
+	// 半精度で UV が十分な精度を保てるか
+	if (layout == KdVertexLayout::Auto)
+	{
+		layout = KdVertexLayout::PackedHalfUV;
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			const Math::Vector2& uv = pVertices[i].UV;
+			if (std::abs(HalfToFloat(FloatToHalf(uv.x)) - uv.x) > kMaxHalfUVError ||
+				std::abs(HalfToFloat(FloatToHalf(uv.y)) - uv.y) > kMaxHalfUVError)
+			{
+				layout = KdVertexLayout::Packed;
+				break;
+			}
+		}
+	}
+
+	if (layout == KdVertexLayout::Full)
+	{
+		outVertices.resize((size_t)vertexCount * sizeof(KdMeshVertex));
+		if (vertexCount > 0) { memcpy(outVertices.data(), pVertices, outVertices.size()); }
+		return sizeof(KdMeshVertex);
+	}
+
+	if (layout == KdVertexLayout::PackedHalfUV)
+	{
+		std::vector<KdPackedMeshVertexHalfUV> vertices(vertexCount);
+		for (UINT i = 0; i < vertexCount; ++i)
+		{
+			EncodeCommon(pVertices[i], vertices[i]);
+			vertices[i].UV = { FloatToHalf(pVertices[i].UV.x), FloatToHalf(pVertices[i].UV.y) };
+		}
+		AppendVertices(vertices, outVertices);
+		return sizeof(KdPackedMeshVertexHalfUV);
+	}
+
+	std::vector<KdPackedMeshVertex> vertices(vertexCount);
+	for (UINT i = 0; i < vertexCount; ++i)
+	{
+		EncodeCommon(pVertices[i], vertices[i]);
+		vertices[i].UV = pVertices[i].UV;
+	}
+	AppendVertices(vertices, outVertices);
+	return sizeof(KdPackedMeshVertex);
+}
+
+const std::vector<D3D11_INPUT_ELEMENT_DESC>& KdVertexCompression::GetInputElements(KdVertexLayout layout)
+{
+	static const std::vector<D3D11_INPUT_ELEMENT_DESC> kFull = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,	0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,		0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM,	0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT,	0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT,	0, 36, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+
+	static const std::vector<D3D11_INPUT_ELEMENT_DESC> kPacked = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,	0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,		0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM,	0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,		0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT",  0, DXGI_FORMAT_R16G16_SNORM,		0, 28, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+
+	static const std::vector<D3D11_INPUT_ELEMENT_DESC> kPackedHalfUV = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,	0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,		0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM,	0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,		0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT",  0, DXGI_FORMAT_R16G16_SNORM,		0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+
+	switch (layout)
+	{
+	case KdVertexLayout::Packed:		return kPacked;
+	case KdVertexLayout::PackedHalfUV:	return kPackedHalfUV;
+	default:							return kFull;
+	}
+}
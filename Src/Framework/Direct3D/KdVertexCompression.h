@@ -0,0 +1,58 @@
+﻿#pragma once
+
+//==========================================================
+//
+// 頂点の圧縮形式
+//
+// ・KdMeshVertex (72 バイト) は読み込み・当たり判定・LOD 生成用の形式として残し、
+//   GPU に置く時だけ小さい形式に変換する
+// ・法線・接線は八面体圧縮 (単位ベクトルを 16bit x 2 で表す)
+// ・UV は誤差が小さければ半精度
+// ・スキン情報 (ボーン番号・ウェイト) は GPU に置かない
+//   KdStandardShader はスキニングをしない (ボーンの行列はノードごとに CPU で計算する) ので、どのシェーダも読まない
+// ・形式の種類 (KdVertexLayout) は KdMesh.h
+//
+//==========================================================
+
+// 法線・接線を八面体圧縮した頂点
+struct KdPackedMeshVertex
+{
+	Math::Vector3			Pos;
+	Math::Vector2			UV;
+	unsigned int			Color = 0xFFFFFFFF;
+	std::array<int16_t, 2>	Normal = {};		// DXGI_FORMAT_R16G16_SNORM
+	std::array<int16_t, 2>	Tangent = {};		// DXGI_FORMAT_R16G16_SNORM
+};
+
+// さらに UV を半精度にした頂点
+struct KdPackedMeshVertexHalfUV
+{
+	Math::Vector3			Pos;
+	std::array<uint16_t, 2>	UV = {};			// DXGI_FORMAT_R16G16_FLOAT
+	unsigned int			Color = 0xFFFFFFFF;
+	std::array<int16_t, 2>	Normal = {};
+	std::array<int16_t, 2>	Tangent = {};
+};
+
+namespace KdVertexCompression
+{
+	// 半精度にした UV の誤差がこれ以下なら PackedHalfUV にする (1024px のテクスチャの半テクセル)
+	constexpr float kMaxHalfUVError = 0.5f / 1024.0f;
+
+	// 八面体圧縮 (長さ 0 のベクトルは +Z になる)
+	std::array<int16_t, 2>	EncodeOctahedral(const Math::Vector3& dir);
+	Math::Vector3			DecodeOctahedral(const std::array<int16_t, 2>& encoded);
+
+	// 半精度浮動小数点
+	uint16_t				FloatToHalf(float value);
+	float					HalfToFloat(uint16_t value);
+
+	// 頂点を layout の形式に変換する
+	// ・Auto は選んだ形式に置き換えて返す
+	// 戻り値 … 1頂点のサイズ
+	UINT Encode(const KdMeshVertex* pVertices, UINT vertexCount, KdVertexLayout& layout, std::vector<uint8_t>& outVertices);
+
+	// 形式ごとの入力レイアウト (KdStandardShader の頂点シェーダに合わせたもの)
+	// ・法線・接線は float3 で受け取るので、八面体圧縮した形式では z が 0 になる (シェーダで戻す)
+	const std::vector<D3D11_INPUT_ELEMENT_DESC>& GetInputElements(KdVertexLayout layout);
+}
@@ -14,6 +14,12 @@
 #include "Utility/KdCSVData.h"
 #include "Utility/KdFPSController.h"
 #include "Utility/KdRandom.h"
+#include "Utility/KdMappedFile.h"
+#include "Utility/KdPackFile.h"
+#include "Utility/KdFileSystem.h"
+#include "Utility/KdDerivedDataCache.h"
+#include "Utility/KdFileWatcher.h"
+#include "Utility/KdParallel.h"
 
 // 音関連
 #include "Audio/KdAudio.h"
@@ -23,10 +29,12 @@
 
 // テクスチャ
 #include "Direct3D/KdTexture.h"
+#include "Direct3D/KdTextureCooker.h"
 // シェーダー描画用マテリアル
 #include "Direct3D/KdMaterial.h"
 // メッシュ
 #include "Direct3D/KdMesh.h"
+#include "Direct3D/KdVertexCompression.h"
 // モデル
 #include "Direct3D/KdModel.h"
 // データ保管庫：テンプレート
@@ -582,13 +582,14 @@ bool KdModelCollision::Intersects(const DirectX::BoundingSphere& target, const M
 		const KdModelWork::Node& workNode = workNodes[index];
 
 		// あり得ないはずだが一応チェック
-		if (!dataNode.m_spMesh) { continue; }
+		const std::shared_ptr<KdMesh>& spMesh = dataNode.GetCollisionMesh();
+		if (!spMesh) { continue; }
 
 		CollisionMeshResult tmpResult;
 		CollisionMeshResult* pTmpResult = pRes ? &tmpResult : nullptr;
 
 		// メッシュと球形の当たり判定実行
-		if (!MeshIntersect(*dataNode.m_spMesh, pushedSphere, workNode.m_worldTransform * world, pTmpResult))
+		if (!MeshIntersect(*spMesh, pushedSphere, workNode.m_worldTransform * world, pTmpResult))
 		{
 			continue;
 		}
@@ -678,12 +679,13 @@ bool KdModelCollision::Intersects(const KdCollider::RayInfo& target, const Math:
 		const KdModelData::Node& dataNode = dataNodes[index];
 		const KdModelWork::Node& workNode = workNodes[index];
 
-		if (!dataNode.m_spMesh) { continue; }
+		const std::shared_ptr<KdMesh>& spMesh = dataNode.GetCollisionMesh();
+		if (!spMesh) { continue; }
 
 		CollisionMeshResult tmpResult;
 		CollisionMeshResult* pTmpResult = pRes ? &tmpResult : nullptr;
 
-		if (!MeshIntersect(*dataNode.m_spMesh, target.m_pos, target.m_dir, target.m_range,
+		if (!MeshIntersect(*spMesh, target.m_pos, target.m_dir, target.m_range,
 			workNode.m_worldTransform * world, pTmpResult))
 		{
 			continue;
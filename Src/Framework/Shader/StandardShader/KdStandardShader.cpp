@@ -136,6 +136,7 @@ void KdStandardShader::DrawMesh(const KdMesh* mesh, const Math::Matrix& mWorld,
 
 	// メッシュの頂点情報転送
 	mesh->SetToDevice();
+	SetVertexLayout(mesh->GetVertexLayout());
 
 	// 3Dワールド行列転送
 	m_cb1_Mesh.Work().mW = mWorld;
@@ -158,6 +159,24 @@ void KdStandardShader::DrawMesh(const KdMesh* mesh, const Math::Matrix& mWorld,
 	}
 }
 
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 頂点の形式の切り替え
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 入力レイアウトを頂点バッファの形式に合わせ、圧縮した法線を頂点シェーダで戻すかを設定する
+// 定数バッファは呼び出し元で行列と一緒に書き込む
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdStandardShader::SetVertexLayout(KdVertexLayout layout)
+{
+	switch (layout)
+	{
+	case KdVertexLayout::Packed:		KdShaderManager::Instance().SetInputLayout(m_inputLayoutPacked);		break;
+	case KdVertexLayout::PackedHalfUV:	KdShaderManager::Instance().SetInputLayout(m_inputLayoutPackedHalfUV);	break;
+	default:							KdShaderManager::Instance().SetInputLayout(m_inputLayout);				break;
+	}
+
+	m_cb1_Mesh.Work().PackedNormal = (layout == KdVertexLayout::Packed || layout == KdVertexLayout::PackedHalfUV) ? 1 : 0;
+}
+
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // モデルデータを描画（スタティック(アニメーションをしない)なモデル専用
 // ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
@@ -204,6 +223,9 @@ void KdStandardShader::DrawModel(KdModelWork& rModel, const Math::Matrix& mWorld
 	// データがないときはスキップ
 	if (data == nullptr) { return; }
 
+	// モデルデータが入れ替わっていればノードを作り直す
+	rModel.SyncModelData();
+
 	if (rModel.NeedCalcNodeMatrices())
 	{
 		rModel.CalcNodeMatrices();
@@ -256,6 +278,7 @@ void KdStandardShader::DrawPolygon(const KdPolygon& rPolygon, const Math::Matrix
 	}
 
 	// 3Dワールド行列転送
+	SetVertexLayout(KdVertexLayout::Full);
 	m_cb1_Mesh.Work().mW = mWorld;
 	m_cb1_Mesh.Write();
 
@@ -328,6 +351,7 @@ void KdStandardShader::DrawVertices(const std::vector<KdPolygon::Vertex>& vertic
 	}
 
 	// 3Dワールド行列転送
+	SetVertexLayout(KdVertexLayout::Full);
 	m_cb1_Mesh.Work().mW = mWorld;
 	m_cb1_Mesh.Write();
 
@@ -391,26 +415,30 @@ bool KdStandardShader::Init()
 			return false;
 		}
 
-		// １頂点の詳細な情報
-		std::vector<D3D11_INPUT_ELEMENT_DESC> layout = {
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,		0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,			0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			{ "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM,		0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT,		0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			{ "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT,		0, 36, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		// １頂点の詳細な情報 (頂点の形式ごと)
+		// ・どの形式も同じ頂点シェーダで受け取る (型の違いは入力アセンブラが float に変換する)
+		std::pair<KdVertexLayout, ID3D11InputLayout**> inputLayouts[] = {
+			{ KdVertexLayout::Full,			&m_inputLayout },
+			{ KdVertexLayout::Packed,		&m_inputLayoutPacked },
+			{ KdVertexLayout::PackedHalfUV,	&m_inputLayoutPackedHalfUV },
 		};
 
-		// 頂点入力レイアウト作成
-		if (FAILED(KdDirect3D::Instance().WorkDev()->CreateInputLayout(
-			&layout[0],				// 入力エレメント先頭アドレス
-			(UINT)layout.size(),	// 入力エレメント数
-			&compiledBuffer[0],		// 頂点バッファのバイナリデータ
-			sizeof(compiledBuffer),	// 上記のバッファサイズ
-			&m_inputLayout))
-			) {
-			assert(0 && "CreateInputLayout失敗");
-			Release();
-			return false;
+		for (auto& [vertexLayout, ppInputLayout] : inputLayouts)
+		{
+			const std::vector<D3D11_INPUT_ELEMENT_DESC>& layout = KdVertexCompression::GetInputElements(vertexLayout);
+
+			// 頂点入力レイアウト作成
+			if (FAILED(KdDirect3D::Instance().WorkDev()->CreateInputLayout(
+				&layout[0],				// 入力エレメント先頭アドレス
+				(UINT)layout.size(),	// 入力エレメント数
+				&compiledBuffer[0],		// 頂点バッファのバイナリデータ
+				sizeof(compiledBuffer),	// 上記のバッファサイズ
+				ppInputLayout))
+				) {
+				assert(0 && "CreateInputLayout失敗");
+				Release();
+				return false;
+			}
 		}
 	}
 
@@ -503,6 +531,8 @@ void KdStandardShader::Release()
 	KdSafeRelease(m_VS_UnLit);
 
 	KdSafeRelease(m_inputLayout);
+	KdSafeRelease(m_inputLayoutPacked);
+	KdSafeRelease(m_inputLayoutPackedHalfUV);
 	
 	KdSafeRelease(m_PS_Lit);
 	KdSafeRelease(m_PS_GenDepthFromLight);
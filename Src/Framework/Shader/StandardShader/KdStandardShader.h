@@ -33,6 +33,10 @@ public:
 	struct cbMesh
 	{
 		Math::Matrix	mW;
+
+		// 法線・接線が八面体圧縮されている (KdVertexLayout::Packed など)
+		int				PackedNormal = 0;
+		float			_blank[3] = { 0.0f, 0.0f, 0.0f };
 	};
 
 	// 定数バッファ(マテリアル単位更新)
@@ -210,7 +214,12 @@ private:
 	ID3D11VertexShader* m_VS_GenDepthFromLight = nullptr;	// 光からの深度
 
 	// 頂点入力レイアウト
-	ID3D11InputLayout* m_inputLayout = nullptr;
+	ID3D11InputLayout* m_inputLayout = nullptr;					// KdPolygon::Vertex・KdVertexLayout::Full
+	ID3D11InputLayout* m_inputLayoutPacked = nullptr;			// KdVertexLayout::Packed
+	ID3D11InputLayout* m_inputLayoutPackedHalfUV = nullptr;		// KdVertexLayout::PackedHalfUV
+
+	// メッシュの頂点の形式に合わせて入力レイアウトと定数バッファを切り替える
+	void SetVertexLayout(KdVertexLayout layout);
 	
 	// ピクセルシェーダー
 	ID3D11PixelShader* m_PS_Lit = nullptr;					// 陰影あり
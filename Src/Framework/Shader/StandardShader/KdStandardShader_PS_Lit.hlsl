@@ -55,10 +55,12 @@ float4 main(VSOutput In) : SV_Target0
 	vCam = normalize(vCam);
 
 	// 法線マップから法線ベクトル取得
-	float3 wN = g_normalTex.Sample(g_ss, In.UV).rgb;
+	// ・XY だけを使い、Z は長さが 1 になるように求める (BC5 に変換済みの法線マップは RG しか持たない)
+	float3 wN;
 
 	// UV座標（0～1）から 射影座標（-1～1）へ変換
-	wN = wN * 2.0 - 1.0;
+	wN.xy = g_normalTex.Sample(g_ss, In.UV).rg * 2.0 - 1.0;
+	wN.z = sqrt(saturate(1.0 - dot(wN.xy, wN.xy)));
 	
 	{
 		// 3種の法線から法線行列を作成
@@ -13,6 +13,13 @@ VSOutput main(
 {
 	VSOutput Out;
 
+	// 圧縮した頂点なら法線・接線を戻す (入力アセンブラが z を 0 で埋めている)
+	if (g_PackedNormal)
+	{
+		normal = DecodeOctahedral(normal.xy);
+		tangent = DecodeOctahedral(tangent.xy);
+	}
+
     // 座標変換
 	Out.Pos = mul(pos, g_mWorld);	 // ローカル座標系	-> ワールド座標系へ変換
 	Out.wPos = Out.Pos.xyz;			 // ワールド座標を別途保存
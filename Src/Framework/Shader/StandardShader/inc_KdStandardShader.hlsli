@@ -17,8 +17,19 @@ cbuffer cbMesh : register(b1)
 {
 	// オブジェクト情報
 	row_major float4x4 g_mWorld; // ワールド変換行列
+
+	int g_PackedNormal;	// 法線・接線が八面体圧縮されている
 };
 
+// 八面体圧縮した方向を戻す (KdVertexCompression::DecodeOctahedral と同じ計算)
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 cbuffer cbMaterial : register(b2)
 {
 	float4	g_BaseColor; // ベース色
@@ -8,21 +8,26 @@ bool KdCSVData::Load(const std::string_view filename)
 
 	m_filePass = filename.data();
 
-	std::ifstream ifs(m_filePass);
-
-	if (!ifs)
+	// パックファイル内にあればそこから読む
+	std::string text;
+	if (!KdFileSystem::Instance().ReadFile(m_filePass, text))
 	{ 
 		assert(0 && "CSVDataが見つかりません");
 
 		return false;
 	}
 
+	std::istringstream ifs(text);
+
 	// 行ごとに分けてデータ格納
 	while (1)
 	{
 		std::string rawLineData;
 		if (!getline(ifs, rawLineData)) { break; }
 
+		// バイナリのまま読んでいるので改行コードの \r が残る
+		if (!rawLineData.empty() && rawLineData.back() == '\r') { rawLineData.pop_back(); }
+
 		// [,]で分けて単語ごとにデータ格納
 		std::vector<std::string> lineData;
 		CommaSeparatedValue(rawLineData, lineData);
@@ -0,0 +1,47 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdDataStorage.h"
+
+KdAssetMemory KdGetAssetMemory(const KdTexture& texture)
+{
+	KdAssetMemory memory;
+	memory[KdAssetCategory::Texture] = texture.GetMemorySize();
+	return memory;
+}
+
+KdAssetMemory KdGetAssetMemory(const KdModelData& model)
+{
+	// マテリアルのテクスチャは m_textures 側で数える
+	KdAssetMemory memory;
+	memory[KdAssetCategory::Mesh] = model.GetMeshMemorySize();
+	memory[KdAssetCategory::Animation] = model.GetAnimationMemorySize();
+	return memory;
+}
+
+void KdAssets::Update()
+{
+	++m_frame;
+
+	// モデルを先に解放すると、そのモデルだけが参照していたテクスチャが次の集計で候補になる
+	m_resident = KdAssetMemory();
+	m_modeldatas.UpdateResidency(m_frame, m_resident);
+	m_textures.UpdateResidency(m_frame, m_resident);
+
+	for (int i = 0; i < (int)KdAssetCategory::Count; ++i)
+	{
+		KdAssetCategory category = (KdAssetCategory)i;
+
+		uint64_t budget = m_budgets[category];
+		if (budget == 0 || m_resident[category] <= budget) { continue; }
+
+		uint64_t over = m_resident[category] - budget;
+
+		KdAssetMemory freed = m_modeldatas.EvictUnreferenced(category, over);
+		if (freed[category] < over)
+		{
+			freed += m_textures.EvictUnreferenced(category, over - freed[category]);
+		}
+
+		m_resident -= freed;
+	}
+}
@@ -1,5 +1,45 @@
 ﻿#pragma once
 
+// アセットのメモリ区分 (区分ごとに予算を設定できる)
+enum class KdAssetCategory
+{
+	Texture,
+	Mesh,
+	Animation,
+	Count
+};
+
+// アセット1つ (または合計) の区分ごとのメモリ量
+struct KdAssetMemory
+{
+	uint64_t m_bytes[(int)KdAssetCategory::Count] = {};
+
+	uint64_t& operator[](KdAssetCategory category) { return m_bytes[(int)category]; }
+	uint64_t operator[](KdAssetCategory category) const { return m_bytes[(int)category]; }
+
+	uint64_t GetTotal() const
+	{
+		uint64_t total = 0;
+		for (uint64_t bytes : m_bytes) { total += bytes; }
+		return total;
+	}
+
+	KdAssetMemory& operator+=(const KdAssetMemory& other)
+	{
+		for (int i = 0; i < (int)KdAssetCategory::Count; ++i) { m_bytes[i] += other.m_bytes[i]; }
+		return *this;
+	}
+
+	KdAssetMemory& operator-=(const KdAssetMemory& other)
+	{
+		for (int i = 0; i < (int)KdAssetCategory::Count; ++i) { m_bytes[i] -= std::min(m_bytes[i], other.m_bytes[i]); }
+		return *this;
+	}
+};
+
+// 各アセットのメモリ量
+KdAssetMemory KdGetAssetMemory(const KdTexture& texture);
+KdAssetMemory KdGetAssetMemory(const KdModelData& model);
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // アセットを取り出し可能な状態で保持するクラス
@@ -16,89 +56,309 @@ public:
 	~KdDataStorage() { ClearData(true); }
 
 	// カスタムローダーの設定
+	// ・読み込み前に設定しておくこと (設定自体はスレッドセーフではない)
 	void SetCustomLoader(std::function<std::shared_ptr<DataType>(const std::string&)> loader)
 	{
 		m_customLoader = loader;
 	}
 
 	// 各アセットの読込・取得関数
+	// ・どちらも複数スレッドから同時に呼んでよい
 	// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
 	// 強制的にデータを読み込ませて更新する
 	std::shared_ptr<DataType> LoadData(std::string_view fileName)
 	{
-		// カスタムローダーがあればそれを使う
-		if (m_customLoader)
+		std::shared_ptr<DataType> newData = Load(fileName);
+		if (!newData) { return nullptr; }
+
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		// 読み込み中の要求があれば、そちらもこのデータを待っているので差し替えるだけでよい
+		m_spDatas[fileName.data()].m_spData = newData;
+
+		return newData;
+	}
+
+	// データの取得：リスト内に存在しない場合は新しくロードする
+	// ・同じファイルを別スレッドが読み込み中の場合は、その完了を待って同じデータを返す
+	std::shared_ptr<DataType> GetData(std::string_view fileName)
+	{
+		std::string key(fileName);
+
+		// リストの中に欲しいデータがあるか検索 (読み取りのみなので共有ロック)
 		{
-			std::shared_ptr<DataType> newData = m_customLoader(fileName.data());
-			if (newData)
+			std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+			auto findData = m_spDatas.find(key);
+			if (findData != m_spDatas.end())
 			{
-				m_spDatas[fileName.data()] = newData;
-				return newData;
+				// データがあった場合はそのまま共有
+				if (findData->second.m_spData) { return findData->second.m_spData; }
+
+				// 読み込み中なら完了を待つ
+				std::shared_future<std::shared_ptr<DataType>> pending = findData->second.m_pending;
+				lock.unlock();
+
+				return pending.get();
 			}
-			// カスタムローダーがnullを返した場合は通常のロードを試みる、またはエラー
 		}
 
-		std::shared_ptr<DataType> newData = std::make_shared<DataType>();
-
-		if (!newData->Load(fileName))
+		// データが無かった場合は、読み込み中として登録してからロードする
+		std::promise<std::shared_ptr<DataType>> promise;
 		{
-			assert(0 && "KdDataStorage::LoadData ファイルが存在しません。ファイルパスを確認してください");
+			std::unique_lock<std::shared_mutex> lock(m_mutex);
 
-			return nullptr;
+			// ロックを取り直す間に他のスレッドが登録しているかもしれない
+			auto findData = m_spDatas.find(key);
+			if (findData != m_spDatas.end())
+			{
+				if (findData->second.m_spData) { return findData->second.m_spData; }
+
+				std::shared_future<std::shared_ptr<DataType>> pending = findData->second.m_pending;
+				lock.unlock();
+
+				return pending.get();
+			}
+
+			m_spDatas[key].m_pending = promise.get_future().share();
+		}
+
+		// 読み込み自体はロックの外で行う (読み込み中に別のアセットを要求してもよい)
+		// ・ローダーが例外を投げた場合は、待っているスレッドにも同じ例外を渡してから投げ直す
+		//   (promise を壊れたままにすると、待っている側は std::future_error になる)
+		std::shared_ptr<DataType> newData;
+		try
+		{
+			newData = Load(fileName);
+		}
+		catch (...)
+		{
+			FinishPending(key, nullptr);
+			promise.set_exception(std::current_exception());
+			throw;
 		}
 
-		m_spDatas[fileName.data()] = newData;
+		FinishPending(key, newData);
+		promise.set_value(newData);
 
 		return newData;
 	}
 
-	// データの取得：リスト内に存在しない場合は新しくロードする
-	std::shared_ptr<DataType> GetData(std::string_view fileName)
+	// 保持しているデータの破棄
+	// ・読み込み中のデータは残す
+	void ClearData(bool force)
 	{
-		// リストの中に欲しいデータがあるか検索
-		auto findData = m_spDatas.find(fileName.data());
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
 
-		// データがあった場合
-		if (findData != m_spDatas.end())
+		for (auto dataIter = m_spDatas.begin(); dataIter != m_spDatas.end();)
 		{
-			// そのままデータを共有
-			return (*findData).second;
+			const Entry& entry = dataIter->second;
+
+			// force … 強制的にすべてのデータを消去
+			// それ以外 … アプリ上で使用されておらず、Storageクラスが保持しているだけのデータを破棄
+			if (entry.m_spData && (force || entry.m_spData.use_count() < 2))
+			{
+				dataIter = m_spDatas.erase(dataIter);
+
+				continue;
+			}
+
+			++dataIter;
 		}
-		// データが無かった場合
-		else
+	}
+
+	// アプリ側から参照されていなければ1つだけ破棄する (読み込みを取り消すデータを残さないため)
+	// ・pExpected と同じデータを保持している時だけ消す (別のデータに差し替わっていたら残す)
+	// ・参照数は排他ロックの中で数えるので、数えてから消すまでの間に GetData で渡されることは無い
+	// 戻り値 … 破棄したか (false なら誰かが使っているので、読み込みを続けること)
+	bool RemoveUnreferenced(std::string_view fileName, const DataType* pExpected)
+	{
+		if (!pExpected) { return false; }
+
+		std::shared_ptr<DataType> removed;
 		{
-			// 新たにデータをロードする
-			return LoadData(fileName);
+			std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+			auto findData = m_spDatas.find(std::string(fileName));
+			if (findData == m_spDatas.end() || findData->second.m_spData.get() != pExpected) { return false; }
+			if (findData->second.m_spData.use_count() > 1) { return false; }
+
+			removed = std::move(findData->second.m_spData);
+			m_spDatas.erase(findData);
 		}
+
+		// 破棄はロックの外で行う
+		return true;
 	}
 
-	// 保持しているデータの破棄
-	void ClearData(bool force)
+	// 保持しているデータの数 (読み込み中を含む)
+	size_t GetDataCount() const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		return m_spDatas.size();
+	}
+
+	// 読み込み済みのデータ一覧 (ファイル名, データ)
+	void GetLoadedDatas(std::vector<std::pair<std::string, std::shared_ptr<DataType>>>& out) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+		out.reserve(out.size() + m_spDatas.size());
+		for (const auto& [name, entry] : m_spDatas)
+		{
+			if (entry.m_spData) { out.emplace_back(name, entry.m_spData); }
+		}
+	}
+
+	// 常駐管理
+	// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+	// 1アセット分の常駐情報 (表示用)
+	struct ResidencyInfo
 	{
-		if (force)
+		std::string		m_name;
+		KdAssetMemory	m_memory;
+		uint64_t		m_lastUsedFrame = 0;	// 最後にアプリ側から参照されていたフレーム
+		long			m_useCount = 0;			// Storage自身の参照を除いた参照数
+		bool			m_isLoading = false;
+	};
+
+	// 各データのメモリ量と参照状況を更新し、合計を outTotal に足す
+	// ・アプリ側から参照されているデータは frame で使われたものとする
+	// ・毎フレーム呼ぶので共有ロックで済ませる (GetData を止めない)
+	//   m_memory / m_lastUsedFrame を読み書きするのはメインスレッド (UpdateResidency・EvictUnreferenced・GetResidency) だけ
+	// ・排他ロックは予算を超えて EvictUnreferenced を呼んだ時だけ取る
+	void UpdateResidency(uint64_t frame, KdAssetMemory& outTotal)
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+		for (auto& [name, entry] : m_spDatas)
 		{
-			// 強制的にすべてのデータを消去
-			m_spDatas.clear();
+			if (!entry.m_spData) { continue; }
 
-			return;
+			entry.m_memory = KdGetAssetMemory(*entry.m_spData);
+			if (entry.m_spData.use_count() > 1) { entry.m_lastUsedFrame = frame; }
+
+			outTotal += entry.m_memory;
 		}
+	}
 
-		// アプリ上で使用されておらず、Storageクラスが保持しているだけのデータを破棄
-		for (auto dataIter = m_spDatas.begin(); dataIter != m_spDatas.end();)
+	// アプリ側から参照されていないデータを、使われなくなったのが古い順に破棄する
+	// ・category のメモリを bytesToFree 以上解放するか、候補が無くなるまで続ける
+	// 戻り値 … 解放したメモリ量 (全区分)
+	KdAssetMemory EvictUnreferenced(KdAssetCategory category, uint64_t bytesToFree)
+	{
+		KdAssetMemory freed;
+
+		// 破棄はロックの外で行う (デストラクタで別のアセットが解放されることがあるため)
+		std::vector<std::shared_ptr<DataType>> evicted;
 		{
-			if (dataIter->second.use_count() < 2)
+			std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+			std::vector<typename std::unordered_map<std::string, Entry>::iterator> candidates;
+			for (auto it = m_spDatas.begin(); it != m_spDatas.end(); ++it)
 			{
-				dataIter = m_spDatas.erase(dataIter);
+				const Entry& entry = it->second;
+				if (entry.m_spData && entry.m_spData.use_count() < 2 && entry.m_memory[category] > 0)
+				{
+					candidates.push_back(it);
+				}
+			}
 
-				continue;
+			std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b)
+				{
+					return a->second.m_lastUsedFrame < b->second.m_lastUsedFrame;
+				});
+
+			for (auto& it : candidates)
+			{
+				if (freed[category] >= bytesToFree) { break; }
+
+				freed += it->second.m_memory;
+				evicted.push_back(std::move(it->second.m_spData));
+				m_spDatas.erase(it);
 			}
+		}
 
-			++dataIter;
+		return freed;
+	}
+
+	// 常駐情報の取得 (表示用。メインスレッドから呼ぶ)
+	void GetResidency(std::vector<ResidencyInfo>& out) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+		out.reserve(out.size() + m_spDatas.size());
+		for (const auto& [name, entry] : m_spDatas)
+		{
+			ResidencyInfo& info = out.emplace_back();
+			info.m_name = name;
+			info.m_memory = entry.m_memory;
+			info.m_lastUsedFrame = entry.m_lastUsedFrame;
+			info.m_useCount = entry.m_spData ? entry.m_spData.use_count() - 1 : 0;
+			info.m_isLoading = !entry.m_spData;
 		}
 	}
 
 private:
-	std::unordered_map<std::string, std::shared_ptr<DataType>> m_spDatas;
+
+	// 1ファイル分の登録情報
+	struct Entry
+	{
+		std::shared_ptr<DataType>	m_spData;		// 読み込み済みのデータ
+		std::shared_future<std::shared_ptr<DataType>>	m_pending;	// 読み込み中の場合の完了待ち
+
+		KdAssetMemory	m_memory;					// 直前の UpdateResidency 時点のメモリ量
+		uint64_t		m_lastUsedFrame = 0;		// 最後にアプリ側から参照されていたフレーム
+	};
+
+	// 読み込み中の登録を読み込み結果で置き換える (失敗・例外なら登録を消す)
+	void FinishPending(const std::string& key, const std::shared_ptr<DataType>& newData)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+		auto findData = m_spDatas.find(key);
+		if (findData == m_spDatas.end()) { return; }
+
+		if (newData)
+		{
+			// 読み込み中に LoadData で差し替えられていたらそちらを優先
+			if (!findData->second.m_spData) { findData->second.m_spData = newData; }
+			findData->second.m_pending = {};
+		}
+		else if (!findData->second.m_spData)
+		{
+			// 失敗したものは残さない (次の要求で読み込み直す)
+			m_spDatas.erase(findData);
+		}
+	}
+
+	// 実際の読み込み (ロックの外で呼ぶ)
+	std::shared_ptr<DataType> Load(std::string_view fileName)
+	{
+		// カスタムローダーがあればそれを使う
+		if (m_customLoader)
+		{
+			std::shared_ptr<DataType> newData = m_customLoader(fileName.data());
+			if (newData) { return newData; }
+			// カスタムローダーがnullを返した場合は通常のロードを試みる
+		}
+
+		std::shared_ptr<DataType> newData = std::make_shared<DataType>();
+
+		if (!newData->Load(fileName))
+		{
+			assert(0 && "KdDataStorage::LoadData ファイルが存在しません。ファイルパスを確認してください");
+
+			return nullptr;
+		}
+
+		return newData;
+	}
+
+	// 読み取りが大半なので読み書きロック
+	mutable std::shared_mutex	m_mutex;
+
+	std::unordered_map<std::string, Entry> m_spDatas;
 	std::function<std::shared_ptr<DataType>(const std::string&)> m_customLoader;
 };
 
@@ -127,8 +387,30 @@ public:
 		m_modeldatas.ClearData(force);
 	}
 
+	// 常駐管理
+	// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+	// 区分ごとのメモリ予算 (0 = 無制限)
+	// ・超えた場合、アプリ側から参照されていないアセットを使われなくなったのが古い順に破棄する
+	// ・参照中のアセットは破棄しないので、予算を超えたままになることはある
+	void SetBudget(KdAssetCategory category, uint64_t bytes) { m_budgets[category] = bytes; }
+	uint64_t GetBudget(KdAssetCategory category) const { return m_budgets[category]; }
+
+	// メモリ量の集計と予算超過分の破棄 (メインスレッドから毎フレーム呼ぶ)
+	// ・予算を超えている区分がある時だけ破棄する (排他ロックを取るのはその時だけ)
+	void Update();
+
+	// 直前の Update 時点の常駐メモリ量
+	const KdAssetMemory& GetResidentMemory() const { return m_resident; }
+
+	// Update を呼んだ回数 (ResidencyInfo::m_lastUsedFrame と比べる)
+	uint64_t GetFrame() const { return m_frame; }
+
 private:
 
+	KdAssetMemory	m_budgets;
+	KdAssetMemory	m_resident;
+	uint64_t		m_frame = 0;
+
 	void Release()
 	{
 		ClearData(true);
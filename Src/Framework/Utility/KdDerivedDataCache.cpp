@@ -0,0 +1,406 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdDerivedDataCache.h"
+
+namespace
+{
+	// 索引の形式を変えたら上げる
+	constexpr int kIndexVersion = 1;
+	constexpr const char* kIndexFileName = "Index.json";
+
+	// FNV-1a (64bit)
+	constexpr uint64_t kHashOffset = 14695981039346656037ull;
+	constexpr uint64_t kHashPrime = 1099511628211ull;
+
+	uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+	{
+		const uint8_t* pBytes = (const uint8_t*)pData;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= pBytes[i];
+			hash *= kHashPrime;
+		}
+		return hash;
+	}
+
+	std::string ToHex(uint64_t value)
+	{
+		char buf[17];
+		snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)value);
+		return buf;
+	}
+}
+
+void KdDerivedDataCache::Init(const std::string& rootDir, uint64_t maxBytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_rootDir = rootDir;
+	m_maxBytes = maxBytes;
+
+	std::error_code ec;
+	std::filesystem::create_directories(m_rootDir, ec);
+	if (ec) { return; }
+
+	LoadIndex();
+
+	m_isInitialized = true;
+
+	// 上限が変わっている場合に備えて
+	Evict(std::string());
+}
+
+void KdDerivedDataCache::Release()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_isInitialized) { return; }
+
+	SaveIndex();
+
+	m_lru.clear();
+	m_entries.clear();
+	m_sourceStamps.clear();
+	m_totalBytes = 0;
+
+	m_isInitialized = false;
+}
+
+std::string KdDerivedDataCache::MakeKey(const std::vector<std::string>& sourcePaths, std::string_view settings, uint32_t version)
+{
+	if (!m_isInitialized || sourcePaths.empty()) { return std::string(); }
+
+	uint64_t key = kHashOffset;
+	key = HashBytes(key, &version, sizeof(version));
+	key = HashBytes(key, settings.data(), settings.size());
+
+	for (const std::string& path : sourcePaths)
+	{
+		uint64_t sourceHash = 0;
+		if (!GetSourceHash(path, sourceHash)) { return std::string(); }
+
+		key = HashBytes(key, &sourceHash, sizeof(sourceHash));
+	}
+
+	return ToHex(key);
+}
+
+std::string KdDerivedDataCache::Find(const std::string& key, std::string_view ext)
+{
+	if (key.empty()) { return std::string(); }
+
+	std::string name = key + "." + std::string(ext);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_isInitialized) { return std::string(); }
+
+	auto it = m_entries.find(name);
+	if (it == m_entries.end()) { return std::string(); }
+
+	// 外部から消されていた
+	std::string path = GetEntryPath(name);
+	std::error_code ec;
+	if (!std::filesystem::exists(path, ec))
+	{
+		m_totalBytes -= it->second->m_size;
+		m_lru.erase(it->second);
+		m_entries.erase(it);
+		return std::string();
+	}
+
+	Touch(name);
+
+	return path;
+}
+
+std::string KdDerivedDataCache::GetWritePath(const std::string& key, std::string_view ext) const
+{
+	// 同じキーを同時に書き出しても衝突しないように連番を付ける
+	uint32_t serial = m_writeSerial.fetch_add(1);
+	return GetEntryPath(key + "." + std::string(ext)) + "." + std::to_string(serial) + ".tmp";
+}
+
+bool KdDerivedDataCache::Commit(const std::string& key, std::string_view ext, const std::string& writtenPath)
+{
+	std::error_code ec;
+
+	if (key.empty())
+	{
+		std::filesystem::remove(writtenPath, ec);
+		return false;
+	}
+
+	std::string name = key + "." + std::string(ext);
+	std::string path = GetEntryPath(name);
+
+	uint64_t size = std::filesystem::file_size(writtenPath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(writtenPath, ec);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_isInitialized)
+	{
+		std::filesystem::remove(writtenPath, ec);
+		return false;
+	}
+
+	// 置き換え (中身は同じキーなら同じはずなので、先に登録されていても上書きでよい)
+	std::filesystem::rename(writtenPath, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(writtenPath, ec);
+		return false;
+	}
+
+	auto it = m_entries.find(name);
+	if (it != m_entries.end())
+	{
+		m_totalBytes -= it->second->m_size;
+		it->second->m_size = size;
+		Touch(name);
+	}
+	else
+	{
+		m_lru.push_back(Entry{ name, size });
+		m_entries[name] = std::prev(m_lru.end());
+	}
+	m_totalBytes += size;
+
+	Evict(name);
+
+	return true;
+}
+
+void KdDerivedDataCache::SetMaxSize(uint64_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_maxBytes = bytes;
+	Evict(std::string());
+}
+
+uint64_t KdDerivedDataCache::GetTotalSize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_totalBytes;
+}
+
+size_t KdDerivedDataCache::GetEntryCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+void KdDerivedDataCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::error_code ec;
+	for (const Entry& entry : m_lru)
+	{
+		std::filesystem::remove(GetEntryPath(entry.m_name), ec);
+	}
+
+	m_lru.clear();
+	m_entries.clear();
+	m_totalBytes = 0;
+}
+
+bool KdDerivedDataCache::GetSourceHash(const std::string& path, uint64_t& outHash)
+{
+	std::error_code ec;
+	uint64_t size = std::filesystem::file_size(path, ec);
+	if (ec) { return false; }
+
+	int64_t writeTime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+	if (ec) { return false; }
+
+	// サイズと更新日時が同じなら前回のハッシュを使う
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_sourceStamps.find(path);
+		if (it != m_sourceStamps.end() && it->second.m_size == size && it->second.m_writeTime == writeTime)
+		{
+			outHash = it->second.m_hash;
+			return true;
+		}
+	}
+
+	// 中身を読んでハッシュを計算
+	std::ifstream ifs(path, std::ios::binary);
+	if (!ifs) { return false; }
+
+	uint64_t hash = kHashOffset;
+	std::vector<char> buffer(64 * 1024);
+	while (ifs)
+	{
+		ifs.read(buffer.data(), (std::streamsize)buffer.size());
+		hash = HashBytes(hash, buffer.data(), (size_t)ifs.gcount());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_sourceStamps[path] = SourceStamp{ size, writeTime, hash };
+	}
+
+	outHash = hash;
+	return true;
+}
+
+std::string KdDerivedDataCache::GetEntryPath(const std::string& name) const
+{
+	return m_rootDir + "/" + name;
+}
+
+void KdDerivedDataCache::Touch(const std::string& name)
+{
+	auto it = m_entries.find(name);
+	if (it == m_entries.end()) { return; }
+
+	// 末尾 (最新) へ移動
+	m_lru.splice(m_lru.end(), m_lru, it->second);
+}
+
+void KdDerivedDataCache::Evict(const std::string& keep)
+{
+	auto it = m_lru.begin();
+	while (m_totalBytes > m_maxBytes && it != m_lru.end())
+	{
+		if (it->m_name == keep)
+		{
+			++it;
+			continue;
+		}
+
+		// 使用中などで消せなかった場合も索引からは外す (次回の Init で拾い直す)
+		std::error_code ec;
+		std::filesystem::remove(GetEntryPath(it->m_name), ec);
+
+		m_totalBytes -= it->m_size;
+		m_entries.erase(it->m_name);
+		it = m_lru.erase(it);
+	}
+}
+
+void KdDerivedDataCache::LoadIndex()
+{
+	m_lru.clear();
+	m_entries.clear();
+	m_sourceStamps.clear();
+	m_totalBytes = 0;
+
+	// 保存先にある実ファイル (索引より優先する)
+	std::unordered_map<std::string, uint64_t> files;
+	std::vector<std::pair<std::filesystem::file_time_type, std::string>> unindexed;
+
+	std::error_code ec;
+	for (const auto& dirEntry : std::filesystem::directory_iterator(m_rootDir, ec))
+	{
+		if (!dirEntry.is_regular_file(ec)) { continue; }
+
+		std::string name = dirEntry.path().filename().string();
+		if (name == kIndexFileName) { continue; }
+
+		// 書き出し途中で終了した一時ファイル
+		if (dirEntry.path().extension() == ".tmp")
+		{
+			std::filesystem::remove(dirEntry.path(), ec);
+			continue;
+		}
+
+		files[name] = dirEntry.file_size(ec);
+	}
+
+	// 索引 (古い順に並んでいる)
+	std::ifstream ifs(GetEntryPath(kIndexFileName));
+	if (ifs)
+	{
+		nlohmann::json index = nlohmann::json::parse(ifs, nullptr, false);
+
+		if (!index.is_discarded() && index.value("Version", 0) == kIndexVersion)
+		{
+			for (const auto& jsonEntry : index.value("Entries", nlohmann::json::array()))
+			{
+				std::string name = jsonEntry.value("Name", "");
+
+				auto file = files.find(name);
+				if (file == files.end()) { continue; }
+
+				m_lru.push_back(Entry{ name, file->second });
+				m_entries[name] = std::prev(m_lru.end());
+				m_totalBytes += file->second;
+
+				files.erase(file);
+			}
+
+			for (const auto& jsonSource : index.value("Sources", nlohmann::json::array()))
+			{
+				SourceStamp stamp;
+				stamp.m_size = jsonSource.value("Size", 0ull);
+				stamp.m_writeTime = jsonSource.value("WriteTime", 0ll);
+				stamp.m_hash = strtoull(jsonSource.value("Hash", "0").c_str(), nullptr, 16);
+
+				m_sourceStamps[jsonSource.value("Path", "")] = stamp;
+			}
+		}
+	}
+
+	// 索引に無いファイルは更新日時順で古い側に入れる
+	for (const auto& [name, size] : files)
+	{
+		unindexed.emplace_back(std::filesystem::last_write_time(GetEntryPath(name), ec), name);
+	}
+	std::sort(unindexed.begin(), unindexed.end(), std::greater<>());
+
+	for (const auto& [time, name] : unindexed)
+	{
+		m_lru.push_front(Entry{ name, files[name] });
+		m_entries[name] = m_lru.begin();
+		m_totalBytes += files[name];
+	}
+}
+
+void KdDerivedDataCache::SaveIndex() const
+{
+	nlohmann::json index;
+	index["Version"] = kIndexVersion;
+
+	nlohmann::json entries = nlohmann::json::array();
+	for (const Entry& entry : m_lru)
+	{
+		entries.push_back({ { "Name", entry.m_name } });
+	}
+	index["Entries"] = std::move(entries);
+
+	nlohmann::json sources = nlohmann::json::array();
+	for (const auto& [path, stamp] : m_sourceStamps)
+	{
+		sources.push_back({
+			{ "Path", path },
+			{ "Size", stamp.m_size },
+			{ "WriteTime", stamp.m_writeTime },
+			{ "Hash", ToHex(stamp.m_hash) },
+			});
+	}
+	index["Sources"] = std::move(sources);
+
+	// 一時ファイルに書いてから置き換える
+	std::string path = GetEntryPath(kIndexFileName);
+	std::string tmpPath = path + ".tmp";
+	{
+		std::ofstream ofs(tmpPath, std::ios::trunc);
+		if (!ofs) { return; }
+
+		ofs << index.dump(1, '\t');
+		if (!ofs) { return; }
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmpPath, path, ec);
+}
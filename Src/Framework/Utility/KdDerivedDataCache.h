@@ -0,0 +1,112 @@
+﻿#pragma once
+
+//===========================================
+//
+// 派生データキャッシュ (DDC)
+//
+// ・読み込み時に変換したデータ (クック済みモデル、ミップ付きテクスチャなど) をディスクに保存し、
+//   次回以降は変換せずに再利用する
+// ・キーは「元ファイルの中身 + 変換設定 + 変換処理のバージョン」のハッシュ
+//   元ファイルを書き換えればキーが変わるので、古いデータが使われることはない
+// ・元ファイルのハッシュはサイズ/更新日時と一緒に記録し、変化が無ければ読み直さない
+// ・合計サイズが上限を超えたら、最後に使われたのが古いものから削除する (LRU)
+// ・Init() していない時は何もキャッシュしない
+//
+//===========================================
+class KdDerivedDataCache
+{
+public:
+
+	// 初期化 (索引の読み込みと、保存先フォルダとの突き合わせ)
+	void Init(const std::string& rootDir = "Cache/DDC", uint64_t maxBytes = 2ull * 1024 * 1024 * 1024);
+
+	// 解放 (索引の保存)
+	void Release();
+
+	bool IsEnabled() const { return m_isInitialized; }
+
+	// キー作成
+	// sourcePaths	… 変換元のファイル (.gltf と .bin など、結果に影響する全てのファイル)
+	// settings		… 変換設定 (設定が違えば別のデータとして保存される)
+	// version		… 変換処理のバージョン (処理を変えたら上げる)
+	// 戻り値		… 元ファイルが読めない・未初期化なら空文字
+	std::string MakeKey(const std::vector<std::string>& sourcePaths, std::string_view settings, uint32_t version);
+
+	// キャッシュ検索 (見つかればファイルパス、無ければ空文字)
+	std::string Find(const std::string& key, std::string_view ext);
+
+	// 書き出し用の一時ファイルパス
+	std::string GetWritePath(const std::string& key, std::string_view ext) const;
+
+	// GetWritePath に書き出したファイルをキャッシュに登録する
+	// ・登録後、上限を超えていれば古いものから削除する
+	bool Commit(const std::string& key, std::string_view ext, const std::string& writtenPath);
+
+	// 容量の上限
+	void SetMaxSize(uint64_t bytes);
+	uint64_t GetMaxSize() const { return m_maxBytes; }
+
+	// 現在の合計サイズ・データ数
+	uint64_t GetTotalSize() const;
+	size_t GetEntryCount() const;
+
+	// 全削除
+	void Clear();
+
+private:
+
+	// キャッシュ内のデータ1つ
+	struct Entry
+	{
+		std::string	m_name;		// "<キー>.<拡張子>"
+		uint64_t	m_size = 0;
+	};
+
+	// 元ファイルのハッシュの記録
+	struct SourceStamp
+	{
+		uint64_t	m_size = 0;
+		int64_t		m_writeTime = 0;
+		uint64_t	m_hash = 0;
+	};
+
+	// 元ファイルの中身のハッシュ (記録が有効ならそれを使う)
+	bool GetSourceHash(const std::string& path, uint64_t& outHash);
+
+	std::string GetEntryPath(const std::string& name) const;
+
+	// name を最近使ったものにする
+	void Touch(const std::string& name);
+
+	// 上限に収まるまで古いものを削除 (keep は削除しない)
+	void Evict(const std::string& keep);
+
+	void LoadIndex();
+	void SaveIndex() const;
+
+	mutable std::mutex	m_mutex;
+
+	std::atomic<bool>	m_isInitialized = false;
+	std::string			m_rootDir;
+	uint64_t			m_maxBytes = 0;
+	uint64_t			m_totalBytes = 0;
+
+	// 先頭ほど古い
+	std::list<Entry>	m_lru;
+	std::unordered_map<std::string, std::list<Entry>::iterator>	m_entries;
+
+	std::unordered_map<std::string, SourceStamp>	m_sourceStamps;
+
+	mutable std::atomic<uint32_t>	m_writeSerial = 0;
+
+public:
+	static KdDerivedDataCache& Instance()
+	{
+		static KdDerivedDataCache instance;
+		return instance;
+	}
+
+private:
+	KdDerivedDataCache() {}
+	~KdDerivedDataCache() {}
+};
@@ -0,0 +1,176 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdFileSystem.h"
+
+// このスレッドの読み込みの進み具合の通知先
+static thread_local KdFileSystem::ReadProgressFunc t_readProgress;
+
+KdFileSystem::ScopedReadProgress::ScopedReadProgress(ReadProgressFunc func)
+	: m_prevFunc(std::move(t_readProgress))
+{
+	t_readProgress = std::move(func);
+}
+
+KdFileSystem::ScopedReadProgress::~ScopedReadProgress()
+{
+	t_readProgress = std::move(m_prevFunc);
+}
+
+bool KdFileSystem::Mount(const std::string& packPath)
+{
+	auto pack = std::make_unique<KdPackFile>();
+	if (!pack->Open(packPath)) { return false; }
+
+	std::unique_lock lock(m_mutex);
+
+	// 同じものは付け直す (最優先にする)
+	std::erase_if(m_packs, [&packPath](const std::unique_ptr<KdPackFile>& mounted) { return mounted->GetPath() == packPath; });
+
+	m_packs.push_back(std::move(pack));
+
+	OutputDebugStringA(("KdFileSystem : mounted " + packPath + " (" + std::to_string(m_packs.back()->GetEntryCount()) + " files)\n").c_str());
+
+	return true;
+}
+
+void KdFileSystem::Unmount(const std::string& packPath)
+{
+	std::unique_lock lock(m_mutex);
+	std::erase_if(m_packs, [&packPath](const std::unique_ptr<KdPackFile>& mounted) { return mounted->GetPath() == packPath; });
+}
+
+void KdFileSystem::UnmountAll()
+{
+	std::unique_lock lock(m_mutex);
+	m_packs.clear();
+}
+
+bool KdFileSystem::ReadFile(std::string_view path, std::vector<uint8_t>& out) const
+{
+	std::string normalizedPath = KdPackFile::NormalizePath(path);
+
+	{
+		// 読んでいる間にマウント解除されないように
+		std::shared_lock lock(m_mutex);
+
+		const KdPackFile::Entry* pEntry = nullptr;
+		const KdPackFile* pPack = FindPack(path, normalizedPath, pEntry);
+		if (pPack)
+		{
+			++m_packedReadCount;
+			if (!pPack->Read(*pEntry, out)) { return false; }
+
+			if (t_readProgress) { t_readProgress(out.size()); }
+			return true;
+		}
+	}
+
+	std::ifstream ifs(std::string(path), std::ios::binary | std::ios::ate);
+	if (!ifs) { return false; }
+
+	std::streamsize size = ifs.tellg();
+	if (size < 0) { return false; }
+
+	out.resize((size_t)size);
+	ifs.seekg(0);
+
+	// 進み具合を通知できるように分けて読む
+	for (size_t offset = 0; offset < (size_t)size; offset += kReadChunkSize)
+	{
+		size_t chunkSize = std::min(kReadChunkSize, (size_t)size - offset);
+		if (!ifs.read((char*)out.data() + offset, (std::streamsize)chunkSize)) { return false; }
+
+		if (t_readProgress) { t_readProgress(chunkSize); }
+	}
+
+	++m_diskReadCount;
+	return true;
+}
+
+bool KdFileSystem::ReadFile(std::string_view path, std::string& out) const
+{
+	std::vector<uint8_t> data;
+	if (!ReadFile(path, data)) { return false; }
+
+	out.assign((const char*)data.data(), data.size());
+	return true;
+}
+
+bool KdFileSystem::Exists(std::string_view path) const
+{
+	if (IsPacked(path)) { return true; }
+
+	std::error_code ec;
+	return std::filesystem::is_regular_file(std::string(path), ec);
+}
+
+bool KdFileSystem::GetFileSize(std::string_view path, uint64_t& outSize) const
+{
+	std::string normalizedPath = KdPackFile::NormalizePath(path);
+
+	{
+		std::shared_lock lock(m_mutex);
+
+		const KdPackFile::Entry* pEntry = nullptr;
+		if (FindPack(path, normalizedPath, pEntry))
+		{
+			outSize = pEntry->m_size;
+			return true;
+		}
+	}
+
+	std::error_code ec;
+	outSize = std::filesystem::file_size(std::string(path), ec);
+	return !ec;
+}
+
+bool KdFileSystem::IsPacked(std::string_view path) const
+{
+	std::string normalizedPath = KdPackFile::NormalizePath(path);
+
+	std::shared_lock lock(m_mutex);
+
+	const KdPackFile::Entry* pEntry = nullptr;
+	return FindPack(path, normalizedPath, pEntry) != nullptr;
+}
+
+bool KdFileSystem::GetWriteTime(std::string_view path, std::filesystem::file_time_type& outTime) const
+{
+	std::string normalizedPath = KdPackFile::NormalizePath(path);
+
+	{
+		std::shared_lock lock(m_mutex);
+
+		const KdPackFile::Entry* pEntry = nullptr;
+		if (const KdPackFile* pPack = FindPack(path, normalizedPath, pEntry))
+		{
+			outTime = pPack->GetWriteTime();
+			return true;
+		}
+	}
+
+	std::error_code ec;
+	outTime = std::filesystem::last_write_time(std::string(path), ec);
+	return !ec;
+}
+
+const KdPackFile* KdFileSystem::FindPack(std::string_view path, const std::string& normalizedPath, const KdPackFile::Entry*& outEntry) const
+{
+	for (auto it = m_packs.rbegin(); it != m_packs.rend(); ++it)
+	{
+		outEntry = (*it)->Find(normalizedPath);
+		if (!outEntry) { continue; }
+
+		// パックファイルを作った後にディスクのファイルが編集された
+		std::error_code ec;
+		auto diskTime = std::filesystem::last_write_time(std::string(path), ec);
+		if (!ec && diskTime > (*it)->GetWriteTime())
+		{
+			outEntry = nullptr;
+			return nullptr;
+		}
+
+		return it->get();
+	}
+	return nullptr;
+}
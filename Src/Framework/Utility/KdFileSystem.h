@@ -0,0 +1,93 @@
+﻿#pragma once
+
+//===========================================
+//
+// 仮想ファイルシステム
+//
+// ・マウントしたパックファイル (KdPackFile) から先に探し、無ければディスクのファイルを読む
+//   パックファイルが無い開発中は、今まで通りディスクのファイルがそのまま読まれる
+// ・後からマウントしたパックファイルほど優先する (パッチ用のパックファイルを後から重ねる)
+// ・ディスクにパックファイルより新しいファイルがあれば、そちらを優先する
+//   (パックファイルを作った後にエディタで編集したファイル・ホットリロードが無視されないように)
+// ・読み込みは複数のスレッドから同時に呼んでよい
+//
+//===========================================
+class KdFileSystem
+{
+public:
+
+	// パックファイルをマウント
+	bool Mount(const std::string& packPath);
+
+	// マウント解除 (パックファイルを作り直す時など)
+	void Unmount(const std::string& packPath);
+	void UnmountAll();
+
+	// ファイルの中身を全て読む
+	bool ReadFile(std::string_view path, std::vector<uint8_t>& out) const;
+	bool ReadFile(std::string_view path, std::string& out) const;
+
+	// パックファイル・ディスクのどちらかにあるか
+	bool Exists(std::string_view path) const;
+
+	// ファイルのサイズ (展開後)
+	bool GetFileSize(std::string_view path, uint64_t& outSize) const;
+
+	// パックファイルから読まれるか
+	bool IsPacked(std::string_view path) const;
+
+	// 更新日時 (パックファイルから読まれるものはパックファイルの日時)
+	// 変換済みファイルが元ファイルより新しいかを、どちらがパックファイルに入っていても同じ方法で比べるのに使う
+	bool GetWriteTime(std::string_view path, std::filesystem::file_time_type& outTime) const;
+
+	// 読み込みの進み具合の通知先
+	// ・設定したスレッドの ReadFile だけに効く (非同期読み込みのジョブが、自分の読んだバイト数を数えるのに使う)
+	// ・bytes … 前回の通知から読み進めたバイト数
+	//   ディスクのファイルは kReadChunkSize ごと、パックファイル内のファイルは (メモリマップからのコピーなので) 読み終えた時にまとめて通知する
+	using ReadProgressFunc = std::function<void(uint64_t bytes)>;
+
+	static constexpr size_t kReadChunkSize = 1024 * 1024;
+
+	// スコープの間だけ、このスレッドの通知先を設定する
+	class ScopedReadProgress
+	{
+	public:
+		explicit ScopedReadProgress(ReadProgressFunc func);
+		~ScopedReadProgress();
+
+	private:
+		ReadProgressFunc	m_prevFunc;
+
+		ScopedReadProgress(const ScopedReadProgress& src) = delete;
+		void operator=(const ScopedReadProgress& src) = delete;
+	};
+
+	// 読み込み回数
+	uint64_t GetPackedReadCount() const { return m_packedReadCount; }
+	uint64_t GetDiskReadCount() const { return m_diskReadCount; }
+
+private:
+
+	// path があるパックファイル (無ければ nullptr、m_mutex をロックして呼ぶこと)
+	// ・ディスクにパックファイルより新しい path があれば nullptr
+	const KdPackFile* FindPack(std::string_view path, const std::string& normalizedPath, const KdPackFile::Entry*& outEntry) const;
+
+	mutable std::shared_mutex	m_mutex;
+
+	// 後ろほど優先
+	std::vector<std::unique_ptr<KdPackFile>>	m_packs;
+
+	mutable std::atomic<uint64_t>	m_packedReadCount = 0;
+	mutable std::atomic<uint64_t>	m_diskReadCount = 0;
+
+public:
+	static KdFileSystem& Instance()
+	{
+		static KdFileSystem instance;
+		return instance;
+	}
+
+private:
+	KdFileSystem() {}
+	~KdFileSystem() {}
+};
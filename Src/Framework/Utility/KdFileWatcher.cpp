@@ -0,0 +1,215 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdFileWatcher.h"
+
+bool KdFileWatcher::Start(const std::string& dir, bool forcePolling, float pollIntervalSec)
+{
+	Stop();
+
+	std::error_code ec;
+	if (!std::filesystem::is_directory(dir, ec)) { return false; }
+
+	m_dir = std::filesystem::path(dir).lexically_normal().generic_string();
+	while (!m_dir.empty() && m_dir.back() == '/') { m_dir.pop_back(); }
+
+	m_pollIntervalSec = pollIntervalSec;
+	m_isStopRequested = false;
+	m_isPolling = forcePolling;
+
+	m_hStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (!m_hStopEvent) { return false; }
+
+	if (!forcePolling)
+	{
+		m_hDir = CreateFileW(sjis_to_wide(m_dir).c_str(), FILE_LIST_DIRECTORY,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+		// 開けなければポーリングに切り替える
+		if (m_hDir == INVALID_HANDLE_VALUE) { m_isPolling = true; }
+	}
+
+	if (m_isPolling)
+	{
+		m_thread = std::thread([this]()
+			{
+				// 現在の状態を基準にする
+				Scan(false);
+				PollThreadProc();
+			});
+	}
+	else
+	{
+		m_thread = std::thread(&KdFileWatcher::NotifyThreadProc, this);
+	}
+
+	return true;
+}
+
+void KdFileWatcher::Stop()
+{
+	if (m_thread.joinable())
+	{
+		m_isStopRequested = true;
+		SetEvent(m_hStopEvent);
+		m_thread.join();
+	}
+
+	if (m_hDir != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hDir);
+		m_hDir = INVALID_HANDLE_VALUE;
+	}
+
+	if (m_hStopEvent)
+	{
+		CloseHandle(m_hStopEvent);
+		m_hStopEvent = nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_changes.clear();
+	m_snapshot.clear();
+}
+
+void KdFileWatcher::PopChanges(std::vector<std::string>& out)
+{
+	auto now = std::chrono::steady_clock::now();
+	auto settleTime = std::chrono::duration<float>(m_settleTimeSec);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto it = m_changes.begin(); it != m_changes.end();)
+	{
+		// まだ書き込み中かもしれない
+		if (now - it->second < settleTime)
+		{
+			++it;
+			continue;
+		}
+
+		out.push_back(m_dir + "/" + it->first);
+		it = m_changes.erase(it);
+	}
+}
+
+void KdFileWatcher::NotifyThreadProc()
+{
+	// FILE_NOTIFY_INFORMATION は DWORD 境界に並ぶ
+	std::vector<DWORD> buffer(16 * 1024);
+	const DWORD bufferSize = (DWORD)(buffer.size() * sizeof(DWORD));
+
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+	const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+	// 通知が溢れた時に比べるための基準
+	Scan(false);
+
+	while (!m_isStopRequested)
+	{
+		ResetEvent(overlapped.hEvent);
+
+		if (!ReadDirectoryChangesW(m_hDir, buffer.data(), bufferSize, TRUE, filter, nullptr, &overlapped, nullptr))
+		{
+			// 監視できなくなったらポーリングで続ける
+			m_isPolling = true;
+			break;
+		}
+
+		HANDLE handles[] = { overlapped.hEvent, m_hStopEvent };
+		DWORD result = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+		if (result != WAIT_OBJECT_0)
+		{
+			CancelIoEx(m_hDir, &overlapped);
+			DWORD dummy = 0;
+			GetOverlappedResult(m_hDir, &overlapped, &dummy, TRUE);
+			break;
+		}
+
+		DWORD bytes = 0;
+		if (!GetOverlappedResult(m_hDir, &overlapped, &bytes, FALSE)) { continue; }
+
+		// 変更が多すぎてバッファに収まらなかった
+		// どのファイルか分からないので、ポーリングと同じ方法で調べ直す
+		if (bytes == 0)
+		{
+			Scan(true);
+			continue;
+		}
+
+		const uint8_t* pCurrent = (const uint8_t*)buffer.data();
+		while (true)
+		{
+			const FILE_NOTIFY_INFORMATION* pInfo = (const FILE_NOTIFY_INFORMATION*)pCurrent;
+
+			if (pInfo->Action != FILE_ACTION_REMOVED && pInfo->Action != FILE_ACTION_RENAMED_OLD_NAME)
+			{
+				std::wstring name(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR));
+				AddChange(wide_to_sjis(name));
+			}
+
+			if (pInfo->NextEntryOffset == 0) { break; }
+			pCurrent += pInfo->NextEntryOffset;
+		}
+	}
+
+	CloseHandle(overlapped.hEvent);
+
+	if (m_isPolling && !m_isStopRequested)
+	{
+		Scan(false);
+		PollThreadProc();
+	}
+}
+
+void KdFileWatcher::PollThreadProc()
+{
+	DWORD intervalMs = (DWORD)(m_pollIntervalSec * 1000.0f);
+
+	while (WaitForSingleObject(m_hStopEvent, intervalMs) == WAIT_TIMEOUT)
+	{
+		Scan(true);
+	}
+}
+
+void KdFileWatcher::Scan(bool recordChanges)
+{
+	std::unordered_map<std::string, std::filesystem::file_time_type> snapshot;
+
+	std::error_code ec;
+	for (auto it = std::filesystem::recursive_directory_iterator(m_dir, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+	{
+		std::error_code fileEc;
+		if (!it->is_regular_file(fileEc)) { continue; }
+
+		std::string relative = it->path().lexically_relative(m_dir).generic_string();
+		if (relative.empty()) { continue; }
+
+		snapshot[relative] = it->last_write_time(fileEc);
+	}
+
+	if (recordChanges)
+	{
+		for (const auto& [path, time] : snapshot)
+		{
+			auto prev = m_snapshot.find(path);
+			if (prev == m_snapshot.end() || prev->second != time)
+			{
+				AddChange(path);
+			}
+		}
+	}
+
+	m_snapshot = std::move(snapshot);
+}
+
+void KdFileWatcher::AddChange(const std::string& relativePath)
+{
+	std::string path = relativePath;
+	std::replace(path.begin(), path.end(), '\\', '/');
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_changes[path] = std::chrono::steady_clock::now();
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+//===========================================
+//
+// フォルダ内のファイル変更の監視
+//
+// ・ReadDirectoryChangesW でサブフォルダも含めて監視する
+//   使えない場合 (ネットワークドライブなど) は一定間隔で更新日時を調べる方式に切り替える
+// ・エディタは1回の保存で何度も書き込むことがあるので、
+//   最後の変更から一定時間たったものだけを取り出す
+// ・監視は専用のスレッドで行うので、PopChanges は毎フレーム呼んでも重くない
+//
+//===========================================
+class KdFileWatcher
+{
+public:
+	KdFileWatcher() {}
+	~KdFileWatcher() { Stop(); }
+
+	// 監視開始
+	// dir				… 監視するフォルダ
+	// forcePolling		… true なら最初から更新日時を調べる方式にする
+	// pollIntervalSec	… 更新日時を調べる間隔 (秒)
+	bool Start(const std::string& dir, bool forcePolling = false, float pollIntervalSec = 1.0f);
+
+	// 監視終了
+	void Stop();
+
+	bool IsWatching() const { return m_thread.joinable(); }
+	bool IsPolling() const { return m_isPolling; }
+
+	// 変更されたファイルを取り出す ("<dir>/<相対パス>"、'/' 区切り)
+	void PopChanges(std::vector<std::string>& out);
+
+	// この時間 (秒) 変更が無ければ書き込みが終わったとみなす
+	void SetSettleTime(float sec) { m_settleTimeSec = sec; }
+
+private:
+
+	void NotifyThreadProc();
+	void PollThreadProc();
+
+	// 更新日時の一覧を取り、前回と違うものを変更として記録する
+	void Scan(bool recordChanges);
+
+	// 変更を記録
+	void AddChange(const std::string& relativePath);
+
+	std::string			m_dir;
+	std::thread			m_thread;
+	std::atomic<bool>	m_isStopRequested = false;
+	std::atomic<bool>	m_isPolling = false;
+	float				m_pollIntervalSec = 1.0f;
+	float				m_settleTimeSec = 0.3f;
+
+	HANDLE				m_hDir = INVALID_HANDLE_VALUE;
+	HANDLE				m_hStopEvent = nullptr;
+
+	// 変更されたファイル → 最後に変更を検知した時刻
+	std::mutex			m_mutex;
+	std::unordered_map<std::string, std::chrono::steady_clock::time_point>	m_changes;
+
+	// ポーリング用 (ファイル → 更新日時)
+	std::unordered_map<std::string, std::filesystem::file_time_type>	m_snapshot;
+
+	// コピー禁止
+	KdFileWatcher(const KdFileWatcher& src) = delete;
+	void operator=(const KdFileWatcher& src) = delete;
+};
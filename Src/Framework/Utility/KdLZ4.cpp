@@ -0,0 +1,191 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdLZ4.h"
+
+namespace
+{
+	constexpr size_t kMinMatch = 4;
+
+	// 最後の 5 バイトは必ずリテラル、最後の一致は終端の 12 バイト手前までに始まる (形式の決まり)
+	constexpr size_t kLastLiterals = 5;
+	constexpr size_t kMatchFindLimit = 12;
+
+	constexpr size_t kMaxOffset = 65535;
+
+	constexpr int kHashBits = 12;
+	constexpr uint32_t kEmpty = 0xFFFFFFFF;
+
+	uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - kHashBits);
+	}
+
+	// 15 以上の長さは 255 の並び + 残りで表す
+	uint8_t* WriteLength(uint8_t* pDst, size_t length)
+	{
+		while (length >= 255)
+		{
+			*pDst++ = 255;
+			length -= 255;
+		}
+		*pDst++ = (uint8_t)length;
+		return pDst;
+	}
+
+	bool ReadLength(const uint8_t*& pSrc, const uint8_t* pSrcEnd, size_t& length)
+	{
+		uint8_t value;
+		do
+		{
+			if (pSrc >= pSrcEnd) { return false; }
+			value = *pSrc++;
+			length += value;
+		} while (value == 255);
+		return true;
+	}
+}
+
+size_t KdLZ4::CompressBound(size_t srcSize)
+{
+	return srcSize + srcSize / 255 + 16;
+}
+
+size_t KdLZ4::Compress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstCapacity)
+{
+	if (dstCapacity < CompressBound(srcSize)) { return 0; }
+
+	uint8_t* pOut = pDst;
+
+	// 一致と一緒に書き出す (literalLength 分のリテラル + 一致)
+	auto emit = [&pOut](const uint8_t* pLiteral, size_t literalLength, size_t offset, size_t matchLength)
+		{
+			uint8_t* pToken = pOut++;
+
+			size_t matchCode = matchLength - kMinMatch;
+			*pToken = (uint8_t)((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+
+			if (literalLength >= 15) { pOut = WriteLength(pOut, literalLength - 15); }
+			memcpy(pOut, pLiteral, literalLength);
+			pOut += literalLength;
+
+			*pOut++ = (uint8_t)(offset & 0xFF);
+			*pOut++ = (uint8_t)(offset >> 8);
+
+			if (matchCode >= 15) { pOut = WriteLength(pOut, matchCode - 15); }
+		};
+
+	size_t anchor = 0;
+
+	if (srcSize > kMatchFindLimit)
+	{
+		// 4 バイト列のハッシュ → 最後に見つかった位置
+		std::vector<uint32_t> table((size_t)1 << kHashBits, kEmpty);
+
+		const size_t matchStartLimit = srcSize - kMatchFindLimit;
+		const size_t matchEndLimit = srcSize - kLastLiterals;
+
+		size_t pos = 0;
+		while (pos < matchStartLimit)
+		{
+			uint32_t sequence = Read32(pSrc + pos);
+			uint32_t& slot = table[Hash(sequence)];
+			size_t ref = slot;
+			slot = (uint32_t)pos;
+
+			if (ref == kEmpty || pos - ref > kMaxOffset || Read32(pSrc + ref) != sequence)
+			{
+				// 一致しない所が続くほど飛ばして探す (圧縮できないデータで遅くならないように)
+				pos += 1 + ((pos - anchor) >> 6);
+				continue;
+			}
+
+			// 前後に伸ばす
+			size_t matchLength = kMinMatch;
+			while (pos + matchLength < matchEndLimit && pSrc[pos + matchLength] == pSrc[ref + matchLength]) { ++matchLength; }
+
+			while (pos > anchor && ref > 0 && pSrc[pos - 1] == pSrc[ref - 1])
+			{
+				--pos;
+				--ref;
+				++matchLength;
+			}
+
+			emit(pSrc + anchor, pos - anchor, pos - ref, matchLength);
+
+			pos += matchLength;
+			anchor = pos;
+
+			// 一致の終わり付近も登録しておくと次の一致が見つかりやすい
+			if (pos - 2 < matchStartLimit) { table[Hash(Read32(pSrc + pos - 2))] = (uint32_t)(pos - 2); }
+		}
+	}
+
+	// 残りは全てリテラル
+	size_t literalLength = srcSize - anchor;
+	*pOut++ = (uint8_t)(std::min<size_t>(literalLength, 15) << 4);
+	if (literalLength >= 15) { pOut = WriteLength(pOut, literalLength - 15); }
+	memcpy(pOut, pSrc + anchor, literalLength);
+	pOut += literalLength;
+
+	return (size_t)(pOut - pDst);
+}
+
+bool KdLZ4::Decompress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize)
+{
+	const uint8_t* pIn = pSrc;
+	const uint8_t* pInEnd = pSrc + srcSize;
+	uint8_t* pOut = pDst;
+	uint8_t* pOutEnd = pDst + dstSize;
+
+	while (true)
+	{
+		if (pIn >= pInEnd) { return false; }
+		uint8_t token = *pIn++;
+
+		// リテラル
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(pIn, pInEnd, literalLength)) { return false; }
+
+		if (literalLength > (size_t)(pInEnd - pIn) || literalLength > (size_t)(pOutEnd - pOut)) { return false; }
+		memcpy(pOut, pIn, literalLength);
+		pIn += literalLength;
+		pOut += literalLength;
+
+		// 最後のシーケンスはリテラルだけ
+		if (pIn == pInEnd) { break; }
+
+		// 一致
+		if (pInEnd - pIn < 2) { return false; }
+		size_t offset = pIn[0] | ((size_t)pIn[1] << 8);
+		pIn += 2;
+
+		if (offset == 0 || offset > (size_t)(pOut - pDst)) { return false; }
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(pIn, pInEnd, matchLength)) { return false; }
+		matchLength += kMinMatch;
+
+		if (matchLength > (size_t)(pOutEnd - pOut)) { return false; }
+
+		const uint8_t* pMatch = pOut - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(pOut, pMatch, matchLength);
+			pOut += matchLength;
+		}
+		else
+		{
+			// 重なっている (同じパターンの繰り返し) ので前から1バイトずつ
+			for (size_t i = 0; i < matchLength; ++i) { *pOut++ = pMatch[i]; }
+		}
+	}
+
+	return pOut == pOutEnd;
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+
+//===========================================
+//
+// LZ4 ブロック形式の圧縮・展開
+//
+// ・本家 LZ4 の「ブロック形式」と互換 (フレーム形式のヘッダ・チェックサムは無い)
+// ・圧縮率より展開速度を優先した形式なので、読み込み時の展開はほぼ読み込み速度で済む
+// ・展開は壊れたデータを渡しても範囲外を読み書きしない
+//
+//===========================================
+namespace KdLZ4
+{
+	// srcSize バイトを圧縮した時の最大サイズ
+	size_t CompressBound(size_t srcSize);
+
+	// 圧縮
+	// ・dstCapacity は CompressBound(srcSize) 以上必要
+	// 戻り値 … 圧縮後のサイズ (失敗したら 0)
+	size_t Compress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstCapacity);
+
+	// 展開
+	// ・dstSize には展開後のサイズを正確に渡すこと
+	// 戻り値 … ちょうど dstSize バイトに展開できたら true
+	bool Decompress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize);
+}
@@ -0,0 +1,61 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdMappedFile.h"
+
+bool KdMappedFile::Open(std::string_view path)
+{
+	Close();
+
+	std::wstring wPath = sjis_to_wide(path.data());
+	m_hFile = CreateFileW(wPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE) { return false; }
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(m_hFile, &fileSize) || fileSize.QuadPart == 0)
+	{
+		// 空のファイルはマップできない
+		Close();
+		return false;
+	}
+
+	m_hMapping = CreateFileMappingW(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_hMapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = (const uint8_t*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!m_pData)
+	{
+		Close();
+		return false;
+	}
+
+	m_size = (size_t)fileSize.QuadPart;
+
+	return true;
+}
+
+void KdMappedFile::Close()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+		m_pData = nullptr;
+	}
+
+	if (m_hMapping)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+
+	m_size = 0;
+}
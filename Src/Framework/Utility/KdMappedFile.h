@@ -0,0 +1,37 @@
+﻿#pragma once
+
+//===========================================
+//
+// 読み取り専用のメモリマップドファイル
+//
+// ・ファイルの中身をコピーせずにポインタとして参照できる
+// ・Close() またはデストラクタまでポインタは有効
+//
+//===========================================
+class KdMappedFile
+{
+public:
+	KdMappedFile() {}
+	~KdMappedFile() { Close(); }
+
+	// ファイルを開いてマップする
+	bool Open(std::string_view path);
+
+	// マップを解除して閉じる
+	void Close();
+
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	const uint8_t* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	HANDLE			m_hFile		= INVALID_HANDLE_VALUE;
+	HANDLE			m_hMapping	= nullptr;
+	const uint8_t*	m_pData		= nullptr;
+	size_t			m_size		= 0;
+
+	// コピー禁止
+	KdMappedFile(const KdMappedFile& src) = delete;
+	void operator=(const KdMappedFile& src) = delete;
+};
@@ -0,0 +1,407 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdPackFile.h"
+#include "KdLZ4.h"
+
+namespace
+{
+	// 各ファイルのデータの先頭をそろえる
+	constexpr uint64_t kDataAlignment = 16;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool ReadAll(const std::filesystem::path& path, std::vector<uint8_t>& out)
+	{
+		std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+		if (!ifs) { return false; }
+
+		std::streamsize size = ifs.tellg();
+		if (size < 0) { return false; }
+
+		out.resize((size_t)size);
+		ifs.seekg(0);
+		return size == 0 || (bool)ifs.read((char*)out.data(), size);
+	}
+}
+
+bool KdPackFile::Open(const std::string& path)
+{
+	Close();
+
+	if (!m_file.Open(path)) { return false; }
+
+	const uint8_t* pData = m_file.GetData();
+	size_t fileSize = m_file.GetSize();
+
+	auto fail = [this, &path](const char* reason)
+		{
+			OutputDebugStringA(("KdPackFile : " + path + " : " + reason + "\n").c_str());
+			Close();
+			return false;
+		};
+
+	if (fileSize < sizeof(Header)) { return fail("too small"); }
+
+	const Header* pHeader = (const Header*)pData;
+	if (memcmp(pHeader->m_magic, kMagic, sizeof(kMagic)) != 0) { return fail("not a pack file"); }
+	if (pHeader->m_version != kVersion) { return fail("version mismatch"); }
+	if (pHeader->m_blockSize == 0) { return fail("broken header"); }
+
+	uint64_t entriesSize = (uint64_t)pHeader->m_entryCount * sizeof(Entry);
+	if (pHeader->m_entriesOffset > fileSize || entriesSize > fileSize - pHeader->m_entriesOffset) { return fail("broken index"); }
+	if (pHeader->m_stringsOffset > fileSize || pHeader->m_stringsSize > fileSize - pHeader->m_stringsOffset) { return fail("broken index"); }
+
+	m_pHeader = pHeader;
+	m_pEntries = (const Entry*)(pData + pHeader->m_entriesOffset);
+	m_pStrings = (const char*)(pData + pHeader->m_stringsOffset);
+	m_path = path;
+
+	std::error_code ec;
+	m_writeTime = std::filesystem::last_write_time(path, ec);
+
+	return true;
+}
+
+void KdPackFile::Close()
+{
+	m_file.Close();
+	m_path.clear();
+
+	m_pHeader = nullptr;
+	m_pEntries = nullptr;
+	m_pStrings = nullptr;
+}
+
+const KdPackFile::Entry* KdPackFile::Find(std::string_view normalizedPath) const
+{
+	if (!m_pHeader) { return nullptr; }
+
+	uint64_t hash = HashPath(normalizedPath);
+
+	const Entry* pBegin = m_pEntries;
+	const Entry* pEnd = m_pEntries + m_pHeader->m_entryCount;
+	const Entry* pEntry = std::lower_bound(pBegin, pEnd, hash, [](const Entry& entry, uint64_t value) { return entry.m_pathHash < value; });
+
+	// ハッシュが同じでもパスが違うことはあり得るので、文字列でも確認する
+	for (; pEntry != pEnd && pEntry->m_pathHash == hash; ++pEntry)
+	{
+		if (GetEntryPath(*pEntry) == normalizedPath) { return pEntry; }
+	}
+
+	return nullptr;
+}
+
+bool KdPackFile::Read(const Entry& entry, std::vector<uint8_t>& out) const
+{
+	if (!m_pHeader) { return false; }
+
+	size_t fileSize = m_file.GetSize();
+	if (entry.m_dataOffset > fileSize || entry.m_storedSize > fileSize - entry.m_dataOffset) { return false; }
+
+	const uint8_t* pStored = m_file.GetData() + entry.m_dataOffset;
+
+	out.resize((size_t)entry.m_size);
+
+	// 圧縮していない
+	if (entry.m_blockCount == 0)
+	{
+		if (entry.m_storedSize != entry.m_size) { return false; }
+		if (entry.m_size > 0) { memcpy(out.data(), pStored, (size_t)entry.m_size); }
+		return true;
+	}
+
+	const uint32_t blockSize = m_pHeader->m_blockSize;
+	if (entry.m_blockCount != (entry.m_size + blockSize - 1) / blockSize) { return false; }
+
+	// サイズ表から各ブロックの位置を求める
+	uint64_t tableSize = (uint64_t)entry.m_blockCount * sizeof(uint32_t);
+	if (tableSize > entry.m_storedSize) { return false; }
+
+	const uint32_t* pBlockSizes = (const uint32_t*)pStored;
+
+	std::vector<uint64_t> blockOffsets(entry.m_blockCount);
+	uint64_t offset = tableSize;
+	for (uint32_t i = 0; i < entry.m_blockCount; ++i)
+	{
+		blockOffsets[i] = offset;
+		offset += pBlockSizes[i] & ~kBlockStoredBit;
+	}
+	if (offset > entry.m_storedSize) { return false; }
+
+	std::atomic<bool> isBroken = false;
+
+	KdParallel::Instance().For(entry.m_blockCount, [&](size_t i)
+		{
+			size_t dstOffset = i * blockSize;
+			size_t dstSize = (size_t)std::min<uint64_t>(blockSize, entry.m_size - dstOffset);
+
+			uint32_t storedSize = pBlockSizes[i] & ~kBlockStoredBit;
+			const uint8_t* pSrc = pStored + blockOffsets[i];
+
+			if (pBlockSizes[i] & kBlockStoredBit)
+			{
+				if (storedSize != dstSize) { isBroken = true; return; }
+				memcpy(out.data() + dstOffset, pSrc, dstSize);
+			}
+			else if (!KdLZ4::Decompress(pSrc, storedSize, out.data() + dstOffset, dstSize))
+			{
+				isBroken = true;
+			}
+		});
+
+	if (isBroken)
+	{
+		OutputDebugStringA(("KdPackFile : broken data : " + std::string(GetEntryPath(entry)) + "\n").c_str());
+		out.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool KdPackFile::Build(const std::string& srcDir, const std::string& outPath, bool compress)
+{
+	// 対象のファイル一覧
+	struct Source
+	{
+		std::filesystem::path	m_filePath;
+		std::string				m_path;		// 正規化したパス
+		uint64_t				m_hash = 0;
+	};
+	std::vector<Source> sources;
+
+	std::error_code ec;
+	std::filesystem::path outFullPath = std::filesystem::absolute(outPath, ec);
+
+	for (auto it = std::filesystem::recursive_directory_iterator(srcDir, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+	{
+		std::error_code fileEc;
+		if (!it->is_regular_file(fileEc)) { continue; }
+
+		// 自分自身 (srcDir の中に作る場合)
+		if (std::filesystem::equivalent(it->path(), outFullPath, fileEc)) { continue; }
+
+		Source source;
+		source.m_filePath = it->path();
+		source.m_path = NormalizePath(srcDir + "/" + it->path().lexically_relative(srcDir).string());
+		source.m_hash = HashPath(source.m_path);
+		sources.push_back(std::move(source));
+	}
+	if (ec)
+	{
+		OutputDebugStringA(("KdPackFile::Build : cannot read " + srcDir + "\n").c_str());
+		return false;
+	}
+
+	std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b)
+		{
+			return a.m_hash != b.m_hash ? a.m_hash < b.m_hash : a.m_path < b.m_path;
+		});
+
+	std::string tmpPath = outPath + ".tmp";
+
+	{
+		std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!ofs)
+		{
+			OutputDebugStringA(("KdPackFile::Build : cannot write " + tmpPath + "\n").c_str());
+			return false;
+		}
+
+		// ヘッダは最後に書き直す
+		Header header;
+		ofs.write((const char*)&header, sizeof(header));
+
+		std::vector<Entry> entries(sources.size());
+		std::string strings;
+
+		uint64_t offset = sizeof(Header);
+
+		auto writePadding = [&ofs, &offset](uint64_t alignment)
+			{
+				static const char zeros[kDataAlignment] = {};
+				uint64_t aligned = AlignUp(offset, alignment);
+				ofs.write(zeros, (std::streamsize)(aligned - offset));
+				offset = aligned;
+			};
+
+		std::vector<uint8_t> data;
+		for (size_t i = 0; i < sources.size(); ++i)
+		{
+			const Source& source = sources[i];
+			Entry& entry = entries[i];
+
+			if (!ReadAll(source.m_filePath, data))
+			{
+				OutputDebugStringA(("KdPackFile::Build : cannot read " + source.m_filePath.string() + "\n").c_str());
+				ofs.close();
+				std::filesystem::remove(tmpPath, ec);
+				return false;
+			}
+
+			writePadding(kDataAlignment);
+
+			entry.m_pathHash = source.m_hash;
+			entry.m_pathOffset = (uint32_t)strings.size();
+			entry.m_pathLength = (uint32_t)source.m_path.size();
+			entry.m_dataOffset = offset;
+			entry.m_size = data.size();
+			strings += source.m_path;
+
+			// ブロックごとに圧縮 (小さくならなければそのまま)
+			uint32_t blockCount = (uint32_t)((data.size() + kBlockSize - 1) / kBlockSize);
+			std::vector<std::vector<uint8_t>> blocks(compress ? blockCount : 0);
+			std::vector<uint8_t> isStored(blocks.size(), 0);
+
+			KdParallel::Instance().For(blocks.size(), [&](size_t block)
+				{
+					size_t srcOffset = block * kBlockSize;
+					size_t srcSize = std::min<size_t>(kBlockSize, data.size() - srcOffset);
+
+					std::vector<uint8_t>& dst = blocks[block];
+					dst.resize(KdLZ4::CompressBound(srcSize));
+					size_t compressedSize = KdLZ4::Compress(data.data() + srcOffset, srcSize, dst.data(), dst.size());
+
+					if (compressedSize == 0 || compressedSize >= srcSize)
+					{
+						dst.assign(data.begin() + srcOffset, data.begin() + srcOffset + srcSize);
+						isStored[block] = 1;
+					}
+					else
+					{
+						dst.resize(compressedSize);
+					}
+				});
+
+			uint64_t compressedSize = (uint64_t)blocks.size() * sizeof(uint32_t);
+			for (const auto& block : blocks) { compressedSize += block.size(); }
+
+			// ファイル全体で小さくならなければ圧縮しない
+			if (blocks.empty() || compressedSize >= data.size())
+			{
+				entry.m_storedSize = data.size();
+				entry.m_blockCount = 0;
+				ofs.write((const char*)data.data(), (std::streamsize)data.size());
+			}
+			else
+			{
+				entry.m_storedSize = compressedSize;
+				entry.m_blockCount = blockCount;
+
+				for (uint32_t block = 0; block < blockCount; ++block)
+				{
+					uint32_t blockSize = (uint32_t)blocks[block].size();
+					if (isStored[block]) { blockSize |= kBlockStoredBit; }
+					ofs.write((const char*)&blockSize, sizeof(blockSize));
+				}
+				for (const auto& block : blocks)
+				{
+					ofs.write((const char*)block.data(), (std::streamsize)block.size());
+				}
+			}
+
+			offset += entry.m_storedSize;
+		}
+
+		// 索引
+		writePadding(kDataAlignment);
+		header.m_entriesOffset = offset;
+		ofs.write((const char*)entries.data(), (std::streamsize)(entries.size() * sizeof(Entry)));
+		offset += entries.size() * sizeof(Entry);
+
+		header.m_stringsOffset = offset;
+		header.m_stringsSize = strings.size();
+		ofs.write(strings.data(), (std::streamsize)strings.size());
+
+		memcpy(header.m_magic, kMagic, sizeof(kMagic));
+		header.m_version = kVersion;
+		header.m_blockSize = kBlockSize;
+		header.m_entryCount = (uint32_t)entries.size();
+
+		ofs.seekp(0);
+		ofs.write((const char*)&header, sizeof(header));
+
+		if (!ofs)
+		{
+			OutputDebugStringA(("KdPackFile::Build : write error " + tmpPath + "\n").c_str());
+			ofs.close();
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tmpPath, outPath, ec);
+	if (ec)
+	{
+		// 開いている (マウント中の) パックファイルは置き換えられない
+		OutputDebugStringA(("KdPackFile::Build : cannot replace " + outPath + "\n").c_str());
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+
+	return true;
+}
+
+std::string KdPackFile::NormalizePath(std::string_view path)
+{
+	// 区切りごとに分けて "." と ".." を解決する
+	std::vector<std::string_view> parts;
+	size_t begin = 0;
+	while (begin <= path.size())
+	{
+		size_t end = path.find_first_of("/\\", begin);
+		if (end == std::string_view::npos) { end = path.size(); }
+
+		std::string_view part = path.substr(begin, end - begin);
+		if (part.empty() || part == ".")
+		{
+		}
+		else if (part == ".." && !parts.empty() && parts.back() != "..")
+		{
+			parts.pop_back();
+		}
+		else
+		{
+			parts.push_back(part);
+		}
+
+		begin = end + 1;
+	}
+
+	std::string result;
+	result.reserve(path.size());
+	for (size_t i = 0; i < parts.size(); ++i)
+	{
+		if (i > 0) { result += '/'; }
+		result += parts[i];
+	}
+
+	// Windows のパスは大文字小文字を区別しない
+	for (char& c : result)
+	{
+		if (c >= 'A' && c <= 'Z') { c = (char)(c - 'A' + 'a'); }
+	}
+
+	return result;
+}
+
+uint64_t KdPackFile::HashPath(std::string_view normalizedPath)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : normalizedPath)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string_view KdPackFile::GetEntryPath(const Entry& entry) const
+{
+	if ((uint64_t)entry.m_pathOffset + entry.m_pathLength > m_pHeader->m_stringsSize) { return std::string_view(); }
+
+	return std::string_view(m_pStrings + entry.m_pathOffset, entry.m_pathLength);
+}
@@ -0,0 +1,105 @@
+﻿#pragma once
+
+//===========================================
+//
+// パックファイル (.kdpak)
+//
+// ・フォルダ内のファイルを1つにまとめたもの。小さいファイルを大量に開く時間が無くなる
+// ・索引はパスのハッシュ順に並んでいるので、二分探索で見つかる
+// ・ファイルは 64KB ごとのブロックに分けて LZ4 で圧縮する
+//   ブロックごとに独立しているので、並列で展開できる
+//   圧縮しても小さくならないブロック (画像・音声など圧縮済みのもの) はそのまま入れる
+// ・パックファイルはメモリマップで開くので、圧縮していないファイルはコピー1回で読める
+//
+// [ファイルの構成]
+//   Header
+//   各ファイルのデータ (圧縮したものは 先頭にブロックのサイズ表 uint32_t[m_blockCount] + ブロック)
+//   Entry[m_entryCount] (パスのハッシュ順)
+//   パスの文字列 (正規化したパスを連結したもの)
+//
+//===========================================
+class KdPackFile
+{
+public:
+
+	static constexpr char		kMagic[4] = { 'K', 'D', 'P', 'K' };
+	static constexpr uint32_t	kVersion = 1;
+
+	// 圧縮の単位
+	static constexpr uint32_t	kBlockSize = 64 * 1024;
+
+	// ブロックのサイズ表で、このビットが立っていれば圧縮していない
+	static constexpr uint32_t	kBlockStoredBit = 0x80000000;
+
+	struct Header
+	{
+		char		m_magic[4] = {};
+		uint32_t	m_version = 0;
+		uint32_t	m_blockSize = 0;
+		uint32_t	m_entryCount = 0;
+		uint64_t	m_entriesOffset = 0;
+		uint64_t	m_stringsOffset = 0;
+		uint64_t	m_stringsSize = 0;
+	};
+
+	struct Entry
+	{
+		uint64_t	m_pathHash = 0;
+		uint32_t	m_pathOffset = 0;		// 文字列の中の位置
+		uint32_t	m_pathLength = 0;
+		uint64_t	m_dataOffset = 0;
+		uint64_t	m_size = 0;				// 展開後のサイズ
+		uint64_t	m_storedSize = 0;		// パック内のサイズ
+		uint32_t	m_blockCount = 0;		// 0 なら圧縮していない
+		uint32_t	m_reserved = 0;
+	};
+
+	KdPackFile() {}
+	~KdPackFile() { Close(); }
+
+	// 開く (ヘッダと索引の確認まで)
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return m_pHeader != nullptr; }
+
+	const std::string& GetPath() const { return m_path; }
+
+	// 開いた時のパックファイルの更新日時
+	const std::filesystem::file_time_type& GetWriteTime() const { return m_writeTime; }
+	uint32_t GetEntryCount() const { return m_pHeader ? m_pHeader->m_entryCount : 0; }
+
+	// 検索 (path は NormalizePath したもの)
+	const Entry* Find(std::string_view normalizedPath) const;
+
+	// ファイルの中身を全て読む
+	// ・圧縮したブロックは KdParallel で並列に展開する
+	bool Read(const Entry& entry, std::vector<uint8_t>& out) const;
+
+	// フォルダ内の全ファイルからパックファイルを作る
+	// ・パスは「srcDir + フォルダ内の相対パス」で登録するので、srcDir はゲーム中で使うパスの書き方で渡す ("Asset" など)
+	// ・一時ファイルに書いてから置き換えるので、失敗しても元のパックファイルは壊れない
+	static bool Build(const std::string& srcDir, const std::string& outPath, bool compress = true);
+
+	// パスの正規化 ('/' 区切り・小文字・"./" や "../" を解決)
+	static std::string NormalizePath(std::string_view path);
+
+	// FNV-1a (64bit)
+	static uint64_t HashPath(std::string_view normalizedPath);
+
+private:
+
+	std::string_view GetEntryPath(const Entry& entry) const;
+
+	KdMappedFile	m_file;
+	std::string		m_path;
+	std::filesystem::file_time_type	m_writeTime;
+
+	const Header*	m_pHeader = nullptr;
+	const Entry*	m_pEntries = nullptr;
+	const char*		m_pStrings = nullptr;
+
+	// コピー禁止
+	KdPackFile(const KdPackFile& src) = delete;
+	void operator=(const KdPackFile& src) = delete;
+};
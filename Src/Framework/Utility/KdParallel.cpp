@@ -0,0 +1,102 @@
+﻿#include "Framework/KdFramework.h"
+
+#include "KdParallel.h"
+
+namespace
+{
+	// For 1回ぶんの共有データ
+	// ワーカー側の処理は For が戻った後に始まることもあるので shared_ptr で持つ
+	struct ParallelState
+	{
+		std::atomic<size_t>		m_next = 0;
+		std::atomic<size_t>		m_done = 0;
+		size_t					m_count = 0;
+
+		// m_next が m_count 未満の番号を取れた間だけ使う (その間は For が待っているので有効)
+		const std::function<void(size_t)>* m_pFunc = nullptr;
+
+		std::mutex				m_mutex;
+		std::condition_variable	m_condition;
+		std::exception_ptr		m_exception;
+
+		// 番号が無くなるまで取って実行する
+		void Run()
+		{
+			while (true)
+			{
+				size_t index = m_next.fetch_add(1);
+				if (index >= m_count) { return; }
+
+				try
+				{
+					(*m_pFunc)(index);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (!m_exception) { m_exception = std::current_exception(); }
+				}
+
+				if (m_done.fetch_add(1) + 1 == m_count)
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_condition.notify_all();
+				}
+			}
+		}
+	};
+}
+
+void KdParallel::SetDispatcher(Dispatcher dispatcher, int workerCount)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_dispatcher = std::move(dispatcher);
+	m_workerCount = m_dispatcher ? std::max(0, workerCount) : 0;
+}
+
+void KdParallel::For(size_t count, const std::function<void(size_t)>& func)
+{
+	if (count == 0) { return; }
+
+	Dispatcher dispatcher;
+	size_t helperCount = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		dispatcher = m_dispatcher;
+		helperCount = std::min((size_t)m_workerCount, count - 1);
+	}
+
+	// 1つだけ、または登録されていない
+	if (!dispatcher || helperCount == 0)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			func(i);
+		}
+		return;
+	}
+
+	auto spState = std::make_shared<ParallelState>();
+	spState->m_count = count;
+	spState->m_pFunc = &func;
+
+	for (size_t i = 0; i < helperCount; ++i)
+	{
+		dispatcher([spState]() { spState->Run(); });
+	}
+
+	// 自分も参加する
+	spState->Run();
+
+	// 他のスレッドが実行中のものを待つ
+	{
+		std::unique_lock<std::mutex> lock(spState->m_mutex);
+		spState->m_condition.wait(lock, [&spState]() { return spState->m_done == spState->m_count; });
+	}
+
+	if (spState->m_exception)
+	{
+		std::rethrow_exception(spState->m_exception);
+	}
+}
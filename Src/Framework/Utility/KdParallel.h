@@ -0,0 +1,46 @@
+﻿#pragma once
+
+//===========================================
+//
+// 並列 for
+//
+// ・Framework は Engine のスレッドプールを直接使えないので、
+//   「ワーカーに処理を1つ投げる関数」を外から登録してもらう
+// ・未登録なら呼び出したスレッドで順番に実行する
+// ・呼び出したスレッドも処理に参加し、残りの番号を取り合う形で進めるので、
+//   ワーカースレッドの中から呼んでも (ワーカーが全て埋まっていても) 止まらない
+//
+//===========================================
+class KdParallel
+{
+public:
+
+	// ワーカーに処理を1つ投げる関数
+	using Dispatcher = std::function<void(std::function<void()>)>;
+
+	// 登録 (workerCount … 同時に投げる最大数)
+	// 解除する時は nullptr を渡す
+	void SetDispatcher(Dispatcher dispatcher, int workerCount);
+
+	// func(0) 〜 func(count - 1) を実行し、全て終わるまで待つ
+	// ・実行順は決まっていないので、結果は番号ごとの場所に書き込むこと
+	// ・func の例外は呼び出し元で投げ直す
+	void For(size_t count, const std::function<void(size_t)>& func);
+
+private:
+
+	std::mutex	m_mutex;
+	Dispatcher	m_dispatcher;
+	int			m_workerCount = 0;
+
+public:
+	static KdParallel& Instance()
+	{
+		static KdParallel instance;
+		return instance;
+	}
+
+private:
+	KdParallel() {}
+	~KdParallel() {}
+};
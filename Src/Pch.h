@@ -27,6 +27,7 @@
 //
 //===============================================
 #include <map>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
@@ -34,6 +35,7 @@
 #include <vector>
 #include <stack>
 #include <list>
+#include <deque>
 #include <iterator>
 #include <queue>
 #include <algorithm>
@@ -46,6 +48,7 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <shared_mutex>
 #include <future>
 #include <condition_variable>
 #include <chrono>
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+//====================================================
+//
+// テスト用の最小限の仕組み
+//
+// ・KD_CHECK が失敗したら場所を表示して数える (その後も続ける)
+// ・main の最後で KdTestResult() を返すと、失敗が1つでもあれば 1 で終わる
+//
+//====================================================
+
+inline int& KdTestFailureCount()
+{
+	static int count = 0;
+	return count;
+}
+
+#define KD_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			++KdTestFailureCount(); \
+			printf("%s(%d): FAILED: %s\n", __FILE__, __LINE__, #cond); \
+		} \
+	} while (0)
+
+inline int KdTestResult(const char* name)
+{
+	if (KdTestFailureCount() == 0)
+	{
+		printf("%s: OK\n", name);
+		return 0;
+	}
+
+	printf("%s: %d check(s) failed\n", name, KdTestFailureCount());
+	return 1;
+}
@@ -0,0 +1,182 @@
+﻿#include "Framework/KdFramework.h"
+#include "KdTest.h"
+
+#include <algorithm>
+#include <tuple>
+
+//====================================================
+//
+// KdMeshOptimize のテスト
+//
+// ・面を1枚ずつ頂点を持たせた格子を、順番を崩してから最適化する
+// ・結合で頂点が減ること、キャッシュ効率が良くなること、
+//   サブセットごとの三角形 (座標と向き) が変わらないこと、同じ結果になることを確かめる
+//
+//====================================================
+
+namespace
+{
+	struct TestMesh
+	{
+		std::vector<KdMeshVertex>	m_vertices;
+		std::vector<KdMeshFace>		m_faces;
+		std::vector<KdMeshSubset>	m_subsets;
+	};
+
+	// size x size の格子を subsetCount 個のサブセットに分けて作る
+	// ・頂点は面ごとに別々に持たせる (結合の対象)
+	// ・面の順番は決まった手順で混ぜる
+	TestMesh MakeShuffledGrid(UINT size, UINT subsetCount)
+	{
+		TestMesh mesh;
+
+		auto addVertex = [&mesh](UINT x, UINT z)
+		{
+			KdMeshVertex vertex{};
+			vertex.Pos = Math::Vector3((float)x, 0.0f, (float)z);
+			vertex.UV = Math::Vector2((float)x, (float)z);
+			vertex.Normal = Math::Vector3(0.0f, 1.0f, 0.0f);
+			mesh.m_vertices.push_back(vertex);
+			return (UINT)mesh.m_vertices.size() - 1;
+		};
+
+		const UINT rowsPerSubset = (size + subsetCount - 1) / subsetCount;
+		for (UINT si = 0; si < subsetCount; ++si)
+		{
+			KdMeshSubset subset;
+			subset.MaterialNo = si;
+			subset.FaceStart = (UINT)mesh.m_faces.size();
+
+			std::vector<KdMeshFace> faces;
+			for (UINT z = si * rowsPerSubset; z < std::min(size, (si + 1) * rowsPerSubset); ++z)
+			{
+				for (UINT x = 0; x < size; ++x)
+				{
+					faces.push_back({ { addVertex(x, z), addVertex(x, z + 1), addVertex(x + 1, z) } });
+					faces.push_back({ { addVertex(x + 1, z), addVertex(x, z + 1), addVertex(x + 1, z + 1) } });
+				}
+			}
+
+			// 乱数を使わずに混ぜる
+			for (UINT fi = 0; fi < faces.size(); ++fi)
+			{
+				std::swap(faces[fi], faces[(fi * 7919u + 13u) % faces.size()]);
+			}
+
+			subset.FaceCount = (UINT)faces.size();
+			mesh.m_faces.insert(mesh.m_faces.end(), faces.begin(), faces.end());
+			mesh.m_subsets.push_back(subset);
+		}
+
+		return mesh;
+	}
+
+	// サブセットの三角形を、頂点の番号に関係なく比べられる形にする
+	// ・向きは残したまま、一番小さい頂点から始まるように回す
+	using Triangle = std::tuple<float, float, float, float, float, float, float, float, float>;
+
+	std::vector<Triangle> GetTriangles(const TestMesh& mesh, const KdMeshSubset& subset)
+	{
+		std::vector<Triangle> triangles;
+		for (UINT fi = subset.FaceStart; fi < subset.FaceStart + subset.FaceCount; ++fi)
+		{
+			std::array<std::tuple<float, float, float>, 3> corners;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				const Math::Vector3& pos = mesh.m_vertices[mesh.m_faces[fi].Idx[corner]].Pos;
+				corners[corner] = { pos.x, pos.y, pos.z };
+			}
+			std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+
+			triangles.push_back(std::tuple_cat(corners[0], corners[1], corners[2]));
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	void TestOptimize()
+	{
+		const UINT size = 32;
+		TestMesh original = MakeShuffledGrid(size, 3);
+
+		TestMesh mesh = original;
+		KdMeshOptimizeStats stats;
+		KD_CHECK(KdOptimizeMesh(mesh.m_vertices, mesh.m_faces, mesh.m_subsets, &stats));
+
+		// 結合で格子の点の数まで減る
+		KD_CHECK(stats.VertexCountBefore == original.m_vertices.size());
+		KD_CHECK(stats.VertexCountAfter == mesh.m_vertices.size());
+		KD_CHECK(mesh.m_vertices.size() <= (size + 1) * (size + 1) + size * 2);
+		KD_CHECK(mesh.m_vertices.size() < original.m_vertices.size());
+
+		// 面の数と、サブセットごとの三角形は変わらない
+		KD_CHECK(mesh.m_faces.size() == original.m_faces.size());
+		for (const KdMeshSubset& subset : mesh.m_subsets)
+		{
+			KD_CHECK(GetTriangles(mesh, subset) == GetTriangles(original, subset));
+		}
+
+		// 全ての頂点番号が範囲内で、使われない頂点が無い
+		std::vector<bool> used(mesh.m_vertices.size(), false);
+		for (const KdMeshFace& face : mesh.m_faces)
+		{
+			for (UINT vi : face.Idx)
+			{
+				KD_CHECK(vi < mesh.m_vertices.size());
+				if (vi < used.size()) { used[vi] = true; }
+			}
+		}
+		KD_CHECK(std::find(used.begin(), used.end(), false) == used.end());
+
+		// キャッシュ効率は良くなる (悪くなることは無い)
+		KD_CHECK(stats.ACMRAfter < stats.ACMRBefore);
+		KD_CHECK(stats.ACMRAfter < 1.0f);
+
+		float acmr, atvr;
+		KdMeasureVertexCache(mesh.m_faces, 16, acmr, atvr);
+		KD_CHECK(std::abs(acmr - stats.ACMRAfter) < 1e-5f);
+		KD_CHECK(std::abs(atvr - stats.ATVRAfter) < 1e-5f);
+
+		printf("  ACMR %.3f -> %.3f / ATVR %.3f -> %.3f / vertices %u -> %u\n",
+			stats.ACMRBefore, stats.ACMRAfter, stats.ATVRBefore, stats.ATVRAfter, stats.VertexCountBefore, stats.VertexCountAfter);
+
+		// 同じ入力からは同じ結果になる
+		TestMesh again = original;
+		KD_CHECK(KdOptimizeMesh(again.m_vertices, again.m_faces, again.m_subsets));
+		KD_CHECK(again.m_vertices.size() == mesh.m_vertices.size());
+		KD_CHECK(again.m_faces.size() == mesh.m_faces.size());
+		KD_CHECK(std::memcmp(again.m_faces.data(), mesh.m_faces.data(), mesh.m_faces.size() * sizeof(KdMeshFace)) == 0);
+
+		bool samePositions = true;
+		for (size_t vi = 0; vi < mesh.m_vertices.size(); ++vi)
+		{
+			if (again.m_vertices[vi].Pos.x != mesh.m_vertices[vi].Pos.x || again.m_vertices[vi].Pos.z != mesh.m_vertices[vi].Pos.z) { samePositions = false; }
+		}
+		KD_CHECK(samePositions);
+
+		// 最適化済みのものをもう一度最適化しても悪くならない
+		KdMeshOptimizeStats secondStats;
+		KD_CHECK(KdOptimizeMesh(again.m_vertices, again.m_faces, again.m_subsets, &secondStats));
+		KD_CHECK(secondStats.ACMRAfter <= secondStats.ACMRBefore + 1e-5f);
+	}
+
+	void TestOutOfRange()
+	{
+		TestMesh original = MakeShuffledGrid(4, 1);
+		original.m_faces[3].Idx[1] = (UINT)original.m_vertices.size();
+
+		// 何も書き換えずに false
+		TestMesh mesh = original;
+		KD_CHECK(!KdOptimizeMesh(mesh.m_vertices, mesh.m_faces, mesh.m_subsets));
+		KD_CHECK(mesh.m_vertices.size() == original.m_vertices.size());
+		KD_CHECK(std::memcmp(mesh.m_faces.data(), original.m_faces.data(), original.m_faces.size() * sizeof(KdMeshFace)) == 0);
+	}
+}
+
+int main()
+{
+	TestOptimize();
+	TestOutOfRange();
+
+	return KdTestResult("MeshOptimizeTest");
+}
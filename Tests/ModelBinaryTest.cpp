@@ -0,0 +1,138 @@
+﻿#include "Framework/KdFramework.h"
+#include "KdTest.h"
+
+//====================================================
+//
+// KdModelBinary::Reader のテスト
+//
+// ・ノード3つ (根 → 子 → 孫) とアニメーション1つの .kdm をメモリ上に作る
+// ・正しいものは開けること、ノード番号を1か所ずつ壊したものは開けないことを確かめる
+//   (開けないと KdModelData は glTF から作り直す)
+//
+//====================================================
+
+namespace
+{
+	using namespace KdModelBinary;
+
+	struct TestFile
+	{
+		std::vector<uint8_t>	m_buffer;
+
+		uint64_t				m_nodesOffset		= 0;
+		uint64_t				m_childrenOffset	= 0;
+		uint64_t				m_animNodesOffset	= 0;
+
+		Header& GetHeader() { return *(Header*)m_buffer.data(); }
+		NodeEntry* GetNodes() { return (NodeEntry*)(m_buffer.data() + m_nodesOffset); }
+		int32_t* GetChildren() { return (int32_t*)(m_buffer.data() + m_childrenOffset); }
+		AnimationNodeEntry* GetAnimNodes() { return (AnimationNodeEntry*)(m_buffer.data() + m_animNodesOffset); }
+
+		bool Open() const
+		{
+			Reader reader;
+			return reader.Open(m_buffer.data(), m_buffer.size());
+		}
+	};
+
+	// 各ブロックを16byte境界に置く (書き出しと同じ)
+	uint64_t Append(std::vector<uint8_t>& buffer, size_t size)
+	{
+		buffer.resize((buffer.size() + 15) / 16 * 16);
+		uint64_t offset = buffer.size();
+		buffer.resize(buffer.size() + size);
+		return offset;
+	}
+
+	// 0 ─ 1 ─ 2 の親子と、ノード 1, 2 を動かすアニメーション
+	TestFile MakeTestFile()
+	{
+		constexpr uint32_t kNodeCount = 3;
+
+		TestFile file;
+		Append(file.m_buffer, sizeof(Header));
+		file.m_childrenOffset = Append(file.m_buffer, sizeof(int32_t) * 2);
+		file.m_nodesOffset = Append(file.m_buffer, sizeof(NodeEntry) * kNodeCount);
+		file.m_animNodesOffset = Append(file.m_buffer, sizeof(AnimationNodeEntry) * 2);
+		uint64_t animationsOffset = Append(file.m_buffer, sizeof(AnimationEntry));
+
+		Header& header = file.GetHeader();
+		header = Header();
+		memcpy(header.m_magic, kMagic, sizeof(kMagic));
+		header.m_version = kVersion;
+		header.m_vertexStride = sizeof(KdMeshVertex);
+		header.m_nodes = { file.m_nodesOffset, kNodeCount };
+		header.m_animations = { animationsOffset, 1 };
+
+		int32_t* pChildren = file.GetChildren();
+		pChildren[0] = 1;
+		pChildren[1] = 2;
+
+		NodeEntry* pNodes = file.GetNodes();
+		for (uint32_t i = 0; i < kNodeCount; ++i) { pNodes[i] = NodeEntry(); }
+
+		pNodes[0].m_children = { file.m_childrenOffset, 1 };
+		pNodes[1].m_parent = 0;
+		pNodes[1].m_boneIndex = 0;
+		pNodes[1].m_children = { file.m_childrenOffset + sizeof(int32_t), 1 };
+		pNodes[2].m_parent = 1;
+		pNodes[2].m_boneIndex = 1;
+
+		AnimationNodeEntry* pAnimNodes = file.GetAnimNodes();
+		pAnimNodes[0] = AnimationNodeEntry();
+		pAnimNodes[0].m_nodeOffset = 1;
+		pAnimNodes[1] = AnimationNodeEntry();
+		pAnimNodes[1].m_nodeOffset = 2;
+
+		AnimationEntry& animation = *(AnimationEntry*)(file.m_buffer.data() + animationsOffset);
+		animation = AnimationEntry();
+		animation.m_nodes = { file.m_animNodesOffset, 2 };
+
+		return file;
+	}
+
+	// 1か所だけ壊したファイルが開けないこと
+	template<class Corrupt>
+	void CheckRejected(const char* name, Corrupt corrupt)
+	{
+		TestFile file = MakeTestFile();
+		corrupt(file);
+
+		bool opened = file.Open();
+		if (opened) { printf("  not rejected: %s\n", name); }
+		KD_CHECK(!opened);
+	}
+}
+
+int main()
+{
+	KD_CHECK(MakeTestFile().Open());
+
+	// 親
+	CheckRejected("parent out of range", [](TestFile& f) { f.GetNodes()[2].m_parent = 3; });
+	CheckRejected("parent negative", [](TestFile& f) { f.GetNodes()[2].m_parent = -2; });
+
+	// 子
+	CheckRejected("child out of range", [](TestFile& f) { f.GetChildren()[1] = 100000; });
+	CheckRejected("child negative", [](TestFile& f) { f.GetChildren()[1] = -1; });
+	CheckRejected("child is self", [](TestFile& f) { f.GetChildren()[1] = 1; });
+	CheckRejected("child has another parent", [](TestFile& f) { f.GetChildren()[0] = 2; });
+
+	// 親子の循環 (0 → 1 → 2 → 0)
+	CheckRejected("cycle", [](TestFile& f)
+	{
+		NodeEntry* pNodes = f.GetNodes();
+		pNodes[0].m_parent = 2;
+		pNodes[2].m_children = { f.m_childrenOffset + sizeof(int32_t) * 2, 0 };
+	});
+
+	// ボーン
+	CheckRejected("bone out of range", [](TestFile& f) { f.GetNodes()[1].m_boneIndex = 0x7fffffff; });
+	CheckRejected("bone negative", [](TestFile& f) { f.GetNodes()[1].m_boneIndex = -5; });
+
+	// アニメーション
+	CheckRejected("anim node out of range", [](TestFile& f) { f.GetAnimNodes()[1].m_nodeOffset = 3; });
+	CheckRejected("anim node negative", [](TestFile& f) { f.GetAnimNodes()[0].m_nodeOffset = -1; });
+
+	return KdTestResult("ModelBinaryTest");
+}
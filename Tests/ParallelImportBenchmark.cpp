@@ -0,0 +1,278 @@
+﻿#include "Framework/KdFramework.h"
+
+//====================================================
+//
+// glTF 読み込みの並列化のベンチマーク
+//
+// ・KdLoadGLTFModel のメッシュ段階と同じ形 (プリミティブごとに頂点を取り出し、ノードごとに合成・最適化) を
+//   大きなモデル相当の量で、1スレッドと KdParallel で実行して時間を比べる
+// ・tinygltf と Direct3D が無くても動くように、取り出し元はメモリ上の配列で代用する
+// ・並列で実行した結果が1スレッドの結果と同じであることも確かめる
+//
+// 使い方 : ParallelImportBenchmark [ノード数] [プリミティブの分割数] [繰り返し回数]
+//
+//====================================================
+
+namespace
+{
+	// glTF のバッファ相当 (位置・UV・法線が別々の配列、インデックスは16bit)
+	struct SourcePrimitive
+	{
+		std::vector<float>		m_positions;
+		std::vector<float>		m_uvs;
+		std::vector<float>		m_normals;
+		std::vector<uint16_t>	m_indices;
+		UINT					m_materialNo = 0;
+	};
+
+	struct SourceNode
+	{
+		std::vector<SourcePrimitive> m_primitives;
+	};
+
+	struct DecodedPrimitive
+	{
+		std::vector<KdMeshVertex>	m_vertices;
+		std::vector<KdMeshFace>		m_faces;
+		UINT						m_materialNo = 0;
+	};
+
+	struct DecodedNode
+	{
+		std::vector<KdMeshVertex>	m_vertices;
+		std::vector<KdMeshFace>		m_faces;
+		std::vector<KdMeshSubset>	m_subsets;
+	};
+
+	// 面ごとに頂点を持つ格子 (書き出しツールがハードエッジで頂点を分けた時と同じく、結合できる頂点が多い)
+	SourcePrimitive MakeGrid(UINT division, float offset, UINT materialNo)
+	{
+		SourcePrimitive prim;
+		prim.m_materialNo = materialNo;
+
+		auto addVertex = [&](UINT x, UINT z)
+		{
+			prim.m_positions.insert(prim.m_positions.end(), { (float)x + offset, std::sin((float)(x + z) * 0.1f), (float)z });
+			prim.m_uvs.insert(prim.m_uvs.end(), { (float)x / division, (float)z / division });
+			prim.m_normals.insert(prim.m_normals.end(), { 0.0f, 1.0f, 0.0f });
+			prim.m_indices.push_back((uint16_t)(prim.m_indices.size()));
+		};
+
+		for (UINT z = 0; z < division; ++z)
+		{
+			for (UINT x = 0; x < division; ++x)
+			{
+				addVertex(x, z);		addVertex(x, z + 1);		addVertex(x + 1, z);
+				addVertex(x + 1, z);	addVertex(x, z + 1);		addVertex(x + 1, z + 1);
+			}
+		}
+		return prim;
+	}
+
+	void DecodePrimitive(const SourcePrimitive& src, DecodedPrimitive& dst)
+	{
+		size_t vertexCount = src.m_positions.size() / 3;
+		dst.m_materialNo = src.m_materialNo;
+		dst.m_vertices.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			KdMeshVertex& v = dst.m_vertices[i];
+			// 右手系から左手系へ (Z を反転)
+			v.Pos = { src.m_positions[i * 3 + 0], src.m_positions[i * 3 + 1], -src.m_positions[i * 3 + 2] };
+			v.UV = { src.m_uvs[i * 2 + 0], src.m_uvs[i * 2 + 1] };
+			v.Normal = { src.m_normals[i * 3 + 0], src.m_normals[i * 3 + 1], -src.m_normals[i * 3 + 2] };
+			v.Tangent = { 1.0f, 0.0f, 0.0f };
+			v.SkinIndexList = {};
+			v.SkinWeightList = {};
+		}
+
+		dst.m_faces.resize(src.m_indices.size() / 3);
+		for (size_t fi = 0; fi < dst.m_faces.size(); ++fi)
+		{
+			// 反転するため 0, 2, 1 の順番にする
+			dst.m_faces[fi].Idx[0] = src.m_indices[fi * 3 + 0];
+			dst.m_faces[fi].Idx[1] = src.m_indices[fi * 3 + 2];
+			dst.m_faces[fi].Idx[2] = src.m_indices[fi * 3 + 1];
+		}
+	}
+
+	void MergePrimitives(const std::vector<DecodedPrimitive>& prims, DecodedNode& dst)
+	{
+		UINT vertexStart = 0;
+		for (const DecodedPrimitive& prim : prims)
+		{
+			KdMeshSubset& subset = dst.m_subsets.emplace_back();
+			subset.MaterialNo = prim.m_materialNo;
+			subset.FaceStart = (UINT)dst.m_faces.size();
+			subset.FaceCount = (UINT)prim.m_faces.size();
+
+			dst.m_vertices.insert(dst.m_vertices.end(), prim.m_vertices.begin(), prim.m_vertices.end());
+			for (const KdMeshFace& face : prim.m_faces)
+			{
+				dst.m_faces.push_back({ face.Idx[0] + vertexStart, face.Idx[1] + vertexStart, face.Idx[2] + vertexStart });
+			}
+			vertexStart += (UINT)prim.m_vertices.size();
+		}
+
+		KdOptimizeMesh(dst.m_vertices, dst.m_faces, dst.m_subsets);
+	}
+
+	// KdLoadGLTFModel のメッシュ段階と同じく、プリミティブごと・ノードごとの2回に分けて For を回す
+	std::vector<DecodedNode> Import(const std::vector<SourceNode>& nodes)
+	{
+		std::vector<std::vector<DecodedPrimitive>> tempPrimitives(nodes.size());
+		std::vector<std::pair<UINT, UINT>> primitiveJobs;
+		for (UINT nodei = 0; nodei < nodes.size(); ++nodei)
+		{
+			tempPrimitives[nodei].resize(nodes[nodei].m_primitives.size());
+			for (UINT pri = 0; pri < nodes[nodei].m_primitives.size(); ++pri) { primitiveJobs.push_back({ nodei, pri }); }
+		}
+
+		KdParallel::Instance().For(primitiveJobs.size(), [&](size_t jobi)
+		{
+			auto [nodei, pri] = primitiveJobs[jobi];
+			DecodePrimitive(nodes[nodei].m_primitives[pri], tempPrimitives[nodei][pri]);
+		});
+
+		std::vector<DecodedNode> result(nodes.size());
+		KdParallel::Instance().For(nodes.size(), [&](size_t nodei)
+		{
+			MergePrimitives(tempPrimitives[nodei], result[nodei]);
+		});
+		return result;
+	}
+
+	bool IsSame(const std::vector<DecodedNode>& a, const std::vector<DecodedNode>& b)
+	{
+		if (a.size() != b.size()) { return false; }
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (a[i].m_vertices.size() != b[i].m_vertices.size() || a[i].m_faces.size() != b[i].m_faces.size()) { return false; }
+			if (memcmp(a[i].m_vertices.data(), b[i].m_vertices.data(), a[i].m_vertices.size() * sizeof(KdMeshVertex)) != 0) { return false; }
+			if (memcmp(a[i].m_faces.data(), b[i].m_faces.data(), a[i].m_faces.size() * sizeof(KdMeshFace)) != 0) { return false; }
+		}
+		return true;
+	}
+
+	// Engine の ThreadManager の代わりの単純なスレッドプール
+	class WorkerPool
+	{
+	public:
+
+		explicit WorkerPool(int workerCount)
+		{
+			for (int i = 0; i < workerCount; ++i)
+			{
+				m_threads.emplace_back([this]() { Run(); });
+			}
+		}
+
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_isQuit = true;
+			}
+			m_condition.notify_all();
+			for (std::thread& thread : m_threads) { thread.join(); }
+		}
+
+		void Push(std::function<void()> job)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_jobs.push_back(std::move(job));
+			}
+			m_condition.notify_one();
+		}
+
+	private:
+
+		void Run()
+		{
+			while (true)
+			{
+				std::function<void()> job;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_condition.wait(lock, [this]() { return m_isQuit || !m_jobs.empty(); });
+					if (m_jobs.empty()) { return; }
+
+					job = std::move(m_jobs.front());
+					m_jobs.erase(m_jobs.begin());
+				}
+				job();
+			}
+		}
+
+		std::vector<std::thread>			m_threads;
+		std::vector<std::function<void()>>	m_jobs;
+		std::mutex							m_mutex;
+		std::condition_variable				m_condition;
+		bool								m_isQuit = false;
+	};
+
+	// 繰り返した中で一番速かった時間 (ms)
+	double Measure(const std::vector<SourceNode>& nodes, int repeat, std::vector<DecodedNode>& outResult)
+	{
+		double best = 0.0;
+		for (int i = 0; i < repeat; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			outResult = Import(nodes);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (i == 0 || ms < best) { best = ms; }
+		}
+		return best;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	UINT nodeCount = argc > 1 ? (UINT)std::atoi(argv[1]) : 200;
+	UINT division = argc > 2 ? (UINT)std::atoi(argv[2]) : 40;
+	int repeat = argc > 3 ? std::max(1, std::atoi(argv[3])) : 3;
+
+	// 65536 頂点を超えると 16bit のインデックスに入らない
+	division = std::clamp(division, 1u, 104u);
+
+	// 大きなモデル相当 (ノードごとにマテリアル違いのプリミティブが3つ)
+	std::vector<SourceNode> nodes(nodeCount);
+	for (UINT nodei = 0; nodei < nodeCount; ++nodei)
+	{
+		for (UINT mat = 0; mat < 3; ++mat)
+		{
+			nodes[nodei].m_primitives.push_back(MakeGrid(division, (float)(nodei * division), mat));
+		}
+	}
+
+	size_t faceCount = (size_t)nodeCount * 3 * division * division * 2;
+	printf("nodes %u / primitives %u / faces %zu\n", nodeCount, nodeCount * 3, faceCount);
+
+	// 1スレッド (Dispatcher 未登録)
+	std::vector<DecodedNode> serialResult;
+	double serialMs = Measure(nodes, repeat, serialResult);
+	printf("serial   : %8.1f ms\n", serialMs);
+
+	// ワーカースレッド + 呼び出し元
+	int workerCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	std::vector<DecodedNode> parallelResult;
+	double parallelMs = 0.0;
+	{
+		WorkerPool pool(workerCount);
+		KdParallel::Instance().SetDispatcher([&pool](std::function<void()> job) { pool.Push(std::move(job)); }, workerCount);
+
+		parallelMs = Measure(nodes, repeat, parallelResult);
+
+		KdParallel::Instance().SetDispatcher(nullptr, 0);
+	}
+	printf("parallel : %8.1f ms (%d workers + caller) x%.2f\n", parallelMs, workerCount, parallelMs > 0.0 ? serialMs / parallelMs : 0.0);
+
+	if (!IsSame(serialResult, parallelResult))
+	{
+		printf("FAILED: parallel result differs from serial result\n");
+		return 1;
+	}
+	printf("results match\n");
+	return 0;
+}
@@ -0,0 +1,138 @@
+﻿#pragma once
+
+//====================================================
+//
+// テスト用の KdFramework.h
+//
+// ・Windows / Direct3D の無い環境で、CPU だけで動く Framework のソースをビルドするための代わり
+// ・Math は DirectX::SimpleMath のうち、対象のソースが使うものだけを用意する
+// ・Direct3D の型は宣言だけ (中身を使うソースはビルドしない)
+//
+//====================================================
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using UINT = unsigned int;
+
+//====================================================
+// Math (DirectX::SimpleMath の一部)
+//====================================================
+namespace DirectX
+{
+	namespace SimpleMath
+	{
+		struct Vector2
+		{
+			float x = 0.0f, y = 0.0f;
+
+			Vector2() {}
+			Vector2(float _x, float _y) : x(_x), y(_y) {}
+		};
+
+		struct Vector3
+		{
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+
+			Vector3() {}
+			Vector3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+
+			Vector3 operator+(const Vector3& v) const { return { x + v.x, y + v.y, z + v.z }; }
+			Vector3 operator-(const Vector3& v) const { return { x - v.x, y - v.y, z - v.z }; }
+			Vector3 operator*(float s) const { return { x * s, y * s, z * s }; }
+			Vector3 operator/(float s) const { return { x / s, y / s, z / s }; }
+			Vector3& operator+=(const Vector3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+			Vector3& operator-=(const Vector3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+			Vector3& operator*=(float s) { x *= s; y *= s; z *= s; return *this; }
+			Vector3& operator/=(float s) { x /= s; y /= s; z /= s; return *this; }
+
+			float Dot(const Vector3& v) const { return x * v.x + y * v.y + z * v.z; }
+			Vector3 Cross(const Vector3& v) const { return { y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x }; }
+			float Length() const { return std::sqrt(Dot(*this)); }
+			float LengthSquared() const { return Dot(*this); }
+
+			// XMVector3Normalize と同じく、長さ 0 の時はそのまま
+			void Normalize()
+			{
+				float length = Length();
+				if (length > 0.0f) { *this /= length; }
+			}
+		};
+
+		struct Vector4
+		{
+			float x = 0.0f, y = 0.0f, z = 0.0f, w = 0.0f;
+		};
+
+		// 中身は使わない (KdModelBinary のノード表の大きさを合わせるため)
+		struct Matrix
+		{
+			float m[4][4] = {};
+		};
+	}
+
+	struct BoundingBox {};
+	struct BoundingSphere {};
+}
+namespace Math = DirectX::SimpleMath;
+
+//====================================================
+// Direct3D (入力レイアウトの表だけ作れるように)
+//====================================================
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN,
+	DXGI_FORMAT_R32G32B32_FLOAT,
+	DXGI_FORMAT_R32G32_FLOAT,
+	DXGI_FORMAT_R16G16_FLOAT,
+	DXGI_FORMAT_R16G16_SNORM,
+	DXGI_FORMAT_R8G8B8A8_UNORM,
+};
+
+enum D3D11_INPUT_CLASSIFICATION
+{
+	D3D11_INPUT_PER_VERTEX_DATA,
+	D3D11_INPUT_PER_INSTANCE_DATA,
+};
+
+struct D3D11_INPUT_ELEMENT_DESC
+{
+	const char*					SemanticName;
+	UINT						SemanticIndex;
+	DXGI_FORMAT					Format;
+	UINT						InputSlot;
+	UINT						AlignedByteOffset;
+	D3D11_INPUT_CLASSIFICATION	InputSlotClass;
+	UINT						InstanceDataStepRate;
+};
+
+// KdMesh.h のメンバーの型
+class KdBuffer
+{
+public:
+	void Release() {}
+};
+
+//====================================================
+// テスト対象のヘッダー
+//====================================================
+#include "Utility/KdParallel.h"
+#include "Direct3D/KdMesh.h"
+#include "Direct3D/KdVertexCompression.h"
+#include "Direct3D/KdMeshOptimize.h"
+#include "Direct3D/KdModelBinary.h"
@@ -0,0 +1,231 @@
+﻿#include "Framework/KdFramework.h"
+#include "KdTest.h"
+
+#include <cstddef>
+
+//====================================================
+//
+// KdVertexCompression のテスト
+//
+// ・圧縮した頂点を CPU で戻して、誤差が許容範囲に収まることを確かめる
+// ・戻し方はシェーダ (inc_KdStandardShader.hlsli の DecodeOctahedral、R16G16_FLOAT の読み込み) と同じ
+//
+//====================================================
+
+namespace
+{
+	// 球面上にほぼ均等に並べた方向 (フィボナッチ球面)
+	std::vector<Math::Vector3> MakeDirections(int count)
+	{
+		std::vector<Math::Vector3> dirs;
+		const float goldenAngle = 2.39996323f;
+		for (int i = 0; i < count; ++i)
+		{
+			float z = 1.0f - 2.0f * (i + 0.5f) / count;
+			float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+			dirs.emplace_back(r * std::cos(goldenAngle * i), r * std::sin(goldenAngle * i), z);
+		}
+
+		// 軸の向きと、八面体の折り返しの境目
+		dirs.emplace_back(1.0f, 0.0f, 0.0f);	dirs.emplace_back(-1.0f, 0.0f, 0.0f);
+		dirs.emplace_back(0.0f, 1.0f, 0.0f);	dirs.emplace_back(0.0f, -1.0f, 0.0f);
+		dirs.emplace_back(0.0f, 0.0f, 1.0f);	dirs.emplace_back(0.0f, 0.0f, -1.0f);
+		dirs.emplace_back(0.7071068f, 0.0f, -0.7071068f);
+		dirs.emplace_back(-0.5773503f, -0.5773503f, -0.5773503f);
+		return dirs;
+	}
+
+	// 2つの方向の間の角度 (度)
+	// ・1 に近い内積から acos で求めると float の精度が足りないので、外積の長さも使う
+	double AngleDegrees(const Math::Vector3& a, const Math::Vector3& b)
+	{
+		return std::atan2((double)a.Cross(b).Length(), (double)a.Dot(b)) * 180.0 / 3.141592653589793;
+	}
+
+	void TestOctahedral()
+	{
+		// 16bit x 2 なら 0.01 度以内に戻る
+		double worstAngle = 0.0;
+		for (const Math::Vector3& dir : MakeDirections(20000))
+		{
+			Math::Vector3 decoded = KdVertexCompression::DecodeOctahedral(KdVertexCompression::EncodeOctahedral(dir));
+
+			KD_CHECK(std::abs(decoded.Length() - 1.0f) < 1e-5f);
+			worstAngle = std::max(worstAngle, AngleDegrees(decoded, dir));
+		}
+		KD_CHECK(worstAngle < 0.01);
+		printf("  octahedral: worst error %.5f deg\n", worstAngle);
+
+		// 長さは関係ない
+		Math::Vector3 scaled = KdVertexCompression::DecodeOctahedral(KdVertexCompression::EncodeOctahedral({ 0.0f, 10.0f, 0.0f }));
+		KD_CHECK(scaled.y > 0.9999f);
+
+		// 長さ 0 は +Z
+		Math::Vector3 zero = KdVertexCompression::DecodeOctahedral(KdVertexCompression::EncodeOctahedral({ 0.0f, 0.0f, 0.0f }));
+		KD_CHECK(zero.z > 0.9999f);
+	}
+
+	void TestHalf()
+	{
+		using KdVertexCompression::FloatToHalf;
+		using KdVertexCompression::HalfToFloat;
+
+		// 半精度でちょうど表せる値
+		for (float value : { 0.0f, 1.0f, -1.0f, 0.5f, 0.25f, 2.0f, -1024.0f, 65504.0f, 6.103515625e-05f })
+		{
+			KD_CHECK(HalfToFloat(FloatToHalf(value)) == value);
+		}
+		KD_CHECK(FloatToHalf(1.0f) == 0x3C00);
+		KD_CHECK(FloatToHalf(-2.0f) == 0xC000);
+
+		// 非正規化数・範囲外
+		KD_CHECK(HalfToFloat(0x0001) == 5.9604644775390625e-08f);
+		KD_CHECK(FloatToHalf(1e-10f) == 0x0000);
+		KD_CHECK(FloatToHalf(1e6f) == 0x7C00);
+		KD_CHECK(FloatToHalf(-1e6f) == 0xFC00);
+		KD_CHECK(std::isinf(HalfToFloat(FloatToHalf(INFINITY))));
+		KD_CHECK(std::isnan(HalfToFloat(FloatToHalf(NAN))));
+
+		// 最近接偶数丸め (1 と 1 + 2^-10 の中間は 1 に、その次の中間は上に丸める)
+		KD_CHECK(FloatToHalf(1.0f + 1.0f / 2048.0f) == 0x3C00);
+		KD_CHECK(FloatToHalf(1.0f + 3.0f / 2048.0f) == 0x3C02);
+
+		// UV の範囲 (0〜1) の相対誤差は 2^-11 以下
+		for (int i = 1; i <= 4096; ++i)
+		{
+			float value = i / 4096.0f;
+			KD_CHECK(std::abs(HalfToFloat(FloatToHalf(value)) - value) <= value / 2048.0f);
+		}
+	}
+
+	KdMeshVertex MakeVertex(const Math::Vector3& pos, const Math::Vector2& uv, const Math::Vector3& normal, const Math::Vector3& tangent)
+	{
+		KdMeshVertex v;
+		v.Pos = pos;
+		v.UV = uv;
+		v.Color = 0x80FF4020;
+		v.Normal = normal;
+		v.Tangent = tangent;
+		v.SkinIndexList = { 1, 2, 3, 4 };
+		v.SkinWeightList = { 0.4f, 0.3f, 0.2f, 0.1f };
+		return v;
+	}
+
+	// 圧縮したバッファの i 番目の頂点を取り出す
+	template<class PackedVertex>
+	PackedVertex ReadVertex(const std::vector<uint8_t>& data, size_t i)
+	{
+		PackedVertex v;
+		memcpy(&v, data.data() + i * sizeof(PackedVertex), sizeof(PackedVertex));
+		return v;
+	}
+
+	template<class PackedVertex>
+	void CheckCommon(const KdMeshVertex& src, const PackedVertex& dst)
+	{
+		KD_CHECK(memcmp(&src.Pos, &dst.Pos, sizeof(src.Pos)) == 0);
+		KD_CHECK(dst.Color == src.Color);
+		KD_CHECK(KdVertexCompression::DecodeOctahedral(dst.Normal).Dot(src.Normal) > 0.99999f);
+		KD_CHECK(KdVertexCompression::DecodeOctahedral(dst.Tangent).Dot(src.Tangent) > 0.99999f);
+	}
+
+	void TestEncode()
+	{
+		// 入力レイアウトと頂点の構造体のずれ
+		KD_CHECK(sizeof(KdMeshVertex) == 72);
+		KD_CHECK(sizeof(KdPackedMeshVertex) == 32);
+		KD_CHECK(sizeof(KdPackedMeshVertexHalfUV) == 28);
+
+		struct LayoutInfo { KdVertexLayout m_layout; std::vector<UINT> m_offsets; };
+		const LayoutInfo layouts[] = {
+			{ KdVertexLayout::Full, { offsetof(KdMeshVertex, Pos), offsetof(KdMeshVertex, UV), offsetof(KdMeshVertex, Color), offsetof(KdMeshVertex, Normal), offsetof(KdMeshVertex, Tangent) } },
+			{ KdVertexLayout::Packed, { offsetof(KdPackedMeshVertex, Pos), offsetof(KdPackedMeshVertex, UV), offsetof(KdPackedMeshVertex, Color), offsetof(KdPackedMeshVertex, Normal), offsetof(KdPackedMeshVertex, Tangent) } },
+			{ KdVertexLayout::PackedHalfUV, { offsetof(KdPackedMeshVertexHalfUV, Pos), offsetof(KdPackedMeshVertexHalfUV, UV), offsetof(KdPackedMeshVertexHalfUV, Color), offsetof(KdPackedMeshVertexHalfUV, Normal), offsetof(KdPackedMeshVertexHalfUV, Tangent) } },
+		};
+		for (const LayoutInfo& info : layouts)
+		{
+			const std::vector<D3D11_INPUT_ELEMENT_DESC>& elements = KdVertexCompression::GetInputElements(info.m_layout);
+			KD_CHECK(elements.size() == info.m_offsets.size());
+			for (size_t i = 0; i < std::min(elements.size(), info.m_offsets.size()); ++i)
+			{
+				KD_CHECK(elements[i].InputSlot == 0);
+				KD_CHECK(elements[i].AlignedByteOffset == info.m_offsets[i]);
+			}
+		}
+
+		std::vector<KdMeshVertex> vertices;
+		for (const Math::Vector3& dir : MakeDirections(64))
+		{
+			Math::Vector3 tangent = dir.Cross({ 0.0f, 1.0f, 0.0f });
+			if (tangent.Length() < 0.01f) { tangent = { 1.0f, 0.0f, 0.0f }; }
+			tangent.Normalize();
+
+			// UV は 1024px のテクスチャのテクセル単位 (半精度で十分)
+			float u = (float)(vertices.size() % 32) / 1024.0f;
+			vertices.push_back(MakeVertex(dir * 3.0f, { u, 1.0f - u }, dir, tangent));
+		}
+
+		// Full はそのまま
+		{
+			KdVertexLayout layout = KdVertexLayout::Full;
+			std::vector<uint8_t> data;
+			KD_CHECK(KdVertexCompression::Encode(vertices.data(), (UINT)vertices.size(), layout, data) == sizeof(KdMeshVertex));
+			KD_CHECK(layout == KdVertexLayout::Full);
+			KD_CHECK(data.size() == vertices.size() * sizeof(KdMeshVertex));
+			KD_CHECK(memcmp(data.data(), vertices.data(), data.size()) == 0);
+		}
+
+		// Auto は UV の誤差が小さければ PackedHalfUV
+		{
+			KdVertexLayout layout = KdVertexLayout::Auto;
+			std::vector<uint8_t> data;
+			KD_CHECK(KdVertexCompression::Encode(vertices.data(), (UINT)vertices.size(), layout, data) == sizeof(KdPackedMeshVertexHalfUV));
+			KD_CHECK(layout == KdVertexLayout::PackedHalfUV);
+			KD_CHECK(data.size() == vertices.size() * sizeof(KdPackedMeshVertexHalfUV));
+
+			for (size_t i = 0; i < vertices.size() && data.size() == vertices.size() * sizeof(KdPackedMeshVertexHalfUV); ++i)
+			{
+				auto v = ReadVertex<KdPackedMeshVertexHalfUV>(data, i);
+				CheckCommon(vertices[i], v);
+				KD_CHECK(std::abs(KdVertexCompression::HalfToFloat(v.UV[0]) - vertices[i].UV.x) <= KdVertexCompression::kMaxHalfUVError);
+				KD_CHECK(std::abs(KdVertexCompression::HalfToFloat(v.UV[1]) - vertices[i].UV.y) <= KdVertexCompression::kMaxHalfUVError);
+			}
+		}
+
+		// 大きな UV (繰り返しのタイル) があれば Packed
+		{
+			std::vector<KdMeshVertex> tiled = vertices;
+			tiled.back().UV = { 300.123f, -2.5f };
+
+			KdVertexLayout layout = KdVertexLayout::Auto;
+			std::vector<uint8_t> data;
+			KD_CHECK(KdVertexCompression::Encode(tiled.data(), (UINT)tiled.size(), layout, data) == sizeof(KdPackedMeshVertex));
+			KD_CHECK(layout == KdVertexLayout::Packed);
+			KD_CHECK(data.size() == tiled.size() * sizeof(KdPackedMeshVertex));
+
+			for (size_t i = 0; i < tiled.size() && data.size() == tiled.size() * sizeof(KdPackedMeshVertex); ++i)
+			{
+				auto v = ReadVertex<KdPackedMeshVertex>(data, i);
+				CheckCommon(tiled[i], v);
+				KD_CHECK(v.UV.x == tiled[i].UV.x && v.UV.y == tiled[i].UV.y);
+			}
+		}
+
+		// 頂点が無い
+		{
+			KdVertexLayout layout = KdVertexLayout::Auto;
+			std::vector<uint8_t> data = { 1, 2, 3 };
+			KdVertexCompression::Encode(nullptr, 0, layout, data);
+			KD_CHECK(data.empty());
+		}
+	}
+}
+
+int main()
+{
+	TestOctahedral();
+	TestHalf();
+	TestEncode();
+
+	return KdTestResult("VertexCompressionTest");
+}